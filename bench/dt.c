@@ -0,0 +1,583 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+// -----------------------------------------------------------------------------
+// allocation counters, hooked in through dt.h's allocator macros
+
+static size_t bench_allocs   = 0;
+static size_t bench_reallocs = 0;
+static size_t bench_frees    = 0;
+static size_t bench_bytes    = 0;
+
+static void *bench_malloc(size_t size)
+{
+  ++bench_allocs;
+  bench_bytes += size;
+  return malloc(size);
+}
+
+static void *bench_calloc(size_t count, size_t size)
+{
+  ++bench_allocs;
+  bench_bytes += count * size;
+  return calloc(count, size);
+}
+
+static void *bench_realloc(void *ptr, size_t size)
+{
+  if (ptr == NULL)
+  {
+    ++bench_allocs;
+  }
+  else
+  {
+    ++bench_reallocs;
+  }
+  bench_bytes += size;
+  return realloc(ptr, size);
+}
+
+static void bench_free(void *ptr)
+{
+  if (ptr != NULL)
+  {
+    ++bench_frees;
+  }
+  free(ptr);
+}
+
+#define _dt_malloc(_Size) bench_malloc(_Size)
+#define _dt_calloc(_Count, _Size) bench_calloc(_Count, _Size)
+#define _dt_realloc(_BlockPtr, _Size) bench_realloc(_BlockPtr, _Size)
+#define _dt_free(_BlockPtr) bench_free(_BlockPtr)
+
+#define DT_IMPLEMENTATION
+#include "../dt.h"
+
+// -----------------------------------------------------------------------------
+// timing and memory
+
+static double bench_now(void)
+{
+#ifdef _WIN32
+  LARGE_INTEGER freq, count;
+  QueryPerformanceFrequency(&freq);
+  QueryPerformanceCounter(&count);
+  return (double) count.QuadPart / (double) freq.QuadPart;
+#else
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double) ts.tv_sec + (double) ts.tv_nsec * 1e-9;
+#endif
+}
+
+// peak resident set size of the process so far, in bytes
+static size_t bench_peak_rss(void)
+{
+#ifdef _WIN32
+  PROCESS_MEMORY_COUNTERS pmc;
+  GetProcessMemoryInfo(GetCurrentProcess(), &pmc, sizeof(pmc));
+  return (size_t) pmc.PeakWorkingSetSize;
+#else
+  struct rusage ru;
+  getrusage(RUSAGE_SELF, &ru);
+#ifdef __APPLE__
+  return (size_t) ru.ru_maxrss;
+#else
+  return (size_t) ru.ru_maxrss * 1024;
+#endif
+#endif
+}
+
+typedef struct bench_mark_t
+{
+  double time;
+  size_t allocs;
+  size_t reallocs;
+  size_t frees;
+  size_t bytes;
+} bench_mark_t;
+
+static bench_mark_t bench_begin(void)
+{
+  return (bench_mark_t){bench_now(), bench_allocs, bench_reallocs, bench_frees,
+                        bench_bytes};
+}
+
+static bench_mark_t bench_end(bench_mark_t begin)
+{
+  return (bench_mark_t){bench_now() - begin.time,
+                        bench_allocs - begin.allocs,
+                        bench_reallocs - begin.reallocs,
+                        bench_frees - begin.frees, bench_bytes - begin.bytes};
+}
+
+static void bench_header(void)
+{
+  printf("%-8s %10s %-12s %10s %10s %10s %10s %12s %10s\n", "corpus", "size",
+         "op", "MB/s", "ms/iter", "allocs", "reallocs", "alloc_bytes",
+         "peak_rss");
+}
+
+// prints one row; mark values are totals over `iters` iterations
+static void bench_report(const char *corpus, size_t size, const char *op,
+                         size_t bytes, size_t iters, bench_mark_t m)
+{
+  double secs = m.time > 0 ? m.time : 1e-9;
+  double mbps = bytes ? ((double) bytes * iters) / (1024.0 * 1024.0) / secs
+                      : 0.0;
+  printf("%-8s %10zu %-12s %10.2f %10.3f %10zu %10zu %12zu %9zuK\n", corpus,
+         size, op, mbps, secs * 1000.0 / iters, m.allocs / iters,
+         m.reallocs / iters, m.bytes / iters, bench_peak_rss() / 1024);
+}
+
+// -----------------------------------------------------------------------------
+// deterministic corpus generation
+
+static uint64_t bench_rng = 0x9E3779B97F4A7C15ull;
+
+static uint32_t bench_rand(void)
+{
+  // xorshift64*
+  bench_rng ^= bench_rng >> 12;
+  bench_rng ^= bench_rng << 25;
+  bench_rng ^= bench_rng >> 27;
+  return (uint32_t) ((bench_rng * 0x2545F4914F6CDD1Dull) >> 32);
+}
+
+static void bench_appendf(char **text, const char *format, ...)
+{
+  char buffer[512];
+  va_list args;
+  va_start(args, format);
+  int len = vsnprintf(buffer, sizeof(buffer), format, args);
+  va_end(args);
+  if (len > 0)
+  {
+    size_t n  = len < (int) sizeof(buffer) ? (size_t) len : sizeof(buffer) - 1;
+    char *ptr = dt_arraddnptr(*text, n);
+    memcpy(ptr, buffer, n);
+  }
+}
+
+static const char *bench_words[] = {
+  "alpha", "bravo", "charlie", "delta", "echo",   "foxtrot", "golf",  "hotel",
+  "india", "juliet", "kilo",   "lima",  "mike",   "november", "oscar", "papa",
+};
+#define BENCH_WORD() bench_words[bench_rand() % 16]
+
+// small service configs in native dt syntax: bare keys, no commas
+static void bench_gen_config(char **text, size_t target)
+{
+  dt_arraddcstr(*text, "{\n");
+  for (size_t i = 0; dt_arrlenu(*text) < target; ++i)
+  {
+    bench_appendf(text,
+                  "  service_%zu: {\n"
+                  "    name: %s_%zu\n"
+                  "    port: %u\n"
+                  "    enabled: %s\n"
+                  "    ratio: %u.%02u\n"
+                  "    owner: null\n"
+                  "    tags: [%s %s %s] // inline comment\n"
+                  "  }\n",
+                  i, BENCH_WORD(), i, 1024 + bench_rand() % 60000,
+                  bench_rand() & 1 ? "true" : "false", bench_rand() % 10,
+                  bench_rand() % 100, BENCH_WORD(), BENCH_WORD(),
+                  BENCH_WORD());
+  }
+  dt_arraddcstr(*text, "}\n");
+}
+
+// chains of nested maps and arrays
+static void bench_gen_deep(char **text, size_t target)
+{
+  const size_t depth = 48;
+  dt_arraddcstr(*text, "[\n");
+  while (dt_arrlenu(*text) < target)
+  {
+    for (size_t d = 0; d < depth; ++d)
+    {
+      dt_arraddcstr(*text, d & 1 ? "[ " : "{ \"n\": ");
+    }
+    bench_appendf(text, "%u", bench_rand());
+    for (size_t d = depth; d-- > 0;)
+    {
+      dt_arraddcstr(*text, d & 1 ? " ]" : " }");
+    }
+    dt_arraddcstr(*text, ",\n");
+  }
+  dt_arraddcstr(*text, "]\n");
+}
+
+// one flat map with many keys
+static void bench_gen_wide(char **text, size_t target)
+{
+  dt_arraddcstr(*text, "{\n");
+  for (size_t i = 0; dt_arrlenu(*text) < target; ++i)
+  {
+    bench_appendf(text, "  \"%s_%zu\": %u,\n", BENCH_WORD(), i, bench_rand());
+  }
+  dt_arraddcstr(*text, "}\n");
+}
+
+// flat arrays of mixed ints and floats
+static void bench_gen_numeric(char **text, size_t target)
+{
+  dt_arraddcstr(*text, "[\n");
+  while (dt_arrlenu(*text) < target)
+  {
+    for (int i = 0; i < 8; ++i)
+    {
+      uint32_t r = bench_rand();
+      if (r & 1)
+      {
+        bench_appendf(text, " %d,", (int) (r >> 1) - (1 << 30));
+      }
+      else
+      {
+        bench_appendf(text, " %.6f,", (double) r / 65536.0 - 32768.0);
+      }
+    }
+    dt_arraddcstr(*text, "\n");
+  }
+  dt_arraddcstr(*text, "]\n");
+}
+
+// log records dominated by quoted strings with escapes
+static void bench_gen_logs(char **text, size_t target)
+{
+  static const char *levels[] = {"debug", "info", "warn", "error"};
+  dt_arraddcstr(*text, "[\n");
+  for (size_t i = 0; dt_arrlenu(*text) < target; ++i)
+  {
+    bench_appendf(text,
+                  "  { \"ts\": %zu, \"level\": \"%s\", \"msg\": \"user %u "
+                  "(%s %s) requested \\\"/%s/%s/%u\\\" from 10.%u.%u.%u\\n"
+                  "\\tstatus=%u bytes=%u\" },\n",
+                  1700000000 + i, levels[bench_rand() % 4], bench_rand(),
+                  BENCH_WORD(), BENCH_WORD(), BENCH_WORD(), BENCH_WORD(),
+                  bench_rand() % 1000, bench_rand() % 256, bench_rand() % 256,
+                  bench_rand() % 256, 200 + bench_rand() % 400,
+                  bench_rand() % 65536);
+  }
+  dt_arraddcstr(*text, "]\n");
+}
+
+typedef struct bench_corpus_t
+{
+  const char *name;
+  void (*generate)(char **text, size_t target);
+} bench_corpus_t;
+
+static const bench_corpus_t bench_corpora[] = {
+  {"config", bench_gen_config}, {"deep", bench_gen_deep},
+  {"wide", bench_gen_wide},     {"numeric", bench_gen_numeric},
+  {"logs", bench_gen_logs},
+};
+
+static char *bench_generate(const bench_corpus_t *corpus, size_t target)
+{
+  char *text = NULL;
+  bench_rng  = 0x9E3779B97F4A7C15ull ^ target;
+  corpus->generate(&text, target);
+  dt_arrput(text, '\0');
+  return text;
+}
+
+// -----------------------------------------------------------------------------
+// benchmarks
+
+// repeat an operation until it has processed at least this many bytes
+#define BENCH_MIN_BYTES (32u << 20)
+
+static size_t bench_iters(size_t size)
+{
+  size_t iters = BENCH_MIN_BYTES / (size ? size : 1);
+  return iters < 1 ? 1 : iters > 1000 ? 1000 : iters;
+}
+
+static void bench_accum(bench_mark_t *total, bench_mark_t m)
+{
+  total->time += m.time;
+  total->allocs += m.allocs;
+  total->reallocs += m.reallocs;
+  total->frees += m.frees;
+  total->bytes += m.bytes;
+}
+
+static void bench_serialize(const bench_corpus_t *corpus, size_t target)
+{
+  char *text     = bench_generate(corpus, target);
+  size_t textlen = dt_arrlenu(text) - 1;
+  size_t iters   = bench_iters(textlen);
+  bench_mark_t load = {0}, dump = {0}, release = {0}, m;
+  dt_node *node = NULL;
+
+  // text load and free, timed separately
+  for (size_t i = 0; i < iters; ++i)
+  {
+    m    = bench_begin();
+    node = dt_loads(text);
+    bench_accum(&load, bench_end(m));
+    if (i + 1 < iters)
+    {
+      m = bench_begin();
+      dt_free(node);
+      bench_accum(&release, bench_end(m));
+    }
+  }
+  bench_report(corpus->name, textlen, "loads", textlen, iters, load);
+
+  // text dump
+  char *dumped = NULL;
+  for (size_t i = 0; i < iters; ++i)
+  {
+    _dt_free(dumped);
+    m      = bench_begin();
+    dumped = dt_dumps(node);
+    bench_accum(&dump, bench_end(m));
+  }
+  bench_report(corpus->name, textlen, "dumps", strlen(dumped), iters, dump);
+  _dt_free(dumped);
+
+  // binary dump
+  byte *bytes = NULL;
+  size_t len  = 0;
+  dump        = (bench_mark_t){0};
+  for (size_t i = 0; i < iters; ++i)
+  {
+    dt_arrfree(bytes);
+    m     = bench_begin();
+    bytes = dt_dumpb(node, &len);
+    bench_accum(&dump, bench_end(m));
+  }
+  bench_report(corpus->name, textlen, "dumpb", len, iters, dump);
+
+  // binary load
+  load = (bench_mark_t){0};
+  for (size_t i = 0; i < iters; ++i)
+  {
+    m               = bench_begin();
+    dt_node *bnode = dt_loadb(len, bytes);
+    bench_accum(&load, bench_end(m));
+    dt_free(bnode);
+  }
+  bench_report(corpus->name, textlen, "loadb", len, iters, load);
+  dt_arrfree(bytes);
+
+  m = bench_begin();
+  dt_free(node);
+  bench_accum(&release, bench_end(m));
+  bench_report(corpus->name, textlen, "free", textlen, iters, release);
+
+  dt_arrfree(text);
+}
+
+typedef dt_kvp(char *, size_t) bench_kvp;
+
+// name is "map" for the default swap-delete map, "omap" for DT_MAP_ORDERED
+static void bench_map(size_t count, bool ordered)
+{
+  const char *name = ordered ? "omap" : "map";
+  char **keys = NULL;
+  char buffer[64];
+  for (size_t i = 0; i < count; ++i)
+  {
+    int len = snprintf(buffer, sizeof(buffer), "%s_%zu_%u", BENCH_WORD(), i,
+                       bench_rand() % 1000);
+    char *key = (char *) malloc((size_t) len + 1);
+    memcpy(key, buffer, (size_t) len + 1);
+    dt_arrput(keys, key);
+  }
+  size_t keybytes = 0;
+  for (size_t i = 0; i < count; ++i)
+  {
+    keybytes += strlen(keys[i]);
+  }
+
+  bench_kvp *map = NULL;
+  bench_mark_t m;
+  size_t checksum = 0;
+  if (ordered)
+  {
+    dt_smpinit(map, DT_SMP_DEFAULT | DT_MAP_ORDERED, NULL);
+  }
+
+  m = bench_begin();
+  for (size_t i = 0; i < count; ++i)
+  {
+    dt_smpput(map, keys[i], i);
+  }
+  m = bench_end(m);
+  bench_report(name, count, "insert", keybytes, 1, m);
+
+  m = bench_begin();
+  for (size_t i = 0; i < count; ++i)
+  {
+    checksum += dt_smpget(map, keys[i]);
+  }
+  m = bench_end(m);
+  bench_report(name, count, "lookup", keybytes, 1, m);
+
+  // delete every other key, then look up the survivors through tombstones
+  m = bench_begin();
+  for (size_t i = 0; i < count; i += 2)
+  {
+    (void) dt_smpdel(map, keys[i]);
+  }
+  m = bench_end(m);
+  bench_report(name, count, "delete", keybytes / 2, 1, m);
+
+  m = bench_begin();
+  for (size_t i = 1; i < count; i += 2)
+  {
+    checksum += dt_smpget(map, keys[i]);
+  }
+  m = bench_end(m);
+  bench_report(name, count, "lookup_del", keybytes / 2, 1, m);
+
+  // steady delete/reinsert churn; the worst single operation is where a
+  // stop-the-world index rebuild shows up
+  double worst = 0.0;
+  m            = bench_begin();
+  for (size_t i = 1; i < count; i += 2)
+  {
+    double t = bench_now();
+    (void) dt_smpdel(map, keys[i]);
+    dt_smpput(map, keys[i - 1], i - 1);
+    t = bench_now() - t;
+    worst = t > worst ? t : worst;
+  }
+  m = bench_end(m);
+  bench_report(name, count, "churn", keybytes, 1, m);
+  bench_report(name, count, "churn_worst", 0, 1,
+               (bench_mark_t){worst, 0, 0, 0, 0});
+
+  m = bench_begin();
+  dt_smpfree(map);
+  m = bench_end(m);
+  bench_report(name, count, "free", 0, 1, m);
+
+  if (checksum == 0 && count > 2)
+  {
+    fprintf(stderr, "ERROR: map checksum mismatch\n");
+  }
+  for (size_t i = 0; i < count; ++i)
+  {
+    free(keys[i]);
+  }
+  dt_arrfree(keys);
+}
+
+// -----------------------------------------------------------------------------
+
+static int bench_write_corpus(const char *dir, const size_t *sizes,
+                              size_t size_count)
+{
+  char path[1024];
+  for (size_t c = 0; c < sizeof(bench_corpora) / sizeof(*bench_corpora); ++c)
+  {
+    for (size_t s = 0; s < size_count; ++s)
+    {
+      char *text = bench_generate(&bench_corpora[c], sizes[s]);
+      snprintf(path, sizeof(path), "%s/%s_%zuk.json", dir,
+               bench_corpora[c].name, sizes[s] >> 10);
+      FILE *file = fopen(path, "wb");
+      if (file == NULL)
+      {
+        fprintf(stderr, "ERROR: Could not write to file '%s'\n", path);
+        dt_arrfree(text);
+        return 1;
+      }
+      fwrite(text, 1, dt_arrlenu(text) - 1, file);
+      fclose(file);
+      printf("wrote %s\n", path);
+      dt_arrfree(text);
+    }
+  }
+  return 0;
+}
+
+static void bench_usage(const char *exe)
+{
+  printf("usage: %s [--quick] [--corpus NAME] [--no-map] [--write DIR]\n"
+         "  --quick        only run the smallest sizes\n"
+         "  --corpus NAME  only run one corpus (config, deep, wide, numeric, "
+         "logs)\n"
+         "  --no-map       skip the map insert/lookup/delete benchmarks\n"
+         "  --write DIR    write the generated corpus to DIR and exit\n",
+         exe);
+}
+
+int main(int argc, char **argv)
+{
+  static const size_t sizes[]     = {16u << 10, 256u << 10, 4u << 20};
+  static const size_t map_sizes[] = {1000, 64000, 1000000};
+  size_t size_count               = 3;
+  const char *only                = NULL;
+  const char *write_dir           = NULL;
+  bool run_map                    = true;
+
+  for (int i = 1; i < argc; ++i)
+  {
+    if (strcmp(argv[i], "--quick") == 0)
+    {
+      size_count = 1;
+    }
+    else if (strcmp(argv[i], "--corpus") == 0 && i + 1 < argc)
+    {
+      only = argv[++i];
+    }
+    else if (strcmp(argv[i], "--no-map") == 0)
+    {
+      run_map = false;
+    }
+    else if (strcmp(argv[i], "--write") == 0 && i + 1 < argc)
+    {
+      write_dir = argv[++i];
+    }
+    else
+    {
+      bench_usage(argv[0]);
+      return strcmp(argv[i], "--help") == 0 ? 0 : 1;
+    }
+  }
+
+  if (write_dir)
+  {
+    return bench_write_corpus(write_dir, sizes, size_count);
+  }
+
+  bench_header();
+  for (size_t c = 0; c < sizeof(bench_corpora) / sizeof(*bench_corpora); ++c)
+  {
+    if (only && strcmp(only, bench_corpora[c].name) != 0)
+    {
+      continue;
+    }
+    for (size_t s = 0; s < size_count; ++s)
+    {
+      bench_serialize(&bench_corpora[c], sizes[s]);
+    }
+  }
+  if (run_map && !only)
+  {
+    for (size_t s = 0; s < size_count; ++s)
+    {
+      bench_map(map_sizes[s], false);
+      bench_map(map_sizes[s], true);
+    }
+  }
+  return 0;
+}
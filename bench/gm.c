@@ -0,0 +1,821 @@
+#include <float.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+#include "../gm.h"
+
+// -----------------------------------------------------------------------------
+// timing
+
+static double bench_now(void)
+{
+#ifdef _WIN32
+  LARGE_INTEGER freq, count;
+  QueryPerformanceFrequency(&freq);
+  QueryPerformanceCounter(&count);
+  return (double) count.QuadPart / (double) freq.QuadPart;
+#else
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double) ts.tv_sec + (double) ts.tv_nsec * 1e-9;
+#endif
+}
+
+#if defined(GM_SIMD_AVX)
+#define BENCH_BACKEND "avx"
+#elif defined(GM_SIMD_SSE)
+#define BENCH_BACKEND "sse"
+#elif defined(GM_SIMD_NEON)
+#define BENCH_BACKEND "neon"
+#else
+#define BENCH_BACKEND "scalar"
+#endif
+
+// the scalar templates stay reachable under _gm_scalar_ names when a simd
+// backend replaces them
+#if defined(GM_SIMD_SSE) || defined(GM_SIMD_NEON)
+#define BENCH_HAS_SCALAR
+#endif
+
+// -----------------------------------------------------------------------------
+// deterministic inputs
+
+static uint64_t bench_rng = 0x9E3779B97F4A7C15ull;
+
+static uint32_t bench_rand(void)
+{
+  // xorshift64*
+  bench_rng ^= bench_rng >> 12;
+  bench_rng ^= bench_rng << 25;
+  bench_rng ^= bench_rng >> 27;
+  return (uint32_t) ((bench_rng * 0x2545F4914F6CDD1Dull) >> 32);
+}
+
+// uniform in [lo, hi)
+static float bench_randf(float lo, float hi)
+{
+  return lo + (hi - lo) * (float) (bench_rand() >> 8) * 5.96046448e-8f;
+}
+
+static vec3f bench_randv3(float r)
+{
+  return v3f(bench_randf(-r, r), bench_randf(-r, r), bench_randf(-r, r));
+}
+
+static quatf bench_randq(void)
+{
+  quatf q = qf(bench_randf(-1, 1), bench_randf(-1, 1), bench_randf(-1, 1),
+               bench_randf(-1, 1));
+  return qf_len(q) > 1.e-3f ? qf_normalize(q) : qf_ident;
+}
+
+// rotation, translation and scale in [0.5, 2], so inverses are well
+// conditioned
+static mat4f bench_randtrs(void)
+{
+  vec3f e = bench_randv3(3.14159265f);
+  vec3f s = v3f(bench_randf(0.5f, 2), bench_randf(0.5f, 2),
+                bench_randf(0.5f, 2));
+  return m4f_trs(bench_randv3(10), e, s);
+}
+
+#define BENCH_N 4096
+
+static vec2f bench_v2[2][BENCH_N];
+static vec3f bench_v3[2][BENCH_N];
+static vec4f bench_v4[2][BENCH_N];
+static vec3i bench_v3i[2][BENCH_N];
+static vec4u bench_v4u[2][BENCH_N];
+static mat2f bench_m2[2][BENCH_N];
+static mat3f bench_m3[2][BENCH_N];
+static quatf bench_q[2][BENCH_N];
+static mat4f bench_m4[2][BENCH_N];
+static vec4d bench_v4d[2][BENCH_N];
+static mat4d bench_m4d[2][BENCH_N];
+static float bench_f[2][BENCH_N];
+
+// outputs, summed at the end so no benchmark is optimized away
+static vec2f bench_ov2[BENCH_N];
+static vec3f bench_ov3[BENCH_N];
+static vec4f bench_ov4[BENCH_N];
+static vec3i bench_ov3i[BENCH_N];
+static vec4u bench_ov4u[BENCH_N];
+static mat2f bench_om2[BENCH_N];
+static mat3f bench_om3[BENCH_N];
+static quatf bench_oq[BENCH_N];
+static mat4f bench_om4[BENCH_N];
+static vec4d bench_ov4d[BENCH_N];
+static mat4d bench_om4d[BENCH_N];
+static float bench_of[BENCH_N];
+
+// element count handed to the batch kernels, kept out of reach of constant
+// propagation so they are timed as callers with a runtime count see them
+static size_t bench_n;
+
+static void bench_fill(void)
+{
+  bench_n = BENCH_N;
+  for (size_t s = 0; s < 2; ++s)
+  {
+    for (size_t i = 0; i < BENCH_N; ++i)
+    {
+      bench_v2[s][i]  = v2f(bench_randf(-10, 10), bench_randf(-10, 10));
+      bench_v3[s][i]  = bench_randv3(10);
+      bench_v4[s][i]  = v4f(bench_randf(-10, 10), bench_randf(-10, 10),
+                            bench_randf(-10, 10), bench_randf(-10, 10));
+      bench_v3i[s][i] = v3i((int) (bench_rand() % 2001) - 1000,
+                            (int) (bench_rand() % 2001) - 1000,
+                            (int) (bench_rand() % 2001) - 1000);
+      bench_v4u[s][i] = v4u(bench_rand() % 1000, bench_rand() % 1000,
+                            bench_rand() % 1000, bench_rand() % 1000);
+      bench_q[s][i]   = bench_randq();
+      bench_m4[s][i]  = bench_randtrs();
+      bench_m3[s][i]  = m3f(bench_m4[s][i].a[0], bench_m4[s][i].a[1],
+                            bench_m4[s][i].a[2], bench_m4[s][i].a[4],
+                            bench_m4[s][i].a[5], bench_m4[s][i].a[6],
+                            bench_m4[s][i].a[8], bench_m4[s][i].a[9],
+                            bench_m4[s][i].a[10]);
+      bench_m2[s][i]  = m2f(bench_m3[s][i].a[0], bench_m3[s][i].a[1],
+                            bench_m3[s][i].a[3], bench_m3[s][i].a[4]);
+      bench_v4d[s][i] = v4d_from_v4f(bench_v4[s][i]);
+      bench_m4d[s][i] = m4d_from_m4f(bench_m4[s][i]);
+      bench_f[s][i]   = bench_randf(-10, 10);
+    }
+  }
+}
+
+static double bench_checksum(void)
+{
+  double sum = 0;
+  for (size_t i = 0; i < BENCH_N; ++i)
+  {
+    sum += bench_ov2[i].x + bench_ov3[i].x + bench_ov4[i].x +
+           bench_ov3i[i].x + bench_ov4u[i].x + bench_oq[i].a[0] +
+           bench_om2[i].a[3] + bench_om3[i].a[4] + bench_om4[i].a[5] +
+           bench_ov4d[i].x + bench_om4d[i].a[5] + bench_of[i];
+  }
+  return sum;
+}
+
+// -----------------------------------------------------------------------------
+// throughput
+
+static double bench_min_time = 0.1;
+
+static void bench_header(void)
+{
+  printf("%-6s %-16s %-7s %-7s %10s %9s\n", "family", "op", "api",
+         "backend", "Mop/s", "ns/op");
+}
+
+static void bench_report(const char *family, const char *op, const char *api,
+                         const char *backend, size_t ops, double secs)
+{
+  secs = secs > 0 ? secs : 1e-9;
+  printf("%-6s %-16s %-7s %-7s %10.2f %9.3f\n", family, op, api, backend,
+         (double) ops / secs * 1e-6, secs * 1e9 / (double) ops);
+}
+
+// runs BODY, which performs OPS operations, until bench_min_time has passed
+#define BENCH_OP(FAMILY, OP, API, BACKEND, OPS, BODY)                          \
+  do                                                                           \
+  {                                                                            \
+    size_t reps_ = 0;                                                          \
+    double t_    = bench_now(), e_;                                            \
+    do                                                                         \
+    {                                                                          \
+      BODY;                                                                    \
+      reps_++;                                                                 \
+    } while ((e_ = bench_now() - t_) < bench_min_time);                        \
+    bench_report(FAMILY, OP, API, BACKEND, (OPS) * reps_, e_);                 \
+  } while (0)
+
+// one call per element
+#define BENCH_EACH(FAMILY, OP, BACKEND, STMT)                                  \
+  BENCH_OP(FAMILY, OP, "single", BACKEND, BENCH_N,                             \
+           for (size_t i = 0; i < BENCH_N; ++i) { STMT; })
+
+static void bench_vec(void)
+{
+  BENCH_EACH("vec2f", "add", "scalar",
+             bench_ov2[i] = v2f_add(bench_v2[0][i], bench_v2[1][i]));
+  BENCH_EACH("vec2f", "dot", "scalar",
+             bench_of[i] = v2f_dot(bench_v2[0][i], bench_v2[1][i]));
+  BENCH_EACH("vec2f", "normalize", "scalar",
+             bench_ov2[i] = v2f_normalize(bench_v2[0][i]));
+
+  BENCH_EACH("vec3f", "add", "scalar",
+             bench_ov3[i] = v3f_add(bench_v3[0][i], bench_v3[1][i]));
+  BENCH_EACH("vec3f", "dot", "scalar",
+             bench_of[i] = v3f_dot(bench_v3[0][i], bench_v3[1][i]));
+  BENCH_EACH("vec3f", "cross", "scalar",
+             bench_ov3[i] = v3f_cross(bench_v3[0][i], bench_v3[1][i]));
+  BENCH_EACH("vec3f", "normalize", "scalar",
+             bench_ov3[i] = v3f_normalize(bench_v3[0][i]));
+  BENCH_EACH("vec3f", "fnorm", "scalar",
+             bench_ov3[i] = v3f_fnorm(bench_v3[0][i]));
+  BENCH_OP("vec3f", "dot", "batch", BENCH_BACKEND, BENCH_N,
+           v3f_dot_many(bench_v3[0], bench_v3[1], bench_of, bench_n));
+  BENCH_OP("vec3f", "normalize", "batch", BENCH_BACKEND, BENCH_N,
+           v3f_normalize_many(bench_v3[0], bench_ov3, bench_n));
+
+  BENCH_EACH("vec4f", "add", BENCH_BACKEND,
+             bench_ov4[i] = v4f_add(bench_v4[0][i], bench_v4[1][i]));
+  BENCH_EACH("vec4f", "dot", BENCH_BACKEND,
+             bench_of[i] = v4f_dot(bench_v4[0][i], bench_v4[1][i]));
+  BENCH_EACH("vec4f", "normalize", BENCH_BACKEND,
+             bench_ov4[i] = v4f_normalize(bench_v4[0][i]));
+#ifdef BENCH_HAS_SCALAR
+  BENCH_EACH("vec4f", "add", "scalar",
+             bench_ov4[i] = _gm_scalar_v4f_add(bench_v4[0][i], bench_v4[1][i]));
+  BENCH_EACH("vec4f", "dot", "scalar",
+             bench_of[i] = _gm_scalar_v4f_dot(bench_v4[0][i], bench_v4[1][i]));
+  BENCH_EACH("vec4f", "normalize", "scalar",
+             bench_ov4[i] = _gm_scalar_v4f_normalize(bench_v4[0][i]));
+#endif
+
+  BENCH_EACH("vec3i", "add", "scalar",
+             bench_ov3i[i] = v3i_add(bench_v3i[0][i], bench_v3i[1][i]));
+  BENCH_EACH("vec3i", "mul", "scalar",
+             bench_ov3i[i] = v3i_mul(bench_v3i[0][i], bench_v3i[1][i]));
+  BENCH_EACH("vec3i", "dot", "scalar",
+             bench_of[i] = (float) v3i_dot(bench_v3i[0][i], bench_v3i[1][i]));
+  BENCH_EACH("vec4u", "add", "scalar",
+             bench_ov4u[i] = v4u_add(bench_v4u[0][i], bench_v4u[1][i]));
+  BENCH_EACH("vec4u", "mul", "scalar",
+             bench_ov4u[i] = v4u_mul(bench_v4u[0][i], bench_v4u[1][i]));
+  BENCH_EACH("vec4u", "dot", "scalar",
+             bench_of[i] = (float) v4u_dot(bench_v4u[0][i], bench_v4u[1][i]));
+
+  BENCH_EACH("vec4d", "add", BENCH_BACKEND,
+             bench_ov4d[i] = v4d_add(bench_v4d[0][i], bench_v4d[1][i]));
+  BENCH_EACH("vec4d", "normalize", BENCH_BACKEND,
+             bench_ov4d[i] = v4d_normalize(bench_v4d[0][i]));
+}
+
+static void bench_mat(void)
+{
+  BENCH_EACH("mat2f", "mul", "scalar",
+             bench_om2[i] = m2f_mul(bench_m2[0][i], bench_m2[1][i]));
+  BENCH_EACH("mat2f", "mulv", "scalar",
+             bench_ov2[i] = m2f_mulv(bench_m2[0][i], bench_v2[0][i]));
+  BENCH_EACH("mat2f", "inv", "scalar",
+             bench_om2[i] = m2f_inv(bench_m2[0][i]));
+
+  BENCH_EACH("mat3f", "mul", "scalar",
+             bench_om3[i] = m3f_mul(bench_m3[0][i], bench_m3[1][i]));
+  BENCH_EACH("mat3f", "mulv", "scalar",
+             bench_ov3[i] = m3f_mulv(bench_m3[0][i], bench_v3[0][i]));
+  BENCH_EACH("mat3f", "transpose", "scalar",
+             bench_om3[i] = m3f_transpose(bench_m3[0][i]));
+  BENCH_EACH("mat3f", "inv", "scalar",
+             bench_om3[i] = m3f_inv(bench_m3[0][i]));
+
+  BENCH_EACH("mat4f", "mul", BENCH_BACKEND,
+             bench_om4[i] = m4f_mul(bench_m4[0][i], bench_m4[1][i]));
+  BENCH_EACH("mat4f", "mulv", BENCH_BACKEND,
+             bench_ov4[i] = m4f_mulv(bench_m4[0][i], bench_v4[0][i]));
+  BENCH_EACH("mat4f", "transpose", BENCH_BACKEND,
+             bench_om4[i] = m4f_transpose(bench_m4[0][i]));
+  BENCH_EACH("mat4f", "inv", BENCH_BACKEND,
+             bench_om4[i] = m4f_inv(bench_m4[0][i]));
+#ifdef BENCH_HAS_SCALAR
+  BENCH_EACH("mat4f", "mul", "scalar",
+             bench_om4[i] = _gm_scalar_m4f_mul(bench_m4[0][i], bench_m4[1][i]));
+  BENCH_EACH("mat4f", "mulv", "scalar",
+             bench_ov4[i] =
+               _gm_scalar_m4f_mulv(bench_m4[0][i], bench_v4[0][i]));
+  BENCH_EACH("mat4f", "transpose", "scalar",
+             bench_om4[i] = _gm_scalar_m4f_transpose(bench_m4[0][i]));
+#endif
+#ifdef GM_SIMD_SSE
+  BENCH_EACH("mat4f", "inv", "scalar",
+             bench_om4[i] = _gm_scalar_m4f_inv(bench_m4[0][i]));
+#endif
+  BENCH_OP("mat4f", "transform", "batch", BENCH_BACKEND, BENCH_N,
+           m4f_transform_points(bench_m4[0][0], bench_v3[0], bench_ov3,
+                                bench_n));
+
+  BENCH_EACH("mat4d", "mul", BENCH_BACKEND,
+             bench_om4d[i] = m4d_mul(bench_m4d[0][i], bench_m4d[1][i]));
+  BENCH_EACH("mat4d", "mulv", BENCH_BACKEND,
+             bench_ov4d[i] = m4d_mulv(bench_m4d[0][i], bench_v4d[0][i]));
+}
+
+static void bench_quat(void)
+{
+  BENCH_EACH("quatf", "mul", BENCH_BACKEND,
+             bench_oq[i] = qf_mul(bench_q[0][i], bench_q[1][i]));
+  BENCH_EACH("quatf", "rotv", BENCH_BACKEND,
+             bench_ov4[i] = qf_rotv(bench_q[0][i], bench_v4[0][i]));
+  BENCH_EACH("quatf", "normalize", BENCH_BACKEND,
+             bench_oq[i] = qf_normalize(bench_q[0][i]));
+#ifdef BENCH_HAS_SCALAR
+  BENCH_EACH("quatf", "mul", "scalar",
+             bench_oq[i] = _gm_scalar_qf_mul(bench_q[0][i], bench_q[1][i]));
+  BENCH_EACH("quatf", "rotv", "scalar",
+             bench_ov4[i] = _gm_scalar_qf_rotv(bench_q[0][i], bench_v4[0][i]));
+  BENCH_EACH("quatf", "normalize", "scalar",
+             bench_oq[i] = _gm_scalar_qf_normalize(bench_q[0][i]));
+#endif
+  BENCH_EACH("quatf", "slerp", "scalar",
+             bench_oq[i] = qf_slerp(bench_q[0][i], bench_q[1][i], 0.3f));
+  BENCH_EACH("quatf", "fslerp", "scalar",
+             bench_oq[i] = qf_fslerp(bench_q[0][i], bench_q[1][i], 0.3f));
+  BENCH_EACH("quatf", "nlerp", "scalar",
+             bench_oq[i] = qf_nlerp(bench_q[0][i], bench_q[1][i], 0.3f));
+  BENCH_OP("quatf", "slerp", "batch", "x8", BENCH_N,
+           qf_slerp_many(bench_q[0], bench_q[1], 0.3f, bench_oq, bench_n));
+  BENCH_OP("quatf", "nlerp", "batch", "x8", BENCH_N,
+           qf_nlerp_many(bench_q[0], bench_q[1], 0.3f, bench_oq, bench_n));
+  BENCH_OP("quatf", "rotate", "batch", BENCH_BACKEND, BENCH_N,
+           qf_rotate_many(bench_q[0][0], bench_v3[0], bench_ov3, bench_n));
+}
+
+static void bench_scalar(void)
+{
+  BENCH_EACH("float", "sinf", "libm", bench_of[i] = sinf(bench_f[0][i]));
+  BENCH_EACH("float", "fast_sinf", "scalar",
+             bench_of[i] = fast_sinf(bench_f[0][i]));
+  BENCH_EACH("float", "atan2f", "libm",
+             bench_of[i] = atan2f(bench_f[0][i], bench_f[1][i]));
+  BENCH_EACH("float", "fast_atan2f", "scalar",
+             bench_of[i] = fast_atan2f(bench_f[0][i], bench_f[1][i]));
+  BENCH_EACH("float", "1/sqrtf", "libm",
+             bench_of[i] = 1 / sqrtf(fabsf(bench_f[0][i]) + 1));
+  BENCH_EACH("float", "fast_rsqrtf", "scalar",
+             bench_of[i] = fast_rsqrtf(fabsf(bench_f[0][i]) + 1));
+}
+
+// -----------------------------------------------------------------------------
+// accuracy against long double references
+// errors are in float ulps of the largest reference component, so vector
+// and matrix results are judged norm-wise rather than per component
+
+static long double bench_ulp(long double x)
+{
+  float f = (float) fabsl(x);
+  if (f < FLT_MIN)
+  {
+    return (long double) FLT_MIN * FLT_EPSILON;
+  }
+  int e;
+  frexpf(f, &e);
+  return ldexpl(1, e - 24);
+}
+
+typedef struct bench_acc_t
+{
+  const char *op;
+  double budget;
+  double max;
+  double sum;
+  size_t n;
+} bench_acc_t;
+
+// scale overrides the reference magnitude when nonzero
+static void bench_acc_add(bench_acc_t *a, const float *got,
+                          const long double *ref, size_t n, long double s)
+{
+  long double e = 0, m = 0;
+  for (size_t k = 0; k < n; ++k)
+  {
+    m = fabsl(ref[k]) > m ? fabsl(ref[k]) : m;
+    e = fabsl(got[k] - ref[k]) > e ? fabsl(got[k] - ref[k]) : e;
+  }
+  double u = (double) (e / bench_ulp(s > 0 ? s : m));
+  a->max   = u > a->max ? u : a->max;
+  a->sum  += u;
+  a->n++;
+}
+
+// returns 1 when the op is over its budget
+static int bench_acc_report(const bench_acc_t *a)
+{
+  bool over = a->max > a->budget;
+  printf("%-16s %10.2f %10.3f %10.1f  %s\n", a->op, a->max,
+         a->n ? a->sum / (double) a->n : 0, a->budget, over ? "FAIL" : "ok");
+  return over;
+}
+
+static void bench_ref_v3(const vec3f v, long double *out)
+{
+  for (size_t k = 0; k < 3; ++k)
+  {
+    out[k] = v.a[k];
+  }
+}
+
+// returns the largest sum of term magnitudes, the scale for the error
+static long double bench_ref_m4mul(const mat4f a, const mat4f b,
+                                   long double *out)
+{
+  // m4f_mul(a, b) is b * a
+  long double scale = 0;
+  for (size_t i = 0; i < 4; ++i)
+  {
+    for (size_t j = 0; j < 4; ++j)
+    {
+      long double s = 0, m = 0;
+      for (size_t k = 0; k < 4; ++k)
+      {
+        s += (long double) b.a[i * 4 + k] * a.a[k * 4 + j];
+        m += fabsl((long double) b.a[i * 4 + k] * a.a[k * 4 + j]);
+      }
+      out[i * 4 + j] = s;
+      scale          = m > scale ? m : scale;
+    }
+  }
+  return scale;
+}
+
+// gauss-jordan with partial pivoting
+static void bench_ref_m4inv(const mat4f m, long double *out)
+{
+  long double a[4][8];
+  for (size_t i = 0; i < 4; ++i)
+  {
+    for (size_t j = 0; j < 4; ++j)
+    {
+      a[i][j]     = m.a[i * 4 + j];
+      a[i][j + 4] = i == j;
+    }
+  }
+  for (size_t c = 0; c < 4; ++c)
+  {
+    size_t p = c;
+    for (size_t r = c + 1; r < 4; ++r)
+    {
+      p = fabsl(a[r][c]) > fabsl(a[p][c]) ? r : p;
+    }
+    for (size_t j = 0; j < 8; ++j)
+    {
+      long double t = a[c][j];
+      a[c][j]       = a[p][j];
+      a[p][j]       = t;
+    }
+    long double d = a[c][c];
+    for (size_t j = 0; j < 8; ++j)
+    {
+      a[c][j] /= d;
+    }
+    for (size_t r = 0; r < 4; ++r)
+    {
+      long double f = a[r][c];
+      for (size_t j = 0; r != c && j < 8; ++j)
+      {
+        a[r][j] -= f * a[c][j];
+      }
+    }
+  }
+  for (size_t i = 0; i < 4; ++i)
+  {
+    for (size_t j = 0; j < 4; ++j)
+    {
+      out[i * 4 + j] = a[i][j + 4];
+    }
+  }
+}
+
+// hamilton product, w first
+static void bench_ref_qmul(const quatf a, const quatf b, long double *out)
+{
+  long double aw = a.a[0], ax = a.a[1], ay = a.a[2], az = a.a[3];
+  long double bw = b.a[0], bx = b.a[1], by = b.a[2], bz = b.a[3];
+  out[0] = aw * bw - ax * bx - ay * by - az * bz;
+  out[1] = aw * bx + ax * bw + ay * bz - az * by;
+  out[2] = aw * by - ax * bz + ay * bw + az * bx;
+  out[3] = aw * bz + ax * by - ay * bx + az * bw;
+}
+
+static void bench_ref_qrot(const quatf q, const vec3f v, long double *out)
+{
+  long double w = q.a[0], x = q.a[1], y = q.a[2], z = q.a[3];
+  long double r[9] = {1 - 2 * (y * y + z * z), 2 * (x * y - w * z),
+                      2 * (x * z + w * y),     2 * (x * y + w * z),
+                      1 - 2 * (x * x + z * z), 2 * (y * z - w * x),
+                      2 * (x * z - w * y),     2 * (y * z + w * x),
+                      1 - 2 * (x * x + y * y)};
+  for (size_t i = 0; i < 3; ++i)
+  {
+    out[i] = r[i * 3] * v.x + r[i * 3 + 1] * v.y + r[i * 3 + 2] * v.z;
+  }
+}
+
+// plain slerp without the hemisphere flip, as qf_slerp
+static void bench_ref_slerp(const quatf a, const quatf b, const float t,
+                            long double *out)
+{
+  long double d = 0;
+  for (size_t k = 0; k < 4; ++k)
+  {
+    d += (long double) a.a[k] * b.a[k];
+  }
+  d                = d > 1 ? 1 : d < -1 ? -1 : d;
+  long double th   = acosl(d);
+  long double w1   = sinl((1 - t) * th) / sinl(th);
+  long double w2   = sinl(t * th) / sinl(th);
+  for (size_t k = 0; k < 4; ++k)
+  {
+    out[k] = w1 * a.a[k] + w2 * b.a[k];
+  }
+}
+
+// budgets in ulps, the second under GM_FAST_MATH
+#ifdef GM_FAST_MATH
+#define BENCH_FAST(EXACT, FAST) FAST
+#else
+#define BENCH_FAST(EXACT, FAST) EXACT
+#endif
+
+// error bounds documented for the fast routines in gm.h
+#ifdef GM_SIMD_SSE
+#define BENCH_RSQRT_REL 2.5e-7
+#define BENCH_ACOS_ABS 8.e-7
+#else
+#define BENCH_RSQRT_REL 4.8e-6
+#define BENCH_ACOS_ABS 8.e-6
+#endif
+#define BENCH_SIN_ABS 1.2e-7
+#define BENCH_ATAN_ABS 2.e-6
+#define BENCH_SLERPW_ABS 2.e-5
+#define BENCH_PI 3.14159265358979323846L
+
+// ulps of scale spanned by an absolute error, plus the final rounding
+static double bench_abs_ulps(double err, long double scale)
+{
+  return err / (double) bench_ulp(scale) + 1;
+}
+
+// ulps spanned by a relative error, where one ulp is at least 2^-24 of the
+// value, plus the final rounding
+static double bench_rel_ulps(double rel)
+{
+  return rel * 16777216.0 + 1;
+}
+
+// fast slerp weights sin(u th) / sin(th) with sin(th) >= s: their slope in
+// th is under 1 / s + 1 / s^2, sin errors add (1 + 1 / s) / s of theirs, and
+// each output component sums two weighted unit components
+static double bench_fslerp_abs(double s)
+{
+  return 2 * ((1 / s + 1 / (s * s)) * BENCH_ACOS_ABS +
+              (1 + 1 / s) / s * BENCH_SIN_ABS);
+}
+
+// runs the body for each sample i, filling got and ref (and scale when the
+// reference magnitude is not the right yardstick), then reports the op
+#define BENCH_ACC(OP, BUDGET, NOUT, ...)                                       \
+  do                                                                           \
+  {                                                                            \
+    bench_acc_t acc_ = {OP, BUDGET, 0, 0, 0};                                  \
+    for (size_t i = 0; i < samples; ++i)                                       \
+    {                                                                          \
+      float got[16];                                                           \
+      long double ref[16], scale = 0;                                          \
+      __VA_ARGS__                                                              \
+      bench_acc_add(&acc_, got, ref, NOUT, scale);                             \
+    }                                                                          \
+    fails += bench_acc_report(&acc_);                                          \
+  } while (0)
+
+static void bench_put(float *got, const float *v, size_t n)
+{
+  for (size_t k = 0; k < n; ++k)
+  {
+    got[k] = v[k];
+  }
+}
+
+static int bench_accuracy(size_t samples)
+{
+  int fails = 0;
+  printf("%-16s %10s %10s %10s\n", "op", "max_ulp", "mean_ulp", "budget");
+  bench_rng = 0x2545F4914F6CDD1Dull;
+
+  BENCH_ACC("v3f_dot", 4, 1, {
+    vec3f a = bench_randv3(10), b = bench_randv3(10);
+    got[0]  = v3f_dot(a, b);
+    ref[0]  = (long double) a.x * b.x + (long double) a.y * b.y +
+             (long double) a.z * b.z;
+    // judged against the sum of magnitudes, as dots may cancel to zero
+    scale = fabsl((long double) a.x * b.x) + fabsl((long double) a.y * b.y) +
+            fabsl((long double) a.z * b.z);
+  });
+  BENCH_ACC("v3f_len", BENCH_FAST(2, 2 + bench_rel_ulps(BENCH_RSQRT_REL)), 1, {
+    vec3f a = bench_randv3(10);
+    got[0]  = v3f_len(a);
+    ref[0]  = sqrtl((long double) a.x * a.x + (long double) a.y * a.y +
+                   (long double) a.z * a.z);
+  });
+  BENCH_ACC("v3f_normalize",
+            BENCH_FAST(3, 3 + bench_rel_ulps(BENCH_RSQRT_REL)), 3, {
+    vec3f a = bench_randv3(10);
+    bench_put(got, v3f_normalize(a).a, 3);
+    bench_ref_v3(a, ref);
+    long double l = sqrtl(ref[0] * ref[0] + ref[1] * ref[1] + ref[2] * ref[2]);
+    for (size_t k = 0; k < 3; ++k)
+    {
+      ref[k] /= l;
+    }
+  });
+  BENCH_ACC("v3f_fnorm", 3 + bench_rel_ulps(BENCH_RSQRT_REL), 3, {
+    vec3f a = bench_randv3(10);
+    bench_put(got, v3f_fnorm(a).a, 3);
+    bench_ref_v3(a, ref);
+    long double l = sqrtl(ref[0] * ref[0] + ref[1] * ref[1] + ref[2] * ref[2]);
+    for (size_t k = 0; k < 3; ++k)
+    {
+      ref[k] /= l;
+    }
+  });
+  BENCH_ACC("v3f_normalize_n",
+            BENCH_FAST(3, 3 + bench_rel_ulps(BENCH_RSQRT_REL)), 3, {
+    vec3f a[5], o[5];
+    for (size_t k = 0; k < 5; ++k)
+    {
+      a[k] = bench_randv3(10);
+    }
+    v3f_normalize_many(a, o, 5);
+    bench_put(got, o[i % 5].a, 3);
+    bench_ref_v3(a[i % 5], ref);
+    long double l = sqrtl(ref[0] * ref[0] + ref[1] * ref[1] + ref[2] * ref[2]);
+    for (size_t k = 0; k < 3; ++k)
+    {
+      ref[k] /= l;
+    }
+  });
+  BENCH_ACC("v3f_cross", 4, 3, {
+    vec3f a = bench_randv3(10), b = bench_randv3(10);
+    bench_put(got, v3f_cross(a, b).a, 3);
+    ref[0] = (long double) a.y * b.z - (long double) a.z * b.y;
+    ref[1] = (long double) a.z * b.x - (long double) a.x * b.z;
+    ref[2] = (long double) a.x * b.y - (long double) a.y * b.x;
+    scale  = (long double) v3f_len(a) * v3f_len(b);
+  });
+  BENCH_ACC("m4f_mul", 4, 16, {
+    mat4f a = bench_randtrs(), b = bench_randtrs();
+    bench_put(got, m4f_mul(a, b).a, 16);
+    scale = bench_ref_m4mul(a, b, ref);
+  });
+  BENCH_ACC("m4f_inv", 16, 16, {
+    mat4f a = bench_randtrs();
+    bench_put(got, m4f_inv(a).a, 16);
+    bench_ref_m4inv(a, ref);
+  });
+  BENCH_ACC("m4f_transform", 4, 3, {
+    mat4f m = bench_randtrs();
+    vec3f p = bench_randv3(10), o;
+    m4f_transform_points(m, &p, &o, 1);
+    bench_put(got, o.a, 3);
+    for (size_t r = 0; r < 3; ++r)
+    {
+      long double t[4] = {(long double) m.a[r * 4] * p.x,
+                          (long double) m.a[r * 4 + 1] * p.y,
+                          (long double) m.a[r * 4 + 2] * p.z, m.a[r * 4 + 3]};
+      long double a    = fabsl(t[0]) + fabsl(t[1]) + fabsl(t[2]) + fabsl(t[3]);
+      ref[r]           = t[0] + t[1] + t[2] + t[3];
+      scale            = a > scale ? a : scale;
+    }
+  });
+  BENCH_ACC("qf_mul", 4, 4, {
+    quatf a = bench_randq(), b = bench_randq();
+    bench_put(got, qf_mul(a, b).a, 4);
+    bench_ref_qmul(a, b, ref);
+  });
+  BENCH_ACC("qf_rotv", 8, 3, {
+    quatf q = bench_randq();
+    vec3f v = bench_randv3(10);
+    bench_put(got, qf_rotv(q, v4f(v.x, v.y, v.z, 0)).a, 3);
+    bench_ref_qrot(q, v, ref);
+  });
+  BENCH_ACC("qf_rotate_many", 8, 3, {
+    quatf q = bench_randq();
+    vec3f v = bench_randv3(10), o;
+    qf_rotate_many(q, &v, &o, 1);
+    bench_put(got, o.a, 3);
+    bench_ref_qrot(q, v, ref);
+  });
+  // slerp is sampled away from nearly parallel pairs, where its float acos
+  // is ill conditioned, so sin(th) >= sqrt(1 - 0.95^2); quaternion
+  // components are judged in ulps of 1
+  BENCH_ACC("qf_slerp",
+            BENCH_FAST(32, 32 + bench_abs_ulps(bench_fslerp_abs(0.312), 1)),
+            4, {
+    quatf a = bench_randq(), b = bench_randq();
+    while (fabsf(qf_dot(a, b)) > 0.95f)
+    {
+      b = bench_randq();
+    }
+    float t = bench_randf(0, 1);
+    bench_put(got, qf_slerp(a, b, t).a, 4);
+    bench_ref_slerp(a, b, t, ref);
+    scale = 1;
+  });
+  // each output component sums two weighted unit components
+  BENCH_ACC("qf_slerp_many", 4 + bench_abs_ulps(2 * BENCH_SLERPW_ABS, 1), 4, {
+    quatf a = bench_randq(), b = bench_randq(), o;
+    // the batch takes the shorter arc
+    b       = qf_dot(a, b) < 0 ? qf_smul(b, -1) : b;
+    float t = bench_randf(0, 1);
+    qf_slerp_many(&a, &b, t, &o, 1);
+    bench_put(got, o.a, 4);
+    bench_ref_slerp(a, b, t, ref);
+    scale = 1;
+  });
+  BENCH_ACC("sinf", 1, 1, {
+    float x = bench_randf(-25, 25);
+    got[0]  = sinf(x);
+    ref[0]  = sinl(x);
+  });
+  BENCH_ACC("fast_sinf", bench_abs_ulps(BENCH_SIN_ABS, 1), 1, {
+    float x = bench_randf(-25, 25);
+    got[0]  = fast_sinf(x);
+    ref[0]  = sinl(x);
+    // absolute error, in ulps of 1
+    scale = 1;
+  });
+  // absolute errors, in ulps of pi
+  BENCH_ACC("fast_atan2f", bench_abs_ulps(BENCH_ATAN_ABS, BENCH_PI), 1, {
+    float y = bench_randf(-10, 10), x = bench_randf(-10, 10);
+    got[0]  = fast_atan2f(y, x);
+    ref[0]  = atan2l(y, x);
+    scale   = BENCH_PI;
+  });
+  BENCH_ACC("fast_acosf", bench_abs_ulps(BENCH_ACOS_ABS, BENCH_PI), 1, {
+    float x = bench_randf(-1, 1);
+    got[0]  = fast_acosf(x);
+    ref[0]  = acosl(x);
+    scale   = BENCH_PI;
+  });
+  BENCH_ACC("fast_rsqrtf", bench_rel_ulps(BENCH_RSQRT_REL), 1, {
+    float x = bench_randf(1.e-3f, 1.e3f);
+    got[0]  = fast_rsqrtf(x);
+    ref[0]  = 1 / sqrtl(x);
+  });
+  return fails;
+}
+
+// -----------------------------------------------------------------------------
+
+static void bench_usage(const char *exe)
+{
+  printf("usage: %s [--quick] [--no-throughput] [--no-accuracy]\n"
+         "  --quick          shorter runs and fewer accuracy samples\n"
+         "  --no-throughput  skip the timing tables\n"
+         "  --no-accuracy    skip the ulp checks\n"
+         "exits with 1 when an op is over its ulp budget\n",
+         exe);
+}
+
+int main(int argc, char **argv)
+{
+  bool throughput = true, accuracy = true;
+  size_t samples  = 100000;
+  for (int i = 1; i < argc; ++i)
+  {
+    if (strcmp(argv[i], "--quick") == 0)
+    {
+      bench_min_time = 0.01;
+      samples        = 10000;
+    }
+    else if (strcmp(argv[i], "--no-throughput") == 0)
+    {
+      throughput = false;
+    }
+    else if (strcmp(argv[i], "--no-accuracy") == 0)
+    {
+      accuracy = false;
+    }
+    else
+    {
+      bench_usage(argv[0]);
+      return strcmp(argv[i], "--help") == 0 ? 0 : 1;
+    }
+  }
+
+  int fails = 0;
+  if (throughput)
+  {
+    bench_fill();
+    bench_header();
+    bench_vec();
+    bench_mat();
+    bench_quat();
+    bench_scalar();
+    printf("checksum %g\n\n", bench_checksum());
+  }
+  if (accuracy)
+  {
+    fails = bench_accuracy(samples);
+  }
+  return fails ? 1 : 0;
+}
@@ -0,0 +1,381 @@
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#endif
+
+#define STREAM_IMPLEMENTATION
+#include "../stream.h"
+
+// -----------------------------------------------------------------------------
+// timing, threads and locks
+
+static double bench_now(void)
+{
+#ifdef _WIN32
+  LARGE_INTEGER freq, count;
+  QueryPerformanceFrequency(&freq);
+  QueryPerformanceCounter(&count);
+  return (double) count.QuadPart / (double) freq.QuadPart;
+#else
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double) ts.tv_sec + (double) ts.tv_nsec * 1e-9;
+#endif
+}
+
+static size_t bench_cpus(void)
+{
+#ifdef _WIN32
+  SYSTEM_INFO info;
+  GetSystemInfo(&info);
+  return (size_t) info.dwNumberOfProcessors;
+#else
+  long n = sysconf(_SC_NPROCESSORS_ONLN);
+  return n > 0 ? (size_t) n : 1;
+#endif
+}
+
+// a full push or empty dequeue gives up the core, since with more threads
+// than cores spinning only delays the other side
+static void bench_yield(void)
+{
+#ifdef _WIN32
+  SwitchToThread();
+#else
+  sched_yield();
+#endif
+}
+
+#ifdef _WIN32
+typedef HANDLE bench_thread_t;
+typedef CRITICAL_SECTION bench_mutex_t;
+#define bench_mutex_init(M) InitializeCriticalSection(M)
+#define bench_mutex_lock(M) EnterCriticalSection(M)
+#define bench_mutex_unlock(M) LeaveCriticalSection(M)
+#define bench_mutex_destroy(M) DeleteCriticalSection(M)
+#else
+typedef pthread_t bench_thread_t;
+typedef pthread_mutex_t bench_mutex_t;
+#define bench_mutex_init(M) pthread_mutex_init(M, NULL)
+#define bench_mutex_lock(M) pthread_mutex_lock(M)
+#define bench_mutex_unlock(M) pthread_mutex_unlock(M)
+#define bench_mutex_destroy(M) pthread_mutex_destroy(M)
+#endif
+
+// -----------------------------------------------------------------------------
+// queues under test, all moving fixed-size messages tagged with their
+// producer and sequence number
+
+#define BENCH_MSG 64
+#define BENCH_SLOTS 1024
+
+typedef enum bench_kind_t
+{
+  BENCH_MUTEX,
+  BENCH_SPSC,
+  BENCH_MPMC,
+} bench_kind_t;
+
+static const char *bench_kinds[] = {"mutex", "spsc", "mpmc"};
+
+typedef struct bench_queue_t
+{
+  bench_kind_t kind;
+  // messages per flush for spsc, per lock for mutex
+  size_t batch;
+  stream_t *stream;
+  bench_mutex_t lock;
+  stream_spsc_t *spsc;
+  stream_mpmc_t *mpmc;
+} bench_queue_t;
+
+typedef struct bench_job_t
+{
+  bench_queue_t *queue;
+  uint64_t id;
+  size_t count;
+  uint64_t sum;
+} bench_job_t;
+
+static size_t bench_push(bench_queue_t *q, const BYTE *msgs, size_t n)
+{
+  switch (q->kind)
+  {
+    case BENCH_MUTEX:
+      bench_mutex_lock(&q->lock);
+      n = min(n, (stream_capacityu(q->stream) - stream_lengthu(q->stream)) /
+                   BENCH_MSG);
+      stream_enqb(q->stream, n * BENCH_MSG, msgs);
+      bench_mutex_unlock(&q->lock);
+      return n;
+    case BENCH_SPSC:
+      for (size_t i = 0; i < n; ++i)
+      {
+        if (!stream_spsc_writeb(q->spsc, BENCH_MSG, msgs + i * BENCH_MSG))
+        {
+          n = i;
+        }
+      }
+      stream_spsc_flush(q->spsc);
+      return n;
+    case BENCH_MPMC:
+      return stream_mpmc_pushb(q->mpmc, BENCH_MSG, msgs) ? 1 : 0;
+  }
+  return 0;
+}
+
+static size_t bench_pop(bench_queue_t *q, BYTE *msgs, size_t n)
+{
+  switch (q->kind)
+  {
+    case BENCH_MUTEX:
+      bench_mutex_lock(&q->lock);
+      n = min(n, stream_lengthu(q->stream) / BENCH_MSG);
+      memcpy(msgs, stream_deqb(q->stream, n * BENCH_MSG), n * BENCH_MSG);
+      bench_mutex_unlock(&q->lock);
+      return n;
+    case BENCH_SPSC:
+      return stream_spsc_deqb(q->spsc, n * BENCH_MSG, msgs) / BENCH_MSG;
+    case BENCH_MPMC:
+      return stream_mpmc_deqb(q->mpmc, BENCH_MSG, msgs) ? 1 : 0;
+  }
+  return 0;
+}
+
+static uint64_t bench_tag(uint64_t id, uint64_t seq)
+{
+  return id << 40 | seq;
+}
+
+static void *bench_producer(void *arg)
+{
+  bench_job_t *job = (bench_job_t *) arg;
+  size_t batch     = job->queue->batch;
+  BYTE *msgs       = (BYTE *) calloc(batch, BENCH_MSG);
+  for (size_t seq = 0; seq < job->count;)
+  {
+    size_t n = min(batch, job->count - seq);
+    for (size_t i = 0; i < n; ++i)
+    {
+      uint64_t tag = bench_tag(job->id, seq + i);
+      memcpy(msgs + i * BENCH_MSG, &tag, sizeof(tag));
+    }
+    size_t pushed = 0;
+    while (pushed < n)
+    {
+      size_t k = bench_push(job->queue, msgs + pushed * BENCH_MSG, n - pushed);
+      pushed += k;
+      if (!k)
+      {
+        bench_yield();
+      }
+    }
+    seq += n;
+  }
+  free(msgs);
+  return NULL;
+}
+
+static void *bench_consumer(void *arg)
+{
+  bench_job_t *job = (bench_job_t *) arg;
+  size_t batch     = job->queue->batch;
+  BYTE *msgs       = (BYTE *) calloc(batch, BENCH_MSG);
+  for (size_t done = 0; done < job->count;)
+  {
+    size_t n = bench_pop(job->queue, msgs, min(batch, job->count - done));
+    for (size_t i = 0; i < n; ++i)
+    {
+      uint64_t tag;
+      memcpy(&tag, msgs + i * BENCH_MSG, sizeof(tag));
+      job->sum += tag;
+    }
+    done += n;
+    if (!n)
+    {
+      bench_yield();
+    }
+  }
+  free(msgs);
+  return NULL;
+}
+
+#ifdef _WIN32
+static DWORD WINAPI bench_producer_win32(LPVOID arg)
+{
+  bench_producer(arg);
+  return 0;
+}
+
+static DWORD WINAPI bench_consumer_win32(LPVOID arg)
+{
+  bench_consumer(arg);
+  return 0;
+}
+#endif
+
+static void bench_spawn(bench_thread_t *thread, bool producer,
+                        bench_job_t *job)
+{
+#ifdef _WIN32
+  *thread = CreateThread(NULL, 0,
+                         producer ? bench_producer_win32 : bench_consumer_win32,
+                         job, 0, NULL);
+#else
+  pthread_create(thread, NULL, producer ? bench_producer : bench_consumer,
+                 job);
+#endif
+}
+
+static void bench_join(bench_thread_t thread)
+{
+#ifdef _WIN32
+  WaitForSingleObject(thread, INFINITE);
+  CloseHandle(thread);
+#else
+  pthread_join(thread, NULL);
+#endif
+}
+
+// -----------------------------------------------------------------------------
+// benchmarks
+
+static void bench_header(void)
+{
+  printf("%-6s %5s %9s %9s %9s %10s %6s\n", "queue", "batch", "producers",
+         "consumers", "Mmsg/s", "MB/s", "check");
+}
+
+// moves total messages from p producers to c consumers, returning whether
+// every message arrived exactly once
+static bool bench_run(bench_kind_t kind, size_t batch, size_t p, size_t c,
+                      size_t total)
+{
+  bench_queue_t q = {.kind = kind, .batch = batch};
+  switch (kind)
+  {
+    case BENCH_MUTEX:
+      bench_mutex_init(&q.lock);
+      stream_ring(q.stream, BENCH_SLOTS * BENCH_MSG);
+      break;
+    case BENCH_SPSC:
+      q.spsc = stream_spsc(BENCH_SLOTS * BENCH_MSG);
+      break;
+    case BENCH_MPMC:
+      q.mpmc = stream_mpmc(BENCH_SLOTS, BENCH_MSG);
+      break;
+  }
+  total                = total / (p * c) * (p * c);
+  bench_job_t *jobs    = (bench_job_t *) calloc(p + c, sizeof(bench_job_t));
+  bench_thread_t *thrs = (bench_thread_t *) calloc(p + c, sizeof(*thrs));
+  uint64_t expect      = 0;
+  for (size_t i = 0; i < p + c; ++i)
+  {
+    jobs[i].queue = &q;
+    jobs[i].id    = i;
+    jobs[i].count = i < p ? total / p : total / c;
+  }
+  for (size_t i = 0; i < p; ++i)
+  {
+    for (size_t seq = 0; seq < total / p; ++seq)
+    {
+      expect += bench_tag(i, seq);
+    }
+  }
+
+  double t = bench_now();
+  for (size_t i = 0; i < p + c; ++i)
+  {
+    bench_spawn(&thrs[i], i < p, &jobs[i]);
+  }
+  uint64_t sum = 0;
+  for (size_t i = 0; i < p + c; ++i)
+  {
+    bench_join(thrs[i]);
+    sum += jobs[i].sum;
+  }
+  t = bench_now() - t;
+
+  bool ok = sum == expect;
+  printf("%-6s %5zu %9zu %9zu %9.2f %10.1f %6s\n", bench_kinds[kind], batch, p,
+         c, (double) total / t * 1e-6,
+         (double) total * BENCH_MSG / t / (1024.0 * 1024.0),
+         ok ? "ok" : "FAIL");
+  free(jobs);
+  free(thrs);
+  switch (kind)
+  {
+    case BENCH_MUTEX:
+      bench_mutex_destroy(&q.lock);
+      stream_free(q.stream);
+      break;
+    case BENCH_SPSC:
+      stream_spsc_free(q.spsc);
+      break;
+    case BENCH_MPMC:
+      stream_mpmc_free(q.mpmc);
+      break;
+  }
+  return ok;
+}
+
+static void bench_usage(const char *exe)
+{
+  printf("usage: %s [--quick] [--threads N]\n"
+         "  --quick      fewer messages per run\n"
+         "  --threads N  most producers and consumers per side (default: "
+         "cores)\n"
+         "exits with 1 when a queue loses or duplicates a message\n",
+         exe);
+}
+
+int main(int argc, char **argv)
+{
+  size_t total   = (size_t) 1 << 22;
+  size_t threads = bench_cpus();
+  for (int i = 1; i < argc; ++i)
+  {
+    if (strcmp(argv[i], "--quick") == 0)
+    {
+      total = (size_t) 1 << 18;
+    }
+    else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc)
+    {
+      threads = (size_t) strtoul(argv[++i], NULL, 10);
+      threads = threads ? threads : 1;
+    }
+    else
+    {
+      bench_usage(argv[0]);
+      return strcmp(argv[i], "--help") == 0 ? 0 : 1;
+    }
+  }
+
+  printf("%zu cores, %d byte messages, %d slots\n\n", bench_cpus(), BENCH_MSG,
+         BENCH_SLOTS);
+  bench_header();
+  bool ok = true;
+  // one producer and one consumer, with and without batching
+  for (size_t batch = 1; batch <= 16; batch *= 16)
+  {
+    ok &= bench_run(BENCH_MUTEX, batch, 1, 1, total);
+    ok &= bench_run(BENCH_SPSC, batch, 1, 1, total);
+  }
+  // contention across both sides
+  for (size_t n = 1; n <= threads; n *= 2)
+  {
+    ok &= bench_run(BENCH_MUTEX, 1, n, n, total);
+    ok &= bench_run(BENCH_MPMC, 1, n, n, total);
+  }
+  return ok ? 0 : 1;
+}
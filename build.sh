@@ -26,20 +26,27 @@ BUILD_ARGS["wav"]="-lm"
 if [[ $OS == win32 ]]; then
     BUILD_ARGS["wav"]="-lwinmm"
     BUILD_ARGS["udp"]="-lws2_32"
+    BUILD_ARGS["dt"]="-lpsapi"
 else
     BUILD_ARGS["mathe"]="-lm"
     BUILD_ARGS["wav"]="-lasound"
     BUILD_ARGS["udp"]="-lnsl -lresolv"
+    BUILD_ARGS["stream"]="-lpthread"
 fi
 
 COMPILE_ARGS=()
 RUNTIME_ARGS=()
 SWITCH=false
+SRC_DIR=tests
+SUFFIX=""
 for arg in "$@"; do
     if $SWITCH; then
         RUNTIME_ARGS+=("$arg")
     elif [[ "$arg" == "--" ]]; then
         SWITCH=true
+    elif [[ "$arg" == "--bench" ]]; then
+        SRC_DIR=bench
+        SUFFIX="_bench"
     else
         COMPILE_ARGS+=("$arg")
     fi
@@ -48,7 +55,8 @@ done
 if [[ "${COMPILE_ARGS[0]}" == "ALL" ]]; then
     APPS=()
     for file in ../*.h; do
-        [ -f "$file" ] && APPS+=("$(basename "$file" .h)")
+        [ -f "$file" ] && [ -f "../$SRC_DIR/$(basename "$file" .h).c" ] && \
+            APPS+=("$(basename "$file" .h)")
     done
 else
     APPS=("${COMPILE_ARGS[@]}")
@@ -56,22 +64,22 @@ fi
 
 for APP in "${APPS[@]}"; do
     if [[ -n "${BUILD_ARGS[$APP]}" ]]; then
-        cc="clang "../tests/$APP.c" \
+        cc="clang "../$SRC_DIR/$APP.c" \
         -O3 -Werror \
-        -o "./$APP$EXT" \
+        -o "./$APP$SUFFIX$EXT" \
         $LIBRARIES ${BUILD_ARGS[$APP]}"
     else
-        cc="clang "../tests/$APP.c" \
+        cc="clang "../$SRC_DIR/$APP.c" \
         -O3 -Werror \
-        -o "./$APP$EXT" \
+        -o "./$APP$SUFFIX$EXT" \
         $LIBRARIES"
     fi
     echo + $cc
     eval $cc
     if [[ -n "${TEST_ARGS[$APP]}" ]]; then
-        exe="./"$APP$EXT" ${TEST_ARGS[$APP]} ${RUNTIME_ARGS[*]}"
+        exe="./"$APP$SUFFIX$EXT" ${TEST_ARGS[$APP]} ${RUNTIME_ARGS[*]}"
     else
-        exe="./"$APP$EXT" ${RUNTIME_ARGS[*]}"
+        exe="./"$APP$SUFFIX$EXT" ${RUNTIME_ARGS[*]}"
     fi
     echo + $exe
     eval $exe
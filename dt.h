@@ -55,6 +55,42 @@
 typedef uint8_t byte;
 #endif
 
+#if defined(_MSC_VER)
+#define DT_THREAD_LOCAL __declspec(thread)
+#elif defined(__STDC_VERSION__) && __STDC_VERSION__ >= 201112L &&             \
+  !defined(__STDC_NO_THREADS__)
+#define DT_THREAD_LOCAL _Thread_local
+#elif defined(__GNUC__) || defined(__clang__)
+#define DT_THREAD_LOCAL __thread
+#else
+#define DT_THREAD_LOCAL
+#endif
+
+// -----------------------------------------------------------------------------
+
+// runtime allocator, for when the compile-time _dt_malloc/_dt_realloc/_dt_free
+// macros are too coarse. all three functions are required. old_size is the
+// size the block was allocated or last resized with.
+typedef struct dt_allocator_t
+{
+  void *(*alloc)(void *user, size_t size);
+  void *(*resize)(void *user, void *ptr, size_t old_size, size_t new_size);
+  void (*release)(void *user, void *ptr);
+  void *user;
+} dt_allocator_t;
+
+// allocate through an allocator, or through the _dt_* macros if it is NULL
+extern void *dt_mem_alloc(const dt_allocator_t *a, size_t size);
+extern void *dt_mem_resize(const dt_allocator_t *a, void *ptr, size_t old_size,
+                           size_t new_size);
+extern void dt_mem_free(const dt_allocator_t *a, void *ptr);
+
+// the calling thread's current allocator, NULL for the _dt_* macros. nodes,
+// strings, and new arrays/maps without an explicit allocator use this one.
+// dt_set_allocator returns the previous allocator so it can be restored.
+extern const dt_allocator_t *dt_allocator(void);
+extern const dt_allocator_t *dt_set_allocator(const dt_allocator_t *a);
+
 // for security against attackers, seed the library with a random number, at
 // least time() but stronger is better
 extern void dt_rand_seed(size_t seed);
@@ -80,6 +116,11 @@ extern void dt_unit_tests(void);
 
 extern void *dt_arrgrowf(void *a, size_t elemsize, size_t addlen,
                          size_t min_cap);
+extern void *dt_arrinitf(size_t elemsize, size_t min_cap,
+                         const dt_allocator_t *alloc);
+extern void *dt_arralignf(void *a, size_t elemsize, size_t align);
+extern void *dt_arrappendf(void *a, size_t elemsize, const void *values,
+                           size_t len);
 extern void *dt_arrtonulltermf(void *a, size_t vallen);
 extern void dt_arrfreef(void *a);
 extern void dt_mapfree_impl(void *p, size_t elemsize);
@@ -92,7 +133,10 @@ extern void *dt_mapput_key(void *a, size_t elemsize, void *key, size_t keysize,
                            int mode);
 extern void *dt_mapdel_key(void *a, size_t elemsize, void *key, size_t keysize,
                            size_t keyoffset, int mode);
-extern void *dt_smpmode_impl(size_t elemsize, int mode);
+extern void *dt_smpmode_impl(size_t elemsize, int mode,
+                             const dt_allocator_t *alloc);
+extern void *dt_mapinit_impl(size_t elemsize, const dt_allocator_t *alloc);
+extern size_t dt_mapcount_impl(void *a, size_t elemsize);
 
 #if !defined(__cplusplus)
 #if defined(__STDC_VERSION__) && __STDC_VERSION__ >= 199901L
@@ -127,12 +171,23 @@ extern void *dt_smpmode_impl(size_t elemsize, int mode);
 #define DT_ADDRESSOF(TypeVar, Value) &(Value)
 #endif
 
-#define DT_OFFSETOF(Var, Field) ((char *) &(Var)->Field - (char *) (var))
+#define DT_OFFSETOF(Var, Field) ((char *) &(Var)->Field - (char *) (Var))
 
 #define dt_arrhead(t) ((dt_arrhead_t *) (t) -1)
 #define dt_temp(t) dt_arrhead(t)->tmp
 #define dt_temp_key(t) (*(char **) dt_arrhead(t)->tbl)
 
+// create an empty array whose storage comes from Alloc for its whole lifetime
+#define dt_arrinit(ArrPtr, Alloc)                                              \
+  ((ArrPtr) = dt_arrinitf(sizeof *(ArrPtr), 0, (Alloc)))
+#define dt_arralloc(ArrPtr) ((ArrPtr) ? dt_arrhead(ArrPtr)->alloc : NULL)
+// keep element storage aligned to Align bytes (a power of two) across growth,
+// e.g. dt_arralign(floats, 64) for aligned AVX loads
+#define dt_arralign(ArrPtr, Align)                                             \
+  ((ArrPtr) = dt_arralignf((ArrPtr), sizeof *(ArrPtr), (Align)))
+#define dt_arralignment(ArrPtr)                                                \
+  ((ArrPtr) && dt_arrhead(ArrPtr)->align ? dt_arrhead(ArrPtr)->align           \
+                                         : DT_ARR_MIN_ALIGN)
 #define dt_arrsetcap(ArrPtr, Capacity) (dt_arrgrow(ArrPtr, 0, Capacity))
 #define dt_arrsetlen(ArrPtr, Len)                                              \
   ((dt_arrcap(ArrPtr) < (size_t) (Len)                                         \
@@ -166,9 +221,14 @@ extern void *dt_smpmode_impl(size_t elemsize, int mode);
    (Len) ? (dt_arrhead(ArrPtr)->len += (Len), dt_arrhead(ArrPtr)->len - (Len)) \
          : dt_arrlen(ArrPtr))
 #define dt_arraddnoff dt_arraddnindex
+// append Len elements copied from Values with a single capacity check,
+// evaluating to the new length
+#define dt_arrappend_n(ArrPtr, Values, Len)                                    \
+  ((ArrPtr) = dt_arrappendf((ArrPtr), sizeof *(ArrPtr), (Values), (Len)),      \
+   dt_arrlenu(ArrPtr))
 #define dt_arrlast(ArrPtr) ((ArrPtr)[dt_arrhead(ArrPtr)->len - 1])
 #define dt_arrfree(ArrPtr)                                                     \
-  ((void) ((ArrPtr) ? _dt_free(dt_arrhead(ArrPtr)) : (void) 0), (ArrPtr) = NULL)
+  ((void) ((ArrPtr) ? dt_arrfreef(ArrPtr) : (void) 0), (ArrPtr) = NULL)
 #define dt_arrdel(ArrPtr, Index) dt_arrdeln(ArrPtr, Index, 1)
 #define dt_arrdeln(ArrPtr, Index, Len)                                         \
   (_dt_memmov(&(ArrPtr)[Index], &(ArrPtr)[(Index) + (Len)],                    \
@@ -213,13 +273,7 @@ extern void *dt_smpmode_impl(size_t elemsize, int mode);
   } while (0)
 
 #define dt_arrconcat(DstArrPtr, SrcArrPtr)                                     \
-  do                                                                           \
-  {                                                                            \
-    size_t dstlen = dt_arrlenu(DstArrPtr);                                     \
-    size_t srclen = dt_arrlenu(SrcArrPtr);                                     \
-    void *__arr   = dt_arraddnptr(DstArrPtr, srclen);                          \
-    _dt_memcpy(__arr, SrcArrPtr, srclen);                                      \
-  } while (0)
+  ((void) dt_arrappend_n(DstArrPtr, SrcArrPtr, dt_arrlenu(SrcArrPtr)))
 
 #define dt_arrtonullterm(ArrPtr) dt_arrtonulltermf((ArrPtr), sizeof *(ArrPtr))
 
@@ -280,6 +334,22 @@ extern void *dt_smpmode_impl(size_t elemsize, int mode);
   ((MapPtr)     = dt_mapput_default((MapPtr), sizeof *(MapPtr)),               \
    (MapPtr)[-1] = (Pair))
 
+// create an empty map whose entries, index, and keys come from Alloc
+#define dt_mapinit(MapPtr, Alloc)                                              \
+  ((MapPtr) = dt_mapinit_impl(sizeof *(MapPtr), (Alloc)))
+
+// an insertion-ordered map: deletes leave holes instead of swapping the last
+// entry in, and both compaction and index rebuilds are spread over later
+// puts/deletes. iterate 0..dt_maplen, skipping entries where !dt_maplive.
+#define dt_mapinit_ordered(MapPtr, Alloc)                                      \
+  ((MapPtr) = dt_smpmode_impl(sizeof *(MapPtr), DT_MAP_ORDERED, (Alloc)))
+#define dt_maplive(MapPtr, Index)                                              \
+  (dt_arrhead((MapPtr) -1)->tbl == NULL ||                                     \
+   ((byte **) dt_arrhead((MapPtr) -1)->tbl)[1] == NULL ||                      \
+   !((byte **) dt_arrhead((MapPtr) -1)->tbl)[1][Index])
+// number of live entries, which dt_maplen overcounts while holes remain
+#define dt_mapcount(MapPtr) dt_mapcount_impl((MapPtr), sizeof *(MapPtr))
+
 #define dt_mapfree(p)                                                          \
   ((void) ((p) != NULL ? dt_mapfree_impl((p) -1, sizeof *(p)), 0 : 0),         \
    (p) = NULL)
@@ -352,9 +422,11 @@ extern void *dt_smpmode_impl(size_t elemsize, int mode);
    (MapPtr) ? dt_temp((MapPtr) -1) : 0)
 
 #define dt_smp_new_arena(MapPtr)                                               \
-  ((MapPtr) = dt_smpmode_impl(sizeof *(MapPtr), DT_SMP_ARENA))
+  ((MapPtr) = dt_smpmode_impl(sizeof *(MapPtr), DT_SMP_ARENA, dt_allocator()))
 #define dt_smp_new_strdup(MapPtr)                                              \
-  ((MapPtr) = dt_smpmode_impl(sizeof *(MapPtr), DT_SMP_STRDUP))
+  ((MapPtr) = dt_smpmode_impl(sizeof *(MapPtr), DT_SMP_STRDUP, dt_allocator()))
+#define dt_smpinit(MapPtr, Mode, Alloc)                                        \
+  ((MapPtr) = dt_smpmode_impl(sizeof *(MapPtr), (Mode), (Alloc)))
 
 #define dt_smpdefault(MapPtr, Value) dt_mapdefault(MapPtr, Value)
 #define dt_smpdefaults(MapPtr, Pair) dt_mapdefaults(MapPtr, Pair)
@@ -367,6 +439,8 @@ extern void *dt_smpmode_impl(size_t elemsize, int mode);
 #define dt_smpgetp_null(MapPtr, Key)                                           \
   (dt_smpgeti(MapPtr, Key) == -1 ? NULL : &(MapPtr)[dt_temp((MapPtr) -1)])
 #define dt_smplen dt_maplen
+#define dt_smplive dt_maplive
+#define dt_smpcount dt_mapcount
 
 typedef struct
 {
@@ -374,8 +448,15 @@ typedef struct
   size_t cap;
   void *tbl;
   ptrdiff_t tmp;
+  const dt_allocator_t *alloc;
+  uint32_t align; // 0 unless set with dt_arralign
+  uint32_t off;   // distance from the start of the allocation to the elements
 } dt_arrhead_t;
 
+// alignment of element storage for arrays that were not given one
+#define DT_ARR_MIN_ALIGN                                                       \
+  (sizeof(dt_arrhead_t) % 16 == 0 ? 16 : sizeof(dt_arrhead_t) % 8 == 0 ? 8 : 4)
+
 typedef struct dt_strblock_t
 {
   struct dt_strblock_t *next;
@@ -388,10 +469,13 @@ struct dt_strarena_t
   size_t remaining;
   unsigned char block;
   unsigned char mode; // this isn't used by the string arena itself
+  const dt_allocator_t *alloc; // NULL for the _dt_* macros
 };
 
 #define DT_MAP_BINARY 0
 #define DT_MAP_STRING 1
+// or'd into the dt_smpinit mode, see dt_mapinit_ordered
+#define DT_MAP_ORDERED 0x100
 
 enum
 {
@@ -452,6 +536,7 @@ const char *dt_type_names[dt_type_count] = {
 typedef struct dt_node
 {
   dt_type type;
+  const dt_allocator_t *alloc; // the allocator the node was created with
   union
   {
 #define X(NAME, TYPE, ...) TYPE NAME##_v;
@@ -530,23 +615,31 @@ extern char *strrchre(const char *string, const char c, const char *end);
 
 extern dt_node *dt_loadf(const char *filepath);
 extern dt_node *dt_loads(const char *string);
+extern dt_node *dt_loadf_ex(const char *filepath, const dt_allocator_t *alloc);
+extern dt_node *dt_loads_ex(const char *string, const dt_allocator_t *alloc);
 extern dt_node *dt_loads_impl(const char *string, size_t *offset);
 extern bool dt_dumpf(const dt_node *node, const char *filepath);
 extern char *dt_dumps(const dt_node *node);
 extern char *dt_dumps_ex(const dt_node *node, const dt_dumps_settings_t *set);
 
 extern dt_node *dt_loadb(const size_t len, const byte *bytes);
+extern dt_node *dt_loadb_ex(const size_t len, const byte *bytes,
+                            const dt_allocator_t *alloc);
 extern dt_node *dt_loadb_impl(const size_t len, const byte *bytes,
                               size_t *offset);
 extern byte *dt_dumpb(const dt_node *node, size_t *len);
-extern void dt_dumpb_impl(const dt_node *node, byte *bytes);
+extern void dt_dumpb_impl(const dt_node *node, byte **bytes);
 
+// frees a tree through the allocator each node was created with, so trees
+// loaded with one of the _ex functions need no extra bookkeeping
 extern void dt_free(dt_node *node);
+// same as dt_free; alloc must be the allocator the tree was loaded with
+extern void dt_free_ex(dt_node *node, const dt_allocator_t *alloc);
 
 extern char *dt_loads_raw_string(const char *string, size_t *offset);
 extern char *dt_dumps_raw_string(const char *string,
                                  const dt_dumps_settings_t *set);
-extern void dt_dumpb_raw_string(const char *string, byte *bytes);
+extern void dt_dumpb_raw_string(const char *string, byte **bytes);
 
 extern void _dt_cons_spc(const char *string, size_t *offset);
 extern void _dt_cons_cmt(const char *string, size_t *offset);
@@ -595,12 +688,13 @@ static inline dt_linecol dt_get_linecol(const char *string, size_t offset)
 #define X(NAME, TYPE, ...)                                                     \
   static inline dt_node *dt_new_##NAME(TYPE val)                               \
   {                                                                            \
-    dt_node *r = (dt_node *) _dt_malloc(sizeof(dt_node));                      \
+    dt_node *r = (dt_node *) dt_mem_alloc(dt_allocator(), sizeof(dt_node));    \
     if (r == NULL)                                                             \
     {                                                                          \
       return NULL;                                                             \
     }                                                                          \
     r->type     = dt_##NAME;                                                   \
+    r->alloc    = dt_allocator();                                              \
     r->NAME##_v = val;                                                         \
     return r;                                                                  \
   }                                                                            \
@@ -609,7 +703,7 @@ static inline dt_linecol dt_get_linecol(const char *string, size_t offset)
   extern dt_node *dt_loads_##NAME(const char *string, size_t *offset);         \
   extern char *dt_dumps_##NAME(const dt_node *node,                            \
                                const dt_dumps_settings_t *set);                \
-  extern void dt_dumpb_##NAME(const dt_node *node, byte *bytes);               \
+  extern void dt_dumpb_##NAME(const dt_node *node, byte **bytes);              \
   extern dt_node *dt_loadb_##NAME(size_t len, const byte *bytes,               \
                                   size_t *offset);
 DT_TYPES_LIST
@@ -657,10 +751,143 @@ DT_TYPES_LIST
 #define DT_ASSERT(x) ((void) 0)
 #endif
 
+// allocations owned by nodes follow the calling thread's allocator
+#define _dt_scoped_malloc(_Size) dt_mem_alloc(dt_allocator(), _Size)
+#define _dt_scoped_realloc(_BlockPtr, _OldSize, _Size)                         \
+  dt_mem_resize(dt_allocator(), _BlockPtr, _OldSize, _Size)
+#define _dt_scoped_free(_BlockPtr) dt_mem_free(dt_allocator(), _BlockPtr)
+
+//
+// allocator implementation
+//
+
+static DT_THREAD_LOCAL const dt_allocator_t *_dt_allocator = NULL;
+
+void *dt_mem_alloc(const dt_allocator_t *a, size_t size)
+{
+  return a ? a->alloc(a->user, size) : _dt_malloc(size);
+}
+
+void *dt_mem_resize(const dt_allocator_t *a, void *ptr, size_t old_size,
+                    size_t new_size)
+{
+  if (a == NULL)
+  {
+    return _dt_realloc(ptr, new_size);
+  }
+  if (ptr == NULL)
+  {
+    return a->alloc(a->user, new_size);
+  }
+  return a->resize(a->user, ptr, old_size, new_size);
+}
+
+void dt_mem_free(const dt_allocator_t *a, void *ptr)
+{
+  if (ptr == NULL)
+  {
+    return;
+  }
+  if (a)
+  {
+    a->release(a->user, ptr);
+  }
+  else
+  {
+    _dt_free(ptr);
+  }
+}
+
+const dt_allocator_t *dt_allocator(void)
+{
+  return _dt_allocator;
+}
+
+const dt_allocator_t *dt_set_allocator(const dt_allocator_t *a)
+{
+  const dt_allocator_t *prev = _dt_allocator;
+  _dt_allocator              = a;
+  return prev;
+}
+
 //
 // dt_arr implementation
 //
 
+#define DT_ALIGN_FWD(n, a) (((n) + (a) -1) & ~((a) -1))
+
+#define dt_arrbase(a) ((char *) (a) -dt_arrhead(a)->off)
+
+// bytes to allocate for cap elements, including the header and any slack
+// needed to align the elements
+static size_t dt_arrblocksize(size_t elemsize, size_t cap, size_t align)
+{
+  size_t size = elemsize * cap + sizeof(dt_arrhead_t);
+  return align > DT_ARR_MIN_ALIGN ? size + align - 1 : size;
+}
+
+// place header and elements inside a (re)allocated block. if a previous
+// allocation placed them at old_off, the old contents are moved to line up
+static void *dt_arrplace(char *block, size_t align, size_t old_off,
+                         size_t used)
+{
+  size_t off = sizeof(dt_arrhead_t);
+  if (align > DT_ARR_MIN_ALIGN)
+  {
+    off = DT_ALIGN_FWD((size_t) block + off, align) - (size_t) block;
+  }
+  if (old_off && old_off != off)
+  {
+    _dt_memmov(block + off - sizeof(dt_arrhead_t),
+               block + old_off - sizeof(dt_arrhead_t),
+               sizeof(dt_arrhead_t) + used);
+  }
+  void *b            = block + off;
+  dt_arrhead(b)->off = (uint32_t) off;
+  return b;
+}
+
+void *dt_arrinitf(size_t elemsize, size_t min_cap, const dt_allocator_t *alloc)
+{
+  if (min_cap < 4)
+  {
+    min_cap = 4;
+  }
+  char *block = dt_mem_alloc(alloc, dt_arrblocksize(elemsize, min_cap, 0));
+  void *b     = dt_arrplace(block, 0, 0, 0);
+
+  dt_arrhead(b)->len   = 0;
+  dt_arrhead(b)->cap   = min_cap;
+  dt_arrhead(b)->tbl   = 0;
+  dt_arrhead(b)->tmp   = 0;
+  dt_arrhead(b)->alloc = alloc;
+  dt_arrhead(b)->align = 0;
+  return b;
+}
+
+void *dt_arralignf(void *a, size_t elemsize, size_t align)
+{
+  DT_ASSERT((align & (align - 1)) == 0);
+  if (a == NULL)
+  {
+    a = dt_arrinitf(elemsize, 0, dt_allocator());
+  }
+  if (align <= DT_ARR_MIN_ALIGN || align == dt_arrhead(a)->align)
+  {
+    return a;
+  }
+  size_t cap  = dt_arrcap(a);
+  size_t used = elemsize * dt_arrlenu(a);
+  size_t off  = dt_arrhead(a)->off;
+  char *block = dt_mem_resize(
+    dt_arrhead(a)->alloc, dt_arrbase(a),
+    dt_arrblocksize(elemsize, cap, dt_arrhead(a)->align),
+    dt_arrblocksize(elemsize, cap, align));
+  void *b              = dt_arrplace(block, align, off, used);
+  dt_arrhead(b)->align = (uint32_t) align;
+  return b;
+}
+
 void *dt_arrgrowf(void *a, size_t elemsize, size_t addlen, size_t min_cap)
 {
   (void) elemsize;
@@ -688,22 +915,41 @@ void *dt_arrgrowf(void *a, size_t elemsize, size_t addlen, size_t min_cap)
     min_cap = 4;
   }
 
-  printf("arrgrowf(%p, %llu, %llu, %llu), %llu->%llu\n", a, elemsize, addlen,
-         min_cap, dt_arrcap(a), min_cap);
-  b = _dt_realloc((a) ? dt_arrhead(a) : NULL,
-                  elemsize * min_cap + sizeof(dt_arrhead_t));
-  b = (char *) b + sizeof(dt_arrhead_t);
+  const dt_allocator_t *alloc = a ? dt_arrhead(a)->alloc : dt_allocator();
+  size_t align                = a ? dt_arrhead(a)->align : 0;
+  size_t off                  = a ? dt_arrhead(a)->off : 0;
+  size_t used                 = elemsize * dt_arrlenu(a);
+  char *block                 = dt_mem_resize(
+    alloc, a ? dt_arrbase(a) : NULL,
+    a ? dt_arrblocksize(elemsize, dt_arrcap(a), align) : 0,
+    dt_arrblocksize(elemsize, min_cap, align));
+  b = dt_arrplace(block, align, off, used);
   if (a == NULL)
   {
-    dt_arrhead(b)->len = 0;
-    dt_arrhead(b)->tbl = 0;
-    dt_arrhead(b)->tmp = 0;
+    dt_arrhead(b)->len   = 0;
+    dt_arrhead(b)->tbl   = 0;
+    dt_arrhead(b)->tmp   = 0;
+    dt_arrhead(b)->alloc = alloc;
+    dt_arrhead(b)->align = 0;
   }
   dt_arrhead(b)->cap = min_cap;
 
   return b;
 }
 
+void *dt_arrappendf(void *a, size_t elemsize, const void *values, size_t len)
+{
+  if (len == 0)
+  {
+    return a;
+  }
+  a = dt_arrgrowf(a, elemsize, len, 0);
+  _dt_memcpy((char *) a + elemsize * dt_arrhead(a)->len, values,
+             elemsize * len);
+  dt_arrhead(a)->len += len;
+  return a;
+}
+
 void *dt_arrtonulltermf(void *a, size_t vallen)
 {
   size_t arrlen = dt_arrlen(a);
@@ -712,7 +958,7 @@ void *dt_arrtonulltermf(void *a, size_t vallen)
     return NULL;
   }
 
-  char *b = _dt_realloc(NULL, vallen * (arrlen + 1));
+  char *b = _dt_scoped_malloc(vallen * (arrlen + 1));
   _dt_memcpy(b, a, vallen * arrlen);
   _dt_memset(&(b)[vallen * arrlen], 0, vallen);
   return b;
@@ -720,7 +966,7 @@ void *dt_arrtonulltermf(void *a, size_t vallen)
 
 void dt_arrfreef(void *a)
 {
-  _dt_free(dt_arrhead(a));
+  dt_mem_free(dt_arrhead(a)->alloc, dt_arrbase(a));
 }
 
 //
@@ -755,8 +1001,6 @@ static const size_t _DT_FNV_OFFSET = 2166136261;
 #define DT_BUCKET_MASK (DT_BUCKET_LENGTH - 1)
 #define DT_CACHE_LINE_SIZE 64
 
-#define DT_ALIGN_FWD(n, a) (((n) + (a) -1) & ~((a) -1))
-
 typedef struct
 {
   size_t hash[DT_BUCKET_LENGTH];
@@ -764,9 +1008,11 @@ typedef struct
 } dt_hshbucket_t; // in 32-bit, this is one 64-byte cache line; in 64-bit,
                   // each array is one 64-byte cache line
 
-typedef struct
+typedef struct dt_hshindex_t
 {
   char *temp_key; // this MUST be the first field of the hash table
+  byte *dead; // this MUST be the second field, see dt_maplive. ordered maps
+              // only, one flag per entry that is set while it awaits compaction
   size_t slot_count;
   size_t used_count;
   size_t used_count_threshold;
@@ -778,6 +1024,17 @@ typedef struct
   dt_strarena_t string;
   dt_hshbucket_t *storage; // not a separate allocation, just 64-byte
                            // aligned storage after this struct
+  int flags;               // DT_MAP_ORDERED
+  // ordered maps rebuild into a new index a few buckets per operation, and
+  // lookups fall back to the old one until it has been drained
+  struct dt_hshindex_t *prev;
+  size_t prev_bucket;
+  // deleted entries stay in place until a compaction pass slides the live
+  // ones down over them, a few entries per operation
+  size_t hole_count;
+  size_t compact_read;
+  size_t compact_write;
+  bool compacting;
 } dt_hshindex_t;
 
 #define DT_INDEX_EMPTY -1
@@ -825,12 +1082,15 @@ static size_t dt_log2(size_t slot_count)
   return n;
 }
 
-static dt_hshindex_t *dt_make_hash_index(size_t slot_count, dt_hshindex_t *ot)
+// a cleared index; metadata, but no entries, are carried over from ot
+static dt_hshindex_t *dt_make_empty_hash_index(size_t slot_count,
+                                               dt_hshindex_t *ot,
+                                               const dt_allocator_t *alloc)
 {
   dt_hshindex_t *t;
-  t = (dt_hshindex_t *) _dt_realloc(
-    NULL, (slot_count >> DT_BUCKET_SHIFT) * sizeof(dt_hshbucket_t) +
-            sizeof(dt_hshindex_t) + DT_CACHE_LINE_SIZE - 1);
+  t = (dt_hshindex_t *) dt_mem_alloc(
+    alloc, (slot_count >> DT_BUCKET_SHIFT) * sizeof(dt_hshbucket_t) +
+             sizeof(dt_hshindex_t) + DT_CACHE_LINE_SIZE - 1);
   t->storage =
     (dt_hshbucket_t *) DT_ALIGN_FWD((size_t) (t + 1), DT_CACHE_LINE_SIZE);
   t->slot_count      = slot_count;
@@ -904,11 +1164,20 @@ static dt_hshindex_t *dt_make_hash_index(size_t slot_count, dt_hshindex_t *ot)
     // reuse old seed so we can reuse old hashes so below "copy out old
     // data" doesn't do any hashing
     t->seed = ot->seed;
+    // the entry array doesn't change, so neither does its ordering state
+    t->flags         = ot->flags;
+    t->dead          = ot->dead;
+    t->hole_count    = ot->hole_count;
+    t->compact_read  = ot->compact_read;
+    t->compact_write = ot->compact_write;
+    t->compacting    = ot->compacting;
+    t->used_count    = ot->used_count;
   }
   else
   {
     size_t a, b, temp;
     _dt_memset(&t->string, 0, sizeof(t->string));
+    t->string.alloc = alloc;
     t->seed = dt_hash_seed;
     // LCG
     // in 32-bit, a =          2147001325   b =  715136305
@@ -916,7 +1185,16 @@ static dt_hshindex_t *dt_make_hash_index(size_t slot_count, dt_hshindex_t *ot)
     dt_load_32_or_64(a, temp, 2147001325, 0x27bb2ee6, 0x87b0b0fd);
     dt_load_32_or_64(b, temp, 715136305, 0, 0xb504f32d);
     dt_hash_seed = dt_hash_seed * a + b;
+    t->flags         = 0;
+    t->dead          = NULL;
+    t->hole_count    = 0;
+    t->compact_read  = 0;
+    t->compact_write = 0;
+    t->compacting    = false;
   }
+  t->temp_key    = NULL;
+  t->prev        = NULL;
+  t->prev_bucket = 0;
 
   {
     size_t i, j;
@@ -930,56 +1208,63 @@ static dt_hshindex_t *dt_make_hash_index(size_t slot_count, dt_hshindex_t *ot)
     }
   }
 
+  return t;
+}
+
+// stores an index entry in the first empty slot of its probe sequence; the
+// caller guarantees the key isn't already present
+static void dt_hash_place(dt_hshindex_t *t, size_t hash, ptrdiff_t index)
+{
+  size_t pos  = dt_probe_position(hash, t->slot_count, t->slot_count_log2);
+  size_t step = DT_BUCKET_LENGTH;
+  for (;;)
+  {
+    size_t limit, z;
+    dt_hshbucket_t *bucket;
+    bucket = &t->storage[pos >> DT_BUCKET_SHIFT];
+
+    for (z = pos & DT_BUCKET_MASK; z < DT_BUCKET_LENGTH; ++z)
+    {
+      if (bucket->hash[z] == 0)
+      {
+        bucket->hash[z]  = hash;
+        bucket->index[z] = index;
+        return;
+      }
+    }
+
+    limit = pos & DT_BUCKET_MASK;
+    for (z = 0; z < limit; ++z)
+    {
+      if (bucket->hash[z] == 0)
+      {
+        bucket->hash[z]  = hash;
+        bucket->index[z] = index;
+        return;
+      }
+    }
+
+    pos += step; // quadratic probing
+    step += DT_BUCKET_LENGTH;
+    pos &= (t->slot_count - 1);
+  }
+}
+
+static dt_hshindex_t *dt_make_hash_index(size_t slot_count, dt_hshindex_t *ot,
+                                         const dt_allocator_t *alloc)
+{
+  dt_hshindex_t *t = dt_make_empty_hash_index(slot_count, ot, alloc);
+
   // copy out the old data, if any
   if (ot)
   {
     size_t i, j;
-    t->used_count = ot->used_count;
     for (i = 0; i < ot->slot_count >> DT_BUCKET_SHIFT; ++i)
     {
       dt_hshbucket_t *ob = &ot->storage[i];
       for (j = 0; j < DT_BUCKET_LENGTH; ++j)
-      {
         if (DT_INDEX_IN_USE(ob->index[j]))
-        {
-          size_t hash = ob->hash[j];
-          size_t pos =
-            dt_probe_position(hash, t->slot_count, t->slot_count_log2);
-          size_t step = DT_BUCKET_LENGTH;
-          for (;;)
-          {
-            size_t limit, z;
-            dt_hshbucket_t *bucket;
-            bucket = &t->storage[pos >> DT_BUCKET_SHIFT];
-
-            for (z = pos & DT_BUCKET_MASK; z < DT_BUCKET_LENGTH; ++z)
-            {
-              if (bucket->hash[z] == 0)
-              {
-                bucket->hash[z]  = hash;
-                bucket->index[z] = ob->index[j];
-                goto done;
-              }
-            }
-
-            limit = pos & DT_BUCKET_MASK;
-            for (z = 0; z < limit; ++z)
-            {
-              if (bucket->hash[z] == 0)
-              {
-                bucket->hash[z]  = hash;
-                bucket->index[z] = ob->index[j];
-                goto done;
-              }
-            }
-
-            pos += step; // quadratic probing
-            step += DT_BUCKET_LENGTH;
-            pos &= (t->slot_count - 1);
-          }
-        }
-      done:;
-      }
+          dt_hash_place(t, ob->hash[j], ob->index[j]);
     }
   }
 
@@ -1174,17 +1459,13 @@ size_t dt_hash_bytes(void *p, size_t len, size_t seed)
     hash ^= hash >> 16;
 #endif
 #ifdef DT_HASHFUNC_FNV
-    // Danny's Numerically Optimized Fowler–Noll–Vo
-    hash ^= seed;
-    hash *= _DT_FNV_OFFSET;
-    hash *= _DT_FNV_PRIME;
-    hash ^= (hash << 0);
-    hash *= _DT_FNV_PRIME;
-    hash ^= (hash << 8);
-    hash *= _DT_FNV_PRIME;
-    hash ^= (hash << 16);
-    hash *= _DT_FNV_PRIME;
-    hash ^= (hash << 24);
+    // seeded FNV-1a over the four key bytes, so every byte reaches the low
+    // bits that pick the bucket
+    hash = (unsigned int) (_DT_FNV_OFFSET ^ seed);
+    hash = (hash ^ d[0]) * (unsigned int) _DT_FNV_PRIME;
+    hash = (hash ^ d[1]) * (unsigned int) _DT_FNV_PRIME;
+    hash = (hash ^ d[2]) * (unsigned int) _DT_FNV_PRIME;
+    hash = (hash ^ d[3]) * (unsigned int) _DT_FNV_PRIME;
 #endif
     // Following statistics were measured on a Core i7-6700 @ 4.00Ghz,
     // compiled with clang 7.0.1 -O2 Note that the larger tables have
@@ -1258,37 +1539,48 @@ void dt_mapfree_impl(void *a, size_t elemsize)
 {
   if (a == NULL)
     return;
+  const dt_allocator_t *alloc = dt_arrhead(a)->alloc;
   if (dt_hash_table(a) != NULL)
   {
-    if (dt_hash_table(a)->string.mode == DT_SMP_STRDUP)
+    dt_hshindex_t *table = dt_hash_table(a);
+    if (table->string.mode == DT_SMP_STRDUP)
     {
       size_t i;
-      // skip 0th element, which is default
+      // skip 0th element, which is default; dead entries were already freed
       for (i = 1; i < dt_arrhead(a)->len; ++i)
-        _dt_free(*(char **) ((char *) a + elemsize * i));
+        if (table->dead == NULL || !table->dead[i - 1])
+          dt_mem_free(alloc, *(char **) ((char *) a + elemsize * i));
     }
-    dt_strreset(&dt_hash_table(a)->string);
+    dt_strreset(&table->string);
+    if (table->dead)
+      dt_arrfreef(table->dead);
+    if (table->prev)
+      dt_mem_free(alloc, table->prev);
   }
-  _dt_free(dt_arrhead(a)->tbl);
-  _dt_free(dt_arrhead(a));
+  dt_mem_free(alloc, dt_arrhead(a)->tbl);
+  dt_mem_free(alloc, dt_arrbase(a));
 }
 
-static ptrdiff_t dt_map_find_slot(void *a, size_t elemsize, void *key,
-                                  size_t keysize, size_t keyoffset, int mode)
+static size_t dt_map_hash(dt_hshindex_t *table, void *key, size_t keysize,
+                          int mode)
 {
-  void *raw_a          = DT_HASH_TO_ARR(a, elemsize);
-  dt_hshindex_t *table = dt_hash_table(raw_a);
-  size_t hash          = mode >= DT_MAP_STRING
-                           ? dt_hash_string((char *) key, table->seed)
-                           : dt_hash_bytes(key, keysize, table->seed);
-  size_t step          = DT_BUCKET_LENGTH;
-  size_t limit, i;
-  size_t pos;
-  dt_hshbucket_t *bucket;
-
+  size_t hash = mode >= DT_MAP_STRING
+                  ? dt_hash_string((char *) key, table->seed)
+                  : dt_hash_bytes(key, keysize, table->seed);
   if (hash < 2)
     hash += 2; // stored hash values are forbidden from being 0, so we
                // can detect empty slots
+  return hash;
+}
+
+static ptrdiff_t dt_map_probe(dt_hshindex_t *table, void *a, size_t elemsize,
+                              size_t hash, void *key, size_t keysize,
+                              size_t keyoffset, int mode)
+{
+  size_t step = DT_BUCKET_LENGTH;
+  size_t limit, i;
+  size_t pos;
+  dt_hshbucket_t *bucket;
 
   pos = dt_probe_position(hash, table->slot_count, table->slot_count_log2);
 
@@ -1340,6 +1632,27 @@ static ptrdiff_t dt_map_find_slot(void *a, size_t elemsize, void *key,
   /* NOTREACHED */
 }
 
+// finds the slot holding key, and which index it lives in: the current one,
+// or the one an ordered map is still migrating out of
+static ptrdiff_t dt_map_find_slot(void *a, size_t elemsize, void *key,
+                                  size_t keysize, size_t keyoffset, int mode,
+                                  dt_hshindex_t **found)
+{
+  void *raw_a          = DT_HASH_TO_ARR(a, elemsize);
+  dt_hshindex_t *table = dt_hash_table(raw_a);
+  size_t hash          = dt_map_hash(table, key, keysize, mode);
+  ptrdiff_t slot =
+    dt_map_probe(table, a, elemsize, hash, key, keysize, keyoffset, mode);
+  *found = table;
+  if (slot < 0 && table->prev)
+  {
+    *found = table->prev;
+    slot   = dt_map_probe(table->prev, a, elemsize, hash, key, keysize,
+                          keyoffset, mode);
+  }
+  return slot;
+}
+
 void *dt_mapget_key_ts(void *a, size_t elemsize, void *key, size_t keysize,
                        ptrdiff_t *temp, int mode)
 {
@@ -1367,7 +1680,7 @@ void *dt_mapget_key_ts(void *a, size_t elemsize, void *key, size_t keysize,
     else
     {
       ptrdiff_t slot =
-        dt_map_find_slot(a, elemsize, key, keysize, keyoffset, mode);
+        dt_map_find_slot(a, elemsize, key, keysize, keyoffset, mode, &table);
       if (slot < 0)
       {
         *temp = DT_INDEX_EMPTY;
@@ -1391,6 +1704,16 @@ void *dt_mapget_key(void *a, size_t elemsize, void *key, size_t keysize,
   return p;
 }
 
+size_t dt_mapcount_impl(void *a, size_t elemsize)
+{
+  void *raw_a;
+  if (a == NULL)
+    return 0;
+  raw_a = DT_HASH_TO_ARR(a, elemsize);
+  return dt_hash_table(raw_a) ? dt_hash_table(raw_a)->used_count
+                              : dt_arrhead(raw_a)->len - 1;
+}
+
 void *dt_mapput_default(void *a, size_t elemsize)
 {
   // three cases:
@@ -1407,7 +1730,137 @@ void *dt_mapput_default(void *a, size_t elemsize)
   return a;
 }
 
-static char *dt_strdup(char *str);
+static char *dt_strdup(const dt_allocator_t *alloc, const char *str);
+
+void *dt_mapinit_impl(size_t elemsize, const dt_allocator_t *alloc)
+{
+  void *a = dt_arrinitf(elemsize, 1, alloc);
+  _dt_memset(a, 0, elemsize);
+  dt_arrhead(a)->len = 1;
+  return DT_ARR_TO_HASH(a, elemsize);
+}
+
+// work an ordered map does per put/delete to pay down a rebuild or compaction
+#ifndef DT_MAP_MIGRATE_BUCKETS
+#define DT_MAP_MIGRATE_BUCKETS 2
+#endif
+#ifndef DT_MAP_COMPACT_ENTRIES
+#define DT_MAP_COMPACT_ENTRIES 8
+#endif
+
+// copies up to 'buckets' buckets out of t->prev. the old slots are left alone
+// so that its probe sequences still end at empty slots; lookups try t first,
+// and deletes scrub the old copy, so a stale one is never seen.
+static void dt_map_migrate(dt_hshindex_t *t, size_t buckets,
+                           const dt_allocator_t *alloc)
+{
+  dt_hshindex_t *ot = t->prev;
+  size_t count      = ot->slot_count >> DT_BUCKET_SHIFT;
+  while (buckets-- > 0 && t->prev_bucket < count)
+  {
+    dt_hshbucket_t *ob = &ot->storage[t->prev_bucket++];
+    size_t j;
+    for (j = 0; j < DT_BUCKET_LENGTH; ++j)
+      if (DT_INDEX_IN_USE(ob->index[j]))
+        dt_hash_place(t, ob->hash[j], ob->index[j]);
+  }
+  if (t->prev_bucket == count)
+  {
+    dt_mem_free(alloc, ot);
+    t->prev        = NULL;
+    t->prev_bucket = 0;
+  }
+}
+
+// replaces an ordered map's index with an empty one of slot_count slots that
+// fills itself from the old one as the map is used
+static dt_hshindex_t *dt_map_rehash(void *raw_a, dt_hshindex_t *table,
+                                    size_t slot_count)
+{
+  const dt_allocator_t *alloc = dt_arrhead(raw_a)->alloc;
+  dt_hshindex_t *nt;
+  // rare: the previous rebuild hasn't drained yet, so finish it now
+  if (table->prev)
+    dt_map_migrate(table, (size_t) -1, alloc);
+  nt                     = dt_make_empty_hash_index(slot_count, table, alloc);
+  nt->prev               = table;
+  dt_arrhead(raw_a)->tbl = nt;
+  return nt;
+}
+
+// slides up to 'entries' live entries of an ordered map down over the dead
+// ones, keeping their order and repointing their index slots
+static void dt_map_compact(void *a, size_t elemsize, size_t keysize,
+                           size_t keyoffset, int mode, size_t entries)
+{
+  void *raw_a          = DT_HASH_TO_ARR(a, elemsize);
+  dt_hshindex_t *table = dt_hash_table(raw_a);
+  size_t len           = dt_arrhead(raw_a)->len - 1;
+  while (entries-- > 0 && table->compact_read < len)
+  {
+    size_t r = table->compact_read++;
+    size_t w;
+    if (table->dead[r])
+    {
+      --table->hole_count;
+      continue;
+    }
+    w = table->compact_write++;
+    if (r != w)
+    {
+      char *src = (char *) a + elemsize * r;
+      void *key =
+        mode >= DT_MAP_STRING ? *(char **) (src + keyoffset) : src + keyoffset;
+      dt_hshindex_t *in;
+      ptrdiff_t slot =
+        dt_map_find_slot(a, elemsize, key, keysize, keyoffset, mode, &in);
+      dt_hshbucket_t *b;
+      DT_ASSERT(slot >= 0);
+      b = &in->storage[slot >> DT_BUCKET_SHIFT];
+      DT_ASSERT(b->index[slot & DT_BUCKET_MASK] == (ptrdiff_t) r);
+      b->index[slot & DT_BUCKET_MASK] = (ptrdiff_t) w;
+      if (in == table && table->prev)
+      {
+        // keep the old slot of a migrated key pointing at the right entry
+        slot = dt_map_probe(table->prev, a, elemsize,
+                            dt_map_hash(table, key, keysize, mode), key,
+                            keysize, keyoffset, mode);
+        if (slot >= 0)
+          table->prev->storage[slot >> DT_BUCKET_SHIFT]
+            .index[slot & DT_BUCKET_MASK] = (ptrdiff_t) w;
+      }
+      _dt_memcpy((char *) a + elemsize * w, src, elemsize);
+      table->dead[w] = 0;
+      table->dead[r] = 1; // stale copy, iteration must skip it
+    }
+  }
+  if (table->compact_read == len)
+  {
+    dt_arrhead(raw_a)->len       = table->compact_write + 1;
+    dt_arrhead(table->dead)->len = table->compact_write;
+    table->compacting            = false;
+  }
+}
+
+// the bounded amount of deferred work an ordered map does on each mutation
+static void dt_map_step(void *a, size_t elemsize, size_t keysize,
+                        size_t keyoffset, int mode)
+{
+  void *raw_a          = DT_HASH_TO_ARR(a, elemsize);
+  dt_hshindex_t *table = dt_hash_table(raw_a);
+  if (table->prev)
+    dt_map_migrate(table, DT_MAP_MIGRATE_BUCKETS, dt_arrhead(raw_a)->alloc);
+  if (!table->compacting && table->hole_count > 0 &&
+      table->hole_count >= (dt_arrhead(raw_a)->len - 1) >> 2)
+  {
+    table->compacting    = true;
+    table->compact_read  = 0;
+    table->compact_write = 0;
+  }
+  if (table->compacting)
+    dt_map_compact(a, elemsize, keysize, keyoffset, mode,
+                   DT_MAP_COMPACT_ENTRIES);
+}
 
 void *dt_mapput_key(void *a, size_t elemsize, void *key, size_t keysize,
                     int mode)
@@ -1431,35 +1884,44 @@ void *dt_mapput_key(void *a, size_t elemsize, void *key, size_t keysize,
 
   table = (dt_hshindex_t *) dt_arrhead(a)->tbl;
 
+  if (table && (table->flags & DT_MAP_ORDERED))
+  {
+    dt_map_step(raw_a, elemsize, keysize, keyoffset, mode);
+    table = (dt_hshindex_t *) dt_arrhead(a)->tbl;
+  }
+
   if (table == NULL || table->used_count >= table->used_count_threshold)
   {
     dt_hshindex_t *nt;
     size_t slot_count;
 
     slot_count = (table == NULL) ? DT_BUCKET_LENGTH : table->slot_count * 2;
-    nt         = dt_make_hash_index(slot_count, table);
-    if (table)
-      _dt_free(table);
+    if (table && (table->flags & DT_MAP_ORDERED))
+    {
+      table = dt_map_rehash(a, table, slot_count);
+    }
     else
-      nt->string.mode = mode >= DT_MAP_STRING ? DT_SMP_DEFAULT : 0;
-    dt_arrhead(a)->tbl = table = nt;
+    {
+      nt = dt_make_hash_index(slot_count, table, dt_arrhead(a)->alloc);
+      if (table)
+        dt_mem_free(dt_arrhead(a)->alloc, table);
+      else
+        nt->string.mode = mode >= DT_MAP_STRING ? DT_SMP_DEFAULT : 0;
+      dt_arrhead(a)->tbl = table = nt;
+    }
   }
 
   // we iterate hash table explicitly because we want to track if we saw a
   // tombstone
   {
-    size_t hash = mode >= DT_MAP_STRING
-                    ? dt_hash_string((char *) key, table->seed)
-                    : dt_hash_bytes(key, keysize, table->seed);
+    // stored hash values are forbidden from being 0, so we can detect
+    // empty slots to early out quickly
+    size_t hash = dt_map_hash(table, key, keysize, mode);
     size_t step = DT_BUCKET_LENGTH;
     size_t pos;
     ptrdiff_t tombstone = -1;
     dt_hshbucket_t *bucket;
 
-    // stored hash values are forbidden from being 0, so we can detect
-    // empty slots to early out quickly
-    if (hash < 2)
-      hash += 2;
 
     pos = dt_probe_position(hash, table->slot_count, table->slot_count_log2);
 
@@ -1527,6 +1989,21 @@ void *dt_mapput_key(void *a, size_t elemsize, void *key, size_t keysize,
       pos &= (table->slot_count - 1);
     }
   found_empty_slot:
+    // keys that haven't been migrated yet are only in the old index
+    if (table->prev)
+    {
+      ptrdiff_t slot = dt_map_probe(table->prev, raw_a, elemsize, hash, key,
+                                    keysize, keyoffset, mode);
+      if (slot >= 0)
+      {
+        bucket     = &table->prev->storage[slot >> DT_BUCKET_SHIFT];
+        dt_temp(a) = bucket->index[slot & DT_BUCKET_MASK];
+        if (mode >= DT_MAP_STRING)
+          dt_temp_key(a) = *(char **) ((char *) raw_a + elemsize * dt_temp(a) +
+                                       keyoffset);
+        return DT_ARR_TO_HASH(a, elemsize);
+      }
+    }
     if (tombstone >= 0)
     {
       pos = tombstone;
@@ -1548,12 +2025,14 @@ void *dt_mapput_key(void *a, size_t elemsize, void *key, size_t keysize,
       bucket->hash[pos & DT_BUCKET_MASK]  = hash;
       bucket->index[pos & DT_BUCKET_MASK] = i - 1;
       dt_temp(a)                          = i - 1;
+      if (table->flags & DT_MAP_ORDERED)
+        dt_arrput(table->dead, 0);
 
       switch (table->string.mode)
       {
         case DT_SMP_STRDUP:
           dt_temp_key(a) = *(char **) ((char *) a + elemsize * i) =
-            dt_strdup((char *) key);
+            dt_strdup(dt_arrhead(a)->alloc, (char *) key);
           break;
         case DT_SMP_ARENA:
           dt_temp_key(a) = *(char **) ((char *) a + elemsize * i) =
@@ -1572,15 +2051,18 @@ void *dt_mapput_key(void *a, size_t elemsize, void *key, size_t keysize,
   }
 }
 
-void *dt_smpmode_impl(size_t elemsize, int mode)
+void *dt_smpmode_impl(size_t elemsize, int mode, const dt_allocator_t *alloc)
 {
-  void *a = dt_arrgrowf(0, elemsize, 0, 1);
+  void *a = dt_arrinitf(elemsize, 1, alloc);
   dt_hshindex_t *h;
   _dt_memset(a, 0, elemsize);
   dt_arrhead(a)->len = 1;
   dt_arrhead(a)->tbl = h =
-    (dt_hshindex_t *) dt_make_hash_index(DT_BUCKET_LENGTH, NULL);
-  h->string.mode = (byte) mode;
+    (dt_hshindex_t *) dt_make_hash_index(DT_BUCKET_LENGTH, NULL, alloc);
+  h->string.mode = (byte) (mode & ~DT_MAP_ORDERED);
+  h->flags       = mode & DT_MAP_ORDERED;
+  if (h->flags & DT_MAP_ORDERED)
+    h->dead = (byte *) dt_arrinitf(sizeof(byte), DT_BUCKET_LENGTH, alloc);
   return DT_ARR_TO_HASH(a, elemsize);
 }
 
@@ -1604,66 +2086,118 @@ void *dt_mapdel_key(void *a, size_t elemsize, void *key, size_t keysize,
     else
     {
       ptrdiff_t slot;
-      slot = dt_map_find_slot(a, elemsize, key, keysize, keyoffset, mode);
+      dt_hshindex_t *in;
+      slot = dt_map_find_slot(a, elemsize, key, keysize, keyoffset, mode, &in);
       if (slot < 0)
         return a;
       else
       {
-        dt_hshbucket_t *b   = &table->storage[slot >> DT_BUCKET_SHIFT];
+        dt_hshbucket_t *b   = &in->storage[slot >> DT_BUCKET_SHIFT];
         int i               = slot & DT_BUCKET_MASK;
         ptrdiff_t old_index = b->index[i];
         ptrdiff_t final_index =
           (ptrdiff_t) dt_arrlen(raw_a) - 1 - 1; // minus one for the raw_a vs
                                                 // a, and minus one for 'last'
-        DT_ASSERT(slot < (ptrdiff_t) table->slot_count);
+        DT_ASSERT(slot < (ptrdiff_t) in->slot_count);
         --table->used_count;
-        ++table->tombstone_count;
+        // tombstones left in an index being migrated out of don't matter
+        if (in == table)
+          ++table->tombstone_count;
         dt_temp(raw_a) = 1;
         DT_ASSERT(table->used_count >= 0);
         // DT_ASSERT(table->tombstone_count < table->slot_count/4);
         b->hash[i]  = DT_HASH_DELETED;
         b->index[i] = DT_INDEX_DELETED;
+        if (in == table && table->prev)
+        {
+          // a migrated key also still has its old slot
+          slot = dt_map_probe(table->prev, a, elemsize,
+                              dt_map_hash(table, key, keysize, mode), key,
+                              keysize, keyoffset, mode);
+          if (slot >= 0)
+          {
+            dt_hshbucket_t *ob = &table->prev->storage[slot >> DT_BUCKET_SHIFT];
+            ob->hash[slot & DT_BUCKET_MASK]  = DT_HASH_DELETED;
+            ob->index[slot & DT_BUCKET_MASK] = DT_INDEX_DELETED;
+          }
+        }
 
         if (mode == DT_MAP_STRING && table->string.mode == DT_SMP_STRDUP)
-          _dt_free(*(char **) ((char *) a + elemsize * old_index));
+          dt_mem_free(dt_arrhead(raw_a)->alloc,
+                      *(char **) ((char *) a + elemsize * old_index));
 
-        // if indices are the same, _dt_memcpy is a no-op, but
-        // back-pointer-fixup will fail, so skip
-        if (old_index != final_index)
+        if (table->flags & DT_MAP_ORDERED)
         {
-          // swap delete
-          _dt_memmov((char *) a + elemsize * old_index,
-                     (char *) a + elemsize * final_index, elemsize);
-
-          // now find the slot for the last element
-          if (mode == DT_MAP_STRING)
-            slot = dt_map_find_slot(
-              a, elemsize,
-              *(char **) ((char *) a + elemsize * old_index + keyoffset),
-              keysize, keyoffset, mode);
-          else
-            slot = dt_map_find_slot(
-              a, elemsize, (char *) a + elemsize * old_index + keyoffset,
-              keysize, keyoffset, mode);
-          DT_ASSERT(slot >= 0);
-          b = &table->storage[slot >> DT_BUCKET_SHIFT];
-          i = slot & DT_BUCKET_MASK;
-          DT_ASSERT(b->index[i] == final_index);
-          b->index[i] = old_index;
+          // leave a hole so nothing moves out of order; compaction reclaims
+          // it later, except at the end where it can be dropped right away
+          table->dead[old_index] = 1;
+          ++table->hole_count;
+          if (!table->compacting)
+          {
+            while (dt_arrhead(raw_a)->len > 1 &&
+                   table->dead[dt_arrhead(raw_a)->len - 2])
+            {
+              dt_arrhead(raw_a)->len -= 1;
+              dt_arrhead(table->dead)->len -= 1;
+              --table->hole_count;
+            }
+          }
+          dt_map_step(a, elemsize, keysize, keyoffset, mode);
+          table = dt_hash_table(raw_a);
+        }
+        else
+        {
+          // if indices are the same, _dt_memcpy is a no-op, but
+          // back-pointer-fixup will fail, so skip
+          if (old_index != final_index)
+          {
+            // swap delete
+            _dt_memmov((char *) a + elemsize * old_index,
+                       (char *) a + elemsize * final_index, elemsize);
+
+            // now find the slot for the last element
+            if (mode == DT_MAP_STRING)
+              slot = dt_map_find_slot(
+                a, elemsize,
+                *(char **) ((char *) a + elemsize * old_index + keyoffset),
+                keysize, keyoffset, mode, &in);
+            else
+              slot = dt_map_find_slot(
+                a, elemsize, (char *) a + elemsize * old_index + keyoffset,
+                keysize, keyoffset, mode, &in);
+            DT_ASSERT(slot >= 0);
+            b = &table->storage[slot >> DT_BUCKET_SHIFT];
+            i = slot & DT_BUCKET_MASK;
+            DT_ASSERT(b->index[i] == final_index);
+            b->index[i] = old_index;
+          }
+          dt_arrhead(raw_a)->len -= 1;
         }
-        dt_arrhead(raw_a)->len -= 1;
 
+        const dt_allocator_t *alloc = dt_arrhead(raw_a)->alloc;
+        bool ordered                = (table->flags & DT_MAP_ORDERED) != 0;
         if (table->used_count < table->used_count_shrink_threshold &&
             table->slot_count > DT_BUCKET_LENGTH)
         {
-          dt_arrhead(raw_a)->tbl =
-            dt_make_hash_index(table->slot_count >> 1, table);
-          _dt_free(table);
+          if (ordered)
+            dt_map_rehash(raw_a, table, table->slot_count >> 1);
+          else
+          {
+            dt_arrhead(raw_a)->tbl =
+              dt_make_hash_index(table->slot_count >> 1, table, alloc);
+            dt_mem_free(alloc, table);
+          }
         }
         else if (table->tombstone_count > table->tombstone_count_threshold)
         {
-          dt_arrhead(raw_a)->tbl = dt_make_hash_index(table->slot_count, table);
-          _dt_free(table);
+          if (ordered)
+            dt_map_rehash(raw_a, table, table->slot_count);
+          else
+          {
+            dt_arrhead(raw_a)->tbl =
+              dt_make_hash_index(table->slot_count, table, alloc);
+            dt_mem_free(alloc, table);
+          }
         }
 
         return a;
@@ -1673,12 +2207,12 @@ void *dt_mapdel_key(void *a, size_t elemsize, void *key, size_t keysize,
   /* NOTREACHED */
 }
 
-static char *dt_strdup(char *str)
+static char *dt_strdup(const dt_allocator_t *alloc, const char *str)
 {
   // to keep replaceable allocator simple, we don't want to use strdup.
   // rolling our own also avoids problem of strdup vs _strdup
   size_t len = strlen(str) + 1;
-  char *p    = (char *) _dt_realloc(0, len);
+  char *p    = (char *) dt_mem_alloc(alloc, len);
   _dt_memmov(p, str, len);
   return p;
 }
@@ -1716,7 +2250,7 @@ char *dt_stralloc(dt_strarena_t *a, char *str)
       // this with 1000-long strings, eventually the arena will start
       // doubling and handling those as well
       dt_strblock_t *sb =
-        (dt_strblock_t *) _dt_realloc(0, sizeof(*sb) - 8 + len);
+        (dt_strblock_t *) dt_mem_alloc(a->alloc, sizeof(*sb) - 8 + len);
       _dt_memmov(sb->storage, str, len);
       if (a->storage)
       {
@@ -1736,7 +2270,7 @@ char *dt_stralloc(dt_strarena_t *a, char *str)
     else
     {
       dt_strblock_t *sb =
-        (dt_strblock_t *) _dt_realloc(0, sizeof(*sb) - 8 + blocksize);
+        (dt_strblock_t *) dt_mem_alloc(a->alloc, sizeof(*sb) - 8 + blocksize);
       sb->next     = a->storage;
       a->storage   = sb;
       a->remaining = blocksize;
@@ -1753,14 +2287,16 @@ char *dt_stralloc(dt_strarena_t *a, char *str)
 void dt_strreset(dt_strarena_t *a)
 {
   dt_strblock_t *x, *y;
-  x = a->storage;
+  const dt_allocator_t *alloc = a->alloc;
+  x                           = a->storage;
   while (x)
   {
     y = x->next;
-    _dt_free(x);
+    dt_mem_free(alloc, x);
     x = y;
   }
   _dt_memset(a, 0, sizeof(*a));
+  a->alloc = alloc;
 }
 
 // -----------------------------------------------------------------------------
@@ -1796,7 +2332,7 @@ dt_node *dt_loadf(const char *filepath)
   fseek(file, 0, SEEK_END);
   size_t len = ftell(file);
   fseek(file, 0, SEEK_SET);
-  uint8_t *data = (uint8_t *) malloc(len);
+  uint8_t *data = (uint8_t *) _dt_malloc(len + 1);
   if (data == NULL)
   {
     fclose(file);
@@ -1806,15 +2342,25 @@ dt_node *dt_loadf(const char *filepath)
   if (bytesRead != len)
   {
     fprintf(stderr, "ERROR: Could not read entire file '%s'\n", filepath);
-    free(data);
+    _dt_free(data);
     fclose(file);
     return NULL;
   }
+  data[len] = '\0';
   dt_node *node = dt_loads((char *) data);
+  _dt_free(data);
   fclose(file);
   return node;
 }
 
+dt_node *dt_loadf_ex(const char *filepath, const dt_allocator_t *alloc)
+{
+  const dt_allocator_t *prev = dt_set_allocator(alloc);
+  dt_node *res               = dt_loadf(filepath);
+  dt_set_allocator(prev);
+  return res;
+}
+
 dt_node *dt_loads(const char *string)
 {
   size_t offset = 0;
@@ -1822,6 +2368,14 @@ dt_node *dt_loads(const char *string)
   return res;
 }
 
+dt_node *dt_loads_ex(const char *string, const dt_allocator_t *alloc)
+{
+  const dt_allocator_t *prev = dt_set_allocator(alloc);
+  dt_node *res               = dt_loads(string);
+  dt_set_allocator(prev);
+  return res;
+}
+
 dt_node *dt_loads_impl(const char *string, size_t *offset)
 {
   dt_assert(string, "String is null", string, *offset);
@@ -1861,7 +2415,16 @@ void dt_free(dt_node *node)
     exit(1);
     return;
   }
+  const dt_allocator_t *prev = dt_set_allocator(node->alloc);
   _dt_free_ptrs[node->type](node);
+  dt_set_allocator(prev);
+}
+
+void dt_free_ex(dt_node *node, const dt_allocator_t *alloc)
+{
+  DT_ASSERT(node == NULL || node->alloc == alloc);
+  (void) alloc;
+  dt_free(node);
 }
 
 // -----------------------------------------------------------------------------
@@ -1958,17 +2521,17 @@ char *dt_dumps_raw_string(const char *string, const dt_dumps_settings_t *set)
   if (islongstring(string) || set->force_json)
   {
     size_t qlen = strlen(escrepr) + 2;
-    res         = (char *) _dt_malloc(qlen + 1);
+    res         = (char *) _dt_scoped_malloc(qlen + 1);
     if (res == NULL)
     {
-      _dt_free(escrepr);
+      _dt_scoped_free(escrepr);
       exit(1);
     }
     res[0] = '"';
     _dt_memcpy(&(res)[1], escrepr, qlen - 2);
     res[qlen - 1] = '"';
     res[qlen]     = '\0';
-    _dt_free(escrepr);
+    _dt_scoped_free(escrepr);
   }
   else
   {
@@ -1991,12 +2554,21 @@ dt_node *dt_loadb(const size_t len, const byte *bytes)
   dt_test(len > 3, "Invalid binary header", (char *) bytes, 0);
   dt_test(bytes[0] == 'd' && bytes[1] == 't', "Invalid binary header",
           (char *) bytes, 0);
-  byte version = bytes[3];
+  byte version = bytes[2];
   (void) version;
   size_t offset = 3;
   return dt_loadb_impl(len, bytes, &offset);
 }
 
+dt_node *dt_loadb_ex(const size_t len, const byte *bytes,
+                     const dt_allocator_t *alloc)
+{
+  const dt_allocator_t *prev = dt_set_allocator(alloc);
+  dt_node *res               = dt_loadb(len, bytes);
+  dt_set_allocator(prev);
+  return res;
+}
+
 dt_node *dt_loadb_impl(const size_t len, const byte *bytes, size_t *offset)
 {
   dt_type type;
@@ -2008,7 +2580,7 @@ dt_node *dt_loadb_impl(const size_t len, const byte *bytes, size_t *offset)
 
 // -----------------------------------------------------------------------------
 
-void (*_dt_dumpb_ptrs[dt_type_count])(const dt_node *, byte *) = {
+void (*_dt_dumpb_ptrs[dt_type_count])(const dt_node *, byte **) = {
 #define X(NAME, ...) dt_dumpb_##NAME,
   DT_TYPES_LIST
 #undef X
@@ -2024,17 +2596,15 @@ byte *dt_dumpb(const dt_node *node, size_t *len)
   dt_arradd(bytes, 'd');
   dt_arradd(bytes, 't');
   dt_arradd(bytes, 0);
-  dt_dumpb_impl(node, bytes);
-  *len += dt_arrlenu(bytes);
+  dt_dumpb_impl(node, &bytes);
+  *len = dt_arrlenu(bytes);
   return bytes;
 }
 
-void dt_dumpb_impl(const dt_node *node, byte *bytes)
+void dt_dumpb_impl(const dt_node *node, byte **bytes)
 {
-  printf("dumpb(%s, %p), (%llu/%llu)\n", dt_type_names[node->type], bytes,
-         dt_arrlenu(bytes), dt_arrcap(bytes));
   byte type = node->type;
-  dt_pushval(byte, bytes, type);
+  dt_pushval(byte, *bytes, type);
   _dt_dumpb_ptrs[node->type](node, bytes);
 }
 
@@ -2045,24 +2615,23 @@ char *dt_loadb_raw_string(const size_t len, const byte *bytes, size_t *offset)
   dt_test(len > *offset, "Not enough bytes", (char *) bytes, *offset);
   size_t slen;
   dt_popval(size_t, bytes, offset, slen);
-  char *string = _dt_realloc(NULL, slen + 1);
+  char *string = _dt_scoped_malloc(slen + 1);
   _dt_memcpy(string, &(bytes)[*offset], slen);
   string[slen]   = '\0';
   char *unescstr = strunesc(string);
-  free(string);
+  _dt_scoped_free(string);
   *offset += slen;
   return unescstr;
 }
 
-void dt_dumpb_raw_string(const char *string, byte *bytes)
+void dt_dumpb_raw_string(const char *string, byte **bytes)
 {
   char *escstr = stresc(string);
   size_t slen  = strlen(escstr);
-  dt_arrmaygrow(bytes, sizeof(size_t) + slen);
-  printf("dumpb(\"%s\", %p), (%llu)\n", escstr, bytes, strlen(escstr));
-  dt_pushval(size_t, bytes, slen);
-  dt_arraddbytes(bytes, escstr, slen);
-  free(escstr);
+  dt_arrmaygrow(*bytes, sizeof(size_t) + slen);
+  dt_pushval(size_t, *bytes, slen);
+  dt_arraddbytes(*bytes, escstr, slen);
+  _dt_scoped_free(escstr);
 }
 
 // -----------------------------------------------------------------------------
@@ -2131,14 +2700,14 @@ void _dt_cons_tok(const char *string, size_t *offset, char token)
 bool dt_test_null(const char *string, size_t *offset)
 {
   const char *next = (string + *offset);
-  return strstr(next, "null") == next;
+  return strncmp(next, "null", 4) == 0;
 }
 
 dt_node *dt_loads_null(const char *string, size_t *offset)
 {
   _dt_cons_cmt(string, offset);
   const char *next = (string + *offset);
-  dt_test(strstr(next, "null") == next, "Expected null", string, *offset);
+  dt_test(strncmp(next, "null", 4) == 0, "Expected null", string, *offset);
   *offset += 4;
   _dt_cons_cmt(string, offset);
   return dt_new_null(NULL);
@@ -2148,17 +2717,17 @@ char *dt_dumps_null(const dt_node *node, const dt_dumps_settings_t *set)
 {
   (void) node;
   (void) set;
-  return strdup("null");
+  return dt_strdup(dt_allocator(), "null");
 }
 
 dt_node *dt_loadb_null(const size_t len, const byte *bytes, size_t *offset)
 {
-  dt_test(len > *offset, "Not enough bytes", (char *) bytes, *offset);
+  dt_test(len >= *offset, "Not enough bytes", (char *) bytes, *offset);
   (void) len;
   return dt_new_null(NULL);
 }
 
-void dt_dumpb_null(const dt_node *node, byte *bytes)
+void dt_dumpb_null(const dt_node *node, byte **bytes)
 {
   (void) node;
   (void) bytes;
@@ -2166,7 +2735,7 @@ void dt_dumpb_null(const dt_node *node, byte *bytes)
 
 void dt_free_null(dt_node *node)
 {
-  _dt_free(node);
+  _dt_scoped_free(node);
 }
 
 // -----------------------------------------------------------------------------
@@ -2174,18 +2743,18 @@ void dt_free_null(dt_node *node)
 bool dt_test_bool(const char *string, size_t *offset)
 {
   const char *next = (string + *offset);
-  return strstr(next, "true") == next || strstr(next, "false") == next;
+  return strncmp(next, "true", 4) == 0 || strncmp(next, "false", 5) == 0;
 }
 
 dt_node *dt_loads_bool(const char *string, size_t *offset)
 {
   const char *next = (string + *offset);
-  if (strstr(next, "true") == next)
+  if (strncmp(next, "true", 4) == 0)
   {
     *offset += 4;
     return dt_new_bool(true);
   }
-  else if (strstr(next, "false") == next)
+  else if (strncmp(next, "false", 5) == 0)
   {
     *offset += 5;
     return dt_new_bool(false);
@@ -2197,7 +2766,7 @@ dt_node *dt_loads_bool(const char *string, size_t *offset)
 char *dt_dumps_bool(const dt_node *node, const dt_dumps_settings_t *set)
 {
   (void) set;
-  return strdup(node->bool_v ? "true" : "false");
+  return dt_strdup(dt_allocator(), node->bool_v ? "true" : "false");
 }
 
 dt_node *dt_loadb_bool(const size_t len, const byte *bytes, size_t *offset)
@@ -2208,14 +2777,14 @@ dt_node *dt_loadb_bool(const size_t len, const byte *bytes, size_t *offset)
   return dt_new_bool(result);
 }
 
-void dt_dumpb_bool(const dt_node *node, byte *bytes)
+void dt_dumpb_bool(const dt_node *node, byte **bytes)
 {
-  dt_pushval(bool, bytes, node->bool_v);
+  dt_pushval(bool, *bytes, node->bool_v);
 }
 
 void dt_free_bool(dt_node *node)
 {
-  _dt_free(node);
+  _dt_scoped_free(node);
 }
 
 // -----------------------------------------------------------------------------
@@ -2252,14 +2821,14 @@ dt_node *dt_loadb_int(const size_t len, const byte *bytes, size_t *offset)
   return dt_new_int(result);
 }
 
-void dt_dumpb_int(const dt_node *node, byte *bytes)
+void dt_dumpb_int(const dt_node *node, byte **bytes)
 {
-  dt_pushval(long, bytes, node->int_v);
+  dt_pushval(long, *bytes, node->int_v);
 }
 
 void dt_free_int(dt_node *node)
 {
-  _dt_free(node);
+  _dt_scoped_free(node);
 }
 
 // -----------------------------------------------------------------------------
@@ -2300,7 +2869,7 @@ char *dt_dumps_float(const dt_node *node, const dt_dumps_settings_t *set)
     {
       len += 1;
     }
-    repr          = _dt_realloc(repr, len + 2);
+    repr = _dt_scoped_realloc(repr, strlen(repr) + 1, len + 2);
     repr[len + 1] = '\0';
   }
   return repr;
@@ -2315,14 +2884,14 @@ dt_node *dt_loadb_float(const size_t len, const byte *bytes, size_t *offset)
   return dt_new_float(result);
 }
 
-void dt_dumpb_float(const dt_node *node, byte *bytes)
+void dt_dumpb_float(const dt_node *node, byte **bytes)
 {
-  dt_pushval(double, bytes, node->float_v);
+  dt_pushval(double, *bytes, node->float_v);
 }
 
 void dt_free_float(dt_node *node)
 {
-  _dt_free(node);
+  _dt_scoped_free(node);
 }
 
 // -----------------------------------------------------------------------------
@@ -2371,10 +2940,11 @@ char *dt_dumps_arr(const dt_node *node, const dt_dumps_settings_t *set)
     {
       dt_arradd(res, ',');
     }
-    _dt_free(erepr);
+    _dt_scoped_free(erepr);
   }
   dt_arraddcstr(res, " ]");
   char *repr = (char *) dt_arrtonullterm(res);
+  dt_arrfree(res);
   return repr;
 }
 
@@ -2392,10 +2962,10 @@ dt_node *dt_loadb_arr(const size_t len, const byte *bytes, size_t *offset)
   return node;
 }
 
-void dt_dumpb_arr(const dt_node *node, byte *bytes)
+void dt_dumpb_arr(const dt_node *node, byte **bytes)
 {
   size_t alen = dt_arrlenu(node->arr_v);
-  dt_pushval(size_t, bytes, alen);
+  dt_pushval(size_t, *bytes, alen);
   for (size_t i = 0; i < alen; ++i)
   {
     dt_dumpb_impl(node->arr_v[i], bytes);
@@ -2410,7 +2980,7 @@ void dt_free_arr(dt_node *node)
     dt_free(node->arr_v[i]);
   }
   dt_arrfree(node->arr_v);
-  _dt_free(node);
+  _dt_scoped_free(node);
 }
 
 // -----------------------------------------------------------------------------
@@ -2465,7 +3035,7 @@ char *dt_dumps_map(const dt_node *node, const dt_dumps_settings_t *set)
     dt_arradd(res, ' ');
     char *krepr = dt_dumps_raw_string(node->map_v[i].key, set);
     dt_arraddcstr(res, krepr);
-    _dt_free(krepr);
+    _dt_scoped_free(krepr);
     dt_arradd(res, ':');
     char *vrepr = dt_dumps_ex(node->map_v[i].value, set);
     dt_arraddcstr(res, vrepr);
@@ -2473,10 +3043,11 @@ char *dt_dumps_map(const dt_node *node, const dt_dumps_settings_t *set)
     {
       dt_arradd(res, ',');
     }
-    _dt_free(vrepr);
+    _dt_scoped_free(vrepr);
   }
   dt_arraddcstr(res, " }");
   char *repr = dt_arrtonullterm(res);
+  dt_arrfree(res);
   return repr;
 }
 
@@ -2494,10 +3065,10 @@ dt_node *dt_loadb_map(const size_t len, const byte *bytes, size_t *offset)
   return node;
 }
 
-void dt_dumpb_map(const dt_node *node, byte *bytes)
+void dt_dumpb_map(const dt_node *node, byte **bytes)
 {
   size_t mlen = dt_smplenu(node->map_v);
-  dt_pushval(size_t, bytes, mlen);
+  dt_pushval(size_t, *bytes, mlen);
   for (size_t i = 0; i < mlen; ++i)
   {
     dt_dumpb_raw_string(node->map_v[i].key, bytes);
@@ -2510,11 +3081,11 @@ void dt_free_map(dt_node *node)
   size_t len = dt_smplenu(node->map_v);
   for (size_t i = 0; i < len; ++i)
   {
-    _dt_free(node->map_v[i].key);
-    _dt_free(node->map_v[i].value);
+    _dt_scoped_free(node->map_v[i].key);
+    dt_free(node->map_v[i].value);
   }
   dt_smpfree(node->map_v);
-  _dt_free(node);
+  _dt_scoped_free(node);
 }
 
 // -----------------------------------------------------------------------------
@@ -2543,15 +3114,15 @@ dt_node *dt_loadb_string(const size_t len, const byte *bytes, size_t *offset)
   return dt_new_string(dt_loadb_raw_string(len, bytes, offset));
 }
 
-void dt_dumpb_string(const dt_node *node, byte *bytes)
+void dt_dumpb_string(const dt_node *node, byte **bytes)
 {
   dt_dumpb_raw_string(node->string_v, bytes);
 }
 
 void dt_free_string(dt_node *node)
 {
-  _dt_free(node->string_v);
-  _dt_free(node);
+  _dt_scoped_free(node->string_v);
+  _dt_scoped_free(node);
 }
 
 // -----------------------------------------------------------------------------
@@ -2569,7 +3140,7 @@ char *sprintfx(const char *format, ...)
     return NULL;
   }
 
-  char *result = (char *) _dt_malloc(len + 1);
+  char *result = (char *) _dt_scoped_malloc(len + 1);
   if (!result)
   {
     va_end(args_copy);
@@ -2650,7 +3221,7 @@ bool islongstring(const char *str)
 
 char *strndup(const char *s, size_t n)
 {
-  char *r = _dt_malloc(n + 1);
+  char *r = _dt_scoped_malloc(n + 1);
   _dt_memcpy(r, s, n);
   r[n] = '\0';
   return r;
@@ -2663,7 +3234,8 @@ char *stresc(const char *s)
 
 char *strnesc(const char *s, size_t len)
 {
-  char *result = (char *) _dt_malloc(len + 1);
+  // worst case every character expands to a two character escape
+  char *result = (char *) _dt_scoped_malloc(2 * len + 1);
   if (!result)
   {
     return NULL;
@@ -2719,7 +3291,7 @@ char *strunesc(const char *s)
 
 char *strnunesc(const char *s, size_t len)
 {
-  char *result = (char *) _dt_malloc(len + 1);
+  char *result = (char *) _dt_scoped_malloc(len + 1);
   if (!result)
   {
     return NULL;
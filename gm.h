@@ -7,7 +7,20 @@ extern "C" {
 
 #include <float.h>
 #include <math.h>
+#include <stddef.h>
 #include <stdint.h>
+#include <stdlib.h>
+
+// redefine these for your own allocation
+#ifndef _gm_malloc
+#define _gm_malloc(_Size) malloc(_Size)
+#endif
+#ifndef _gm_realloc
+#define _gm_realloc(_BlockPtr, _Size) realloc(_BlockPtr, _Size)
+#endif
+#ifndef _gm_free
+#define _gm_free(_BlockPtr) free(_BlockPtr)
+#endif
 
 // universal macros do not touch
 
@@ -72,6 +85,39 @@ extern "C" {
 #define GM_MAT_DEFAULTNAME(BASETYPE, TYPEPREFIX, M, N) GM_CONCAT(mat, N)
 #endif
 
+#ifndef GM_LANES_TYPENAME
+#define GM_LANES_TYPENAME(BASETYPE, TYPEPREFIX, W)                             \
+  GM_CONCAT_1(BASETYPE, _x, W)
+#endif
+#ifndef GM_LANES_SHORTNAME
+#define GM_LANES_SHORTNAME(BASETYPE, TYPEPREFIX, W)                            \
+  GM_CONCAT_1(TYPEPREFIX, _x, W)
+#endif
+#ifndef GM_VECX_TYPENAME
+#define GM_VECX_TYPENAME(BASETYPE, TYPEPREFIX, N, W)                           \
+  GM_CONCAT_1(GM_VEC_TYPENAME(BASETYPE, TYPEPREFIX, N), _x, W)
+#endif
+#ifndef GM_VECX_SHORTNAME
+#define GM_VECX_SHORTNAME(BASETYPE, TYPEPREFIX, N, W)                          \
+  GM_CONCAT_1(GM_VEC_SHORTNAME(BASETYPE, TYPEPREFIX, N), _x, W)
+#endif
+#ifndef GM_QUATX_TYPENAME
+#define GM_QUATX_TYPENAME(BASETYPE, TYPEPREFIX, W)                             \
+  GM_CONCAT_1(GM_QUAT_TYPENAME(BASETYPE, TYPEPREFIX), _x, W)
+#endif
+#ifndef GM_QUATX_SHORTNAME
+#define GM_QUATX_SHORTNAME(BASETYPE, TYPEPREFIX, W)                            \
+  GM_CONCAT_1(GM_QUAT_SHORTNAME(BASETYPE, TYPEPREFIX), _x, W)
+#endif
+#ifndef GM_POSEX_TYPENAME
+#define GM_POSEX_TYPENAME(BASETYPE, TYPEPREFIX, W)                             \
+  GM_CONCAT_1(GM_CONCAT(pose, TYPEPREFIX), _x, W)
+#endif
+#ifndef GM_POSEX_SHORTNAME
+#define GM_POSEX_SHORTNAME(BASETYPE, TYPEPREFIX, W)                            \
+  GM_CONCAT_1(GM_CONCAT(p, TYPEPREFIX), _x, W)
+#endif
+
 #ifndef GM_OPERNAME
 #define GM_OPERNAME(SHORTNAME, OPER) GM_CONCAT_1(SHORTNAME, _, OPER)
 #endif
@@ -107,6 +153,34 @@ extern "C" {
 #define GM_CONST static const
 #endif
 
+// define GM_SIMD to specialize the vec4f, mat4f and quatf operators with
+// SSE/AVX or NEON intrinsics, under the same names
+// targets without either keep the scalar operators
+
+#ifdef GM_SIMD
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64) ||              \
+  (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define GM_SIMD_SSE
+#include <emmintrin.h>
+#if defined(__SSE4_1__)
+#include <smmintrin.h>
+#endif
+#if defined(__AVX__)
+#define GM_SIMD_AVX
+#endif
+#if defined(__AVX__) || defined(__FMA__) || defined(__F16C__)
+#include <immintrin.h>
+#endif
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#define GM_SIMD_NEON
+#include <arm_neon.h>
+#endif
+#endif
+
+#ifdef __BMI2__
+#include <immintrin.h>
+#endif
+
 //
 
 #ifndef bool
@@ -139,7 +213,8 @@ typedef long double ldouble;
 
 // for any of these, define GM_(TYPE)_CUSTOM_X_LIST as necessary
 // also define:
-// _gm_(BASETYPE)_fmt, _gm_(BASETYPE)_sqrt, _gm_(BASETYPE)_dot,
+// _gm_(BASETYPE)_fmt, _gm_(BASETYPE)_sqrt, _gm_(BASETYPE)_lensqrt,
+// _gm_(BASETYPE)_dot,
 // _gm_(BASETYPE)_add, _gm_(BASETYPE)_sub, _gm_(BASETYPE)_mul,
 // _gm_(BASETYPE)_cmul, _gm_(BASETYPE)_div, _gm_(BASETYPE)_mod
 
@@ -299,6 +374,60 @@ typedef long double ldouble;
   X(ldouble, ld, 16, 4, 9, 3)                                                  \
   GM_MAT4X4F_T_CUSTOM_X_LIST
 
+// structure-of-arrays types, W lanes of each component
+// X(BASETYPE, TYPEPREFIX, W) for lanes, X(BASETYPE, TYPEPREFIX, N, W, ...)
+// for vectors
+
+#ifndef GM_LANES_T_CUSTOM_X_LIST
+#define GM_LANES_T_CUSTOM_X_LIST
+#endif
+#define GM_LANES_T_X_LIST                                                      \
+  X(float, f, 4)                                                               \
+  X(float, f, 8)                                                               \
+  GM_LANES_T_CUSTOM_X_LIST
+
+#ifndef GM_VEC2X_T_CUSTOM_X_LIST
+#define GM_VEC2X_T_CUSTOM_X_LIST
+#endif
+#define GM_VEC2X_T_X_LIST                                                      \
+  X(float, f, 2, 4, x, y)                                                      \
+  X(float, f, 2, 8, x, y)                                                      \
+  GM_VEC2X_T_CUSTOM_X_LIST
+
+#ifndef GM_VEC3X_T_CUSTOM_X_LIST
+#define GM_VEC3X_T_CUSTOM_X_LIST
+#endif
+#define GM_VEC3X_T_X_LIST                                                      \
+  X(float, f, 3, 4, x, y, z)                                                   \
+  X(float, f, 3, 8, x, y, z)                                                   \
+  GM_VEC3X_T_CUSTOM_X_LIST
+
+#ifndef GM_VEC4X_T_CUSTOM_X_LIST
+#define GM_VEC4X_T_CUSTOM_X_LIST
+#endif
+#define GM_VEC4X_T_X_LIST                                                      \
+  X(float, f, 4, 4, x, y, z, w)                                                \
+  X(float, f, 4, 8, x, y, z, w)                                                \
+  GM_VEC4X_T_CUSTOM_X_LIST
+
+#ifndef GM_QUATX_T_CUSTOM_X_LIST
+#define GM_QUATX_T_CUSTOM_X_LIST
+#endif
+#define GM_QUATX_T_X_LIST                                                      \
+  X(float, f, 4, 4, w, x, y, z)                                                \
+  X(float, f, 4, 8, w, x, y, z)                                                \
+  GM_QUATX_T_CUSTOM_X_LIST
+
+// joint transforms, X(BASETYPE, TYPEPREFIX, W)
+
+#ifndef GM_POSEX_T_CUSTOM_X_LIST
+#define GM_POSEX_T_CUSTOM_X_LIST
+#endif
+#define GM_POSEX_T_X_LIST                                                      \
+  X(float, f, 4)                                                               \
+  X(float, f, 8)                                                               \
+  GM_POSEX_T_CUSTOM_X_LIST
+
 //
 GM_CONST float GM_OPERNAME(gm, epsilon) = FLT_EPSILON;
 GM_CONST float GM_OPERNAME(gm, small)   = 1.e-5f;
@@ -345,9 +474,9 @@ GM_CONST float GM_OPERNAME(gm,
 GM_CONST float
   GM_OPERNAME(gm, glaisher) = 1.282427129100622636875342568869791727768f;
 GM_CONST float
-  GM_OPERNAME(gm, deg2rad) = 57.29577951308232087679815481410517033241f;
+  GM_OPERNAME(gm, deg2rad) = 0.01745329251994329576923690768488612713443f;
 GM_CONST float
-  GM_OPERNAME(gm, rad2deg) = 0.01745329251994329576923690768488612713443f;
+  GM_OPERNAME(gm, rad2deg) = 57.29577951308232087679815481410517033241f;
 
 GM_CONST double GM_OPERNAME(gm, epsilon_d) = DBL_EPSILON;
 GM_CONST double GM_OPERNAME(gm, small_d)   = 1.e-6;
@@ -396,9 +525,9 @@ GM_CONST double
 GM_CONST double
   GM_OPERNAME(gm, glaisher_d) = 1.282427129100622636875342568869791727768;
 GM_CONST double
-  GM_OPERNAME(gm, deg2rad_d) = 57.29577951308232087679815481410517033241;
+  GM_OPERNAME(gm, deg2rad_d) = 0.01745329251994329576923690768488612713443;
 GM_CONST double
-  GM_OPERNAME(gm, rad2deg_d) = 0.01745329251994329576923690768488612713443;
+  GM_OPERNAME(gm, rad2deg_d) = 57.29577951308232087679815481410517033241;
 
 GM_CONST ldouble GM_OPERNAME(gm, epsilon_ld) = LDBL_EPSILON;
 GM_CONST ldouble GM_OPERNAME(gm, small_ld)   = 1.e-7L;
@@ -447,9 +576,9 @@ GM_CONST ldouble GM_OPERNAME(gm, apery_ld) =
 GM_CONST ldouble GM_OPERNAME(gm, glaisher_ld) =
   1.282427129100622636875342568869791727768L;
 GM_CONST ldouble GM_OPERNAME(gm, deg2rad_ld) =
-  57.29577951308232087679815481410517033241L;
-GM_CONST ldouble GM_OPERNAME(gm, rad2deg_ld) =
   0.01745329251994329576923690768488612713443L;
+GM_CONST ldouble GM_OPERNAME(gm, rad2deg_ld) =
+  57.29577951308232087679815481410517033241L;
 
 #define gm_min(A, B) ((A) < (B) ? (A) : (B))
 #define gm_max(A, B) ((A) > (B) ? (A) : (B))
@@ -732,12 +861,145 @@ GM_CDECL long sqrtli(const long i)
   }
 }
 
+// approximations for when speed matters more than the last few bits, with
+// max errors measured against libm in double
+// define GM_FAST_MATH to route the float lengths and normalizations and the
+// trig used by the vector, quaternion and matrix operators through them, or
+// call them directly; the solvers and elementwise sqrt stay exact
+
+// relative error below 2.5e-7 with SSE, 4.8e-6 otherwise, x > 0
+GM_CDECL float fast_rsqrtf(const float x)
+{
+#if defined(GM_SIMD_SSE)
+  float y = _mm_cvtss_f32(_mm_rsqrt_ss(_mm_set_ss(x)));
+  return y * (1.5f - 0.5f * x * y * y);
+#else
+  union
+  {
+    float f;
+    uint32_t u;
+  } v = {x};
+  v.u = 0x5f375a86u - (v.u >> 1);
+  float y = v.f;
+  y       = y * (1.5f - 0.5f * x * y * y);
+  return y * (1.5f - 0.5f * x * y * y);
+#endif
+}
+
+// same relative error as fast_rsqrtf, exact at 0
+GM_CDECL float fast_sqrtf(const float x)
+{
+  return x > 0 ? x * fast_rsqrtf(x) : 0;
+}
+
+// absolute error below 1.2e-7 for |x| <= 8192, reduced by quadrant with a
+// two-part pi / 2 and evaluated by cephes' polynomials on [-pi/4, pi/4]
+GM_CDECL void fast_sincosf(const float x, float *s, float *c)
+{
+  float q  = x * 0.636619772f;
+  int k    = (int) (q + (q < 0 ? -0.5f : 0.5f));
+  float kf = (float) k;
+  float r  = x - kf * 1.5703125f;
+  r        = r - kf * 4.83751297e-4f - kf * 7.54978995e-8f;
+  float r2 = r * r;
+  float ps = r + r * r2 *
+                   (-1.66666546e-1f +
+                    r2 * (8.33216087e-3f - r2 * 1.95152959e-4f));
+  float pc = 1 - 0.5f * r2 +
+             r2 * r2 *
+               (4.16666457e-2f + r2 * (-1.38873163e-3f + r2 * 2.44331571e-5f));
+  switch (k & 3)
+  {
+  case 0:
+    *s = ps;
+    *c = pc;
+    break;
+  case 1:
+    *s = pc;
+    *c = -ps;
+    break;
+  case 2:
+    *s = -ps;
+    *c = -pc;
+    break;
+  default:
+    *s = -pc;
+    *c = ps;
+    break;
+  }
+}
+
+GM_CDECL float fast_sinf(const float x)
+{
+  float s, c;
+  fast_sincosf(x, &s, &c);
+  return s;
+}
+
+GM_CDECL float fast_cosf(const float x)
+{
+  float s, c;
+  fast_sincosf(x, &s, &c);
+  return c;
+}
+
+// absolute error below 2e-6 rad, a degree 11 odd polynomial on [0, 1]
+// with octant folding, fast_atan2f(0, 0) is 0
+GM_CDECL float fast_atan2f(const float y, const float x)
+{
+  float ax = fabsf(x), ay = fabsf(y);
+  float hi = ax > ay ? ax : ay, lo = ax > ay ? ay : ax;
+  if (hi == 0)
+  {
+    return 0;
+  }
+  float a  = lo / hi;
+  float a2 = a * a;
+  float r  = a * (0.99997726f +
+                 a2 * (-0.33262347f +
+                       a2 * (0.19354346f +
+                             a2 * (-0.11643287f +
+                                   a2 * (0.05265332f - a2 * 0.01172120f)))));
+  r        = ay > ax ? 1.57079633f - r : r;
+  r        = x < 0 ? 3.14159265f - r : r;
+  return y < 0 ? -r : r;
+}
+
+// absolute error below 8e-7 rad with SSE and 8e-6 otherwise, abramowitz and
+// stegun 4.4.46 with acos(-x) = pi - acos(x), x is clamped to [-1, 1]
+GM_CDECL float fast_acosf(const float x)
+{
+  float a = fabsf(x) < 1 ? fabsf(x) : 1;
+  float p =
+    1.5707963050f +
+    a * (-0.2145988016f +
+         a * (0.0889789874f +
+              a * (-0.0501743046f +
+                   a * (0.0308918810f +
+                        a * (-0.0170881256f +
+                             a * (0.0066700901f - a * 0.0012624911f))))));
+  float r = fast_sqrtf(1 - a) * p;
+  return x < 0 ? 3.14159265f - r : r;
+}
+
+#ifdef GM_FAST_MATH
+#define _gm_sinf(X) fast_sinf(X)
+#define _gm_cosf(X) fast_cosf(X)
+#define _gm_acosf(X) fast_acosf(X)
+#else
+#define _gm_sinf(X) sinf(X)
+#define _gm_cosf(X) cosf(X)
+#define _gm_acosf(X) acosf(X)
+#endif
+
 #define sqrtf sqrtf
 #define sqrtd sqrt
 #define sqrtld sqrtl
 
 #define _gm_sbyte_fmt "%x"
+#define _gm_sbyte_eps 0
 #define _gm_sbyte_sqrt(X) ((sbyte) sqrtui((uint) (X)))
+#define _gm_sbyte_lensqrt(X) _gm_sbyte_sqrt(X)
 #define _gm_sbyte_dot(X, Y) (X) * (Y)
 #define _gm_sbyte_add(X, Y) (X) + (Y)
 #define _gm_sbyte_sub(X, Y) (X) - (Y)
@@ -760,7 +1022,9 @@ GM_CDECL long sqrtli(const long i)
 #define _gm_sbyte_or(X, Y) (X) || (Y)
 
 #define _gm_byte_fmt "%X"
+#define _gm_byte_eps 0
 #define _gm_byte_sqrt(X) ((byte) sqrti((int) (X)))
+#define _gm_byte_lensqrt(X) _gm_byte_sqrt(X)
 #define _gm_byte_dot(X, Y) (X) * (Y)
 #define _gm_byte_add(X, Y) (X) + (Y)
 #define _gm_byte_sub(X, Y) (X) - (Y)
@@ -783,7 +1047,9 @@ GM_CDECL long sqrtli(const long i)
 #define _gm_byte_or(X, Y) (X) || (Y)
 
 #define _gm_ushort_fmt "%u"
+#define _gm_ushort_eps 0
 #define _gm_ushort_sqrt(X) ((ushort) sqrtui((uint) (X)))
+#define _gm_ushort_lensqrt(X) _gm_ushort_sqrt(X)
 #define _gm_ushort_dot(X, Y) (X) * (Y)
 #define _gm_ushort_add(X, Y) (X) + (Y)
 #define _gm_ushort_sub(X, Y) (X) - (Y)
@@ -806,7 +1072,9 @@ GM_CDECL long sqrtli(const long i)
 #define _gm_ushort_or(X, Y) (X) || (Y)
 
 #define _gm_short_fmt "%lu"
+#define _gm_short_eps 0
 #define _gm_short_sqrt(X) ((short) sqrti((int) (X)))
+#define _gm_short_lensqrt(X) _gm_short_sqrt(X)
 #define _gm_short_dot(X, Y) (X) * (Y)
 #define _gm_short_add(X, Y) (X) + (Y)
 #define _gm_short_sub(X, Y) (X) - (Y)
@@ -829,7 +1097,9 @@ GM_CDECL long sqrtli(const long i)
 #define _gm_short_or(X, Y) (X) || (Y)
 
 #define _gm_uint_fmt "%u"
+#define _gm_uint_eps 0
 #define _gm_uint_sqrt(X) ((uint) sqrtui((uint) (X)))
+#define _gm_uint_lensqrt(X) _gm_uint_sqrt(X)
 #define _gm_uint_dot(X, Y) (X) * (Y)
 #define _gm_uint_add(X, Y) (X) + (Y)
 #define _gm_uint_sub(X, Y) (X) - (Y)
@@ -852,7 +1122,9 @@ GM_CDECL long sqrtli(const long i)
 #define _gm_uint_or(X, Y) (X) || (Y)
 
 #define _gm_int_fmt "%d"
+#define _gm_int_eps 0
 #define _gm_int_sqrt(X) ((int) sqrti((int) (X)))
+#define _gm_int_lensqrt(X) _gm_int_sqrt(X)
 #define _gm_int_dot(X, Y) (X) * (Y)
 #define _gm_int_add(X, Y) (X) + (Y)
 #define _gm_int_sub(X, Y) (X) - (Y)
@@ -875,7 +1147,9 @@ GM_CDECL long sqrtli(const long i)
 #define _gm_int_or(X, Y) (X) || (Y)
 
 #define _gm_ulong_fmt "%lu"
+#define _gm_ulong_eps 0
 #define _gm_ulong_sqrt(X) ((ulong) sqrtli((long) (X)))
+#define _gm_ulong_lensqrt(X) _gm_ulong_sqrt(X)
 #define _gm_ulong_dot(X, Y) (X) * (Y)
 #define _gm_ulong_add(X, Y) (X) + (Y)
 #define _gm_ulong_sub(X, Y) (X) - (Y)
@@ -898,7 +1172,9 @@ GM_CDECL long sqrtli(const long i)
 #define _gm_ulong_or(X, Y) (X) || (Y)
 
 #define _gm_long_fmt "%ld"
+#define _gm_long_eps 0
 #define _gm_long_sqrt(X) ((long) sqrtlu((ulong) (X)))
+#define _gm_long_lensqrt(X) _gm_long_sqrt(X)
 #define _gm_long_dot(X, Y) (X) * (Y)
 #define _gm_long_add(X, Y) (X) + (Y)
 #define _gm_long_sub(X, Y) (X) - (Y)
@@ -921,7 +1197,9 @@ GM_CDECL long sqrtli(const long i)
 #define _gm_long_or(X, Y) (X) || (Y)
 
 #define _gm_uint8_t_fmt "%x"
+#define _gm_uint8_t_eps 0
 #define _gm_uint8_sqrt(X) ((uint8_t) sqrtui((uint) (X)))
+#define _gm_uint8_t_lensqrt(X) _gm_uint8_sqrt(X)
 #define _gm_uint8_t_dot(X, Y) (X) * (Y)
 #define _gm_uint8_t_add(X, Y) (X) + (Y)
 #define _gm_uint8_t_sub(X, Y) (X) - (Y)
@@ -944,7 +1222,9 @@ GM_CDECL long sqrtli(const long i)
 #define _gm_uint8_t_or(X, Y) (X) || (Y)
 
 #define _gm_int8_t_fmt "%c"
+#define _gm_int8_t_eps 0
 #define _gm_int8_sqrt(X) ((int8_t) sqrti((uint) (X)))
+#define _gm_int8_t_lensqrt(X) _gm_int8_sqrt(X)
 #define _gm_int8_t_add(X, Y) (X) + (Y)
 #define _gm_int8_t_sub(X, Y) (X) - (Y)
 #define _gm_int8_t_mul(X, Y) (X) * (Y)
@@ -966,7 +1246,9 @@ GM_CDECL long sqrtli(const long i)
 #define _gm_int8_t_or(X, Y) (X) || (Y)
 
 #define _gm_uint16_t_fmt "%ld"
+#define _gm_uint16_t_eps 0
 #define _gm_uint16_sqrt(X) ((uint16_t) sqrtui((uint) (X)))
+#define _gm_uint16_t_lensqrt(X) _gm_uint16_sqrt(X)
 #define _gm_uint16_t_dot(X, Y) (X) * (Y)
 #define _gm_uint16_t_add(X, Y) (X) + (Y)
 #define _gm_uint16_t_sub(X, Y) (X) - (Y)
@@ -989,7 +1271,9 @@ GM_CDECL long sqrtli(const long i)
 #define _gm_uint16_t_or(X, Y) (X) || (Y)
 
 #define _gm_int16_t_fmt "%d"
+#define _gm_int16_t_eps 0
 #define _gm_int16_sqrt(X) ((int16_t) sqrti((uint) (X)))
+#define _gm_int16_t_lensqrt(X) _gm_int16_sqrt(X)
 #define _gm_int16_t_add(X, Y) (X) + (Y)
 #define _gm_int16_t_sub(X, Y) (X) - (Y)
 #define _gm_int16_t_mul(X, Y) (X) * (Y)
@@ -1011,7 +1295,9 @@ GM_CDECL long sqrtli(const long i)
 #define _gm_int16_t_or(X, Y) (X) || (Y)
 
 #define _gm_uint32_t_fmt "%ld"
+#define _gm_uint32_t_eps 0
 #define _gm_uint32_sqrt(X) ((uint32_t) sqrtui((uint) (X)))
+#define _gm_uint32_t_lensqrt(X) _gm_uint32_sqrt(X)
 #define _gm_uint32_t_dot(X, Y) (X) * (Y)
 #define _gm_uint32_t_add(X, Y) (X) + (Y)
 #define _gm_uint32_t_sub(X, Y) (X) - (Y)
@@ -1034,7 +1320,9 @@ GM_CDECL long sqrtli(const long i)
 #define _gm_uint32_t_or(X, Y) (X) || (Y)
 
 #define _gm_int32_t_fmt "%d"
+#define _gm_int32_t_eps 0
 #define _gm_int32_sqrt(X) ((int32_t) sqrti((uint) (X)))
+#define _gm_int32_t_lensqrt(X) _gm_int32_sqrt(X)
 #define _gm_int32_t_dot(X, Y) (X) * (Y)
 #define _gm_int32_t_add(X, Y) (X) + (Y)
 #define _gm_int32_t_sub(X, Y) (X) - (Y)
@@ -1057,7 +1345,9 @@ GM_CDECL long sqrtli(const long i)
 #define _gm_int32_t_or(X, Y) (X) || (Y)
 
 #define _gm_uint64_t_fmt "%lu"
+#define _gm_uint64_t_eps 0
 #define _gm_uint64_sqrt(X) ((uint64_t) sqrtlu((uint) (X)))
+#define _gm_uint64_t_lensqrt(X) _gm_uint64_sqrt(X)
 #define _gm_uint64_t_dot(X, Y) (X) * (Y)
 #define _gm_uint64_t_add(X, Y) (X) + (Y)
 #define _gm_uint64_t_sub(X, Y) (X) - (Y)
@@ -1080,7 +1370,9 @@ GM_CDECL long sqrtli(const long i)
 #define _gm_uint64_t_or(X, Y) (X) || (Y)
 
 #define _gm_int64_t_fmt "%ld"
+#define _gm_int64_t_eps 0
 #define _gm_int64_sqrt(X) ((int64_t) sqrtli((uint) (X)))
+#define _gm_int64_t_lensqrt(X) _gm_int64_sqrt(X)
 #define _gm_int64_t_dot(X, Y) (X) * (Y)
 #define _gm_int64_t_add(X, Y) (X) + (Y)
 #define _gm_int64_t_sub(X, Y) (X) - (Y)
@@ -1103,7 +1395,13 @@ GM_CDECL long sqrtli(const long i)
 #define _gm_int64_t_or(X, Y) (X) || (Y)
 
 #define _gm_float_fmt "%g"
+#define _gm_float_eps FLT_EPSILON
 #define _gm_float_sqrt(X) ((float) sqrtf(X))
+#ifdef GM_FAST_MATH
+#define _gm_float_lensqrt(X) ((float) fast_sqrtf(X))
+#else
+#define _gm_float_lensqrt(X) _gm_float_sqrt(X)
+#endif
 #define _gm_float_dot(X, Y) (X) * (Y)
 #define _gm_float_add(X, Y) (X) + (Y)
 #define _gm_float_sub(X, Y) (X) - (Y)
@@ -1126,7 +1424,9 @@ GM_CDECL long sqrtli(const long i)
 #define _gm_float_or(X, Y) (NAN)
 
 #define _gm_double_fmt "%lg"
+#define _gm_double_eps DBL_EPSILON
 #define _gm_double_sqrt(X) ((double) sqrt(X))
+#define _gm_double_lensqrt(X) _gm_double_sqrt(X)
 #define _gm_double_dot(X, Y) (X) * (Y)
 #define _gm_double_add(X, Y) (X) + (Y)
 #define _gm_double_sub(X, Y) (X) - (Y)
@@ -1149,7 +1449,9 @@ GM_CDECL long sqrtli(const long i)
 #define _gm_double_or(X, Y) (NAN)
 
 #define _gm_ldouble_fmt "%lg"
+#define _gm_ldouble_eps LDBL_EPSILON
 #define _gm_ldouble_sqrt(X) ((double) sqrtl(X))
+#define _gm_ldouble_lensqrt(X) _gm_ldouble_sqrt(X)
 #define _gm_ldouble_dot(X, Y) (X) * (Y)
 #define _gm_ldouble_add(X, Y) (X) + (Y)
 #define _gm_ldouble_sub(X, Y) (X) - (Y)
@@ -1806,7 +2108,38 @@ GM_CDECL long sqrtli(const long i)
     {                                                                          \
       v += GM_OPNAME(BASETYPE, mul)(m.a[i], m.a[i]);                           \
     }                                                                          \
-    return GM_OPNAME(BASETYPE, sqrt)(v);                                       \
+    return GM_OPNAME(BASETYPE, lensqrt)(v);                                    \
+  }
+
+#define GM_NORMALIZE_OP(TYPENAME, SHORTNAME, BASETYPE, TYPEPREFIX, N, OPER)    \
+  GM_CDECL TYPENAME GM_OPERNAME(SHORTNAME, OPER)(const TYPENAME m)             \
+  {                                                                            \
+    BASETYPE l = GM_OPERNAME(SHORTNAME, len)(m);                               \
+    if (l == 0)                                                                \
+    {                                                                          \
+      return m;                                                                \
+    }                                                                          \
+    return GM_OPERNAME(SHORTNAME, sdiv)(m, l);                                 \
+  }
+
+// flen and fnorm go through fast_sqrtf and fast_rsqrtf at float precision
+// whatever the basetype, zero-length vectors are passed through
+#define GM_FLEN_OP(TYPENAME, SHORTNAME, BASETYPE, TYPEPREFIX, N, OPER)         \
+  GM_CDECL BASETYPE GM_OPERNAME(SHORTNAME, OPER)(const TYPENAME m)             \
+  {                                                                            \
+    return (BASETYPE) fast_sqrtf((float) GM_OPERNAME(SHORTNAME, sqlen)(m));    \
+  }
+
+#define GM_FNORMALIZE_OP(TYPENAME, SHORTNAME, BASETYPE, TYPEPREFIX, N, OPER)   \
+  GM_CDECL TYPENAME GM_OPERNAME(SHORTNAME, OPER)(const TYPENAME m)             \
+  {                                                                            \
+    BASETYPE l = GM_OPERNAME(SHORTNAME, sqlen)(m);                             \
+    if (l == 0)                                                                \
+    {                                                                          \
+      return m;                                                                \
+    }                                                                          \
+    BASETYPE r = (BASETYPE) fast_rsqrtf((float) l);                            \
+    return GM_OPERNAME(SHORTNAME, smul)(m, r);                                 \
   }
 
 #define GM_DISTANCE_OP(TYPENAME, SHORTNAME, BASETYPE, TYPEPREFIX, N, OPER)     \
@@ -1957,12 +2290,12 @@ typedef struct Quaternion
     float half_radians_z = z.a * 0.5f;                                         \
     float half_radians_y = y.a * 0.5f;                                         \
     float half_radians_x = x.a * 0.5f;                                         \
-    float cos_half_z     = cosf(half_radians_z);                               \
-    float sin_half_z     = sinf(half_radians_z);                               \
-    float cos_half_y     = cosf(half_radians_y);                               \
-    float sin_half_y     = sinf(half_radians_y);                               \
-    float cos_half_x     = cosf(half_radians_x);                               \
-    float sin_half_x     = sinf(half_radians_x);                               \
+    float cos_half_z     = _gm_cosf(half_radians_z);                           \
+    float sin_half_z     = _gm_sinf(half_radians_z);                           \
+    float cos_half_y     = _gm_cosf(half_radians_y);                           \
+    float sin_half_y     = _gm_sinf(half_radians_y);                           \
+    float cos_half_x     = _gm_cosf(half_radians_x);                           \
+    float sin_half_x     = _gm_sinf(half_radians_x);                           \
     TYPENAME result      = {{1.0f, 0.0f, 0.0f, 0.0f}};                         \
     result.a[1]          = sin_half_x * cos_half_y * cos_half_z -              \
                   cos_half_x * sin_half_y * sin_half_z;                        \
@@ -1981,8 +2314,8 @@ typedef struct Quaternion
     GM_VEC_TYPENAME(BASETYPE, TYPEPREFIX, 3) axis)                             \
   {                                                                            \
     BASETYPE half_angle = a.a * 0.5;                                           \
-    BASETYPE sa2        = (BASETYPE) sinf((float) half_angle);                 \
-    BASETYPE ca2        = (BASETYPE) cosf((float) half_angle);                 \
+    BASETYPE sa2        = (BASETYPE) _gm_sinf((float) half_angle);             \
+    BASETYPE ca2        = (BASETYPE) _gm_cosf((float) half_angle);             \
     return (TYPENAME){{ca2, axis.x * sa2, axis.y * sa2, axis.z * sa2}};        \
   }
 
@@ -2005,15 +2338,57 @@ typedef struct Quaternion
                                                  const TYPENAME q2, float t)   \
   {                                                                            \
     float dot      = GM_OPERNAME(SHORTNAME, dot)(q1, q2);                      \
-    float theta    = acosf(dot);                                               \
-    float sinTheta = sinf(theta);                                              \
-    float w1       = sinf((1.0f - t) * theta) / sinTheta;                      \
-    float w2       = sinf(t * theta) / sinTheta;                               \
+    float theta    = _gm_acosf(dot);                                           \
+    float sinTheta = _gm_sinf(theta);                                          \
+    float w1       = _gm_sinf((1.0f - t) * theta) / sinTheta;                  \
+    float w2       = _gm_sinf(t * theta) / sinTheta;                           \
     return (TYPENAME){                                                         \
       {{w1 * q1.a[0] + w2 * q2.a[0], w1 * q1.a[1] + w2 * q2.a[1],              \
         w1 * q1.a[2] + w2 * q2.a[2], w1 * q1.a[3] + w2 * q2.a[3]}}};           \
   }
 
+// shortest-arc normalized lerp, b is negated when it lies in the opposite
+// hemisphere from a
+#define GM_QUAT_NLERP_OP(TYPENAME, SHORTNAME, BASETYPE, TYPEPREFIX, N, OPER)   \
+  GM_CDECL TYPENAME GM_OPERNAME(SHORTNAME, OPER)(                              \
+    const TYPENAME a, const TYPENAME b, const BASETYPE t)                      \
+  {                                                                            \
+    BASETYPE s = GM_OPERNAME(SHORTNAME, dot)(a, b) < 0 ? -t : t;               \
+    TYPENAME v;                                                                \
+    for (size_t k = 0; k < N; ++k)                                             \
+    {                                                                          \
+      v.a[k] = (1 - t) * a.a[k] + s * b.a[k];                                  \
+    }                                                                          \
+    return GM_OPERNAME(SHORTNAME, normalize)(v);                               \
+  }
+
+// shortest-arc slerp through fast_acosf and fast_sincosf, nearly parallel
+// inputs fall back to nlerp
+#define GM_QUAT_FSLERP_OP(TYPENAME, SHORTNAME, BASETYPE, TYPEPREFIX, N, OPER)  \
+  GM_CDECL TYPENAME GM_OPERNAME(SHORTNAME, OPER)(                              \
+    const TYPENAME a, const TYPENAME b, const BASETYPE t)                      \
+  {                                                                            \
+    float d = (float) GM_OPERNAME(SHORTNAME, dot)(a, b);                       \
+    float s = d < 0 ? -1.0f : 1.0f;                                            \
+    d *= s;                                                                    \
+    if (d > 0.9995f)                                                           \
+    {                                                                          \
+      return GM_OPERNAME(SHORTNAME, nlerp)(a, b, t);                           \
+    }                                                                          \
+    float th = fast_acosf(d);                                                  \
+    float r  = fast_rsqrtf(1 - d * d);                                         \
+    float s0, s1, c;                                                           \
+    fast_sincosf((1 - (float) t) * th, &s0, &c);                               \
+    fast_sincosf((float) t * th, &s1, &c);                                     \
+    BASETYPE w0 = (BASETYPE) (s0 * r), w1 = (BASETYPE) (s * s1 * r);           \
+    TYPENAME v;                                                                \
+    for (size_t k = 0; k < N; ++k)                                             \
+    {                                                                          \
+      v.a[k] = w0 * a.a[k] + w1 * b.a[k];                                      \
+    }                                                                          \
+    return v;                                                                  \
+  }
+
 #define GM_QUAT_MUL_REF_OP(TYPENAME, SHORTNAME, BASETYPE, TYPEPREFIX, N, OPER) \
   GM_CDECL TYPENAME *GM_OPERNAME(SHORTNAME, r##OPER)(TYPENAME * l,             \
                                                      const TYPENAME r)         \
@@ -2034,25 +2409,13 @@ typedef struct Quaternion
   GM_CDECL VTYPENAME GM_OPERNAME(SHORTNAME, OPER)(const TYPENAME q,            \
                                                   const VTYPENAME v)           \
   {                                                                            \
-    BASETYPE t = 2.0 * q.a[0] * q.a[0];                                        \
-    BASETYPE x = t - 1.0;                                                      \
-    BASETYPE y = 2.0 * q.a[0] * q.a[1];                                        \
-    BASETYPE z = 2.0 * q.a[0] * q.a[2];                                        \
-    t          = 2.0 * q.a[1] * q.a[1];                                        \
-    x += 2.0 * t;                                                              \
-    y += 2.0 * q.a[1] * q.a[2];                                                \
-    z += 2.0 * q.a[1] * q.a[3];                                                \
-    t = 2.0 * q.a[2] * q.a[2];                                                 \
-    x += 2.0 * t;                                                              \
-    y += 2.0 * t;                                                              \
-    z += 2.0 * q.a[2] * q.a[3];                                                \
-    x = v.a[0] * (x) + v.a[1] * (y) + v.a[2] * (z);                            \
-    y = v.a[0] * (2.0 * q.a[1] * q.a[3] - 2.0 * q.a[0] * q.a[2]) +             \
-        v.a[1] * (2.0 * q.a[0] * q.a[1] + 2.0 * q.a[2] * q.a[3]) +             \
-        v.a[2] * (2.0 * q.a[0] * q.a[0] - 1.0 + 2.0 * q.a[3] * q.a[3]);        \
-    z = v.a[0] * (2.0 * q.a[1] * q.a[2] + 2.0 * q.a[0] * q.a[3]) +             \
-        v.a[1] * (2.0 * q.a[3] * q.a[3] - 1.0 + 2.0 * q.a[0] * q.a[0]) +       \
-        v.a[2] * (2.0 * q.a[0] * q.a[1] - 2.0 * q.a[2] * q.a[3]);              \
+    /* v + w * t + u x t, where t = 2 * u x v and u = q.xyz */                 \
+    BASETYPE tx = 2 * (q.a[2] * v.a[2] - q.a[3] * v.a[1]);                     \
+    BASETYPE ty = 2 * (q.a[3] * v.a[0] - q.a[1] * v.a[2]);                     \
+    BASETYPE tz = 2 * (q.a[1] * v.a[1] - q.a[2] * v.a[0]);                     \
+    BASETYPE x  = v.a[0] + q.a[0] * tx + (q.a[2] * tz - q.a[3] * ty);          \
+    BASETYPE y  = v.a[1] + q.a[0] * ty + (q.a[3] * tx - q.a[1] * tz);          \
+    BASETYPE z  = v.a[2] + q.a[0] * tz + (q.a[1] * ty - q.a[2] * tx);          \
     return (VTYPENAME){{{x, y, z}}};                                           \
   }
 
@@ -2108,6 +2471,23 @@ typedef struct Quaternion
     return v;                                                                  \
   }
 
+#define GM_MAT_MULV_OP(TYPENAME, SHORTNAME, VECTYPE, BASETYPE, TYPEPREFIX, M,  \
+                       N, OPER)                                                \
+  GM_CDECL VECTYPE GM_OPERNAME(SHORTNAME, OPER)(const TYPENAME m,              \
+                                                const VECTYPE r)               \
+  {                                                                            \
+    VECTYPE v;                                                                 \
+    for (size_t i = 0; i < N; i++)                                             \
+    {                                                                          \
+      v.a[i] = 0;                                                              \
+      for (size_t k = 0; k < N; k++)                                           \
+      {                                                                        \
+        v.a[i] += m.a[i * N + k] * r.a[k];                                     \
+      }                                                                        \
+    }                                                                          \
+    return v;                                                                  \
+  }
+
 #define GM_MAT_MUL_REF_OP(TYPENAME, SHORTNAME, BASETYPE, TYPEPREFIX, M, N,     \
                           OPER)                                                \
   GM_CDECL TYPENAME *GM_OPERNAME(SHORTNAME, r##OPER)(TYPENAME * l,             \
@@ -2149,15 +2529,49 @@ typedef struct Quaternion
     return m.a[0] * m.a[3] - m.a[1] * m.a[2];                                  \
   }
 
+// declares TINY = N eps max|a_ij|^N over the N x N block of A with row stride
+// STRIDE, the bound under which a determinant is treated as zero, consistent
+// with the pivot test in lusolve. integer types have an eps of 0 and only
+// reject an exact zero
+#define GM_MAT_DET_TINY(BASETYPE, A, N, STRIDE, TINY)                          \
+  BASETYPE TINY = (N) * GM_OPNAME(BASETYPE, eps);                              \
+  {                                                                            \
+    BASETYPE scale_ = 0;                                                       \
+    for (size_t i_ = 0; i_ < (N); ++i_)                                        \
+    {                                                                          \
+      for (size_t j_ = 0; j_ < (N); ++j_)                                      \
+      {                                                                        \
+        BASETYPE v_ = (A)[i_ * (STRIDE) + j_];                                 \
+        v_          = v_ > 0 ? v_ : -v_;                                       \
+        scale_      = v_ > scale_ ? v_ : scale_;                               \
+      }                                                                        \
+    }                                                                          \
+    for (size_t i_ = 0; i_ < (N); ++i_)                                        \
+    {                                                                          \
+      TINY *= scale_;                                                          \
+    }                                                                          \
+  }
+
 #define GM_MAT2X2_INV(TYPENAME, SHORTNAME, BASETYPE, TYPEPREFIX, M, N, OPER)   \
-  GM_CDECL TYPENAME GM_OPERNAME(SHORTNAME, OPER)(const TYPENAME m)             \
+  GM_CDECL bool GM_OPERNAME(SHORTNAME, try##OPER)(const TYPENAME m,            \
+                                                  TYPENAME *r)                 \
   {                                                                            \
     BASETYPE d = m.a[0] * m.a[3] - m.a[1] * m.a[2];                            \
-    if (d == 0)                                                                \
+    GM_MAT_DET_TINY(BASETYPE, m.a, 2, 2, tiny);                                \
+    if (!((d > 0 ? d : -d) > tiny))                                            \
     {                                                                          \
-      return m;                                                                \
+      return false;                                                            \
     }                                                                          \
-    return GM_OPERNAME(SHORTNAME, sdiv)(m, d);                                 \
+    r->a[0] = m.a[3] / d;                                                      \
+    r->a[1] = -m.a[1] / d;                                                     \
+    r->a[2] = -m.a[2] / d;                                                     \
+    r->a[3] = m.a[0] / d;                                                      \
+    return true;                                                               \
+  }                                                                            \
+  GM_CDECL TYPENAME GM_OPERNAME(SHORTNAME, OPER)(const TYPENAME m)             \
+  {                                                                            \
+    TYPENAME r;                                                                \
+    return GM_OPERNAME(SHORTNAME, try##OPER)(m, &r) ? r : m;                   \
   }
 
 #define GM_MAT3X3_DET(TYPENAME, SHORTNAME, BASETYPE, TYPEPREFIX, M, N, OPER)   \
@@ -2169,26 +2583,32 @@ typedef struct Quaternion
   }
 
 #define GM_MAT3X3_INV(TYPENAME, SHORTNAME, BASETYPE, TYPEPREFIX, M, N, OPER)   \
-  GM_CDECL TYPENAME GM_OPERNAME(SHORTNAME, OPER)(const TYPENAME m)             \
+  GM_CDECL bool GM_OPERNAME(SHORTNAME, try##OPER)(const TYPENAME m,            \
+                                                  TYPENAME *r)                 \
   {                                                                            \
     BASETYPE det = m.a[0] * (m.a[4] * m.a[8] - m.a[5] * m.a[7]) -              \
                    m.a[3] * (m.a[1] * m.a[8] - m.a[2] * m.a[7]) +              \
                    m.a[6] * (m.a[1] * m.a[5] - m.a[2] * m.a[4]);               \
-    if (det == 0)                                                              \
+    GM_MAT_DET_TINY(BASETYPE, m.a, 3, 3, tiny);                                \
+    if (!((det > 0 ? det : -det) > tiny))                                      \
     {                                                                          \
-      return m;                                                                \
+      return false;                                                            \
     }                                                                          \
+    r->a[0] = (m.a[4] * m.a[8] - m.a[7] * m.a[5]) / det;                       \
+    r->a[1] = (m.a[2] * m.a[7] - m.a[1] * m.a[8]) / det;                       \
+    r->a[2] = (m.a[1] * m.a[5] - m.a[2] * m.a[4]) / det;                       \
+    r->a[3] = (m.a[5] * m.a[6] - m.a[3] * m.a[8]) / det;                       \
+    r->a[4] = (m.a[0] * m.a[8] - m.a[2] * m.a[6]) / det;                       \
+    r->a[5] = (m.a[2] * m.a[3] - m.a[0] * m.a[5]) / det;                       \
+    r->a[6] = (m.a[3] * m.a[7] - m.a[4] * m.a[6]) / det;                       \
+    r->a[7] = (m.a[1] * m.a[6] - m.a[0] * m.a[7]) / det;                       \
+    r->a[8] = (m.a[0] * m.a[4] - m.a[1] * m.a[3]) / det;                       \
+    return true;                                                               \
+  }                                                                            \
+  GM_CDECL TYPENAME GM_OPERNAME(SHORTNAME, OPER)(const TYPENAME m)             \
+  {                                                                            \
     TYPENAME r;                                                                \
-    r.a[0] = (m.a[4] * m.a[8] - m.a[7] * m.a[5]) / det;                        \
-    r.a[1] = (m.a[2] * m.a[7] - m.a[1] * m.a[8]) / det;                        \
-    r.a[2] = (m.a[1] * m.a[5] - m.a[2] * m.a[4]) / det;                        \
-    r.a[3] = (m.a[5] * m.a[6] - m.a[3] * m.a[8]) / det;                        \
-    r.a[4] = (m.a[0] * m.a[8] - m.a[2] * m.a[6]) / det;                        \
-    r.a[5] = (m.a[2] * m.a[3] - m.a[0] * m.a[5]) / det;                        \
-    r.a[6] = (m.a[3] * m.a[7] - m.a[4] * m.a[6]) / det;                        \
-    r.a[7] = (m.a[1] * m.a[6] - m.a[0] * m.a[7]) / det;                        \
-    r.a[8] = (m.a[0] * m.a[4] - m.a[1] * m.a[3]) / det;                        \
-    return r;                                                                  \
+    return GM_OPERNAME(SHORTNAME, try##OPER)(m, &r) ? r : m;                   \
   }
 
 #define GM_MAT4X4_DET(TYPENAME, SHORTNAME, BASETYPE, TYPEPREFIX, M, N, OPER)   \
@@ -2231,6 +2651,49 @@ typedef struct Quaternion
     return r;                                                                  \
   }
 
+// inverse of an affine transform with any invertible upper 3x3, so scale
+// and shear are handled where finv only handles rotation and translation
+// the bottom row is assumed to be 0 0 0 1
+#define GM_MAT4X4_AINV(TYPENAME, SHORTNAME, BASETYPE, TYPEPREFIX, M, N, OPER)  \
+  GM_CDECL bool GM_OPERNAME(SHORTNAME, try##OPER)(const TYPENAME m,            \
+                                                  TYPENAME *r)                 \
+  {                                                                            \
+    BASETYPE c0  = m.a[5] * m.a[10] - m.a[6] * m.a[9];                         \
+    BASETYPE c1  = m.a[6] * m.a[8] - m.a[4] * m.a[10];                         \
+    BASETYPE c2  = m.a[4] * m.a[9] - m.a[5] * m.a[8];                          \
+    BASETYPE det = m.a[0] * c0 + m.a[1] * c1 + m.a[2] * c2;                    \
+    GM_MAT_DET_TINY(BASETYPE, m.a, 3, 4, tiny);                                \
+    if (!((det > 0 ? det : -det) > tiny))                                      \
+    {                                                                          \
+      return false;                                                            \
+    }                                                                          \
+    r->a[0]  = c0 / det;                                                       \
+    r->a[1]  = (m.a[2] * m.a[9] - m.a[1] * m.a[10]) / det;                     \
+    r->a[2]  = (m.a[1] * m.a[6] - m.a[2] * m.a[5]) / det;                      \
+    r->a[4]  = c1 / det;                                                       \
+    r->a[5]  = (m.a[0] * m.a[10] - m.a[2] * m.a[8]) / det;                     \
+    r->a[6]  = (m.a[2] * m.a[4] - m.a[0] * m.a[6]) / det;                      \
+    r->a[8]  = c2 / det;                                                       \
+    r->a[9]  = (m.a[1] * m.a[8] - m.a[0] * m.a[9]) / det;                      \
+    r->a[10] = (m.a[0] * m.a[5] - m.a[1] * m.a[4]) / det;                      \
+    for (int i = 0; i < 3; i++)                                                \
+    {                                                                          \
+      r->a[i * 4 + 3] = -(r->a[i * 4 + 0] * m.a[3] +                           \
+                          r->a[i * 4 + 1] * m.a[7] +                           \
+                          r->a[i * 4 + 2] * m.a[11]);                          \
+    }                                                                          \
+    r->a[12] = 0;                                                              \
+    r->a[13] = 0;                                                              \
+    r->a[14] = 0;                                                              \
+    r->a[15] = 1;                                                              \
+    return true;                                                               \
+  }                                                                            \
+  GM_CDECL TYPENAME GM_OPERNAME(SHORTNAME, OPER)(const TYPENAME m)             \
+  {                                                                            \
+    TYPENAME r;                                                                \
+    return GM_OPERNAME(SHORTNAME, try##OPER)(m, &r) ? r : m;                   \
+  }
+
 #define GM_MAT_LUDECOMP(TYPENAME, SHORTNAME, BASETYPE, TYPEPREFIX, M, N, OPER) \
   GM_CDECL void GM_OPERNAME(SHORTNAME, OPER)(const TYPENAME m, TYPENAME *l,    \
                                              TYPENAME *u)                      \
@@ -2315,20 +2778,20 @@ typedef struct Quaternion
   }                                                                            \
   GM_CDECL MTYPENAME GM_OPERNAME(SHORTNAME, OPER##rotx)(const angf x)          \
   {                                                                            \
-    BASETYPE cosX = cosf(x.a);                                                 \
-    BASETYPE sinX = sinf(x.a);                                                 \
+    BASETYPE cosX = _gm_cosf(x.a);                                             \
+    BASETYPE sinX = _gm_sinf(x.a);                                             \
     return (MTYPENAME){{1, 0, 0, 0, cosX, -sinX, 0, sinX, cosX}};              \
   }                                                                            \
   GM_CDECL MTYPENAME GM_OPERNAME(SHORTNAME, OPER##roty)(const angf y)          \
   {                                                                            \
-    BASETYPE cosY = cosf(y.a);                                                 \
-    BASETYPE sinY = sinf(y.a);                                                 \
+    BASETYPE cosY = _gm_cosf(y.a);                                             \
+    BASETYPE sinY = _gm_sinf(y.a);                                             \
     return (MTYPENAME){{cosY, 0, sinY, 0, 1, 0, -sinY, 0, cosY}};              \
   }                                                                            \
   GM_CDECL MTYPENAME GM_OPERNAME(SHORTNAME, OPER##rotz)(const angf z)          \
   {                                                                            \
-    BASETYPE cosZ = cosf(z.a);                                                 \
-    BASETYPE sinZ = sinf(z.a);                                                 \
+    BASETYPE cosZ = _gm_cosf(z.a);                                             \
+    BASETYPE sinZ = _gm_sinf(z.a);                                             \
     return (MTYPENAME){{cosZ, -sinZ, 0, sinZ, cosZ, 0, 0, 0, 1}};              \
   }                                                                            \
   GM_CDECL TYPENAME GM_OPERNAME(SHORTNAME, OPER##scl)(const VTYPENAME s)       \
@@ -2374,12 +2837,176 @@ typedef struct Quaternion
     return GM_CONCAT(SHORTNAME, OPER)(rs, p);                                  \
   }
 
+// cramer's rule with the twelve 2x2 determinants of the top and bottom row
+// pairs shared between the determinant and all sixteen cofactors
 #define GM_MAT4X4_INV(TYPENAME, SHORTNAME, BASETYPE, TYPEPREFIX, M, N, OPER)   \
+  GM_CDECL bool GM_OPERNAME(SHORTNAME, try##OPER)(const TYPENAME m,            \
+                                                  TYPENAME *r)                 \
+  {                                                                            \
+    const BASETYPE *a = m.a;                                                   \
+    BASETYPE s0       = a[0] * a[5] - a[4] * a[1];                             \
+    BASETYPE s1       = a[0] * a[6] - a[4] * a[2];                             \
+    BASETYPE s2       = a[0] * a[7] - a[4] * a[3];                             \
+    BASETYPE s3       = a[1] * a[6] - a[5] * a[2];                             \
+    BASETYPE s4       = a[1] * a[7] - a[5] * a[3];                             \
+    BASETYPE s5       = a[2] * a[7] - a[6] * a[3];                             \
+    BASETYPE c5       = a[10] * a[15] - a[14] * a[11];                         \
+    BASETYPE c4       = a[9] * a[15] - a[13] * a[11];                          \
+    BASETYPE c3       = a[9] * a[14] - a[13] * a[10];                          \
+    BASETYPE c2       = a[8] * a[15] - a[12] * a[11];                          \
+    BASETYPE c1       = a[8] * a[14] - a[12] * a[10];                          \
+    BASETYPE c0       = a[8] * a[13] - a[12] * a[9];                           \
+    BASETYPE det =                                                             \
+      s0 * c5 - s1 * c4 + s2 * c3 + s3 * c2 - s4 * c1 + s5 * c0;               \
+    GM_MAT_DET_TINY(BASETYPE, a, 4, 4, tiny);                                  \
+    if (!((det > 0 ? det : -det) > tiny))                                      \
+    {                                                                          \
+      return false;                                                            \
+    }                                                                          \
+    r->a[0]  = (a[5] * c5 - a[6] * c4 + a[7] * c3) / det;                      \
+    r->a[1]  = (-a[1] * c5 + a[2] * c4 - a[3] * c3) / det;                     \
+    r->a[2]  = (a[13] * s5 - a[14] * s4 + a[15] * s3) / det;                   \
+    r->a[3]  = (-a[9] * s5 + a[10] * s4 - a[11] * s3) / det;                   \
+    r->a[4]  = (-a[4] * c5 + a[6] * c2 - a[7] * c1) / det;                     \
+    r->a[5]  = (a[0] * c5 - a[2] * c2 + a[3] * c1) / det;                      \
+    r->a[6]  = (-a[12] * s5 + a[14] * s2 - a[15] * s1) / det;                  \
+    r->a[7]  = (a[8] * s5 - a[10] * s2 + a[11] * s1) / det;                    \
+    r->a[8]  = (a[4] * c4 - a[5] * c2 + a[7] * c0) / det;                      \
+    r->a[9]  = (-a[0] * c4 + a[1] * c2 - a[3] * c0) / det;                     \
+    r->a[10] = (a[12] * s4 - a[13] * s2 + a[15] * s0) / det;                   \
+    r->a[11] = (-a[8] * s4 + a[9] * s2 - a[11] * s0) / det;                    \
+    r->a[12] = (-a[4] * c3 + a[5] * c1 - a[6] * c0) / det;                     \
+    r->a[13] = (a[0] * c3 - a[1] * c1 + a[2] * c0) / det;                      \
+    r->a[14] = (-a[12] * s3 + a[13] * s1 - a[14] * s0) / det;                  \
+    r->a[15] = (a[8] * s3 - a[9] * s1 + a[10] * s0) / det;                     \
+    return true;                                                               \
+  }                                                                            \
   GM_CDECL TYPENAME GM_OPERNAME(SHORTNAME, OPER)(const TYPENAME m)             \
   {                                                                            \
-    TYPENAME adj = GM_OPERNAME(SHORTNAME, adjoint)(m);                         \
-    BASETYPE det = GM_OPERNAME(SHORTNAME, det)(m);                             \
-    return GM_OPERNAME(SHORTNAME, sdiv)(adj, det);                             \
+    TYPENAME r;                                                                \
+    return GM_OPERNAME(SHORTNAME, try##OPER)(m, &r) ? r : m;                   \
+  }
+
+// solves m * x = b, the same product as mulv, by lu decomposition with
+// partial pivoting; fails when a pivot falls below the working precision
+// relative to the largest entry of m
+#define GM_MAT_LUSOLVE(TYPENAME, SHORTNAME, VTYPENAME, BASETYPE, TYPEPREFIX,   \
+                       N, OPER)                                                \
+  GM_CDECL bool GM_OPERNAME(SHORTNAME, OPER)(const TYPENAME m,                 \
+                                             const VTYPENAME b, VTYPENAME *x)  \
+  {                                                                            \
+    TYPENAME lu    = m;                                                        \
+    VTYPENAME y    = b;                                                        \
+    BASETYPE scale = 0;                                                        \
+    for (size_t i = 0; i < N * N; ++i)                                         \
+    {                                                                          \
+      BASETYPE v = lu.a[i] < 0 ? -lu.a[i] : lu.a[i];                           \
+      scale      = v > scale ? v : scale;                                      \
+    }                                                                          \
+    BASETYPE tiny = scale * N * GM_OPNAME(BASETYPE, eps);                      \
+    for (size_t k = 0; k < N; ++k)                                             \
+    {                                                                          \
+      size_t p      = k;                                                       \
+      BASETYPE best = 0;                                                       \
+      for (size_t i = k; i < N; ++i)                                           \
+      {                                                                        \
+        BASETYPE v = lu.a[i * N + k];                                          \
+        v          = v < 0 ? -v : v;                                           \
+        if (v > best)                                                          \
+        {                                                                      \
+          best = v;                                                            \
+          p    = i;                                                            \
+        }                                                                      \
+      }                                                                        \
+      if (!(best > tiny))                                                      \
+      {                                                                        \
+        return false;                                                          \
+      }                                                                        \
+      if (p != k)                                                              \
+      {                                                                        \
+        for (size_t j = 0; j < N; ++j)                                         \
+        {                                                                      \
+          BASETYPE t      = lu.a[k * N + j];                                   \
+          lu.a[k * N + j] = lu.a[p * N + j];                                   \
+          lu.a[p * N + j] = t;                                                 \
+        }                                                                      \
+        BASETYPE t = y.a[k];                                                   \
+        y.a[k]     = y.a[p];                                                   \
+        y.a[p]     = t;                                                        \
+      }                                                                        \
+      for (size_t i = k + 1; i < N; ++i)                                       \
+      {                                                                        \
+        BASETYPE f = lu.a[i * N + k] / lu.a[k * N + k];                        \
+        for (size_t j = k + 1; j < N; ++j)                                     \
+        {                                                                      \
+          lu.a[i * N + j] -= f * lu.a[k * N + j];                              \
+        }                                                                      \
+        y.a[i] -= f * y.a[k];                                                  \
+      }                                                                        \
+    }                                                                          \
+    for (size_t i = N; i-- > 0;)                                               \
+    {                                                                          \
+      BASETYPE s = y.a[i];                                                     \
+      for (size_t j = i + 1; j < N; ++j)                                       \
+      {                                                                        \
+        s -= lu.a[i * N + j] * y.a[j];                                         \
+      }                                                                        \
+      y.a[i] = s / lu.a[i * N + i];                                            \
+    }                                                                          \
+    *x = y;                                                                    \
+    return true;                                                               \
+  }                                                                            \
+                                                                               \
+// solves m * x = b for symmetric positive definite m, only the lower
+// triangle is read; fails when m is not positive definite
+#define GM_MAT_CHOLSOLVE(TYPENAME, SHORTNAME, VTYPENAME, BASETYPE,             \
+                         TYPEPREFIX, N, OPER)                                  \
+  GM_CDECL bool GM_OPERNAME(SHORTNAME, OPER)(const TYPENAME m,                 \
+                                             const VTYPENAME b, VTYPENAME *x)  \
+  {                                                                            \
+    TYPENAME l  = GM_OPERNAME(SHORTNAME, zero);                                \
+    VTYPENAME y = b;                                                           \
+    for (size_t j = 0; j < N; ++j)                                             \
+    {                                                                          \
+      BASETYPE d = m.a[j * N + j];                                             \
+      for (size_t k = 0; k < j; ++k)                                           \
+      {                                                                        \
+        d -= l.a[j * N + k] * l.a[j * N + k];                                  \
+      }                                                                        \
+      if (!(d > 0))                                                            \
+      {                                                                        \
+        return false;                                                          \
+      }                                                                        \
+      d              = GM_OPNAME(BASETYPE, sqrt)(d);                           \
+      l.a[j * N + j] = d;                                                      \
+      for (size_t i = j + 1; i < N; ++i)                                       \
+      {                                                                        \
+        BASETYPE s = m.a[i * N + j];                                           \
+        for (size_t k = 0; k < j; ++k)                                         \
+        {                                                                      \
+          s -= l.a[i * N + k] * l.a[j * N + k];                                \
+        }                                                                      \
+        l.a[i * N + j] = s / d;                                                \
+      }                                                                        \
+    }                                                                          \
+    for (size_t i = 0; i < N; ++i)                                             \
+    {                                                                          \
+      for (size_t k = 0; k < i; ++k)                                           \
+      {                                                                        \
+        y.a[i] -= l.a[i * N + k] * y.a[k];                                     \
+      }                                                                        \
+      y.a[i] /= l.a[i * N + i];                                                \
+    }                                                                          \
+    for (size_t i = N; i-- > 0;)                                               \
+    {                                                                          \
+      for (size_t k = i + 1; k < N; ++k)                                       \
+      {                                                                        \
+        y.a[i] -= l.a[k * N + i] * y.a[k];                                     \
+      }                                                                        \
+      y.a[i] /= l.a[i * N + i];                                                \
+    }                                                                          \
+    *x = y;                                                                    \
+    return true;                                                               \
   }
 
 #define GM_MAT_MINOR(TYPENAME, SHORTNAME, BASETYPE, TYPEPREFIX, M, N, O, P,    \
@@ -2556,6 +3183,8 @@ typedef struct Quaternion
   GM_CMP_OP_OR(TYPENAME, SHORTNAME, BASETYPE, TYPEPREFIX, M, gt);              \
   GM_TRANSPOSE_OP(TYPENAME, SHORTNAME, BASETYPE, TYPEPREFIX, M, N, transpose); \
   GM_MAT_MUL_OP(TYPENAME, SHORTNAME, BASETYPE, TYPEPREFIX, M, N, mul);         \
+  GM_MAT_MULV_OP(TYPENAME, SHORTNAME, VECTYPE, BASETYPE, TYPEPREFIX, M, N,     \
+                 mulv);                                                        \
   GM_MAT_MUL_REF_OP(TYPENAME, SHORTNAME, BASETYPE, TYPEPREFIX, M, N, mul);
 
 #define GM_QUAT_T(TYPENAME, SHORTNAME, VECTYPE, BASETYPE, TYPEPREFIX, N, ...)  \
@@ -2589,11 +3218,15 @@ typedef struct Quaternion
   GM_BIN_OP(TYPENAME, SHORTNAME, BASETYPE, TYPEPREFIX, N, cmul);               \
   GM_SCL_OP_1(TYPENAME, SHORTNAME, BASETYPE, TYPEPREFIX, N, div);              \
   GM_SCL_OP_1(TYPENAME, SHORTNAME, BASETYPE, TYPEPREFIX, N, mod);              \
+  GM_NORMALIZE_OP(TYPENAME, SHORTNAME, BASETYPE, TYPEPREFIX, N, normalize);    \
+  GM_FNORMALIZE_OP(TYPENAME, SHORTNAME, BASETYPE, TYPEPREFIX, N, fnorm);       \
   GM_BIN_OP(TYPENAME, SHORTNAME, BASETYPE, TYPEPREFIX, N, add);                \
   GM_BIN_OP(TYPENAME, SHORTNAME, BASETYPE, TYPEPREFIX, N, sub);                \
   GM_QUAT_CONJ_OP(TYPENAME, SHORTNAME, BASETYPE, TYPEPREFIX, N, conj);         \
   GM_QUAT_MUL_OP(TYPENAME, SHORTNAME, BASETYPE, TYPEPREFIX, N, mul);           \
   GM_QUAT_SLERP_OP(TYPENAME, SHORTNAME, BASETYPE, TYPEPREFIX, N, slerp);       \
+  GM_QUAT_NLERP_OP(TYPENAME, SHORTNAME, BASETYPE, TYPEPREFIX, N, nlerp);       \
+  GM_QUAT_FSLERP_OP(TYPENAME, SHORTNAME, BASETYPE, TYPEPREFIX, N, fslerp);     \
   GM_QUAT_ROTV(TYPENAME, SHORTNAME, VECTYPE, BASETYPE, TYPEPREFIX, N, rotv);   \
   GM_QUAT_ROTM(TYPENAME, SHORTNAME, VECTYPE, BASETYPE, TYPEPREFIX, N, rotm);   \
   GM_QUAT_ROT_OP(TYPENAME, SHORTNAME, BASETYPE, TYPEPREFIX, N, rot);           \
@@ -2640,6 +3273,7 @@ typedef struct Quaternion
   GM_MAT4X4_TRS(TYPENAME, SHORTNAME, BASETYPE, TYPEPREFIX, M, N, t, MTYPENAME, \
                 MSHORTNAME, VTYPENAME, VSHORTNAME);                            \
   GM_MAT4X4_FINV(TYPENAME, SHORTNAME, BASETYPE, TYPEPREFIX, M, N, finv);       \
+  GM_MAT4X4_AINV(TYPENAME, SHORTNAME, BASETYPE, TYPEPREFIX, M, N, ainv);       \
   GM_MAT4X4_DET(TYPENAME, SHORTNAME, BASETYPE, TYPEPREFIX, M, N, det);         \
   GM_MAT_LUDECOMP(TYPENAME, SHORTNAME, BASETYPE, TYPEPREFIX, M, N, ludecomp);  \
   GM_MAT_MINOR(TYPENAME, SHORTNAME, BASETYPE, TYPEPREFIX, M, N, O, P, minor,   \
@@ -2650,54 +3284,455 @@ typedef struct Quaternion
                  adjoint, MTYPENAME, MSHORTNAME);                              \
   GM_MAT4X4_INV(TYPENAME, SHORTNAME, BASETYPE, TYPEPREFIX, M, N, inv);
 
-#define GM_BIN_OP_T(TYPENAME, SHORTNAME, BASETYPE, TYPEPREFIX, N)              \
-  GM_BIN_OP(TYPENAME, SHORTNAME, BASETYPE, TYPEPREFIX, N, lshift);             \
-  GM_BIN_OP(TYPENAME, SHORTNAME, BASETYPE, TYPEPREFIX, N, rshift);             \
-  GM_BIN_OP(TYPENAME, SHORTNAME, BASETYPE, TYPEPREFIX, N, band);               \
-  GM_BIN_OP(TYPENAME, SHORTNAME, BASETYPE, TYPEPREFIX, N, bor);                \
-  GM_BIN_OP(TYPENAME, SHORTNAME, BASETYPE, TYPEPREFIX, N, xor);                \
-  GM_BIN_OP(TYPENAME, SHORTNAME, BASETYPE, TYPEPREFIX, N, and);                \
-  GM_REF_OP(TYPENAME, SHORTNAME, BASETYPE, TYPEPREFIX, N, lshift);             \
-  GM_REF_OP(TYPENAME, SHORTNAME, BASETYPE, TYPEPREFIX, N, rshift);             \
-  GM_REF_OP(TYPENAME, SHORTNAME, BASETYPE, TYPEPREFIX, N, band);               \
-  GM_REF_OP(TYPENAME, SHORTNAME, BASETYPE, TYPEPREFIX, N, bor);                \
-  GM_REF_OP(TYPENAME, SHORTNAME, BASETYPE, TYPEPREFIX, N, xor);                \
-  GM_REF_OP(TYPENAME, SHORTNAME, BASETYPE, TYPEPREFIX, N, and);                \
-  GM_REF_OP(TYPENAME, SHORTNAME, BASETYPE, TYPEPREFIX, N, or);
-
-//
-
-#define GM_VEC2_CONSTS(TYPENAME, SHORTNAME, BASETYPE, TYPEPREFIX, N)           \
-  GM_DEF_CONSTS(TYPENAME, SHORTNAME, BASETYPE, TYPEPREFIX, N, right, {1, 0});  \
-  GM_DEF_CONSTS(TYPENAME, SHORTNAME, BASETYPE, TYPEPREFIX, N, up, {0, 1});     \
-  GM_DEF_CONSTS(TYPENAME, SHORTNAME, BASETYPE, TYPEPREFIX, N, down, {0, -1});  \
-  GM_DEF_CONSTS(TYPENAME, SHORTNAME, BASETYPE, TYPEPREFIX, N, left, {-1, 0});
-
-#define GM_VEC3_CONSTS(TYPENAME, SHORTNAME, BASETYPE, TYPEPREFIX, N)           \
-  GM_DEF_CONSTS(TYPENAME, SHORTNAME, BASETYPE, TYPEPREFIX, N, right,           \
-                {1, 0, 0});                                                    \
-  GM_DEF_CONSTS(TYPENAME, SHORTNAME, BASETYPE, TYPEPREFIX, N, up, {0, 1, 0});  \
-  GM_DEF_CONSTS(TYPENAME, SHORTNAME, BASETYPE, TYPEPREFIX, N, forward,         \
-                {0, 0, 1});                                                    \
-  GM_DEF_CONSTS(TYPENAME, SHORTNAME, BASETYPE, TYPEPREFIX, N, left,            \
-                {-1, 0, 0});                                                   \
-  GM_DEF_CONSTS(TYPENAME, SHORTNAME, BASETYPE, TYPEPREFIX, N, down,            \
-                {0, -1, 0});                                                   \
-  GM_DEF_CONSTS(TYPENAME, SHORTNAME, BASETYPE, TYPEPREFIX, N, back, {0, 0, -1});
+// lane-wise operators for the structure-of-arrays types
+// the vector, quaternion and pose lanes are built from the scalar lanes'
+// operators, which GM_SIMD replaces with _gm_f4 code for float_x4/float_x8
 
-#define GM_VEC4_CONSTS(TYPENAME, SHORTNAME, BASETYPE, TYPEPREFIX, N)           \
-  GM_DEF_CONSTS(TYPENAME, SHORTNAME, BASETYPE, TYPEPREFIX, N, right,           \
-                {1, 0, 0, 0});                                                 \
-  GM_DEF_CONSTS(TYPENAME, SHORTNAME, BASETYPE, TYPEPREFIX, N, up,              \
-                {0, 1, 0, 0});                                                 \
-  GM_DEF_CONSTS(TYPENAME, SHORTNAME, BASETYPE, TYPEPREFIX, N, forward,         \
-                {0, 0, 1, 0});                                                 \
-  GM_DEF_CONSTS(TYPENAME, SHORTNAME, BASETYPE, TYPEPREFIX, N, left,            \
-                {-1, 0, 0, 0});                                                \
-  GM_DEF_CONSTS(TYPENAME, SHORTNAME, BASETYPE, TYPEPREFIX, N, down,            \
-                {0, -1, 0, 0});                                                \
-  GM_DEF_CONSTS(TYPENAME, SHORTNAME, BASETYPE, TYPEPREFIX, N, back,            \
-                {0, 0, -1, 0});
+#define GM_LANES_BIN_OP(TYPENAME, SHORTNAME, BASETYPE, TYPEPREFIX, W, OPER)    \
+  GM_CDECL TYPENAME GM_OPERNAME(SHORTNAME, OPER)(const TYPENAME l,             \
+                                                 const TYPENAME r)             \
+  {                                                                            \
+    TYPENAME v;                                                                \
+    for (size_t i = 0; i < W; ++i)                                             \
+    {                                                                          \
+      v.a[i] = GM_OPNAME(BASETYPE, OPER)(l.a[i], r.a[i]);                      \
+    }                                                                          \
+    return v;                                                                  \
+  }
+
+#define GM_LANES_T(TYPENAME, SHORTNAME, BASETYPE, TYPEPREFIX, W)               \
+  typedef struct                                                               \
+  {                                                                            \
+    BASETYPE a[W];                                                             \
+  } TYPENAME;                                                                  \
+  GM_CDECL TYPENAME GM_OPERNAME(SHORTNAME, set1)(const BASETYPE s)             \
+  {                                                                            \
+    TYPENAME v;                                                                \
+    for (size_t i = 0; i < W; ++i)                                             \
+    {                                                                          \
+      v.a[i] = s;                                                              \
+    }                                                                          \
+    return v;                                                                  \
+  }                                                                            \
+  GM_CDECL TYPENAME GM_OPERNAME(SHORTNAME, sqrt)(const TYPENAME m)             \
+  {                                                                            \
+    TYPENAME v;                                                                \
+    for (size_t i = 0; i < W; ++i)                                             \
+    {                                                                          \
+      v.a[i] = GM_OPNAME(BASETYPE, sqrt)(m.a[i]);                              \
+    }                                                                          \
+    return v;                                                                  \
+  }                                                                            \
+  GM_CDECL TYPENAME GM_OPERNAME(SHORTNAME, lensqrt)(const TYPENAME m)          \
+  {                                                                            \
+    TYPENAME v;                                                                \
+    for (size_t i = 0; i < W; ++i)                                             \
+    {                                                                          \
+      v.a[i] = GM_OPNAME(BASETYPE, lensqrt)(m.a[i]);                           \
+    }                                                                          \
+    return v;                                                                  \
+  }                                                                            \
+  GM_CDECL TYPENAME GM_OPERNAME(SHORTNAME, min)(const TYPENAME l,              \
+                                                const TYPENAME r)              \
+  {                                                                            \
+    TYPENAME v;                                                                \
+    for (size_t i = 0; i < W; ++i)                                             \
+    {                                                                          \
+      v.a[i] = GM_OPNAME(BASETYPE, lt)(l.a[i], r.a[i]) ? l.a[i] : r.a[i];      \
+    }                                                                          \
+    return v;                                                                  \
+  }                                                                            \
+  GM_CDECL TYPENAME GM_OPERNAME(SHORTNAME, max)(const TYPENAME l,              \
+                                                const TYPENAME r)              \
+  {                                                                            \
+    TYPENAME v;                                                                \
+    for (size_t i = 0; i < W; ++i)                                             \
+    {                                                                          \
+      v.a[i] = GM_OPNAME(BASETYPE, gt)(l.a[i], r.a[i]) ? l.a[i] : r.a[i];      \
+    }                                                                          \
+    return v;                                                                  \
+  }                                                                            \
+  /* l * r + a */                                                              \
+  GM_CDECL TYPENAME GM_OPERNAME(SHORTNAME, madd)(                              \
+    const TYPENAME l, const TYPENAME r, const TYPENAME a)                      \
+  {                                                                            \
+    TYPENAME v;                                                                \
+    for (size_t i = 0; i < W; ++i)                                             \
+    {                                                                          \
+      v.a[i] = GM_OPNAME(BASETYPE, add)(                                       \
+        GM_OPNAME(BASETYPE, mul)(l.a[i], r.a[i]), a.a[i]);                     \
+    }                                                                          \
+    return v;                                                                  \
+  }                                                                            \
+  /* x where l < r, y elsewhere */                                             \
+  GM_CDECL TYPENAME GM_OPERNAME(SHORTNAME, ltsel)(                             \
+    const TYPENAME l, const TYPENAME r, const TYPENAME x, const TYPENAME y)    \
+  {                                                                            \
+    TYPENAME v;                                                                \
+    for (size_t i = 0; i < W; ++i)                                             \
+    {                                                                          \
+      v.a[i] = GM_OPNAME(BASETYPE, lt)(l.a[i], r.a[i]) ? x.a[i] : y.a[i];      \
+    }                                                                          \
+    return v;                                                                  \
+  }                                                                            \
+  GM_LANES_BIN_OP(TYPENAME, SHORTNAME, BASETYPE, TYPEPREFIX, W, add);          \
+  GM_LANES_BIN_OP(TYPENAME, SHORTNAME, BASETYPE, TYPEPREFIX, W, sub);          \
+  GM_LANES_BIN_OP(TYPENAME, SHORTNAME, BASETYPE, TYPEPREFIX, W, mul);          \
+  GM_LANES_BIN_OP(TYPENAME, SHORTNAME, BASETYPE, TYPEPREFIX, W, div);
+
+#define GM_VECX_BIN_OP(TYPENAME, SHORTNAME, LSHORTNAME, N, OPER)               \
+  GM_CDECL TYPENAME GM_OPERNAME(SHORTNAME, OPER)(const TYPENAME l,             \
+                                                 const TYPENAME r)             \
+  {                                                                            \
+    TYPENAME v;                                                                \
+    for (size_t k = 0; k < N; ++k)                                             \
+    {                                                                          \
+      v.a[k] = GM_OPERNAME(LSHORTNAME, OPER)(l.a[k], r.a[k]);                  \
+    }                                                                          \
+    return v;                                                                  \
+  }
+
+#define GM_VECX_SCL_OP(TYPENAME, SHORTNAME, LTYPENAME, LSHORTNAME, BASETYPE,   \
+                       N, OPER)                                                \
+  GM_CDECL TYPENAME GM_OPERNAME(SHORTNAME, s##OPER)(const TYPENAME l,          \
+                                                    const BASETYPE r)          \
+  {                                                                            \
+    LTYPENAME s = GM_OPERNAME(LSHORTNAME, set1)(r);                            \
+    TYPENAME v;                                                                \
+    for (size_t k = 0; k < N; ++k)                                             \
+    {                                                                          \
+      v.a[k] = GM_OPERNAME(LSHORTNAME, OPER)(l.a[k], s);                       \
+    }                                                                          \
+    return v;                                                                  \
+  }
+
+#define GM_VECX_T(TYPENAME, SHORTNAME, LTYPENAME, LSHORTNAME, VTYPENAME,       \
+                  BASETYPE, TYPEPREFIX, N, W, ...)                             \
+  typedef struct                                                               \
+  {                                                                            \
+    union                                                                      \
+    {                                                                          \
+      struct                                                                   \
+      {                                                                        \
+        LTYPENAME a[N];                                                        \
+      };                                                                       \
+      struct                                                                   \
+      {                                                                        \
+        LTYPENAME __VA_ARGS__;                                                 \
+      };                                                                       \
+    };                                                                         \
+  } TYPENAME;                                                                  \
+  GM_CDECL TYPENAME GM_OPERNAME(SHORTNAME, set1)(const VTYPENAME s)            \
+  {                                                                            \
+    TYPENAME v;                                                                \
+    for (size_t k = 0; k < N; ++k)                                             \
+    {                                                                          \
+      v.a[k] = GM_OPERNAME(LSHORTNAME, set1)(s.a[k]);                          \
+    }                                                                          \
+    return v;                                                                  \
+  }                                                                            \
+  GM_CDECL VTYPENAME GM_OPERNAME(SHORTNAME, get)(const TYPENAME m,             \
+                                                 const size_t i)               \
+  {                                                                            \
+    VTYPENAME v;                                                               \
+    for (size_t k = 0; k < N; ++k)                                             \
+    {                                                                          \
+      v.a[k] = m.a[k].a[i];                                                    \
+    }                                                                          \
+    return v;                                                                  \
+  }                                                                            \
+  GM_CDECL void GM_OPERNAME(SHORTNAME, set)(TYPENAME * m, const size_t i,      \
+                                            const VTYPENAME s)                 \
+  {                                                                            \
+    for (size_t k = 0; k < N; ++k)                                             \
+    {                                                                          \
+      m->a[k].a[i] = s.a[k];                                                   \
+    }                                                                          \
+  }                                                                            \
+  /* gathers up to W vectors, lanes past n are zeroed */                       \
+  GM_CDECL TYPENAME GM_OPERNAME(SHORTNAME, pack)(const VTYPENAME *in,          \
+                                                 const size_t n)               \
+  {                                                                            \
+    TYPENAME v;                                                                \
+    for (size_t k = 0; k < N; ++k)                                             \
+    {                                                                          \
+      for (size_t i = 0; i < W; ++i)                                           \
+      {                                                                        \
+        v.a[k].a[i] = i < n ? in[i].a[k] : (BASETYPE) 0;                       \
+      }                                                                        \
+    }                                                                          \
+    return v;                                                                  \
+  }                                                                            \
+  /* scatters the first n lanes, n is capped at W */                           \
+  GM_CDECL void GM_OPERNAME(SHORTNAME, unpack)(const TYPENAME m,               \
+                                               VTYPENAME *out, size_t n)       \
+  {                                                                            \
+    n = n < W ? n : W;                                                         \
+    for (size_t i = 0; i < n; ++i)                                             \
+    {                                                                          \
+      for (size_t k = 0; k < N; ++k)                                           \
+      {                                                                        \
+        out[i].a[k] = m.a[k].a[i];                                             \
+      }                                                                        \
+    }                                                                          \
+  }                                                                            \
+  GM_VECX_BIN_OP(TYPENAME, SHORTNAME, LSHORTNAME, N, add);                     \
+  GM_VECX_BIN_OP(TYPENAME, SHORTNAME, LSHORTNAME, N, sub);                     \
+  GM_VECX_BIN_OP(TYPENAME, SHORTNAME, LSHORTNAME, N, mul);                     \
+  GM_VECX_BIN_OP(TYPENAME, SHORTNAME, LSHORTNAME, N, div);                     \
+  GM_VECX_BIN_OP(TYPENAME, SHORTNAME, LSHORTNAME, N, min);                     \
+  GM_VECX_BIN_OP(TYPENAME, SHORTNAME, LSHORTNAME, N, max);                     \
+  GM_VECX_SCL_OP(TYPENAME, SHORTNAME, LTYPENAME, LSHORTNAME, BASETYPE, N,      \
+                 add);                                                         \
+  GM_VECX_SCL_OP(TYPENAME, SHORTNAME, LTYPENAME, LSHORTNAME, BASETYPE, N,      \
+                 sub);                                                         \
+  GM_VECX_SCL_OP(TYPENAME, SHORTNAME, LTYPENAME, LSHORTNAME, BASETYPE, N,      \
+                 mul);                                                         \
+  GM_VECX_SCL_OP(TYPENAME, SHORTNAME, LTYPENAME, LSHORTNAME, BASETYPE, N,      \
+                 div);                                                         \
+  GM_CDECL LTYPENAME GM_OPERNAME(SHORTNAME, dot)(const TYPENAME l,             \
+                                                 const TYPENAME r)             \
+  {                                                                            \
+    LTYPENAME v = GM_OPERNAME(LSHORTNAME, mul)(l.a[0], r.a[0]);                \
+    for (size_t k = 1; k < N; ++k)                                             \
+    {                                                                          \
+      v = GM_OPERNAME(LSHORTNAME, madd)(l.a[k], r.a[k], v);                    \
+    }                                                                          \
+    return v;                                                                  \
+  }                                                                            \
+  GM_CDECL LTYPENAME GM_OPERNAME(SHORTNAME, sqlen)(const TYPENAME m)           \
+  {                                                                            \
+    return GM_OPERNAME(SHORTNAME, dot)(m, m);                                  \
+  }                                                                            \
+  GM_CDECL LTYPENAME GM_OPERNAME(SHORTNAME, len)(const TYPENAME m)             \
+  {                                                                            \
+    LTYPENAME v = GM_OPERNAME(SHORTNAME, dot)(m, m);                           \
+    return GM_OPERNAME(LSHORTNAME, lensqrt)(v);                                \
+  }                                                                            \
+  GM_CDECL LTYPENAME GM_OPERNAME(SHORTNAME, distance)(const TYPENAME l,        \
+                                                      const TYPENAME r)        \
+  {                                                                            \
+    return GM_OPERNAME(SHORTNAME, len)(GM_OPERNAME(SHORTNAME, sub)(r, l));     \
+  }                                                                            \
+  /* zero-length lanes are passed through, as with the scalar normalize */     \
+  GM_CDECL TYPENAME GM_OPERNAME(SHORTNAME, normalize)(const TYPENAME m)        \
+  {                                                                            \
+    LTYPENAME z = GM_OPERNAME(LSHORTNAME, set1)((BASETYPE) 0);                 \
+    LTYPENAME l = GM_OPERNAME(SHORTNAME, len)(m);                              \
+    l           = GM_OPERNAME(LSHORTNAME, ltsel)(                              \
+      z, l, l, GM_OPERNAME(LSHORTNAME, set1)((BASETYPE) 1));                   \
+    TYPENAME v;                                                                \
+    for (size_t k = 0; k < N; ++k)                                             \
+    {                                                                          \
+      v.a[k] = GM_OPERNAME(LSHORTNAME, div)(m.a[k], l);                        \
+    }                                                                          \
+    return v;                                                                  \
+  }                                                                            \
+  /* a + t * (b - a) as with the scalar lerp */                                \
+  GM_CDECL TYPENAME GM_OPERNAME(SHORTNAME, lerp)(                              \
+    const TYPENAME a, const TYPENAME b, const BASETYPE t)                      \
+  {                                                                            \
+    LTYPENAME s = GM_OPERNAME(LSHORTNAME, set1)(t);                            \
+    TYPENAME v;                                                                \
+    for (size_t k = 0; k < N; ++k)                                             \
+    {                                                                          \
+      v.a[k] = GM_OPERNAME(LSHORTNAME, madd)(                                  \
+        s, GM_OPERNAME(LSHORTNAME, sub)(b.a[k], a.a[k]), a.a[k]);              \
+    }                                                                          \
+    return v;                                                                  \
+  }                                                                            \
+  GM_CDECL TYPENAME GM_OPERNAME(SHORTNAME, clamp)(                             \
+    const TYPENAME v, const TYPENAME min, const TYPENAME max)                  \
+  {                                                                            \
+    return GM_OPERNAME(SHORTNAME, min)(GM_OPERNAME(SHORTNAME, max)(v, min),    \
+                                       max);                                   \
+  }
+
+#define GM_VECX_CROSS(TYPENAME, SHORTNAME, LSHORTNAME, OPER)                   \
+  GM_CDECL TYPENAME GM_OPERNAME(SHORTNAME, OPER)(const TYPENAME l,             \
+                                                 const TYPENAME r)             \
+  {                                                                            \
+    TYPENAME v;                                                                \
+    for (size_t k = 0; k < 3; ++k)                                             \
+    {                                                                          \
+      size_t i = (k + 1) % 3, j = (k + 2) % 3;                                 \
+      v.a[k]   = GM_OPERNAME(LSHORTNAME, sub)(                                 \
+        GM_OPERNAME(LSHORTNAME, mul)(l.a[i], r.a[j]),                          \
+        GM_OPERNAME(LSHORTNAME, mul)(l.a[j], r.a[i]));                         \
+    }                                                                          \
+    return v;                                                                  \
+  }
+
+// shortest-arc blends over W quaternion lanes, b is negated per lane where
+// it lies in the opposite hemisphere from a
+#define GM_QUATX_NLERP(TYPENAME, SHORTNAME, LTYPENAME, LSHORTNAME, BASETYPE,   \
+                       OPER)                                                   \
+  GM_CDECL TYPENAME GM_OPERNAME(SHORTNAME, OPER)(                              \
+    const TYPENAME a, const TYPENAME b, const BASETYPE t)                      \
+  {                                                                            \
+    LTYPENAME d = GM_OPERNAME(SHORTNAME, dot)(a, b);                           \
+    LTYPENAME u = GM_OPERNAME(LSHORTNAME, set1)(1 - t);                        \
+    LTYPENAME s = GM_OPERNAME(LSHORTNAME, ltsel)(                              \
+      d, GM_OPERNAME(LSHORTNAME, set1)((BASETYPE) 0),                          \
+      GM_OPERNAME(LSHORTNAME, set1)(-t), GM_OPERNAME(LSHORTNAME, set1)(t));    \
+    TYPENAME v;                                                                \
+    for (size_t k = 0; k < 4; ++k)                                             \
+    {                                                                          \
+      v.a[k] = GM_OPERNAME(LSHORTNAME, madd)(                                  \
+        s, b.a[k], GM_OPERNAME(LSHORTNAME, mul)(u, a.a[k]));                   \
+    }                                                                          \
+    return GM_OPERNAME(SHORTNAME, normalize)(v);                               \
+  }
+
+// eberly's polynomial slerp, the sin ratios are expanded as a series in
+// cos(theta) - 1 with the eighth term scaled by mu to absorb the rest
+// within 2e-5 of the trigonometric weights, with no acos, sin or divide
+#define GM_QUATX_SLERP(TYPENAME, SHORTNAME, LTYPENAME, LSHORTNAME, BASETYPE,   \
+                       OPER)                                                   \
+  GM_CDECL TYPENAME GM_OPERNAME(SHORTNAME, OPER)(                              \
+    const TYPENAME a, const TYPENAME b, const BASETYPE t)                      \
+  {                                                                            \
+    const BASETYPE mu = (BASETYPE) 1.85298109240830;                           \
+    const BASETYPE s  = 1 - t;                                                 \
+    BASETYPE bt[8], bs[8];                                                     \
+    for (size_t j = 0; j < 8; ++j)                                             \
+    {                                                                          \
+      BASETYPE u = (BASETYPE) 1 / (BASETYPE) ((j + 1) * (2 * j + 3));          \
+      BASETYPE v = (BASETYPE) (j + 1) / (BASETYPE) (2 * j + 3);                \
+      u          = j == 7 ? u * mu : u;                                        \
+      v          = j == 7 ? v * mu : v;                                        \
+      bt[j]      = u * t * t - v;                                              \
+      bs[j]      = u * s * s - v;                                              \
+    }                                                                          \
+    LTYPENAME one  = GM_OPERNAME(LSHORTNAME, set1)((BASETYPE) 1);              \
+    LTYPENAME d    = GM_OPERNAME(SHORTNAME, dot)(a, b);                        \
+    LTYPENAME sign = GM_OPERNAME(LSHORTNAME, ltsel)(                           \
+      d, GM_OPERNAME(LSHORTNAME, set1)((BASETYPE) 0),                          \
+      GM_OPERNAME(LSHORTNAME, set1)((BASETYPE) -1), one);                      \
+    LTYPENAME xm1  = GM_OPERNAME(LSHORTNAME, mul)(d, sign);                    \
+    xm1            = GM_OPERNAME(LSHORTNAME, sub)(xm1, one);                   \
+    LTYPENAME ct = one, cs = one;                                              \
+    for (size_t j = 8; j-- > 0;)                                               \
+    {                                                                          \
+      LTYPENAME et = GM_OPERNAME(LSHORTNAME, set1)(bt[j]);                     \
+      LTYPENAME es = GM_OPERNAME(LSHORTNAME, set1)(bs[j]);                     \
+      ct           = GM_OPERNAME(LSHORTNAME, madd)(                            \
+        GM_OPERNAME(LSHORTNAME, mul)(et, xm1), ct, one);                       \
+      cs           = GM_OPERNAME(LSHORTNAME, madd)(                            \
+        GM_OPERNAME(LSHORTNAME, mul)(es, xm1), cs, one);                       \
+    }                                                                          \
+    LTYPENAME ts = GM_OPERNAME(LSHORTNAME, set1)(t);                           \
+    LTYPENAME ss = GM_OPERNAME(LSHORTNAME, set1)(s);                           \
+    ts = GM_OPERNAME(LSHORTNAME, mul)(ts, sign);                               \
+    ct = GM_OPERNAME(LSHORTNAME, mul)(ct, ts);                                 \
+    cs = GM_OPERNAME(LSHORTNAME, mul)(cs, ss);                                 \
+    TYPENAME r;                                                                \
+    for (size_t k = 0; k < 4; ++k)                                             \
+    {                                                                          \
+      r.a[k] = GM_OPERNAME(LSHORTNAME, madd)(                                  \
+        ct, b.a[k], GM_OPERNAME(LSHORTNAME, mul)(cs, a.a[k]));                 \
+    }                                                                          \
+    return r;                                                                  \
+  }
+
+// W joint transforms in component form, blended as a lerp of translation
+// and scale and an nlerp of rotation
+#define GM_POSEX_T(TYPENAME, SHORTNAME, VXTYPENAME, VXSHORTNAME, QXTYPENAME,   \
+                   QXSHORTNAME, VTYPENAME, QTYPENAME, BASETYPE, TYPEPREFIX,    \
+                   W)                                                          \
+  typedef struct                                                               \
+  {                                                                            \
+    VXTYPENAME t;                                                              \
+    QXTYPENAME r;                                                              \
+    VXTYPENAME s;                                                              \
+  } TYPENAME;                                                                  \
+  /* gathers up to W transforms, lanes past n are zeroed */                    \
+  GM_CDECL TYPENAME GM_OPERNAME(SHORTNAME, pack)(                              \
+    const VTYPENAME *t, const QTYPENAME *r, const VTYPENAME *s,                \
+    const size_t n)                                                            \
+  {                                                                            \
+    TYPENAME v;                                                                \
+    v.t = GM_OPERNAME(VXSHORTNAME, pack)(t, n);                                \
+    v.r = GM_OPERNAME(QXSHORTNAME, pack)(r, n);                                \
+    v.s = GM_OPERNAME(VXSHORTNAME, pack)(s, n);                                \
+    return v;                                                                  \
+  }                                                                            \
+  /* scatters the first n lanes, n is capped at W */                           \
+  GM_CDECL void GM_OPERNAME(SHORTNAME, unpack)(                                \
+    const TYPENAME m, VTYPENAME *t, QTYPENAME *r, VTYPENAME *s, size_t n)      \
+  {                                                                            \
+    GM_OPERNAME(VXSHORTNAME, unpack)(m.t, t, n);                               \
+    GM_OPERNAME(QXSHORTNAME, unpack)(m.r, r, n);                               \
+    GM_OPERNAME(VXSHORTNAME, unpack)(m.s, s, n);                               \
+  }                                                                            \
+  GM_CDECL TYPENAME GM_OPERNAME(SHORTNAME, blend)(                             \
+    const TYPENAME a, const TYPENAME b, const BASETYPE w)                      \
+  {                                                                            \
+    TYPENAME v;                                                                \
+    v.t = GM_OPERNAME(VXSHORTNAME, lerp)(a.t, b.t, w);                         \
+    v.r = GM_OPERNAME(QXSHORTNAME, nlerp)(a.r, b.r, w);                        \
+    v.s = GM_OPERNAME(VXSHORTNAME, lerp)(a.s, b.s, w);                         \
+    return v;                                                                  \
+  }                                                                            \
+  /* blends n blocks of W transforms, out may be the same array as a or b */   \
+  GM_CDECL void GM_OPERNAME(SHORTNAME, blend_many)(                            \
+    const TYPENAME *a, const TYPENAME *b, const BASETYPE w, TYPENAME *out,     \
+    const size_t n)                                                            \
+  {                                                                            \
+    for (size_t i = 0; i < n; ++i)                                             \
+    {                                                                          \
+      out[i] = GM_OPERNAME(SHORTNAME, blend)(a[i], b[i], w);                   \
+    }                                                                          \
+  }
+
+#define GM_BIN_OP_T(TYPENAME, SHORTNAME, BASETYPE, TYPEPREFIX, N)              \
+  GM_BIN_OP(TYPENAME, SHORTNAME, BASETYPE, TYPEPREFIX, N, lshift);             \
+  GM_BIN_OP(TYPENAME, SHORTNAME, BASETYPE, TYPEPREFIX, N, rshift);             \
+  GM_BIN_OP(TYPENAME, SHORTNAME, BASETYPE, TYPEPREFIX, N, band);               \
+  GM_BIN_OP(TYPENAME, SHORTNAME, BASETYPE, TYPEPREFIX, N, bor);                \
+  GM_BIN_OP(TYPENAME, SHORTNAME, BASETYPE, TYPEPREFIX, N, xor);                \
+  GM_BIN_OP(TYPENAME, SHORTNAME, BASETYPE, TYPEPREFIX, N, and);                \
+  GM_REF_OP(TYPENAME, SHORTNAME, BASETYPE, TYPEPREFIX, N, lshift);             \
+  GM_REF_OP(TYPENAME, SHORTNAME, BASETYPE, TYPEPREFIX, N, rshift);             \
+  GM_REF_OP(TYPENAME, SHORTNAME, BASETYPE, TYPEPREFIX, N, band);               \
+  GM_REF_OP(TYPENAME, SHORTNAME, BASETYPE, TYPEPREFIX, N, bor);                \
+  GM_REF_OP(TYPENAME, SHORTNAME, BASETYPE, TYPEPREFIX, N, xor);                \
+  GM_REF_OP(TYPENAME, SHORTNAME, BASETYPE, TYPEPREFIX, N, and);                \
+  GM_REF_OP(TYPENAME, SHORTNAME, BASETYPE, TYPEPREFIX, N, or);
+
+//
+
+#define GM_VEC2_CONSTS(TYPENAME, SHORTNAME, BASETYPE, TYPEPREFIX, N)           \
+  GM_DEF_CONSTS(TYPENAME, SHORTNAME, BASETYPE, TYPEPREFIX, N, right, {1, 0});  \
+  GM_DEF_CONSTS(TYPENAME, SHORTNAME, BASETYPE, TYPEPREFIX, N, up, {0, 1});     \
+  GM_DEF_CONSTS(TYPENAME, SHORTNAME, BASETYPE, TYPEPREFIX, N, down, {0, -1});  \
+  GM_DEF_CONSTS(TYPENAME, SHORTNAME, BASETYPE, TYPEPREFIX, N, left, {-1, 0});
+
+#define GM_VEC3_CONSTS(TYPENAME, SHORTNAME, BASETYPE, TYPEPREFIX, N)           \
+  GM_DEF_CONSTS(TYPENAME, SHORTNAME, BASETYPE, TYPEPREFIX, N, right,           \
+                {1, 0, 0});                                                    \
+  GM_DEF_CONSTS(TYPENAME, SHORTNAME, BASETYPE, TYPEPREFIX, N, up, {0, 1, 0});  \
+  GM_DEF_CONSTS(TYPENAME, SHORTNAME, BASETYPE, TYPEPREFIX, N, forward,         \
+                {0, 0, 1});                                                    \
+  GM_DEF_CONSTS(TYPENAME, SHORTNAME, BASETYPE, TYPEPREFIX, N, left,            \
+                {-1, 0, 0});                                                   \
+  GM_DEF_CONSTS(TYPENAME, SHORTNAME, BASETYPE, TYPEPREFIX, N, down,            \
+                {0, -1, 0});                                                   \
+  GM_DEF_CONSTS(TYPENAME, SHORTNAME, BASETYPE, TYPEPREFIX, N, back, {0, 0, -1});
+
+#define GM_VEC4_CONSTS(TYPENAME, SHORTNAME, BASETYPE, TYPEPREFIX, N)           \
+  GM_DEF_CONSTS(TYPENAME, SHORTNAME, BASETYPE, TYPEPREFIX, N, right,           \
+                {1, 0, 0, 0});                                                 \
+  GM_DEF_CONSTS(TYPENAME, SHORTNAME, BASETYPE, TYPEPREFIX, N, up,              \
+                {0, 1, 0, 0});                                                 \
+  GM_DEF_CONSTS(TYPENAME, SHORTNAME, BASETYPE, TYPEPREFIX, N, forward,         \
+                {0, 0, 1, 0});                                                 \
+  GM_DEF_CONSTS(TYPENAME, SHORTNAME, BASETYPE, TYPEPREFIX, N, left,            \
+                {-1, 0, 0, 0});                                                \
+  GM_DEF_CONSTS(TYPENAME, SHORTNAME, BASETYPE, TYPEPREFIX, N, down,            \
+                {0, -1, 0, 0});                                                \
+  GM_DEF_CONSTS(TYPENAME, SHORTNAME, BASETYPE, TYPEPREFIX, N, back,            \
+                {0, 0, -1, 0});
 
 #define GM_MAT4X4_CONSTS(TYPENAME, SHORTNAME, BASETYPE, TYPEPREFIX, N)         \
   GM_DEF_CONSTS(TYPENAME, SHORTNAME, BASETYPE, TYPEPREFIX, N, catmull,         \
@@ -2705,8 +3740,83 @@ typedef struct Quaternion
                  0.0, 0.0, 1.0, 0.0, 0.0});                                    \
   GM_DEF_CONSTS(TYPENAME, SHORTNAME, BASETYPE, TYPEPREFIX, N, bezier,          \
                 {-1.0, 3.0, -3.0, 1.0, 3.0, -6.0, 3.0, 0.0, -3.0, 3.0, 0.0,    \
+                 0.0, 1.0, 0.0, 0.0, 0.0});                                    \
+  GM_DEF_CONSTS(TYPENAME, SHORTNAME, BASETYPE, TYPEPREFIX, N, bspline,         \
+                {-1 / 6.0, 3 / 6.0, -3 / 6.0, 1 / 6.0, 3 / 6.0, -6 / 6.0,      \
+                 3 / 6.0, 0.0, -3 / 6.0, 0.0, 3 / 6.0, 0.0, 1 / 6.0, 4 / 6.0,  \
+                 1 / 6.0, 0.0});                                               \
+  /* controls ordered p0, t0, p1, t1 */                                        \
+  GM_DEF_CONSTS(TYPENAME, SHORTNAME, BASETYPE, TYPEPREFIX, N, hermite,         \
+                {2.0, 1.0, -2.0, 1.0, -3.0, -2.0, 3.0, -1.0, 0.0, 1.0, 0.0,    \
                  0.0, 1.0, 0.0, 0.0, 0.0});
 
+#if defined(GM_SIMD_SSE) || defined(GM_SIMD_NEON)
+// the generic instantiations keep their scalar bodies under these names
+// the intrinsic versions below take over the public ones
+#define v4f_add _gm_scalar_v4f_add
+#define v4f_sub _gm_scalar_v4f_sub
+#define v4f_mul _gm_scalar_v4f_mul
+#define v4f_div _gm_scalar_v4f_div
+#define v4f_smul _gm_scalar_v4f_smul
+#define v4f_dot _gm_scalar_v4f_dot
+#define v4f_sqlen _gm_scalar_v4f_sqlen
+#define v4f_len _gm_scalar_v4f_len
+#define v4f_normalize _gm_scalar_v4f_normalize
+#define v4f_cross _gm_scalar_v4f_cross
+#define m4f_mul _gm_scalar_m4f_mul
+#define m4f_mulv _gm_scalar_m4f_mulv
+#define m4f_transpose _gm_scalar_m4f_transpose
+#define qf_mul _gm_scalar_qf_mul
+#define qf_dot _gm_scalar_qf_dot
+#define qf_normalize _gm_scalar_qf_normalize
+#define qf_rotv _gm_scalar_qf_rotv
+#define f_x4_set1 _gm_scalar_f_x4_set1
+#define f_x4_sqrt _gm_scalar_f_x4_sqrt
+#define f_x4_min _gm_scalar_f_x4_min
+#define f_x4_max _gm_scalar_f_x4_max
+#define f_x4_add _gm_scalar_f_x4_add
+#define f_x4_sub _gm_scalar_f_x4_sub
+#define f_x4_mul _gm_scalar_f_x4_mul
+#define f_x4_div _gm_scalar_f_x4_div
+#define f_x4_madd _gm_scalar_f_x4_madd
+#define f_x4_ltsel _gm_scalar_f_x4_ltsel
+#define f_x8_set1 _gm_scalar_f_x8_set1
+#define f_x8_sqrt _gm_scalar_f_x8_sqrt
+#define f_x8_min _gm_scalar_f_x8_min
+#define f_x8_max _gm_scalar_f_x8_max
+#define f_x8_add _gm_scalar_f_x8_add
+#define f_x8_sub _gm_scalar_f_x8_sub
+#define f_x8_mul _gm_scalar_f_x8_mul
+#define f_x8_div _gm_scalar_f_x8_div
+#define f_x8_madd _gm_scalar_f_x8_madd
+#define f_x8_ltsel _gm_scalar_f_x8_ltsel
+#ifndef GM_FAST_MATH
+#define f_x4_lensqrt _gm_scalar_f_x4_lensqrt
+#define f_x8_lensqrt _gm_scalar_f_x8_lensqrt
+#endif
+#if defined(GM_SIMD_SSE)
+#define m4f_tryinv _gm_scalar_m4f_tryinv
+#define m4f_inv _gm_scalar_m4f_inv
+#endif
+#if defined(GM_SIMD_AVX)
+#define v4d_add _gm_scalar_v4d_add
+#define v4d_sub _gm_scalar_v4d_sub
+#define v4d_mul _gm_scalar_v4d_mul
+#define v4d_div _gm_scalar_v4d_div
+#define v4d_smul _gm_scalar_v4d_smul
+#define v4d_dot _gm_scalar_v4d_dot
+#define v4d_sqlen _gm_scalar_v4d_sqlen
+#define v4d_len _gm_scalar_v4d_len
+#define v4d_normalize _gm_scalar_v4d_normalize
+#define m4d_mul _gm_scalar_m4d_mul
+#define m4d_mulv _gm_scalar_m4d_mulv
+#define m4d_transpose _gm_scalar_m4d_transpose
+#define qd_mul _gm_scalar_qd_mul
+#define qd_dot _gm_scalar_qd_dot
+#define qd_normalize _gm_scalar_qd_normalize
+#endif
+#endif
+
 #define X(BASETYPE, TYPEPREFIX)                                                \
   GM_ANG_T(GM_ANG_TYPENAME(BASETYPE, TYPEPREFIX),                              \
            GM_ANG_SHORTNAME(BASETYPE, TYPEPREFIX), BASETYPE, TYPEPREFIX);
@@ -2774,6 +3884,21 @@ GM_VEC4F_T_X_LIST;
 GM_VEC4I_T_X_LIST;
 #undef X
 
+#define X(BASETYPE, TYPEPREFIX, N, ...)                                        \
+  GM_NORMALIZE_OP(GM_VEC_TYPENAME(BASETYPE, TYPEPREFIX, N),                    \
+                  GM_VEC_SHORTNAME(BASETYPE, TYPEPREFIX, N), BASETYPE,         \
+                  TYPEPREFIX, N, normalize);                                   \
+  GM_FLEN_OP(GM_VEC_TYPENAME(BASETYPE, TYPEPREFIX, N),                         \
+             GM_VEC_SHORTNAME(BASETYPE, TYPEPREFIX, N), BASETYPE, TYPEPREFIX,  \
+             N, flen);                                                         \
+  GM_FNORMALIZE_OP(GM_VEC_TYPENAME(BASETYPE, TYPEPREFIX, N),                   \
+                   GM_VEC_SHORTNAME(BASETYPE, TYPEPREFIX, N), BASETYPE,        \
+                   TYPEPREFIX, N, fnorm);
+GM_VEC2F_T_X_LIST;
+GM_VEC3F_T_X_LIST;
+GM_VEC4F_T_X_LIST;
+#undef X
+
 #define X(BASETYPE, TYPEPREFIX, M, N, ...)                                     \
   GM_MAT_T(GM_MAT_TYPENAME(BASETYPE, TYPEPREFIX, M, N),                        \
            GM_MAT_SHORTNAME(BASETYPE, TYPEPREFIX, M, N),                       \
@@ -2830,6 +3955,20 @@ GM_MAT4X4F_T_X_LIST;
 GM_MAT4X4I_T_X_LIST;
 #undef X
 
+#define X(BASETYPE, TYPEPREFIX, M, N, ...)                                     \
+  GM_MAT_LUSOLVE(GM_MAT_TYPENAME(BASETYPE, TYPEPREFIX, M, N),                  \
+                 GM_MAT_SHORTNAME(BASETYPE, TYPEPREFIX, M, N),                 \
+                 GM_VEC_TYPENAME(BASETYPE, TYPEPREFIX, N), BASETYPE,           \
+                 TYPEPREFIX, N, lusolve);                                      \
+  GM_MAT_CHOLSOLVE(GM_MAT_TYPENAME(BASETYPE, TYPEPREFIX, M, N),                \
+                   GM_MAT_SHORTNAME(BASETYPE, TYPEPREFIX, M, N),               \
+                   GM_VEC_TYPENAME(BASETYPE, TYPEPREFIX, N), BASETYPE,         \
+                   TYPEPREFIX, N, cholsolve);
+GM_MAT2X2F_T_X_LIST;
+GM_MAT3X3F_T_X_LIST;
+GM_MAT4X4F_T_X_LIST;
+#undef X
+
 #define X(BASETYPE, TYPEPREFIX, M, N, O, P)                                    \
   GM_MAT4X4_CONSTS(GM_MAT_TYPENAME(BASETYPE, TYPEPREFIX, M, N),                \
                    GM_MAT_SHORTNAME(BASETYPE, TYPEPREFIX, M, N), BASETYPE,     \
@@ -2845,6 +3984,5294 @@ GM_MAT4X4F_T_X_LIST;
 GM_QUAT_T_X_LIST;
 #undef X
 
+#define X(BASETYPE, TYPEPREFIX, W)                                             \
+  GM_LANES_T(GM_LANES_TYPENAME(BASETYPE, TYPEPREFIX, W),                       \
+             GM_LANES_SHORTNAME(BASETYPE, TYPEPREFIX, W), BASETYPE,            \
+             TYPEPREFIX, W);
+GM_LANES_T_X_LIST;
+#undef X
+
+#if defined(GM_SIMD_SSE) || defined(GM_SIMD_NEON)
+#undef v4f_add
+#undef v4f_sub
+#undef v4f_mul
+#undef v4f_div
+#undef v4f_smul
+#undef v4f_dot
+#undef v4f_sqlen
+#undef v4f_len
+#undef v4f_normalize
+#undef v4f_cross
+#undef m4f_mul
+#undef m4f_mulv
+#undef m4f_transpose
+#undef qf_mul
+#undef qf_dot
+#undef qf_normalize
+#undef qf_rotv
+#undef f_x4_set1
+#undef f_x4_sqrt
+#undef f_x4_min
+#undef f_x4_max
+#undef f_x4_add
+#undef f_x4_sub
+#undef f_x4_mul
+#undef f_x4_div
+#undef f_x4_madd
+#undef f_x4_ltsel
+#undef f_x8_set1
+#undef f_x8_sqrt
+#undef f_x8_min
+#undef f_x8_max
+#undef f_x8_add
+#undef f_x8_sub
+#undef f_x8_mul
+#undef f_x8_div
+#undef f_x8_madd
+#undef f_x8_ltsel
+#ifndef GM_FAST_MATH
+#undef f_x4_lensqrt
+#undef f_x8_lensqrt
+#endif
+#if defined(GM_SIMD_SSE)
+#undef m4f_tryinv
+#undef m4f_inv
+#endif
+#if defined(GM_SIMD_AVX)
+#undef v4d_add
+#undef v4d_sub
+#undef v4d_mul
+#undef v4d_div
+#undef v4d_smul
+#undef v4d_dot
+#undef v4d_sqlen
+#undef v4d_len
+#undef v4d_normalize
+#undef m4d_mul
+#undef m4d_mulv
+#undef m4d_transpose
+#undef qd_mul
+#undef qd_dot
+#undef qd_normalize
+#endif
+
+// four float lanes, the minimal set of primitives the operators need
+
+#if defined(GM_SIMD_SSE)
+typedef __m128 _gm_f4;
+#define _gm_f4_load(P) _mm_loadu_ps(P)
+#define _gm_f4_store(P, V) _mm_storeu_ps(P, V)
+#define _gm_f4_set1(X) _mm_set1_ps(X)
+#define _gm_f4_setr(X, Y, Z, W) _mm_setr_ps(X, Y, Z, W)
+#define _gm_f4_add(L, R) _mm_add_ps(L, R)
+#define _gm_f4_sub(L, R) _mm_sub_ps(L, R)
+#define _gm_f4_mul(L, R) _mm_mul_ps(L, R)
+#define _gm_f4_div(L, R) _mm_div_ps(L, R)
+#if defined(__FMA__)
+#define _gm_f4_madd(L, R, A) _mm_fmadd_ps(L, R, A)
+#else
+#define _gm_f4_madd(L, R, A) _mm_add_ps(_mm_mul_ps(L, R), A)
+#endif
+#define _gm_f4_splat(V, I) _mm_shuffle_ps(V, V, _MM_SHUFFLE(I, I, I, I))
+#define _gm_f4_yzxw(V) _mm_shuffle_ps(V, V, _MM_SHUFFLE(3, 0, 2, 1))
+#define _gm_f4_yxwz(V) _mm_shuffle_ps(V, V, _MM_SHUFFLE(2, 3, 0, 1))
+#define _gm_f4_zwxy(V) _mm_shuffle_ps(V, V, _MM_SHUFFLE(1, 0, 3, 2))
+#define _gm_f4_wzyx(V) _mm_shuffle_ps(V, V, _MM_SHUFFLE(0, 1, 2, 3))
+#define _gm_f4_transpose(R0, R1, R2, R3) _MM_TRANSPOSE4_PS(R0, R1, R2, R3)
+#define _gm_f4_sqrt(V) _mm_sqrt_ps(V)
+// estimate plus one newton step, as fast_rsqrtf
+#define _gm_f4_rsqrt(V)                                                        \
+  _gm_f4_rsqrt_step(V, _mm_rsqrt_ps(V))
+#define _gm_f4_rsqrt_step(V, Y)                                                \
+  _mm_mul_ps(Y, _mm_sub_ps(_mm_set1_ps(1.5f),                                  \
+                           _mm_mul_ps(_mm_mul_ps(_mm_set1_ps(0.5f), V),        \
+                                      _mm_mul_ps(Y, Y))))
+#define _gm_f4_zero_to_one(V)                                                  \
+  _mm_add_ps(V, _mm_and_ps(_mm_cmpeq_ps(V, _mm_setzero_ps()), _mm_set1_ps(1)))
+// four packed xyz triples in and out of one register per component
+#define _gm_f4_load3(P, X, Y, Z)                                               \
+  do                                                                           \
+  {                                                                            \
+    __m128 _a  = _mm_loadu_ps((P) + 0);                                        \
+    __m128 _b  = _mm_loadu_ps((P) + 4);                                        \
+    __m128 _c  = _mm_loadu_ps((P) + 8);                                        \
+    __m128 _t0 = _mm_shuffle_ps(_b, _c, _MM_SHUFFLE(2, 1, 3, 2));              \
+    __m128 _t1 = _mm_shuffle_ps(_a, _b, _MM_SHUFFLE(1, 0, 2, 1));              \
+    X          = _mm_shuffle_ps(_a, _t0, _MM_SHUFFLE(2, 0, 3, 0));             \
+    Y          = _mm_shuffle_ps(_t1, _t0, _MM_SHUFFLE(3, 1, 2, 0));            \
+    Z          = _mm_shuffle_ps(_t1, _c, _MM_SHUFFLE(3, 0, 3, 1));             \
+  } while (0)
+#define _gm_f4_store3(P, X, Y, Z)                                              \
+  do                                                                           \
+  {                                                                            \
+    __m128 _t0 = _mm_shuffle_ps(X, Y, _MM_SHUFFLE(2, 0, 2, 0));                \
+    __m128 _t1 = _mm_shuffle_ps(X, Y, _MM_SHUFFLE(3, 1, 3, 1));                \
+    __m128 _t2 = _mm_shuffle_ps(Z, _t1, _MM_SHUFFLE(0, 0, 2, 0));              \
+    __m128 _t3 = _mm_shuffle_ps(_t1, Z, _MM_SHUFFLE(1, 1, 2, 2));              \
+    __m128 _t4 = _mm_shuffle_ps(Z, _t1, _MM_SHUFFLE(1, 1, 2, 2));              \
+    __m128 _t5 = _mm_shuffle_ps(_t1, Z, _MM_SHUFFLE(3, 3, 3, 3));              \
+    _mm_storeu_ps((P) + 0, _mm_shuffle_ps(_t0, _t2, _MM_SHUFFLE(2, 0, 2, 0))); \
+    _mm_storeu_ps((P) + 4, _mm_shuffle_ps(_t3, _t0, _MM_SHUFFLE(3, 1, 2, 0))); \
+    _mm_storeu_ps((P) + 8, _mm_shuffle_ps(_t4, _t5, _MM_SHUFFLE(2, 0, 2, 0))); \
+  } while (0)
+
+GM_CDECL float _gm_f4_hsum(const _gm_f4 v)
+{
+  _gm_f4 s = _mm_add_ps(v, _mm_movehl_ps(v, v));
+  s        = _mm_add_ss(s, _mm_shuffle_ps(s, s, _MM_SHUFFLE(1, 1, 1, 1)));
+  return _mm_cvtss_f32(s);
+}
+
+// lane-wise fminf and fmaxf, a nan in one operand yields the other
+GM_CDECL _gm_f4 _gm_f4_fmin(const _gm_f4 l, const _gm_f4 r)
+{
+  __m128 n = _mm_cmpunord_ps(r, r);
+  return _mm_or_ps(_mm_and_ps(n, l), _mm_andnot_ps(n, _mm_min_ps(l, r)));
+}
+
+GM_CDECL _gm_f4 _gm_f4_fmax(const _gm_f4 l, const _gm_f4 r)
+{
+  __m128 n = _mm_cmpunord_ps(r, r);
+  return _mm_or_ps(_mm_and_ps(n, l), _mm_andnot_ps(n, _mm_max_ps(l, r)));
+}
+
+// compares give all-ones lanes where they hold, and _gm_f4_mask packs the
+// lanes' top bits into bits 0 to 3
+#define _gm_f4_eq(L, R) _mm_cmpeq_ps(L, R)
+#define _gm_f4_neq(L, R) _mm_cmpneq_ps(L, R)
+#define _gm_f4_lt(L, R) _mm_cmplt_ps(L, R)
+#define _gm_f4_le(L, R) _mm_cmple_ps(L, R)
+#define _gm_f4_and(L, R) _mm_and_ps(L, R)
+#define _gm_f4_or(L, R) _mm_or_ps(L, R)
+#define _gm_f4_select(M, A, B) _mm_or_ps(_mm_and_ps(M, A), _mm_andnot_ps(M, B))
+#define _gm_f4_mask(M) _mm_movemask_ps(M)
+
+// a * b - c * d lane-wise with the products exact in double, so the result
+// is the same whether or not the compiler fuses the subtraction
+GM_CDECL _gm_f4 _gm_f4_dop(const _gm_f4 a, const _gm_f4 b, const _gm_f4 c,
+                           const _gm_f4 d)
+{
+  __m128d lo = _mm_sub_pd(_mm_mul_pd(_mm_cvtps_pd(a), _mm_cvtps_pd(b)),
+                          _mm_mul_pd(_mm_cvtps_pd(c), _mm_cvtps_pd(d)));
+  __m128d hi = _mm_sub_pd(_mm_mul_pd(_mm_cvtps_pd(_mm_movehl_ps(a, a)),
+                                     _mm_cvtps_pd(_mm_movehl_ps(b, b))),
+                          _mm_mul_pd(_mm_cvtps_pd(_mm_movehl_ps(c, c)),
+                                     _mm_cvtps_pd(_mm_movehl_ps(d, d))));
+  return _mm_movelh_ps(_mm_cvtpd_ps(lo), _mm_cvtpd_ps(hi));
+}
+
+// 32-bit integer lanes for the packing, random and noise kernels, shift
+// counts need not be constant, _gm_i4_shr is logical and _gm_i4_sar
+// arithmetic
+typedef __m128i _gm_i4;
+#define _gm_i4_load(P) _mm_loadu_si128((const __m128i *) (P))
+#define _gm_i4_store(P, V) _mm_storeu_si128((__m128i *) (P), V)
+#define _gm_i4_set1(X) _mm_set1_epi32((int) (X))
+#define _gm_i4_and(L, R) _mm_and_si128(L, R)
+#define _gm_i4_or(L, R) _mm_or_si128(L, R)
+#define _gm_i4_shl(V, N) _mm_sll_epi32(V, _mm_cvtsi32_si128((int) (N)))
+#define _gm_i4_shr(V, N) _mm_srl_epi32(V, _mm_cvtsi32_si128((int) (N)))
+#define _gm_i4_sar(V, N) _mm_sra_epi32(V, _mm_cvtsi32_si128((int) (N)))
+#define _gm_i4_from_f4(V) _mm_cvttps_epi32(V)
+#define _gm_f4_from_i4(V) _mm_cvtepi32_ps(V)
+#define _gm_f4_abs(V) _mm_andnot_ps(_mm_set1_ps(-0.0f), V)
+#define _gm_i4_xor(L, R) _mm_xor_si128(L, R)
+#define _gm_i4_add(L, R) _mm_add_epi32(L, R)
+// integer compares give float masks for _gm_f4_select, _gm_i4_lt is signed
+#define _gm_i4_eq(L, R) _mm_castsi128_ps(_mm_cmpeq_epi32(L, R))
+#define _gm_i4_lt(L, R) _mm_castsi128_ps(_mm_cmplt_epi32(L, R))
+// flips the float lanes whose word in m has its top bit set
+#define _gm_f4_signxor(V, M) _mm_xor_ps(V, _mm_castsi128_ps(M))
+
+// the unsigned 64-bit products of the lanes and m, low words returned and
+// high words in *hi
+GM_CDECL _gm_i4 _gm_i4_mulx(const _gm_i4 v, const uint32_t m, _gm_i4 *hi)
+{
+  __m128i s = _mm_set1_epi32((int) m);
+  __m128i e = _mm_mul_epu32(v, s);
+  __m128i o = _mm_mul_epu32(_mm_srli_epi64(v, 32), s);
+  *hi       = _mm_unpacklo_epi32(_mm_shuffle_epi32(e, _MM_SHUFFLE(0, 0, 3, 1)),
+                                 _mm_shuffle_epi32(o, _MM_SHUFFLE(0, 0, 3, 1)));
+  return _mm_unpacklo_epi32(_mm_shuffle_epi32(e, _MM_SHUFFLE(0, 0, 2, 0)),
+                            _mm_shuffle_epi32(o, _MM_SHUFFLE(0, 0, 2, 0)));
+}
+
+#if defined(__SSE4_1__)
+#define _gm_i4_mullo(V, M) _mm_mullo_epi32(V, _mm_set1_epi32((int) (M)))
+#else
+GM_CDECL _gm_i4 _gm_i4_mullo(const _gm_i4 v, const uint32_t m)
+{
+  _gm_i4 hi;
+  return _gm_i4_mulx(v, m, &hi);
+}
+#endif
+#else
+typedef float32x4_t _gm_f4;
+#define _gm_f4_load(P) vld1q_f32(P)
+#define _gm_f4_store(P, V) vst1q_f32(P, V)
+#define _gm_f4_set1(X) vdupq_n_f32(X)
+#define _gm_f4_add(L, R) vaddq_f32(L, R)
+#define _gm_f4_sub(L, R) vsubq_f32(L, R)
+#define _gm_f4_mul(L, R) vmulq_f32(L, R)
+#define _gm_f4_div(L, R) vdivq_f32(L, R)
+#define _gm_f4_madd(L, R, A) vfmaq_f32(A, L, R)
+#define _gm_f4_splat(V, I) vdupq_laneq_f32(V, I)
+// lane 3 holds x rather than w, callers only keep the first three lanes
+#define _gm_f4_yzxw(V) vcopyq_laneq_f32(vextq_f32(V, V, 1), 2, V, 0)
+#define _gm_f4_yxwz(V) vrev64q_f32(V)
+#define _gm_f4_zwxy(V) vextq_f32(V, V, 2)
+#define _gm_f4_wzyx(V) vrev64q_f32(vextq_f32(V, V, 2))
+#define _gm_f4_hsum(V) vaddvq_f32(V)
+#define _gm_f4_sqrt(V) vsqrtq_f32(V)
+#define _gm_f4_rsqrt(V)                                                        \
+  _gm_f4_rsqrt_step(V, _gm_f4_rsqrt_step(V, vrsqrteq_f32(V)))
+#define _gm_f4_rsqrt_step(V, Y) vmulq_f32(Y, vrsqrtsq_f32(vmulq_f32(V, Y), Y))
+#define _gm_f4_zero_to_one(V)                                                  \
+  vaddq_f32(V, vreinterpretq_f32_u32(                                          \
+                 vandq_u32(vceqq_f32(V, vdupq_n_f32(0)),                       \
+                           vreinterpretq_u32_f32(vdupq_n_f32(1)))))
+#define _gm_f4_load3(P, X, Y, Z)                                               \
+  do                                                                           \
+  {                                                                            \
+    float32x4x3_t _v = vld3q_f32(P);                                           \
+    X                = _v.val[0];                                              \
+    Y                = _v.val[1];                                              \
+    Z                = _v.val[2];                                              \
+  } while (0)
+#define _gm_f4_store3(P, X, Y, Z)                                              \
+  do                                                                           \
+  {                                                                            \
+    float32x4x3_t _v = {{X, Y, Z}};                                            \
+    vst3q_f32(P, _v);                                                          \
+  } while (0)
+#define _gm_f4_transpose(R0, R1, R2, R3)                                       \
+  do                                                                           \
+  {                                                                            \
+    float32x4x2_t _t01 = vtrnq_f32(R0, R1);                                    \
+    float32x4x2_t _t23 = vtrnq_f32(R2, R3);                                    \
+    R0 = vcombine_f32(vget_low_f32(_t01.val[0]), vget_low_f32(_t23.val[0]));   \
+    R1 = vcombine_f32(vget_low_f32(_t01.val[1]), vget_low_f32(_t23.val[1]));   \
+    R2 = vcombine_f32(vget_high_f32(_t01.val[0]), vget_high_f32(_t23.val[0])); \
+    R3 = vcombine_f32(vget_high_f32(_t01.val[1]), vget_high_f32(_t23.val[1])); \
+  } while (0)
+
+GM_CDECL _gm_f4 _gm_f4_setr(const float x, const float y, const float z,
+                            const float w)
+{
+  const float v[4] = {x, y, z, w};
+  return vld1q_f32(v);
+}
+
+#define _gm_f4_fmin(L, R) vminnmq_f32(L, R)
+#define _gm_f4_fmax(L, R) vmaxnmq_f32(L, R)
+
+// compare masks stay in float registers, as on SSE
+#define _gm_f4_u4(V) vreinterpretq_u32_f32(V)
+#define _gm_f4_eq(L, R) vreinterpretq_f32_u32(vceqq_f32(L, R))
+#define _gm_f4_neq(L, R) vreinterpretq_f32_u32(vmvnq_u32(vceqq_f32(L, R)))
+#define _gm_f4_lt(L, R) vreinterpretq_f32_u32(vcltq_f32(L, R))
+#define _gm_f4_le(L, R) vreinterpretq_f32_u32(vcleq_f32(L, R))
+#define _gm_f4_and(L, R)                                                       \
+  vreinterpretq_f32_u32(vandq_u32(_gm_f4_u4(L), _gm_f4_u4(R)))
+#define _gm_f4_or(L, R)                                                        \
+  vreinterpretq_f32_u32(vorrq_u32(_gm_f4_u4(L), _gm_f4_u4(R)))
+#define _gm_f4_select(M, A, B) vbslq_f32(_gm_f4_u4(M), A, B)
+
+GM_CDECL int _gm_f4_mask(const _gm_f4 m)
+{
+  const uint32_t bits[4] = {1, 2, 4, 8};
+  return (int) vaddvq_u32(vandq_u32(_gm_f4_u4(m), vld1q_u32(bits)));
+}
+
+GM_CDECL _gm_f4 _gm_f4_dop(const _gm_f4 a, const _gm_f4 b, const _gm_f4 c,
+                           const _gm_f4 d)
+{
+  float64x2_t lo =
+    vsubq_f64(vmulq_f64(vcvt_f64_f32(vget_low_f32(a)),
+                        vcvt_f64_f32(vget_low_f32(b))),
+              vmulq_f64(vcvt_f64_f32(vget_low_f32(c)),
+                        vcvt_f64_f32(vget_low_f32(d))));
+  float64x2_t hi = vsubq_f64(
+    vmulq_f64(vcvt_high_f64_f32(a), vcvt_high_f64_f32(b)),
+    vmulq_f64(vcvt_high_f64_f32(c), vcvt_high_f64_f32(d)));
+  return vcvt_high_f32_f64(vcvt_f32_f64(lo), hi);
+}
+
+typedef int32x4_t _gm_i4;
+#define _gm_i4_load(P) vld1q_s32((const int32_t *) (P))
+#define _gm_i4_store(P, V) vst1q_s32((int32_t *) (P), V)
+#define _gm_i4_set1(X) vdupq_n_s32((int32_t) (X))
+#define _gm_i4_and(L, R) vandq_s32(L, R)
+#define _gm_i4_or(L, R) vorrq_s32(L, R)
+#define _gm_i4_shl(V, N) vshlq_s32(V, vdupq_n_s32((int32_t) (N)))
+#define _gm_i4_shr(V, N)                                                       \
+  vreinterpretq_s32_u32(                                                       \
+    vshlq_u32(vreinterpretq_u32_s32(V), vdupq_n_s32(-(int32_t) (N))))
+#define _gm_i4_sar(V, N) vshlq_s32(V, vdupq_n_s32(-(int32_t) (N)))
+#define _gm_i4_from_f4(V) vcvtq_s32_f32(V)
+#define _gm_f4_from_i4(V) vcvtq_f32_s32(V)
+#define _gm_f4_abs(V) vabsq_f32(V)
+#define _gm_i4_xor(L, R) veorq_s32(L, R)
+#define _gm_i4_add(L, R) vaddq_s32(L, R)
+#define _gm_i4_mullo(V, M) vmulq_n_s32(V, (int32_t) (M))
+#define _gm_i4_eq(L, R) vreinterpretq_f32_u32(vceqq_s32(L, R))
+#define _gm_i4_lt(L, R) vreinterpretq_f32_u32(vcltq_s32(L, R))
+#define _gm_f4_signxor(V, M)                                                   \
+  vreinterpretq_f32_s32(veorq_s32(vreinterpretq_s32_f32(V), M))
+
+GM_CDECL _gm_i4 _gm_i4_mulx(const _gm_i4 v, const uint32_t m, _gm_i4 *hi)
+{
+  uint32x4_t u  = vreinterpretq_u32_s32(v);
+  uint64x2_t lo = vmull_n_u32(vget_low_u32(u), m);
+  uint64x2_t up = vmull_high_n_u32(u, m);
+  *hi = vreinterpretq_s32_u32(
+    vcombine_u32(vshrn_n_u64(lo, 32), vshrn_n_u64(up, 32)));
+  return vreinterpretq_s32_u32(vcombine_u32(vmovn_u64(lo), vmovn_u64(up)));
+}
+#endif
+
+// bit i set where lane i of l is at most lane i of r
+#define _gm_f4_le_mask(L, R) _gm_f4_mask(_gm_f4_le(L, R))
+
+// cross product of the first three lanes, lane 3 is unspecified
+GM_CDECL _gm_f4 _gm_f4_cross3(const _gm_f4 l, const _gm_f4 r)
+{
+  _gm_f4 c = _gm_f4_sub(_gm_f4_mul(l, _gm_f4_yzxw(r)),
+                        _gm_f4_mul(_gm_f4_yzxw(l), r));
+  return _gm_f4_yzxw(c);
+}
+
+GM_CDECL vec4f v4f_add(const vec4f l, const vec4f r)
+{
+  vec4f v;
+  _gm_f4_store(v.a, _gm_f4_add(_gm_f4_load(l.a), _gm_f4_load(r.a)));
+  return v;
+}
+
+GM_CDECL vec4f v4f_sub(const vec4f l, const vec4f r)
+{
+  vec4f v;
+  _gm_f4_store(v.a, _gm_f4_sub(_gm_f4_load(l.a), _gm_f4_load(r.a)));
+  return v;
+}
+
+GM_CDECL vec4f v4f_mul(const vec4f l, const vec4f r)
+{
+  vec4f v;
+  _gm_f4_store(v.a, _gm_f4_mul(_gm_f4_load(l.a), _gm_f4_load(r.a)));
+  return v;
+}
+
+GM_CDECL vec4f v4f_div(const vec4f l, const vec4f r)
+{
+  vec4f v;
+  _gm_f4_store(v.a, _gm_f4_div(_gm_f4_load(l.a), _gm_f4_load(r.a)));
+  return v;
+}
+
+GM_CDECL vec4f v4f_smul(const vec4f l, const float r)
+{
+  vec4f v;
+  _gm_f4_store(v.a, _gm_f4_mul(_gm_f4_load(l.a), _gm_f4_set1(r)));
+  return v;
+}
+
+GM_CDECL float v4f_dot(const vec4f l, const vec4f r)
+{
+  return _gm_f4_hsum(_gm_f4_mul(_gm_f4_load(l.a), _gm_f4_load(r.a)));
+}
+
+GM_CDECL float v4f_sqlen(const vec4f m)
+{
+  _gm_f4 v = _gm_f4_load(m.a);
+  return _gm_f4_hsum(_gm_f4_mul(v, v));
+}
+
+GM_CDECL float v4f_len(const vec4f m)
+{
+  return _gm_float_lensqrt(v4f_sqlen(m));
+}
+
+GM_CDECL vec4f v4f_normalize(const vec4f m)
+{
+  _gm_f4 v = _gm_f4_load(m.a);
+  float l  = _gm_float_lensqrt(_gm_f4_hsum(_gm_f4_mul(v, v)));
+  if (l == 0)
+  {
+    return m;
+  }
+  vec4f r;
+  _gm_f4_store(r.a, _gm_f4_div(v, _gm_f4_set1(l)));
+  return r;
+}
+
+GM_CDECL vec4f v4f_cross(const vec4f l, const vec4f r)
+{
+  vec4f v;
+  _gm_f4_store(v.a, _gm_f4_cross3(_gm_f4_load(l.a), _gm_f4_load(r.a)));
+  v.a[3] = 0;
+  return v;
+}
+
+// column j of the product is the columns of l weighted by column j of r
+GM_CDECL mat4f m4f_mul(const mat4f l, const mat4f r)
+{
+  mat4f v;
+#if defined(GM_SIMD_AVX)
+  __m128 l0  = _mm_loadu_ps(l.a + 0);
+  __m128 l1  = _mm_loadu_ps(l.a + 4);
+  __m128 l2  = _mm_loadu_ps(l.a + 8);
+  __m128 l3  = _mm_loadu_ps(l.a + 12);
+  __m256 ll0 = _mm256_insertf128_ps(_mm256_castps128_ps256(l0), l0, 1);
+  __m256 ll1 = _mm256_insertf128_ps(_mm256_castps128_ps256(l1), l1, 1);
+  __m256 ll2 = _mm256_insertf128_ps(_mm256_castps128_ps256(l2), l2, 1);
+  __m256 ll3 = _mm256_insertf128_ps(_mm256_castps128_ps256(l3), l3, 1);
+  for (size_t j = 0; j < 4; j += 2)
+  {
+    __m256 rr = _mm256_loadu_ps(r.a + j * 4);
+    __m256 c  = _mm256_mul_ps(ll0, _mm256_shuffle_ps(rr, rr, 0x00));
+    c = _mm256_add_ps(c, _mm256_mul_ps(ll1, _mm256_shuffle_ps(rr, rr, 0x55)));
+    c = _mm256_add_ps(c, _mm256_mul_ps(ll2, _mm256_shuffle_ps(rr, rr, 0xaa)));
+    c = _mm256_add_ps(c, _mm256_mul_ps(ll3, _mm256_shuffle_ps(rr, rr, 0xff)));
+    _mm256_storeu_ps(v.a + j * 4, c);
+  }
+#else
+  _gm_f4 l0 = _gm_f4_load(l.a + 0);
+  _gm_f4 l1 = _gm_f4_load(l.a + 4);
+  _gm_f4 l2 = _gm_f4_load(l.a + 8);
+  _gm_f4 l3 = _gm_f4_load(l.a + 12);
+  for (size_t j = 0; j < 4; ++j)
+  {
+    _gm_f4 c = _gm_f4_mul(l0, _gm_f4_set1(r.a[j * 4 + 0]));
+    c        = _gm_f4_madd(l1, _gm_f4_set1(r.a[j * 4 + 1]), c);
+    c        = _gm_f4_madd(l2, _gm_f4_set1(r.a[j * 4 + 2]), c);
+    c        = _gm_f4_madd(l3, _gm_f4_set1(r.a[j * 4 + 3]), c);
+    _gm_f4_store(v.a + j * 4, c);
+  }
+#endif
+  return v;
+}
+
+GM_CDECL vec4f m4f_mulv(const mat4f m, const vec4f r)
+{
+  _gm_f4 c0 = _gm_f4_load(m.a + 0);
+  _gm_f4 c1 = _gm_f4_load(m.a + 4);
+  _gm_f4 c2 = _gm_f4_load(m.a + 8);
+  _gm_f4 c3 = _gm_f4_load(m.a + 12);
+  _gm_f4_transpose(c0, c1, c2, c3);
+  _gm_f4 rv = _gm_f4_load(r.a);
+  _gm_f4 s  = _gm_f4_mul(c0, _gm_f4_splat(rv, 0));
+  s         = _gm_f4_madd(c1, _gm_f4_splat(rv, 1), s);
+  s         = _gm_f4_madd(c2, _gm_f4_splat(rv, 2), s);
+  s         = _gm_f4_madd(c3, _gm_f4_splat(rv, 3), s);
+  vec4f v;
+  _gm_f4_store(v.a, s);
+  return v;
+}
+
+GM_CDECL mat4f m4f_transpose(const mat4f m)
+{
+  _gm_f4 r0 = _gm_f4_load(m.a + 0);
+  _gm_f4 r1 = _gm_f4_load(m.a + 4);
+  _gm_f4 r2 = _gm_f4_load(m.a + 8);
+  _gm_f4 r3 = _gm_f4_load(m.a + 12);
+  _gm_f4_transpose(r0, r1, r2, r3);
+  mat4f v;
+  _gm_f4_store(v.a + 0, r0);
+  _gm_f4_store(v.a + 4, r1);
+  _gm_f4_store(v.a + 8, r2);
+  _gm_f4_store(v.a + 12, r3);
+  return v;
+}
+
+#if defined(GM_SIMD_SSE)
+// block inverse over the four 2x2 quarters a b / c d, each held as one
+// register, using adjugates so only the final scale needs a division
+#define _GM_SHUF(V, W, X, Y, Z, T) _mm_shuffle_ps(V, W, _MM_SHUFFLE(T, Z, Y, X))
+
+// a * b
+GM_CDECL __m128 _gm_m2_mul(const __m128 a, const __m128 b)
+{
+  return _mm_add_ps(_mm_mul_ps(a, _GM_SHUF(b, b, 0, 3, 0, 3)),
+                    _mm_mul_ps(_GM_SHUF(a, a, 1, 0, 3, 2),
+                               _GM_SHUF(b, b, 2, 1, 2, 1)));
+}
+
+// adj(a) * b
+GM_CDECL __m128 _gm_m2_adjmul(const __m128 a, const __m128 b)
+{
+  return _mm_sub_ps(_mm_mul_ps(_GM_SHUF(a, a, 3, 3, 0, 0), b),
+                    _mm_mul_ps(_GM_SHUF(a, a, 1, 1, 2, 2),
+                               _GM_SHUF(b, b, 2, 3, 0, 1)));
+}
+
+// a * adj(b)
+GM_CDECL __m128 _gm_m2_muladj(const __m128 a, const __m128 b)
+{
+  return _mm_sub_ps(_mm_mul_ps(a, _GM_SHUF(b, b, 3, 0, 3, 0)),
+                    _mm_mul_ps(_GM_SHUF(a, a, 1, 0, 3, 2),
+                               _GM_SHUF(b, b, 2, 1, 2, 1)));
+}
+
+GM_CDECL bool m4f_tryinv(const mat4f m, mat4f *r)
+{
+  __m128 r0 = _mm_loadu_ps(m.a + 0);
+  __m128 r1 = _mm_loadu_ps(m.a + 4);
+  __m128 r2 = _mm_loadu_ps(m.a + 8);
+  __m128 r3 = _mm_loadu_ps(m.a + 12);
+  __m128 a  = _mm_movelh_ps(r0, r1);
+  __m128 b  = _mm_movehl_ps(r1, r0);
+  __m128 c  = _mm_movelh_ps(r2, r3);
+  __m128 d  = _mm_movehl_ps(r3, r2);
+  // determinants of the four quarters as |a| |b| |c| |d|
+  __m128 ds = _mm_sub_ps(
+    _mm_mul_ps(_GM_SHUF(r0, r2, 0, 2, 0, 2), _GM_SHUF(r1, r3, 1, 3, 1, 3)),
+    _mm_mul_ps(_GM_SHUF(r0, r2, 1, 3, 1, 3), _GM_SHUF(r1, r3, 0, 2, 0, 2)));
+  __m128 da  = _GM_SHUF(ds, ds, 0, 0, 0, 0);
+  __m128 db  = _GM_SHUF(ds, ds, 1, 1, 1, 1);
+  __m128 dc  = _GM_SHUF(ds, ds, 2, 2, 2, 2);
+  __m128 dd  = _GM_SHUF(ds, ds, 3, 3, 3, 3);
+  __m128 dcx = _gm_m2_adjmul(d, c);
+  __m128 abx = _gm_m2_adjmul(a, b);
+  __m128 x   = _mm_sub_ps(_mm_mul_ps(dd, a), _gm_m2_mul(b, dcx));
+  __m128 w   = _mm_sub_ps(_mm_mul_ps(da, d), _gm_m2_mul(c, abx));
+  __m128 y   = _mm_sub_ps(_mm_mul_ps(db, c), _gm_m2_muladj(d, abx));
+  __m128 z   = _mm_sub_ps(_mm_mul_ps(dc, b), _gm_m2_muladj(a, dcx));
+  // |m| = |a||d| + |b||c| - tr(adj(a) b adj(d) c)
+  float det = _mm_cvtss_f32(_mm_add_ss(_mm_mul_ss(da, dd), _mm_mul_ss(db, dc)));
+  det -= _gm_f4_hsum(_mm_mul_ps(abx, _GM_SHUF(dcx, dcx, 0, 2, 1, 3)));
+  // the same scale-relative bound as the scalar inverse
+  __m128 sign = _mm_set1_ps(-0.0f);
+  __m128 mx   = _mm_max_ps(
+    _mm_max_ps(_mm_andnot_ps(sign, r0), _mm_andnot_ps(sign, r1)),
+    _mm_max_ps(_mm_andnot_ps(sign, r2), _mm_andnot_ps(sign, r3)));
+  mx          = _mm_max_ps(mx, _GM_SHUF(mx, mx, 2, 3, 0, 1));
+  mx          = _mm_max_ps(mx, _GM_SHUF(mx, mx, 1, 0, 3, 2));
+  float scale = _mm_cvtss_f32(mx);
+  float tiny  = 4 * FLT_EPSILON * scale * scale * scale * scale;
+  if (!((det > 0 ? det : -det) > tiny))
+  {
+    return false;
+  }
+  __m128 rd = _mm_div_ps(_mm_setr_ps(1, -1, -1, 1), _mm_set1_ps(det));
+  x         = _mm_mul_ps(x, rd);
+  y         = _mm_mul_ps(y, rd);
+  z         = _mm_mul_ps(z, rd);
+  w         = _mm_mul_ps(w, rd);
+  _mm_storeu_ps(r->a + 0, _GM_SHUF(x, y, 3, 1, 3, 1));
+  _mm_storeu_ps(r->a + 4, _GM_SHUF(x, y, 2, 0, 2, 0));
+  _mm_storeu_ps(r->a + 8, _GM_SHUF(z, w, 3, 1, 3, 1));
+  _mm_storeu_ps(r->a + 12, _GM_SHUF(z, w, 2, 0, 2, 0));
+  return true;
+}
+
+#undef _GM_SHUF
+
+GM_CDECL mat4f m4f_inv(const mat4f m)
+{
+  mat4f r;
+  return m4f_tryinv(m, &r) ? r : m;
+}
+#endif
+
+// the hamilton product as four broadcasts of l against sign-flipped
+// permutations of r
+GM_CDECL quatf qf_mul(const quatf l, const quatf r)
+{
+  _gm_f4 lv = _gm_f4_load(l.a);
+  _gm_f4 rv = _gm_f4_load(r.a);
+  _gm_f4 q  = _gm_f4_mul(_gm_f4_splat(lv, 0), rv);
+  q         = _gm_f4_madd(_gm_f4_mul(_gm_f4_splat(lv, 1), _gm_f4_yxwz(rv)),
+                          _gm_f4_setr(-1, 1, -1, 1), q);
+  q         = _gm_f4_madd(_gm_f4_mul(_gm_f4_splat(lv, 2), _gm_f4_zwxy(rv)),
+                          _gm_f4_setr(-1, 1, 1, -1), q);
+  q         = _gm_f4_madd(_gm_f4_mul(_gm_f4_splat(lv, 3), _gm_f4_wzyx(rv)),
+                          _gm_f4_setr(-1, -1, 1, 1), q);
+  quatf v;
+  _gm_f4_store(v.a, q);
+  return v;
+}
+
+GM_CDECL float qf_dot(const quatf l, const quatf r)
+{
+  return _gm_f4_hsum(_gm_f4_mul(_gm_f4_load(l.a), _gm_f4_load(r.a)));
+}
+
+GM_CDECL quatf qf_normalize(const quatf m)
+{
+  _gm_f4 v = _gm_f4_load(m.a);
+  float l  = _gm_float_lensqrt(_gm_f4_hsum(_gm_f4_mul(v, v)));
+  if (l == 0)
+  {
+    return m;
+  }
+  quatf r;
+  _gm_f4_store(r.a, _gm_f4_div(v, _gm_f4_set1(l)));
+  return r;
+}
+
+GM_CDECL vec4f qf_rotv(const quatf q, const vec4f v)
+{
+  _gm_f4 u  = _gm_f4_setr(q.a[1], q.a[2], q.a[3], 0);
+  _gm_f4 vv = _gm_f4_setr(v.a[0], v.a[1], v.a[2], 0);
+  _gm_f4 t  = _gm_f4_cross3(u, vv);
+  t         = _gm_f4_add(t, t);
+  _gm_f4 r  = _gm_f4_madd(_gm_f4_set1(q.a[0]), t, vv);
+  r         = _gm_f4_add(r, _gm_f4_cross3(u, t));
+  vec4f o;
+  _gm_f4_store(o.a, r);
+  o.a[3] = 0;
+  return o;
+}
+
+// float_x4 and float_x8 as one and two _gm_f4 per operator, or float_x8
+// as one _gm_f8 with avx; min and max keep the scalar lanes' l < r ? l : r
+// rather than fminf's nan handling
+
+#if defined(GM_SIMD_AVX)
+typedef __m256 _gm_f8;
+#define _gm_f8_load(P) _mm256_loadu_ps(P)
+#define _gm_f8_store(P, V) _mm256_storeu_ps(P, V)
+#define _gm_f8_set1(X) _mm256_set1_ps(X)
+#define _gm_f8_add(L, R) _mm256_add_ps(L, R)
+#define _gm_f8_sub(L, R) _mm256_sub_ps(L, R)
+#define _gm_f8_mul(L, R) _mm256_mul_ps(L, R)
+#define _gm_f8_div(L, R) _mm256_div_ps(L, R)
+#define _gm_f8_sqrt(V) _mm256_sqrt_ps(V)
+#if defined(__FMA__)
+#define _gm_f8_madd(L, R, A) _mm256_fmadd_ps(L, R, A)
+#else
+#define _gm_f8_madd(L, R, A) _mm256_add_ps(_mm256_mul_ps(L, R), A)
+#endif
+#define _gm_f8_lt(L, R) _mm256_cmp_ps(L, R, _CMP_LT_OQ)
+#define _gm_f8_select(M, A, B) _mm256_blendv_ps(B, A, M)
+// a 4 x 4 transpose within each 128-bit half
+#define _gm_f8_transpose4(R0, R1, R2, R3)                                      \
+  do                                                                           \
+  {                                                                            \
+    __m256 _t0 = _mm256_unpacklo_ps(R0, R1);                                   \
+    __m256 _t1 = _mm256_unpacklo_ps(R2, R3);                                   \
+    __m256 _t2 = _mm256_unpackhi_ps(R0, R1);                                   \
+    __m256 _t3 = _mm256_unpackhi_ps(R2, R3);                                   \
+    R0         = _mm256_shuffle_ps(_t0, _t1, _MM_SHUFFLE(1, 0, 1, 0));         \
+    R1         = _mm256_shuffle_ps(_t0, _t1, _MM_SHUFFLE(3, 2, 3, 2));         \
+    R2         = _mm256_shuffle_ps(_t2, _t3, _MM_SHUFFLE(1, 0, 1, 0));         \
+    R3         = _mm256_shuffle_ps(_t2, _t3, _MM_SHUFFLE(3, 2, 3, 2));         \
+  } while (0)
+#endif
+
+// REG is the register type's prefix and RW its lane count
+#define GM_SIMD_LANES_BIN(TYPENAME, SHORTNAME, W, REG, RW, OPER, EXPR)         \
+  GM_CDECL TYPENAME SHORTNAME##_##OPER(const TYPENAME l, const TYPENAME r)     \
+  {                                                                            \
+    TYPENAME v;                                                                \
+    for (size_t i = 0; i < W; i += RW)                                         \
+    {                                                                          \
+      REG a = REG##_load(l.a + i), b = REG##_load(r.a + i);                    \
+      REG##_store(v.a + i, EXPR);                                              \
+    }                                                                          \
+    return v;                                                                  \
+  }
+
+#define GM_SIMD_LANES_T(TYPENAME, SHORTNAME, W, REG, RW)                       \
+  GM_CDECL TYPENAME SHORTNAME##_set1(const float s)                            \
+  {                                                                            \
+    TYPENAME v;                                                                \
+    for (size_t i = 0; i < W; i += RW)                                         \
+    {                                                                          \
+      REG##_store(v.a + i, REG##_set1(s));                                     \
+    }                                                                          \
+    return v;                                                                  \
+  }                                                                            \
+  GM_CDECL TYPENAME SHORTNAME##_sqrt(const TYPENAME m)                         \
+  {                                                                            \
+    TYPENAME v;                                                                \
+    for (size_t i = 0; i < W; i += RW)                                         \
+    {                                                                          \
+      REG##_store(v.a + i, REG##_sqrt(REG##_load(m.a + i)));                   \
+    }                                                                          \
+    return v;                                                                  \
+  }                                                                            \
+  GM_CDECL TYPENAME SHORTNAME##_madd(const TYPENAME l, const TYPENAME r,       \
+                                     const TYPENAME a)                         \
+  {                                                                            \
+    TYPENAME v;                                                                \
+    for (size_t i = 0; i < W; i += RW)                                         \
+    {                                                                          \
+      REG##_store(v.a + i, REG##_madd(REG##_load(l.a + i),                     \
+                                      REG##_load(r.a + i),                     \
+                                      REG##_load(a.a + i)));                   \
+    }                                                                          \
+    return v;                                                                  \
+  }                                                                            \
+  GM_CDECL TYPENAME SHORTNAME##_ltsel(const TYPENAME l, const TYPENAME r,      \
+                                      const TYPENAME x, const TYPENAME y)      \
+  {                                                                            \
+    TYPENAME v;                                                                \
+    for (size_t i = 0; i < W; i += RW)                                         \
+    {                                                                          \
+      REG m = REG##_lt(REG##_load(l.a + i), REG##_load(r.a + i));              \
+      REG##_store(v.a + i,                                                     \
+                  REG##_select(m, REG##_load(x.a + i), REG##_load(y.a + i)));  \
+    }                                                                          \
+    return v;                                                                  \
+  }                                                                            \
+  GM_SIMD_LANES_BIN(TYPENAME, SHORTNAME, W, REG, RW, add, REG##_add(a, b));    \
+  GM_SIMD_LANES_BIN(TYPENAME, SHORTNAME, W, REG, RW, sub, REG##_sub(a, b));    \
+  GM_SIMD_LANES_BIN(TYPENAME, SHORTNAME, W, REG, RW, mul, REG##_mul(a, b));    \
+  GM_SIMD_LANES_BIN(TYPENAME, SHORTNAME, W, REG, RW, div, REG##_div(a, b));    \
+  GM_SIMD_LANES_BIN(TYPENAME, SHORTNAME, W, REG, RW, min,                      \
+                    REG##_select(REG##_lt(a, b), a, b));                       \
+  GM_SIMD_LANES_BIN(TYPENAME, SHORTNAME, W, REG, RW, max,                      \
+                    REG##_select(REG##_lt(b, a), a, b));
+
+GM_SIMD_LANES_T(float_x4, f_x4, 4, _gm_f4, 4);
+#if defined(GM_SIMD_AVX)
+GM_SIMD_LANES_T(float_x8, f_x8, 8, _gm_f8, 8);
+#else
+GM_SIMD_LANES_T(float_x8, f_x8, 8, _gm_f4, 4);
+#endif
+
+#ifndef GM_FAST_MATH
+GM_CDECL float_x4 f_x4_lensqrt(const float_x4 m)
+{
+  return f_x4_sqrt(m);
+}
+
+GM_CDECL float_x8 f_x8_lensqrt(const float_x8 m)
+{
+  return f_x8_sqrt(m);
+}
+#endif
+
+#undef GM_SIMD_LANES_T
+#undef GM_SIMD_LANES_BIN
+#endif
+
+#if defined(GM_SIMD_AVX)
+// four double lanes for the vec4d, mat4d and quatd operators
+
+typedef __m256d _gm_d4;
+#define _gm_d4_load(P) _mm256_loadu_pd(P)
+#define _gm_d4_store(P, V) _mm256_storeu_pd(P, V)
+#define _gm_d4_set1(X) _mm256_set1_pd(X)
+#define _gm_d4_setr(X, Y, Z, W) _mm256_setr_pd(X, Y, Z, W)
+#define _gm_d4_add(L, R) _mm256_add_pd(L, R)
+#define _gm_d4_sub(L, R) _mm256_sub_pd(L, R)
+#define _gm_d4_mul(L, R) _mm256_mul_pd(L, R)
+#define _gm_d4_div(L, R) _mm256_div_pd(L, R)
+#if defined(__FMA__)
+#define _gm_d4_madd(L, R, A) _mm256_fmadd_pd(L, R, A)
+#else
+#define _gm_d4_madd(L, R, A) _mm256_add_pd(_mm256_mul_pd(L, R), A)
+#endif
+#define _gm_d4_yxwz(V) _mm256_permute_pd(V, 0x5)
+#define _gm_d4_zwxy(V) _mm256_permute2f128_pd(V, V, 0x01)
+#define _gm_d4_wzyx(V) _mm256_permute_pd(_gm_d4_zwxy(V), 0x5)
+#define _gm_d4_transpose(R0, R1, R2, R3)                                       \
+  do                                                                           \
+  {                                                                            \
+    __m256d _t0 = _mm256_unpacklo_pd(R0, R1);                                  \
+    __m256d _t1 = _mm256_unpackhi_pd(R0, R1);                                  \
+    __m256d _t2 = _mm256_unpacklo_pd(R2, R3);                                  \
+    __m256d _t3 = _mm256_unpackhi_pd(R2, R3);                                  \
+    R0          = _mm256_permute2f128_pd(_t0, _t2, 0x20);                      \
+    R1          = _mm256_permute2f128_pd(_t1, _t3, 0x20);                      \
+    R2          = _mm256_permute2f128_pd(_t0, _t2, 0x31);                      \
+    R3          = _mm256_permute2f128_pd(_t1, _t3, 0x31);                      \
+  } while (0)
+
+GM_CDECL double _gm_d4_hsum(const _gm_d4 v)
+{
+  __m128d s = _mm_add_pd(_mm256_castpd256_pd128(v),
+                         _mm256_extractf128_pd(v, 1));
+  return _mm_cvtsd_f64(_mm_add_sd(s, _mm_unpackhi_pd(s, s)));
+}
+
+GM_CDECL vec4d v4d_add(const vec4d l, const vec4d r)
+{
+  vec4d v;
+  _gm_d4_store(v.a, _gm_d4_add(_gm_d4_load(l.a), _gm_d4_load(r.a)));
+  return v;
+}
+
+GM_CDECL vec4d v4d_sub(const vec4d l, const vec4d r)
+{
+  vec4d v;
+  _gm_d4_store(v.a, _gm_d4_sub(_gm_d4_load(l.a), _gm_d4_load(r.a)));
+  return v;
+}
+
+GM_CDECL vec4d v4d_mul(const vec4d l, const vec4d r)
+{
+  vec4d v;
+  _gm_d4_store(v.a, _gm_d4_mul(_gm_d4_load(l.a), _gm_d4_load(r.a)));
+  return v;
+}
+
+GM_CDECL vec4d v4d_div(const vec4d l, const vec4d r)
+{
+  vec4d v;
+  _gm_d4_store(v.a, _gm_d4_div(_gm_d4_load(l.a), _gm_d4_load(r.a)));
+  return v;
+}
+
+GM_CDECL vec4d v4d_smul(const vec4d l, const double r)
+{
+  vec4d v;
+  _gm_d4_store(v.a, _gm_d4_mul(_gm_d4_load(l.a), _gm_d4_set1(r)));
+  return v;
+}
+
+GM_CDECL double v4d_dot(const vec4d l, const vec4d r)
+{
+  return _gm_d4_hsum(_gm_d4_mul(_gm_d4_load(l.a), _gm_d4_load(r.a)));
+}
+
+GM_CDECL double v4d_sqlen(const vec4d m)
+{
+  _gm_d4 v = _gm_d4_load(m.a);
+  return _gm_d4_hsum(_gm_d4_mul(v, v));
+}
+
+GM_CDECL double v4d_len(const vec4d m)
+{
+  return _gm_double_sqrt(v4d_sqlen(m));
+}
+
+GM_CDECL vec4d v4d_normalize(const vec4d m)
+{
+  _gm_d4 v = _gm_d4_load(m.a);
+  double l = _gm_double_sqrt(_gm_d4_hsum(_gm_d4_mul(v, v)));
+  if (l == 0)
+  {
+    return m;
+  }
+  vec4d r;
+  _gm_d4_store(r.a, _gm_d4_div(v, _gm_d4_set1(l)));
+  return r;
+}
+
+// as m4f_mul, one register per column of the result
+GM_CDECL mat4d m4d_mul(const mat4d l, const mat4d r)
+{
+  mat4d v;
+  _gm_d4 l0 = _gm_d4_load(l.a + 0);
+  _gm_d4 l1 = _gm_d4_load(l.a + 4);
+  _gm_d4 l2 = _gm_d4_load(l.a + 8);
+  _gm_d4 l3 = _gm_d4_load(l.a + 12);
+  for (size_t j = 0; j < 4; ++j)
+  {
+    _gm_d4 c = _gm_d4_mul(l0, _gm_d4_set1(r.a[j * 4 + 0]));
+    c        = _gm_d4_madd(l1, _gm_d4_set1(r.a[j * 4 + 1]), c);
+    c        = _gm_d4_madd(l2, _gm_d4_set1(r.a[j * 4 + 2]), c);
+    c        = _gm_d4_madd(l3, _gm_d4_set1(r.a[j * 4 + 3]), c);
+    _gm_d4_store(v.a + j * 4, c);
+  }
+  return v;
+}
+
+GM_CDECL vec4d m4d_mulv(const mat4d m, const vec4d r)
+{
+  _gm_d4 c0 = _gm_d4_load(m.a + 0);
+  _gm_d4 c1 = _gm_d4_load(m.a + 4);
+  _gm_d4 c2 = _gm_d4_load(m.a + 8);
+  _gm_d4 c3 = _gm_d4_load(m.a + 12);
+  _gm_d4_transpose(c0, c1, c2, c3);
+  _gm_d4 s = _gm_d4_mul(c0, _gm_d4_set1(r.a[0]));
+  s        = _gm_d4_madd(c1, _gm_d4_set1(r.a[1]), s);
+  s        = _gm_d4_madd(c2, _gm_d4_set1(r.a[2]), s);
+  s        = _gm_d4_madd(c3, _gm_d4_set1(r.a[3]), s);
+  vec4d v;
+  _gm_d4_store(v.a, s);
+  return v;
+}
+
+GM_CDECL mat4d m4d_transpose(const mat4d m)
+{
+  _gm_d4 r0 = _gm_d4_load(m.a + 0);
+  _gm_d4 r1 = _gm_d4_load(m.a + 4);
+  _gm_d4 r2 = _gm_d4_load(m.a + 8);
+  _gm_d4 r3 = _gm_d4_load(m.a + 12);
+  _gm_d4_transpose(r0, r1, r2, r3);
+  mat4d v;
+  _gm_d4_store(v.a + 0, r0);
+  _gm_d4_store(v.a + 4, r1);
+  _gm_d4_store(v.a + 8, r2);
+  _gm_d4_store(v.a + 12, r3);
+  return v;
+}
+
+GM_CDECL quatd qd_mul(const quatd l, const quatd r)
+{
+  _gm_d4 rv = _gm_d4_load(r.a);
+  _gm_d4 q  = _gm_d4_mul(_gm_d4_set1(l.a[0]), rv);
+  q         = _gm_d4_madd(_gm_d4_mul(_gm_d4_set1(l.a[1]), _gm_d4_yxwz(rv)),
+                          _gm_d4_setr(-1, 1, -1, 1), q);
+  q         = _gm_d4_madd(_gm_d4_mul(_gm_d4_set1(l.a[2]), _gm_d4_zwxy(rv)),
+                          _gm_d4_setr(-1, 1, 1, -1), q);
+  q         = _gm_d4_madd(_gm_d4_mul(_gm_d4_set1(l.a[3]), _gm_d4_wzyx(rv)),
+                          _gm_d4_setr(-1, -1, 1, 1), q);
+  quatd v;
+  _gm_d4_store(v.a, q);
+  return v;
+}
+
+GM_CDECL double qd_dot(const quatd l, const quatd r)
+{
+  return _gm_d4_hsum(_gm_d4_mul(_gm_d4_load(l.a), _gm_d4_load(r.a)));
+}
+
+GM_CDECL quatd qd_normalize(const quatd m)
+{
+  _gm_d4 v = _gm_d4_load(m.a);
+  double l = _gm_double_sqrt(_gm_d4_hsum(_gm_d4_mul(v, v)));
+  if (l == 0)
+  {
+    return m;
+  }
+  quatd r;
+  _gm_d4_store(r.a, _gm_d4_div(v, _gm_d4_set1(l)));
+  return r;
+}
+#endif
+
+// the vector, quaternion and pose lanes come after the SIMD section so they
+// pick up its float_x4 and float_x8 operators
+
+#define X(BASETYPE, TYPEPREFIX, N, W, ...)                                     \
+  GM_VECX_T(GM_VECX_TYPENAME(BASETYPE, TYPEPREFIX, N, W),                      \
+            GM_VECX_SHORTNAME(BASETYPE, TYPEPREFIX, N, W),                     \
+            GM_LANES_TYPENAME(BASETYPE, TYPEPREFIX, W),                        \
+            GM_LANES_SHORTNAME(BASETYPE, TYPEPREFIX, W),                       \
+            GM_VEC_TYPENAME(BASETYPE, TYPEPREFIX, N), BASETYPE, TYPEPREFIX, N, \
+            W, __VA_ARGS__);
+GM_VEC2X_T_X_LIST;
+GM_VEC3X_T_X_LIST;
+GM_VEC4X_T_X_LIST;
+#undef X
+
+#define X(BASETYPE, TYPEPREFIX, N, W, ...)                                     \
+  GM_VECX_CROSS(GM_VECX_TYPENAME(BASETYPE, TYPEPREFIX, N, W),                  \
+                GM_VECX_SHORTNAME(BASETYPE, TYPEPREFIX, N, W),                 \
+                GM_LANES_SHORTNAME(BASETYPE, TYPEPREFIX, W), cross);
+GM_VEC3X_T_X_LIST;
+#undef X
+
+#define X(BASETYPE, TYPEPREFIX, N, W, ...)                                     \
+  GM_VECX_T(GM_QUATX_TYPENAME(BASETYPE, TYPEPREFIX, W),                        \
+            GM_QUATX_SHORTNAME(BASETYPE, TYPEPREFIX, W),                       \
+            GM_LANES_TYPENAME(BASETYPE, TYPEPREFIX, W),                        \
+            GM_LANES_SHORTNAME(BASETYPE, TYPEPREFIX, W),                       \
+            GM_QUAT_TYPENAME(BASETYPE, TYPEPREFIX), BASETYPE, TYPEPREFIX, N,   \
+            W, __VA_ARGS__);                                                   \
+  GM_QUATX_NLERP(GM_QUATX_TYPENAME(BASETYPE, TYPEPREFIX, W),                   \
+                 GM_QUATX_SHORTNAME(BASETYPE, TYPEPREFIX, W),                  \
+                 GM_LANES_TYPENAME(BASETYPE, TYPEPREFIX, W),                   \
+                 GM_LANES_SHORTNAME(BASETYPE, TYPEPREFIX, W), BASETYPE,        \
+                 nlerp);                                                       \
+  GM_QUATX_SLERP(GM_QUATX_TYPENAME(BASETYPE, TYPEPREFIX, W),                   \
+                 GM_QUATX_SHORTNAME(BASETYPE, TYPEPREFIX, W),                  \
+                 GM_LANES_TYPENAME(BASETYPE, TYPEPREFIX, W),                   \
+                 GM_LANES_SHORTNAME(BASETYPE, TYPEPREFIX, W), BASETYPE,        \
+                 slerp);
+GM_QUATX_T_X_LIST;
+#undef X
+
+#define X(BASETYPE, TYPEPREFIX, W)                                             \
+  GM_POSEX_T(GM_POSEX_TYPENAME(BASETYPE, TYPEPREFIX, W),                       \
+             GM_POSEX_SHORTNAME(BASETYPE, TYPEPREFIX, W),                      \
+             GM_VECX_TYPENAME(BASETYPE, TYPEPREFIX, 3, W),                     \
+             GM_VECX_SHORTNAME(BASETYPE, TYPEPREFIX, 3, W),                    \
+             GM_QUATX_TYPENAME(BASETYPE, TYPEPREFIX, W),                       \
+             GM_QUATX_SHORTNAME(BASETYPE, TYPEPREFIX, W),                      \
+             GM_VEC_TYPENAME(BASETYPE, TYPEPREFIX, 3),                         \
+             GM_QUAT_TYPENAME(BASETYPE, TYPEPREFIX), BASETYPE, TYPEPREFIX, W);
+GM_POSEX_T_X_LIST;
+#undef X
+
+// conversions between the float and double types, and camera-relative
+// helpers that subtract a double origin before dropping to float so that
+// large-world positions keep their precision near the camera
+
+#define GM_CVT_OP(TOTYPE, TOSHORT, TOBASE, FROMTYPE, FROMSHORT, N)             \
+  GM_CDECL TOTYPE TOSHORT##_from_##FROMSHORT(const FROMTYPE m)                 \
+  {                                                                            \
+    TOTYPE v;                                                                  \
+    for (size_t k = 0; k < N; ++k)                                             \
+    {                                                                          \
+      v.a[k] = (TOBASE) m.a[k];                                                \
+    }                                                                          \
+    return v;                                                                  \
+  }
+
+GM_CVT_OP(vec2f, v2f, float, vec2d, v2d, 2);
+GM_CVT_OP(vec3f, v3f, float, vec3d, v3d, 3);
+GM_CVT_OP(vec4f, v4f, float, vec4d, v4d, 4);
+GM_CVT_OP(mat2f, m2f, float, mat2d, m2d, 4);
+GM_CVT_OP(mat3f, m3f, float, mat3d, m3d, 9);
+GM_CVT_OP(mat4f, m4f, float, mat4d, m4d, 16);
+GM_CVT_OP(quatf, qf, float, quatd, qd, 4);
+GM_CVT_OP(vec2d, v2d, double, vec2f, v2f, 2);
+GM_CVT_OP(vec3d, v3d, double, vec3f, v3f, 3);
+GM_CVT_OP(vec4d, v4d, double, vec4f, v4f, 4);
+GM_CVT_OP(mat2d, m2d, double, mat2f, m2f, 4);
+GM_CVT_OP(mat3d, m3d, double, mat3f, m3f, 9);
+GM_CVT_OP(mat4d, m4d, double, mat4f, m4f, 16);
+GM_CVT_OP(quatd, qd, double, quatf, qf, 4);
+
+#undef GM_CVT_OP
+
+GM_CDECL vec3f v3d_relative(const vec3d p, const vec3d origin)
+{
+  return v3f((float) (p.x - origin.x), (float) (p.y - origin.y),
+             (float) (p.z - origin.z));
+}
+
+// m with its translation moved by -origin, for a model matrix drawn with a
+// view matrix built at the origin
+GM_CDECL mat4f m4d_relative(const mat4d m, const vec3d origin)
+{
+  mat4d r = m;
+  for (size_t k = 0; k < 3; ++k)
+  {
+    r.a[k * 4 + 3] -= origin.a[k] * m.a[15];
+  }
+  return m4f_from_m4d(r);
+}
+
+GM_CDECL void v3d_relative_many(const vec3d *in, const vec3d origin,
+                                vec3f *out, size_t n)
+{
+  for (size_t i = 0; i < n; ++i)
+  {
+    out[i] = v3d_relative(in[i], origin);
+  }
+}
+
+// batched kernels over packed vec3f arrays
+// out may be the same array as in, but must not partially overlap it
+// with GM_SIMD these run four elements per step in component registers
+
+// transforms points as (x, y, z, 1), keeping the first three rows
+GM_CDECL void m4f_transform_points(const mat4f m, const vec3f *in,
+                                   vec3f *out, size_t n)
+{
+  size_t i = 0;
+#if defined(GM_SIMD_SSE) || defined(GM_SIMD_NEON)
+  _gm_f4 r[12];
+  for (size_t k = 0; k < 12; ++k)
+  {
+    r[k] = _gm_f4_set1(m.a[k]);
+  }
+  for (; i + 4 <= n; i += 4)
+  {
+    _gm_f4 x, y, z;
+    _gm_f4_load3(in[i].a, x, y, z);
+    _gm_f4 ox = _gm_f4_madd(r[0], x, _gm_f4_madd(r[1], y, r[3]));
+    _gm_f4 oy = _gm_f4_madd(r[4], x, _gm_f4_madd(r[5], y, r[7]));
+    _gm_f4 oz = _gm_f4_madd(r[8], x, _gm_f4_madd(r[9], y, r[11]));
+    ox        = _gm_f4_madd(r[2], z, ox);
+    oy        = _gm_f4_madd(r[6], z, oy);
+    oz        = _gm_f4_madd(r[10], z, oz);
+    _gm_f4_store3(out[i].a, ox, oy, oz);
+  }
+#endif
+  for (; i < n; ++i)
+  {
+    vec3f p = in[i];
+    for (size_t k = 0; k < 3; ++k)
+    {
+      out[i].a[k] = m.a[k * 4 + 0] * p.a[0] + m.a[k * 4 + 1] * p.a[1] +
+                    m.a[k * 4 + 2] * p.a[2] + m.a[k * 4 + 3];
+    }
+  }
+}
+
+// rotates every vector by the same quaternion, matching qf_rotv
+GM_CDECL void qf_rotate_many(const quatf q, const vec3f *in, vec3f *out,
+                             size_t n)
+{
+  size_t i = 0;
+#if defined(GM_SIMD_SSE) || defined(GM_SIMD_NEON)
+  _gm_f4 w  = _gm_f4_set1(q.a[0]);
+  _gm_f4 ux = _gm_f4_set1(q.a[1]);
+  _gm_f4 uy = _gm_f4_set1(q.a[2]);
+  _gm_f4 uz = _gm_f4_set1(q.a[3]);
+  for (; i + 4 <= n; i += 4)
+  {
+    _gm_f4 x, y, z;
+    _gm_f4_load3(in[i].a, x, y, z);
+    _gm_f4 tx = _gm_f4_sub(_gm_f4_mul(uy, z), _gm_f4_mul(uz, y));
+    _gm_f4 ty = _gm_f4_sub(_gm_f4_mul(uz, x), _gm_f4_mul(ux, z));
+    _gm_f4 tz = _gm_f4_sub(_gm_f4_mul(ux, y), _gm_f4_mul(uy, x));
+    tx        = _gm_f4_add(tx, tx);
+    ty        = _gm_f4_add(ty, ty);
+    tz        = _gm_f4_add(tz, tz);
+    x = _gm_f4_add(_gm_f4_madd(w, tx, x),
+                   _gm_f4_sub(_gm_f4_mul(uy, tz), _gm_f4_mul(uz, ty)));
+    y = _gm_f4_add(_gm_f4_madd(w, ty, y),
+                   _gm_f4_sub(_gm_f4_mul(uz, tx), _gm_f4_mul(ux, tz)));
+    z = _gm_f4_add(_gm_f4_madd(w, tz, z),
+                   _gm_f4_sub(_gm_f4_mul(ux, ty), _gm_f4_mul(uy, tx)));
+    _gm_f4_store3(out[i].a, x, y, z);
+  }
+#endif
+  for (; i < n; ++i)
+  {
+    vec3f v  = in[i];
+    float tx = 2 * (q.a[2] * v.a[2] - q.a[3] * v.a[1]);
+    float ty = 2 * (q.a[3] * v.a[0] - q.a[1] * v.a[2]);
+    float tz = 2 * (q.a[1] * v.a[1] - q.a[2] * v.a[0]);
+    out[i].a[0] = v.a[0] + q.a[0] * tx + (q.a[2] * tz - q.a[3] * ty);
+    out[i].a[1] = v.a[1] + q.a[0] * ty + (q.a[3] * tx - q.a[1] * tz);
+    out[i].a[2] = v.a[2] + q.a[0] * tz + (q.a[1] * ty - q.a[2] * tx);
+  }
+}
+
+// zero-length vectors are passed through, as with v3f_normalize
+GM_CDECL void v3f_normalize_many(const vec3f *in, vec3f *out, size_t n)
+{
+  size_t i = 0;
+#if defined(GM_SIMD_SSE) || defined(GM_SIMD_NEON)
+  for (; i + 4 <= n; i += 4)
+  {
+    _gm_f4 x, y, z;
+    _gm_f4_load3(in[i].a, x, y, z);
+    _gm_f4 l = _gm_f4_madd(x, x, _gm_f4_madd(y, y, _gm_f4_mul(z, z)));
+#ifdef GM_FAST_MATH
+    l = _gm_f4_rsqrt(_gm_f4_zero_to_one(l));
+    _gm_f4_store3(out[i].a, _gm_f4_mul(x, l), _gm_f4_mul(y, l),
+                  _gm_f4_mul(z, l));
+#else
+    l = _gm_f4_zero_to_one(_gm_f4_sqrt(l));
+    _gm_f4_store3(out[i].a, _gm_f4_div(x, l), _gm_f4_div(y, l),
+                  _gm_f4_div(z, l));
+#endif
+  }
+#endif
+  for (; i < n; ++i)
+  {
+    out[i] = v3f_normalize(in[i]);
+  }
+}
+
+GM_CDECL void v3f_dot_many(const vec3f *l, const vec3f *r, float *out,
+                           size_t n)
+{
+  size_t i = 0;
+#if defined(GM_SIMD_SSE) || defined(GM_SIMD_NEON)
+  for (; i + 4 <= n; i += 4)
+  {
+    _gm_f4 lx, ly, lz, rx, ry, rz;
+    _gm_f4_load3(l[i].a, lx, ly, lz);
+    _gm_f4_load3(r[i].a, rx, ry, rz);
+    _gm_f4_store(out + i,
+                 _gm_f4_madd(lx, rx, _gm_f4_madd(ly, ry, _gm_f4_mul(lz, rz))));
+  }
+#endif
+  for (; i < n; ++i)
+  {
+    out[i] = v3f_dot(l[i], r[i]);
+  }
+}
+
+// shortest-arc blends of packed quaternion pairs by a shared weight, run
+// eight at a time through the component-form types
+// qf_x8_pack and qf_x8_unpack, with full blocks moved by 4 x 4 transposes
+// in registers as wide as float_x8's operators, so its loads forward from
+// the stores here
+GM_CDECL quatf_x8 _gm_qf_x8_load(const quatf *in, const size_t n)
+{
+#if defined(GM_SIMD_AVX)
+  if (n == 8)
+  {
+    quatf_x8 v;
+    __m256 r[4];
+    for (size_t k = 0; k < 4; ++k)
+    {
+      r[k] = _mm256_insertf128_ps(_mm256_castps128_ps256(_gm_f4_load(in[k].a)),
+                                  _gm_f4_load(in[k + 4].a), 1);
+    }
+    _gm_f8_transpose4(r[0], r[1], r[2], r[3]);
+    for (size_t k = 0; k < 4; ++k)
+    {
+      _gm_f8_store(v.a[k].a, r[k]);
+    }
+    return v;
+  }
+#elif defined(GM_SIMD_SSE) || defined(GM_SIMD_NEON)
+  if (n == 8)
+  {
+    quatf_x8 v;
+    for (size_t i = 0; i < 8; i += 4)
+    {
+      _gm_f4 r[4] = {_gm_f4_load(in[i].a), _gm_f4_load(in[i + 1].a),
+                     _gm_f4_load(in[i + 2].a), _gm_f4_load(in[i + 3].a)};
+      _gm_f4_transpose(r[0], r[1], r[2], r[3]);
+      for (size_t k = 0; k < 4; ++k)
+      {
+        _gm_f4_store(v.a[k].a + i, r[k]);
+      }
+    }
+    return v;
+  }
+#endif
+  return qf_x8_pack(in, n);
+}
+
+GM_CDECL void _gm_qf_x8_store(const quatf_x8 v, quatf *out, const size_t n)
+{
+#if defined(GM_SIMD_AVX)
+  if (n == 8)
+  {
+    __m256 r[4];
+    for (size_t k = 0; k < 4; ++k)
+    {
+      r[k] = _gm_f8_load(v.a[k].a);
+    }
+    _gm_f8_transpose4(r[0], r[1], r[2], r[3]);
+    for (size_t k = 0; k < 4; ++k)
+    {
+      _gm_f4_store(out[k].a, _mm256_castps256_ps128(r[k]));
+      _gm_f4_store(out[k + 4].a, _mm256_extractf128_ps(r[k], 1));
+    }
+    return;
+  }
+#elif defined(GM_SIMD_SSE) || defined(GM_SIMD_NEON)
+  if (n == 8)
+  {
+    for (size_t i = 0; i < 8; i += 4)
+    {
+      _gm_f4 r[4] = {_gm_f4_load(v.a[0].a + i), _gm_f4_load(v.a[1].a + i),
+                     _gm_f4_load(v.a[2].a + i), _gm_f4_load(v.a[3].a + i)};
+      _gm_f4_transpose(r[0], r[1], r[2], r[3]);
+      for (size_t k = 0; k < 4; ++k)
+      {
+        _gm_f4_store(out[i + k].a, r[k]);
+      }
+    }
+    return;
+  }
+#endif
+  qf_x8_unpack(v, out, n);
+}
+
+GM_CDECL void qf_nlerp_many(const quatf *a, const quatf *b, const float t,
+                            quatf *out, size_t n)
+{
+  for (size_t i = 0; i < n; i += 8)
+  {
+    size_t c = n - i < 8 ? n - i : 8;
+    quatf_x8 v =
+      qf_x8_nlerp(_gm_qf_x8_load(a + i, c), _gm_qf_x8_load(b + i, c), t);
+    _gm_qf_x8_store(v, out + i, c);
+  }
+}
+
+GM_CDECL void qf_slerp_many(const quatf *a, const quatf *b, const float t,
+                            quatf *out, size_t n)
+{
+  for (size_t i = 0; i < n; i += 8)
+  {
+    size_t c = n - i < 8 ? n - i : 8;
+    quatf_x8 v =
+      qf_x8_slerp(_gm_qf_x8_load(a + i, c), _gm_qf_x8_load(b + i, c), t);
+    _gm_qf_x8_store(v, out + i, c);
+  }
+}
+
+// bounding volumes
+// planes hold n . p + d = 0 with n pointing into the half-space they keep
+
+typedef struct
+{
+  vec3f min;
+  vec3f max;
+} aabbf;
+
+typedef struct
+{
+  vec3f c;
+  float r;
+} spheref;
+
+// centre, unit axes and the half extent along each axis
+typedef struct
+{
+  vec3f c;
+  vec3f u[3];
+  vec3f e;
+} obbf;
+
+typedef struct
+{
+  vec3f n;
+  float d;
+} planef;
+
+// left, right, bottom, top, near, far
+typedef struct
+{
+  planef p[6];
+} frustumf;
+
+// inverted so that any union with it yields the other operand
+GM_CONST aabbf aabbf_empty = {{{{INFINITY, INFINITY, INFINITY}}},
+                              {{{-INFINITY, -INFINITY, -INFINITY}}}};
+
+GM_CDECL aabbf aabbf_union(const aabbf a, const aabbf b)
+{
+  return (aabbf){v3f_min(a.min, b.min), v3f_max(a.max, b.max)};
+}
+
+GM_CDECL aabbf aabbf_addp(const aabbf a, const vec3f p)
+{
+  return (aabbf){v3f_min(a.min, p), v3f_max(a.max, p)};
+}
+
+GM_CDECL aabbf aabbf_from_points(const vec3f *p, const size_t n)
+{
+  aabbf b = aabbf_empty;
+  for (size_t i = 0; i < n; ++i)
+  {
+    b = aabbf_addp(b, p[i]);
+  }
+  return b;
+}
+
+GM_CDECL vec3f aabbf_center(const aabbf b)
+{
+  return v3f_smul(v3f_add(b.min, b.max), 0.5f);
+}
+
+// half extents
+GM_CDECL vec3f aabbf_extents(const aabbf b)
+{
+  return v3f_smul(v3f_sub(b.max, b.min), 0.5f);
+}
+
+GM_CDECL float aabbf_area(const aabbf b)
+{
+  vec3f d = v3f_sub(b.max, b.min);
+  return 2 * (d.x * d.y + d.y * d.z + d.z * d.x);
+}
+
+GM_CDECL bool aabbf_containsp(const aabbf b, const vec3f p)
+{
+  return p.x >= b.min.x && p.x <= b.max.x && p.y >= b.min.y &&
+         p.y <= b.max.y && p.z >= b.min.z && p.z <= b.max.z;
+}
+
+GM_CDECL bool aabbf_overlaps(const aabbf a, const aabbf b)
+{
+  return a.min.x <= b.max.x && a.max.x >= b.min.x && a.min.y <= b.max.y &&
+         a.max.y >= b.min.y && a.min.z <= b.max.z && a.max.z >= b.min.z;
+}
+
+// the box around an affinely transformed box, from the transformed centre
+// and the extents taken through the absolute upper 3x3
+GM_CDECL aabbf aabbf_transform(const mat4f m, const aabbf b)
+{
+  vec3f c = aabbf_center(b);
+  vec3f e = aabbf_extents(b);
+  vec3f tc, te;
+  for (size_t i = 0; i < 3; ++i)
+  {
+    const float *r = m.a + i * 4;
+    tc.a[i] = r[0] * c.x + r[1] * c.y + r[2] * c.z + r[3];
+    te.a[i] = fabsf(r[0]) * e.x + fabsf(r[1]) * e.y + fabsf(r[2]) * e.z;
+  }
+  return (aabbf){v3f_sub(tc, te), v3f_add(tc, te)};
+}
+
+GM_CDECL spheref spheref_from_aabbf(const aabbf b)
+{
+  return (spheref){aabbf_center(b), v3f_len(aabbf_extents(b))};
+}
+
+// ritter's bounding sphere, within a few percent of the minimal sphere
+GM_CDECL spheref spheref_from_points(const vec3f *p, const size_t n)
+{
+  if (n == 0)
+  {
+    return (spheref){v3f_zero, 0};
+  }
+  size_t y = 0, z = 0;
+  for (size_t i = 1; i < n; ++i)
+  {
+    y = v3f_sqlen(v3f_sub(p[i], p[0])) > v3f_sqlen(v3f_sub(p[y], p[0])) ? i : y;
+  }
+  for (size_t i = 1; i < n; ++i)
+  {
+    z = v3f_sqlen(v3f_sub(p[i], p[y])) > v3f_sqlen(v3f_sub(p[z], p[y])) ? i : z;
+  }
+  spheref s = {v3f_smul(v3f_add(p[y], p[z]), 0.5f),
+               0.5f * v3f_len(v3f_sub(p[z], p[y]))};
+  for (size_t i = 0; i < n; ++i)
+  {
+    float d = v3f_len(v3f_sub(p[i], s.c));
+    if (d > s.r)
+    {
+      float r = 0.5f * (s.r + d);
+      s.c     = v3f_add(s.c, v3f_smul(v3f_sub(p[i], s.c), (r - s.r) / d));
+      s.r     = r;
+    }
+  }
+  return s;
+}
+
+GM_CDECL bool spheref_containsp(const spheref s, const vec3f p)
+{
+  return v3f_sqlen(v3f_sub(p, s.c)) <= s.r * s.r;
+}
+
+GM_CDECL bool spheref_overlaps(const spheref a, const spheref b)
+{
+  float r = a.r + b.r;
+  return v3f_sqlen(v3f_sub(b.c, a.c)) <= r * r;
+}
+
+GM_CDECL bool aabbf_overlaps_spheref(const aabbf b, const spheref s)
+{
+  vec3f q = v3f_max(b.min, v3f_min(s.c, b.max));
+  return v3f_sqlen(v3f_sub(q, s.c)) <= s.r * s.r;
+}
+
+// an aabb under an affine transform, which may scale but not shear
+GM_CDECL obbf obbf_from_aabbf(const mat4f m, const aabbf b)
+{
+  obbf o;
+  vec3f c = aabbf_center(b);
+  vec3f e = aabbf_extents(b);
+  for (size_t i = 0; i < 3; ++i)
+  {
+    o.c.a[i] = m.a[i * 4 + 0] * c.x + m.a[i * 4 + 1] * c.y +
+               m.a[i * 4 + 2] * c.z + m.a[i * 4 + 3];
+    vec3f u  = v3f(m.a[i], m.a[4 + i], m.a[8 + i]);
+    float l  = v3f_len(u);
+    o.u[i]   = l > 0 ? v3f_sdiv(u, l) : u;
+    o.e.a[i] = e.a[i] * l;
+  }
+  return o;
+}
+
+GM_CDECL aabbf obbf_to_aabbf(const obbf o)
+{
+  vec3f e;
+  for (size_t i = 0; i < 3; ++i)
+  {
+    e.a[i] = fabsf(o.u[0].a[i]) * o.e.x + fabsf(o.u[1].a[i]) * o.e.y +
+             fabsf(o.u[2].a[i]) * o.e.z;
+  }
+  return (aabbf){v3f_sub(o.c, e), v3f_add(o.c, e)};
+}
+
+GM_CDECL bool obbf_containsp(const obbf o, const vec3f p)
+{
+  vec3f d = v3f_sub(p, o.c);
+  for (size_t i = 0; i < 3; ++i)
+  {
+    if (fabsf(v3f_dot(d, o.u[i])) > o.e.a[i])
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+// separating axis test over the 3 + 3 face axes and 9 edge cross products
+// the absolute rotation is padded so near-parallel edges cannot produce a
+// false separating axis from a degenerate cross product
+GM_CDECL bool obbf_overlaps(const obbf a, const obbf b)
+{
+  float r[3][3], ar[3][3], t[3];
+  vec3f d = v3f_sub(b.c, a.c);
+  for (size_t i = 0; i < 3; ++i)
+  {
+    for (size_t j = 0; j < 3; ++j)
+    {
+      r[i][j]  = v3f_dot(a.u[i], b.u[j]);
+      ar[i][j] = fabsf(r[i][j]) + GM_OPERNAME(gm, small);
+    }
+    t[i] = v3f_dot(d, a.u[i]);
+  }
+  for (size_t i = 0; i < 3; ++i)
+  {
+    float rb = b.e.x * ar[i][0] + b.e.y * ar[i][1] + b.e.z * ar[i][2];
+    if (fabsf(t[i]) > a.e.a[i] + rb)
+    {
+      return false;
+    }
+  }
+  for (size_t j = 0; j < 3; ++j)
+  {
+    float ra = a.e.x * ar[0][j] + a.e.y * ar[1][j] + a.e.z * ar[2][j];
+    float tt = t[0] * r[0][j] + t[1] * r[1][j] + t[2] * r[2][j];
+    if (fabsf(tt) > ra + b.e.a[j])
+    {
+      return false;
+    }
+  }
+  for (size_t i = 0; i < 3; ++i)
+  {
+    size_t i1 = (i + 1) % 3, i2 = (i + 2) % 3;
+    for (size_t j = 0; j < 3; ++j)
+    {
+      size_t j1 = (j + 1) % 3, j2 = (j + 2) % 3;
+      float ra  = a.e.a[i1] * ar[i2][j] + a.e.a[i2] * ar[i1][j];
+      float rb  = b.e.a[j1] * ar[i][j2] + b.e.a[j2] * ar[i][j1];
+      float tt  = t[i2] * r[i1][j] - t[i1] * r[i2][j];
+      if (fabsf(tt) > ra + rb)
+      {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+// the plane through p facing along n, n need not be unit length
+GM_CDECL planef planef_new(const vec3f n, const vec3f p)
+{
+  return (planef){n, -v3f_dot(n, p)};
+}
+
+GM_CDECL planef planef_normalize(const planef p)
+{
+  float l = v3f_len(p.n);
+  return l > 0 ? (planef){v3f_sdiv(p.n, l), p.d / l} : p;
+}
+
+// signed distance, positive on the kept side, scaled by |n|
+GM_CDECL float planef_dist(const planef p, const vec3f v)
+{
+  return v3f_dot(p.n, v) + p.d;
+}
+
+// gribb and hartmann's extraction for column vectors and -w <= z <= w
+// clip space, as produced by m4f_tpersp and m4f_tortho
+// given a view-projection matrix the planes are in world space
+GM_CDECL frustumf frustumf_from_m4f(const mat4f m)
+{
+  frustumf f;
+  for (size_t i = 0; i < 6; ++i)
+  {
+    const float *r = m.a + (i / 2) * 4;
+    float s        = i % 2 ? -1.0f : 1.0f;
+    f.p[i]         = planef_normalize((planef){
+      {{{m.a[12] + s * r[0], m.a[13] + s * r[1], m.a[14] + s * r[2]}}},
+      m.a[15] + s * r[3]});
+  }
+  return f;
+}
+
+// false only when the box is wholly outside one plane, so boxes near the
+// frustum corners may be kept
+GM_CDECL bool frustumf_test_aabbf(const frustumf *f, const aabbf b)
+{
+  vec3f c = aabbf_center(b);
+  vec3f e = aabbf_extents(b);
+  for (size_t i = 0; i < 6; ++i)
+  {
+    const planef *p = f->p + i;
+    float r = fabsf(p->n.x) * e.x + fabsf(p->n.y) * e.y + fabsf(p->n.z) * e.z;
+    if (planef_dist(*p, c) + r < 0)
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+GM_CDECL bool frustumf_test_spheref(const frustumf *f, const spheref s)
+{
+  for (size_t i = 0; i < 6; ++i)
+  {
+    if (planef_dist(f->p[i], s.c) + s.r < 0)
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+// batch culling, eight volumes against all six planes per step in
+// component form; bit i of mask[j] is set when volume 8 * j + i is kept
+// and bits past n in the last byte are cleared
+
+// e are box half extents and r sphere radii, either may be zero
+GM_CDECL byte _gm_frustumf_cull8(const frustumf *f, const vec3f_x8 c,
+                                 const vec3f_x8 e, const float_x8 r)
+{
+  float_x8 zero = f_x8_set1(0), out = zero;
+  for (size_t k = 0; k < 6; ++k)
+  {
+    const planef p = f->p[k];
+    vec3f a        = v3f(fabsf(p.n.x), fabsf(p.n.y), fabsf(p.n.z));
+    // the distance of the point furthest along n
+    float_x8 d = f_x8_add(v3f_x8_dot(c, v3f_x8_set1(p.n)), f_x8_set1(p.d));
+    d   = f_x8_add(f_x8_add(d, v3f_x8_dot(e, v3f_x8_set1(a))), r);
+    out = f_x8_ltsel(d, zero, f_x8_set1(1), out);
+  }
+  byte mask = 0;
+  for (size_t i = 0; i < 8; ++i)
+  {
+    mask |= (byte) ((out.a[i] == 0) << i);
+  }
+  return mask;
+}
+
+GM_CDECL void frustumf_cull_aabbfs(const frustumf *f, const aabbf *b,
+                                   const size_t n, byte *mask)
+{
+  for (size_t i = 0; i < n; i += 8)
+  {
+    size_t w = n - i < 8 ? n - i : 8;
+    vec3f c[8], e[8];
+    for (size_t j = 0; j < w; ++j)
+    {
+      c[j] = aabbf_center(b[i + j]);
+      e[j] = aabbf_extents(b[i + j]);
+    }
+    byte m = _gm_frustumf_cull8(f, v3f_x8_pack(c, w), v3f_x8_pack(e, w),
+                                f_x8_set1(0));
+    mask[i / 8] = m & (byte) (0xff >> (8 - w));
+  }
+}
+
+GM_CDECL void frustumf_cull_spherefs(const frustumf *f, const spheref *s,
+                                     const size_t n, byte *mask)
+{
+  for (size_t i = 0; i < n; i += 8)
+  {
+    size_t w   = n - i < 8 ? n - i : 8;
+    float_x8 r = f_x8_set1(0);
+    vec3f c[8];
+    for (size_t j = 0; j < w; ++j)
+    {
+      c[j]   = s[i + j].c;
+      r.a[j] = s[i + j].r;
+    }
+    byte m = _gm_frustumf_cull8(f, v3f_x8_pack(c, w), v3f_x8_set1(v3f_zero),
+                                r);
+    mask[i / 8] = m & (byte) (0xff >> (8 - w));
+  }
+}
+
+// ray packet kernels in component form, one ray against eight triangles and
+// eight rays against one box, returning a hit bit per lane
+// the _wt variants are watertight: rays through shared edges and vertices
+// hit at least one of the adjoining triangles, and box tests are
+// conservative under rounding
+
+// eight triangles as their corners, lanes past the packed count are
+// degenerate and never hit
+typedef struct
+{
+  vec3f_x8 a;
+  vec3f_x8 b;
+  vec3f_x8 c;
+} trif_x8;
+
+// eight rays with reciprocal directions, lanes past the packed count have
+// a negative tmax and never hit
+typedef struct
+{
+  vec3f_x8 o;
+  vec3f_x8 d;
+  vec3f_x8 inv;
+  float_x8 tmax;
+} rayf_x8;
+
+// v holds three corners per triangle
+GM_CDECL trif_x8 trif_x8_pack(const vec3f *v, const size_t n)
+{
+  trif_x8 t;
+  vec3f a[8], b[8], c[8];
+  size_t w = n < 8 ? n : 8;
+  for (size_t i = 0; i < w; ++i)
+  {
+    a[i] = v[3 * i + 0];
+    b[i] = v[3 * i + 1];
+    c[i] = v[3 * i + 2];
+  }
+  t.a = v3f_x8_pack(a, w);
+  t.b = v3f_x8_pack(b, w);
+  t.c = v3f_x8_pack(c, w);
+  return t;
+}
+
+GM_CDECL rayf_x8 rayf_x8_pack(const vec3f *o, const vec3f *d,
+                              const float tmax, const size_t n)
+{
+  rayf_x8 r;
+  size_t w = n < 8 ? n : 8;
+  r.o      = v3f_x8_pack(o, w);
+  r.d      = v3f_x8_pack(d, w);
+  for (size_t k = 0; k < 3; ++k)
+  {
+    for (size_t i = 0; i < 8; ++i)
+    {
+      r.inv.a[k].a[i] = 1 / r.d.a[k].a[i];
+    }
+  }
+  for (size_t i = 0; i < 8; ++i)
+  {
+    r.tmax.a[i] = i < w ? tmax : -1;
+  }
+  return r;
+}
+
+// the kernels run the eight lanes as two halves of four under simd, with
+// the hit mask taken from the lane compares, and one lane at a time without
+#if defined(GM_SIMD_SSE) || defined(GM_SIMD_NEON)
+// moller-trumbore, two-sided, for hits with 0 < t <= tmax
+// dist gets the hit distance per lane and infinity for misses
+GM_CDECL byte trif_x8_raycast(const trif_x8 *t, const vec3f o, const vec3f d,
+                              const float tmax, float_x8 *dist)
+{
+  const _gm_f4 zero = _gm_f4_set1(0);
+  const _gm_f4 dx = _gm_f4_set1(d.x), dy = _gm_f4_set1(d.y);
+  const _gm_f4 dz = _gm_f4_set1(d.z);
+  int m           = 0;
+  for (size_t h = 0; h < 8; h += 4)
+  {
+    _gm_f4 ax  = _gm_f4_load(t->a.x.a + h);
+    _gm_f4 ay  = _gm_f4_load(t->a.y.a + h);
+    _gm_f4 az  = _gm_f4_load(t->a.z.a + h);
+    _gm_f4 e1x = _gm_f4_sub(_gm_f4_load(t->b.x.a + h), ax);
+    _gm_f4 e1y = _gm_f4_sub(_gm_f4_load(t->b.y.a + h), ay);
+    _gm_f4 e1z = _gm_f4_sub(_gm_f4_load(t->b.z.a + h), az);
+    _gm_f4 e2x = _gm_f4_sub(_gm_f4_load(t->c.x.a + h), ax);
+    _gm_f4 e2y = _gm_f4_sub(_gm_f4_load(t->c.y.a + h), ay);
+    _gm_f4 e2z = _gm_f4_sub(_gm_f4_load(t->c.z.a + h), az);
+    _gm_f4 px  = _gm_f4_sub(_gm_f4_mul(dy, e2z), _gm_f4_mul(dz, e2y));
+    _gm_f4 py  = _gm_f4_sub(_gm_f4_mul(dz, e2x), _gm_f4_mul(dx, e2z));
+    _gm_f4 pz  = _gm_f4_sub(_gm_f4_mul(dx, e2y), _gm_f4_mul(dy, e2x));
+    _gm_f4 det = _gm_f4_add(
+      _gm_f4_add(_gm_f4_mul(e1x, px), _gm_f4_mul(e1y, py)),
+      _gm_f4_mul(e1z, pz));
+    _gm_f4 sx  = _gm_f4_sub(_gm_f4_set1(o.x), ax);
+    _gm_f4 sy  = _gm_f4_sub(_gm_f4_set1(o.y), ay);
+    _gm_f4 sz  = _gm_f4_sub(_gm_f4_set1(o.z), az);
+    _gm_f4 qx  = _gm_f4_sub(_gm_f4_mul(sy, e1z), _gm_f4_mul(sz, e1y));
+    _gm_f4 qy  = _gm_f4_sub(_gm_f4_mul(sz, e1x), _gm_f4_mul(sx, e1z));
+    _gm_f4 qz  = _gm_f4_sub(_gm_f4_mul(sx, e1y), _gm_f4_mul(sy, e1x));
+    _gm_f4 nz  = _gm_f4_neq(det, zero);
+    _gm_f4 r   = _gm_f4_select(nz, _gm_f4_div(_gm_f4_set1(1), det), zero);
+    _gm_f4 u   = _gm_f4_mul(
+      _gm_f4_add(_gm_f4_add(_gm_f4_mul(sx, px), _gm_f4_mul(sy, py)),
+                 _gm_f4_mul(sz, pz)),
+      r);
+    _gm_f4 v = _gm_f4_mul(
+      _gm_f4_add(_gm_f4_add(_gm_f4_mul(dx, qx), _gm_f4_mul(dy, qy)),
+                 _gm_f4_mul(dz, qz)),
+      r);
+    _gm_f4 s = _gm_f4_mul(
+      _gm_f4_add(_gm_f4_add(_gm_f4_mul(e2x, qx), _gm_f4_mul(e2y, qy)),
+                 _gm_f4_mul(e2z, qz)),
+      r);
+    _gm_f4 hit = _gm_f4_and(nz, _gm_f4_and(_gm_f4_le(zero, u),
+                                           _gm_f4_le(zero, v)));
+    hit        = _gm_f4_and(hit, _gm_f4_le(_gm_f4_add(u, v), _gm_f4_set1(1)));
+    hit        = _gm_f4_and(hit, _gm_f4_and(_gm_f4_lt(zero, s),
+                                            _gm_f4_le(s, _gm_f4_set1(tmax))));
+    _gm_f4_store(dist->a + h, _gm_f4_select(hit, s, _gm_f4_set1(INFINITY)));
+    m |= _gm_f4_mask(hit) << h;
+  }
+  return (byte) m;
+}
+
+// woop, benthin and wald's watertight test: the triangle is sheared into
+// the ray's frame so the edge functions are evaluated identically for
+// triangles sharing an edge
+// their products are taken exactly in double, which keeps an exact zero
+// exact and a shared edge's two signs opposite even under fused multiply-add
+GM_CDECL byte trif_x8_raycast_wt(const trif_x8 *t, const vec3f o,
+                                 const vec3f d, const float tmax,
+                                 float_x8 *dist)
+{
+  size_t kz = fabsf(d.x) > fabsf(d.y) ? (fabsf(d.x) > fabsf(d.z) ? 0 : 2)
+                                      : (fabsf(d.y) > fabsf(d.z) ? 1 : 2);
+  size_t kx = (kz + 1) % 3;
+  size_t ky = (kx + 1) % 3;
+  if (d.a[kz] < 0)
+  {
+    size_t s = kx;
+    kx       = ky;
+    ky       = s;
+  }
+  const vec3f_x8 *p[3] = {&t->a, &t->b, &t->c};
+  const _gm_f4 zero    = _gm_f4_set1(0);
+  const _gm_f4 sx      = _gm_f4_set1(d.a[kx] / d.a[kz]);
+  const _gm_f4 sy      = _gm_f4_set1(d.a[ky] / d.a[kz]);
+  const _gm_f4 sz      = _gm_f4_set1(1 / d.a[kz]);
+  int m                = 0;
+  for (size_t h = 0; h < 8; h += 4)
+  {
+    _gm_f4 x[3], y[3], z[3];
+    for (size_t j = 0; j < 3; ++j)
+    {
+      _gm_f4 ax = _gm_f4_sub(_gm_f4_load(p[j]->a[kx].a + h),
+                             _gm_f4_set1(o.a[kx]));
+      _gm_f4 ay = _gm_f4_sub(_gm_f4_load(p[j]->a[ky].a + h),
+                             _gm_f4_set1(o.a[ky]));
+      _gm_f4 az = _gm_f4_sub(_gm_f4_load(p[j]->a[kz].a + h),
+                             _gm_f4_set1(o.a[kz]));
+      x[j]      = _gm_f4_sub(ax, _gm_f4_mul(sx, az));
+      y[j]      = _gm_f4_sub(ay, _gm_f4_mul(sy, az));
+      z[j]      = _gm_f4_mul(sz, az);
+    }
+    _gm_f4 u   = _gm_f4_dop(x[2], y[1], y[2], x[1]);
+    _gm_f4 v   = _gm_f4_dop(x[0], y[2], y[0], x[2]);
+    _gm_f4 w   = _gm_f4_dop(x[1], y[0], y[1], x[0]);
+    _gm_f4 det = _gm_f4_add(_gm_f4_add(u, v), w);
+    _gm_f4 nz  = _gm_f4_neq(det, zero);
+    _gm_f4 s   = _gm_f4_add(
+      _gm_f4_add(_gm_f4_mul(u, z[0]), _gm_f4_mul(v, z[1])),
+      _gm_f4_mul(w, z[2]));
+    s          = _gm_f4_select(nz, _gm_f4_div(s, det), zero);
+    _gm_f4 in  = _gm_f4_or(
+      _gm_f4_and(_gm_f4_and(_gm_f4_le(zero, u), _gm_f4_le(zero, v)),
+                 _gm_f4_le(zero, w)),
+      _gm_f4_and(_gm_f4_and(_gm_f4_le(u, zero), _gm_f4_le(v, zero)),
+                 _gm_f4_le(w, zero)));
+    _gm_f4 hit = _gm_f4_and(_gm_f4_and(in, nz),
+                            _gm_f4_and(_gm_f4_lt(zero, s),
+                                       _gm_f4_le(s, _gm_f4_set1(tmax))));
+    _gm_f4_store(dist->a + h, _gm_f4_select(hit, s, _gm_f4_set1(INFINITY)));
+    m |= _gm_f4_mask(hit) << h;
+  }
+  return (byte) m;
+}
+
+// slab test of eight rays against one box over [0, tmax] per ray
+// tnear gets the entry distance, 0 for rays starting inside
+// the selects keep a nan slab from 0 * inf from changing the range
+GM_CDECL byte _gm_rayf_x8_aabbf(const rayf_x8 *r, const aabbf b,
+                                const float far, float_x8 *tnear)
+{
+  int m = 0;
+  for (size_t h = 0; h < 8; h += 4)
+  {
+    _gm_f4 t0 = _gm_f4_set1(0);
+    _gm_f4 t1 = _gm_f4_load(r->tmax.a + h);
+    for (size_t k = 0; k < 3; ++k)
+    {
+      _gm_f4 o   = _gm_f4_load(r->o.a[k].a + h);
+      _gm_f4 inv = _gm_f4_load(r->inv.a[k].a + h);
+      _gm_f4 a   = _gm_f4_mul(_gm_f4_sub(_gm_f4_set1(b.min.a[k]), o), inv);
+      _gm_f4 c   = _gm_f4_mul(_gm_f4_sub(_gm_f4_set1(b.max.a[k]), o), inv);
+      _gm_f4 ac  = _gm_f4_lt(a, c);
+      _gm_f4 n   = _gm_f4_select(ac, a, c);
+      _gm_f4 f   = _gm_f4_mul(_gm_f4_select(ac, c, a), _gm_f4_set1(far));
+      t0         = _gm_f4_select(_gm_f4_lt(t0, n), n, t0);
+      t1         = _gm_f4_select(_gm_f4_lt(f, t1), f, t1);
+    }
+    _gm_f4_store(tnear->a + h, t0);
+    m |= _gm_f4_le_mask(t0, t1) << h;
+  }
+  return (byte) m;
+}
+#else
+GM_CDECL byte trif_x8_raycast(const trif_x8 *t, const vec3f o, const vec3f d,
+                              const float tmax, float_x8 *dist)
+{
+  byte m = 0;
+  for (size_t i = 0; i < 8; ++i)
+  {
+    float e1x = t->b.x.a[i] - t->a.x.a[i];
+    float e1y = t->b.y.a[i] - t->a.y.a[i];
+    float e1z = t->b.z.a[i] - t->a.z.a[i];
+    float e2x = t->c.x.a[i] - t->a.x.a[i];
+    float e2y = t->c.y.a[i] - t->a.y.a[i];
+    float e2z = t->c.z.a[i] - t->a.z.a[i];
+    float px  = d.y * e2z - d.z * e2y;
+    float py  = d.z * e2x - d.x * e2z;
+    float pz  = d.x * e2y - d.y * e2x;
+    float det = e1x * px + e1y * py + e1z * pz;
+    float sx  = o.x - t->a.x.a[i];
+    float sy  = o.y - t->a.y.a[i];
+    float sz  = o.z - t->a.z.a[i];
+    float qx  = sy * e1z - sz * e1y;
+    float qy  = sz * e1x - sx * e1z;
+    float qz  = sx * e1y - sy * e1x;
+    float r   = det != 0 ? 1 / det : 0;
+    float u   = (sx * px + sy * py + sz * pz) * r;
+    float v   = (d.x * qx + d.y * qy + d.z * qz) * r;
+    float s   = (e2x * qx + e2y * qy + e2z * qz) * r;
+    bool h = det != 0 && u >= 0 && v >= 0 && u + v <= 1 && s > 0 && s <= tmax;
+    m |= (byte) (h << i);
+    dist->a[i] = h ? s : INFINITY;
+  }
+  return m;
+}
+
+GM_CDECL byte trif_x8_raycast_wt(const trif_x8 *t, const vec3f o,
+                                 const vec3f d, const float tmax,
+                                 float_x8 *dist)
+{
+  size_t kz = fabsf(d.x) > fabsf(d.y) ? (fabsf(d.x) > fabsf(d.z) ? 0 : 2)
+                                      : (fabsf(d.y) > fabsf(d.z) ? 1 : 2);
+  size_t kx = (kz + 1) % 3;
+  size_t ky = (kx + 1) % 3;
+  if (d.a[kz] < 0)
+  {
+    size_t s = kx;
+    kx       = ky;
+    ky       = s;
+  }
+  float sx             = d.a[kx] / d.a[kz];
+  float sy             = d.a[ky] / d.a[kz];
+  float sz             = 1 / d.a[kz];
+  const vec3f_x8 *p[3] = {&t->a, &t->b, &t->c};
+  byte m               = 0;
+  for (size_t i = 0; i < 8; ++i)
+  {
+    float x[3], y[3], z[3];
+    for (size_t j = 0; j < 3; ++j)
+    {
+      float ax = p[j]->a[kx].a[i] - o.a[kx];
+      float ay = p[j]->a[ky].a[i] - o.a[ky];
+      float az = p[j]->a[kz].a[i] - o.a[kz];
+      x[j]     = ax - sx * az;
+      y[j]     = ay - sy * az;
+      z[j]     = sz * az;
+    }
+    float u   = (float) ((double) x[2] * y[1] - (double) y[2] * x[1]);
+    float v   = (float) ((double) x[0] * y[2] - (double) y[0] * x[2]);
+    float w   = (float) ((double) x[1] * y[0] - (double) y[1] * x[0]);
+    float det = u + v + w;
+    float s   = det != 0 ? (u * z[0] + v * z[1] + w * z[2]) / det : 0;
+    bool in   = (u >= 0 && v >= 0 && w >= 0) || (u <= 0 && v <= 0 && w <= 0);
+    bool h    = in && det != 0 && s > 0 && s <= tmax;
+    m |= (byte) (h << i);
+    dist->a[i] = h ? s : INFINITY;
+  }
+  return m;
+}
+
+GM_CDECL byte _gm_rayf_x8_aabbf(const rayf_x8 *r, const aabbf b,
+                                const float far, float_x8 *tnear)
+{
+  byte m = 0;
+  for (size_t i = 0; i < 8; ++i)
+  {
+    float t0 = 0, t1 = r->tmax.a[i];
+    for (size_t k = 0; k < 3; ++k)
+    {
+      float a = (b.min.a[k] - r->o.a[k].a[i]) * r->inv.a[k].a[i];
+      float c = (b.max.a[k] - r->o.a[k].a[i]) * r->inv.a[k].a[i];
+      float n = a < c ? a : c;
+      float f = (a < c ? c : a) * far;
+      // written so a nan slab from 0 * inf leaves the range unchanged
+      t0 = n > t0 ? n : t0;
+      t1 = f < t1 ? f : t1;
+    }
+    m |= (byte) ((t0 <= t1) << i);
+    tnear->a[i] = t0;
+  }
+  return m;
+}
+#endif
+
+GM_CDECL byte rayf_x8_aabbf(const rayf_x8 *r, const aabbf b, float_x8 *tnear)
+{
+  return _gm_rayf_x8_aabbf(r, b, 1, tnear);
+}
+
+// ize's robust slab test, far distances are pushed out by 2 gamma(3) to
+// cover the rounding of the subtraction and product
+GM_CDECL byte rayf_x8_aabbf_wt(const rayf_x8 *r, const aabbf b,
+                               float_x8 *tnear)
+{
+  const float g3 = 3 * (FLT_EPSILON / 2) / (1 - 3 * (FLT_EPSILON / 2));
+  return _gm_rayf_x8_aabbf(r, b, 1 + 2 * g3, tnear);
+}
+
+// bounding volume hierarchy over item boxes
+// nodes are flattened in depth-first order with siblings adjacent, so every
+// child lies after its parent and refitting is one reverse pass
+// zero-initialize a bvhf before the first build or insert
+
+#ifndef GM_BVH_LEAF_SIZE
+#define GM_BVH_LEAF_SIZE 4
+#endif
+#ifndef GM_BVH_BINS
+#define GM_BVH_BINS 12
+#endif
+// with openmp, subtrees of at least this many items build as tasks
+#ifndef GM_BVH_PARALLEL_MIN
+#define GM_BVH_PARALLEL_MIN 4096
+#endif
+
+typedef struct
+{
+  aabbf box;
+  // inner nodes: the left child, with the right child following it
+  // leaves: the first slot in items
+  uint32_t first;
+  // items in a leaf, 0 for inner nodes
+  uint32_t count;
+} bvhf_node;
+
+typedef struct
+{
+  bvhf_node *nodes;
+  size_t nnodes;
+  size_t cnodes;
+  // item ids in leaf order
+  uint32_t *items;
+  // item boxes by id
+  aabbf *boxes;
+  size_t nitems;
+  size_t citems;
+} bvhf;
+
+GM_CDECL void bvhf_free(bvhf *t)
+{
+  _gm_free(t->nodes);
+  _gm_free(t->items);
+  _gm_free(t->boxes);
+  *t = (bvhf){0};
+}
+
+// builds node into its reserved slots: a subtree of m items owns 2m - 1
+// slots, itself plus 2m - 2 from desc on, so sibling subtrees never share
+// a slot and can be built concurrently
+GM_CDECL void _gm_bvhf_build(bvhf *t, bvhf_node *nodes, const vec3f *cent,
+                             const uint32_t node, const uint32_t desc,
+                             const uint32_t lo, const uint32_t hi)
+{
+  aabbf b  = aabbf_empty;
+  aabbf cb = aabbf_empty;
+  for (uint32_t i = lo; i < hi; ++i)
+  {
+    b  = aabbf_union(b, t->boxes[t->items[i]]);
+    cb = aabbf_addp(cb, cent[t->items[i]]);
+  }
+  nodes[node].box = b;
+  uint32_t m      = hi - lo;
+  if (m <= GM_BVH_LEAF_SIZE)
+  {
+    nodes[node].first = lo;
+    nodes[node].count = m;
+    return;
+  }
+  vec3f ext = v3f_sub(cb.max, cb.min);
+  int axis  = ext.x > ext.y ? (ext.x > ext.z ? 0 : 2) : (ext.y > ext.z ? 1 : 2);
+  float w   = ext.a[axis];
+  uint32_t mid = lo + m / 2;
+  // coincident centroids are split by count, anything else by binned sah
+  if (w > 0)
+  {
+    aabbf bb[GM_BVH_BINS], acc = aabbf_empty;
+    uint32_t bc[GM_BVH_BINS], rc[GM_BVH_BINS], n = 0;
+    float ra[GM_BVH_BINS], best = INFINITY, k = GM_BVH_BINS / w;
+    uint32_t split = 1;
+    for (size_t j = 0; j < GM_BVH_BINS; ++j)
+    {
+      bb[j] = aabbf_empty;
+      bc[j] = 0;
+    }
+#define _GM_BVH_BIN(C)                                                         \
+  ((uint32_t) gm_min((int) (((C) - cb.min.a[axis]) * k), GM_BVH_BINS - 1))
+    for (uint32_t i = lo; i < hi; ++i)
+    {
+      uint32_t j = _GM_BVH_BIN(cent[t->items[i]].a[axis]);
+      bb[j]      = aabbf_union(bb[j], t->boxes[t->items[i]]);
+      bc[j]++;
+    }
+    for (size_t j = GM_BVH_BINS - 1; j > 0; --j)
+    {
+      acc   = aabbf_union(acc, bb[j]);
+      n    += bc[j];
+      rc[j] = n;
+      ra[j] = n ? aabbf_area(acc) : 0;
+    }
+    acc = aabbf_empty;
+    n   = 0;
+    for (size_t j = 0; j + 1 < GM_BVH_BINS; ++j)
+    {
+      acc       = aabbf_union(acc, bb[j]);
+      n        += bc[j];
+      float c   = n * aabbf_area(acc) + rc[j + 1] * ra[j + 1];
+      if (n && rc[j + 1] && c < best)
+      {
+        best  = c;
+        split = (uint32_t) j + 1;
+      }
+    }
+    uint32_t i = lo, e = hi;
+    while (i < e)
+    {
+      if (_GM_BVH_BIN(cent[t->items[i]].a[axis]) < split)
+      {
+        ++i;
+      }
+      else
+      {
+        uint32_t s   = t->items[i];
+        t->items[i]  = t->items[--e];
+        t->items[e]  = s;
+      }
+    }
+#undef _GM_BVH_BIN
+    mid = i > lo && i < hi ? i : mid;
+  }
+  uint32_t dl       = desc + 2;
+  uint32_t dr       = dl + 2 * (mid - lo) - 2;
+  nodes[node].first = desc;
+  nodes[node].count = 0;
+#ifdef _OPENMP
+  if (m >= GM_BVH_PARALLEL_MIN)
+  {
+#pragma omp task
+    _gm_bvhf_build(t, nodes, cent, desc, dl, lo, mid);
+    _gm_bvhf_build(t, nodes, cent, desc + 1, dr, mid, hi);
+#pragma omp taskwait
+    return;
+  }
+#endif
+  _gm_bvhf_build(t, nodes, cent, desc, dl, lo, mid);
+  _gm_bvhf_build(t, nodes, cent, desc + 1, dr, mid, hi);
+}
+
+// sah build over n item boxes, ids are their indices
+// replaces any previous contents, false when allocation fails
+GM_CDECL bool bvhf_build(bvhf *t, const aabbf *boxes, const size_t n)
+{
+  bvhf_free(t);
+  if (n == 0)
+  {
+    return true;
+  }
+  size_t cn         = 2 * n - 1;
+  bvhf_node *sparse = (bvhf_node *) _gm_malloc(cn * sizeof(bvhf_node));
+  vec3f *cent       = (vec3f *) _gm_malloc(n * sizeof(vec3f));
+  uint32_t *stack   = (uint32_t *) _gm_malloc(n * sizeof(uint32_t));
+  t->nodes          = (bvhf_node *) _gm_malloc(cn * sizeof(bvhf_node));
+  t->items          = (uint32_t *) _gm_malloc(n * sizeof(uint32_t));
+  t->boxes          = (aabbf *) _gm_malloc(n * sizeof(aabbf));
+  if (!sparse || !cent || !stack || !t->nodes || !t->items || !t->boxes)
+  {
+    _gm_free(sparse);
+    _gm_free(cent);
+    _gm_free(stack);
+    bvhf_free(t);
+    return false;
+  }
+  for (size_t i = 0; i < n; ++i)
+  {
+    t->items[i] = (uint32_t) i;
+    t->boxes[i] = boxes[i];
+    cent[i]     = aabbf_center(boxes[i]);
+  }
+  t->nitems = t->citems = n;
+  t->cnodes             = cn;
+#ifdef _OPENMP
+  if (n >= GM_BVH_PARALLEL_MIN)
+  {
+#pragma omp parallel
+#pragma omp single
+    _gm_bvhf_build(t, sparse, cent, 0, 1, 0, (uint32_t) n);
+  }
+  else
+#endif
+  {
+    _gm_bvhf_build(t, sparse, cent, 0, 1, 0, (uint32_t) n);
+  }
+  // pack the reserved layout depth-first, placing each sibling pair as
+  // its parent is popped so the left subtree follows its parent directly
+  size_t sp   = 0;
+  t->nodes[0] = sparse[0];
+  t->nnodes   = 1;
+  if (sparse[0].count == 0)
+  {
+    stack[sp++] = 0;
+  }
+  while (sp > 0)
+  {
+    uint32_t p             = stack[--sp];
+    uint32_t c             = t->nodes[p].first;
+    uint32_t k             = (uint32_t) t->nnodes;
+    t->nodes[k]            = sparse[c];
+    t->nodes[k + 1]        = sparse[c + 1];
+    t->nodes[p].first      = k;
+    t->nnodes             += 2;
+    if (sparse[c + 1].count == 0)
+    {
+      stack[sp++] = k + 1;
+    }
+    if (sparse[c].count == 0)
+    {
+      stack[sp++] = k;
+    }
+  }
+  _gm_free(sparse);
+  _gm_free(cent);
+  _gm_free(stack);
+  return true;
+}
+
+// recomputes every node box after items have moved, from boxes if given
+// or else from the boxes already held, which may be edited in place
+GM_CDECL void bvhf_refit(bvhf *t, const aabbf *boxes)
+{
+  for (size_t i = 0; boxes && i < t->nitems; ++i)
+  {
+    t->boxes[i] = boxes[i];
+  }
+  for (size_t i = t->nnodes; i-- > 0;)
+  {
+    bvhf_node *n = t->nodes + i;
+    if (n->count)
+    {
+      n->box = aabbf_empty;
+      for (uint32_t j = 0; j < n->count; ++j)
+      {
+        n->box = aabbf_union(n->box, t->boxes[t->items[n->first + j]]);
+      }
+    }
+    else
+    {
+      n->box = aabbf_union(t->nodes[n->first].box, t->nodes[n->first + 1].box);
+    }
+  }
+}
+
+// adds one item with the next id, descending to the child whose surface
+// area grows least and splitting the leaf found there
+// cheap enough per frame, but the tree degrades and a periodic rebuild
+// restores sah quality; false when allocation fails
+GM_CDECL bool bvhf_insert(bvhf *t, const aabbf box)
+{
+  if (t->nitems == t->citems)
+  {
+    size_t c   = t->citems ? 2 * t->citems : 16;
+    uint32_t *i = (uint32_t *) _gm_realloc(t->items, c * sizeof(uint32_t));
+    t->items    = i ? i : t->items;
+    aabbf *b    = i ? (aabbf *) _gm_realloc(t->boxes, c * sizeof(aabbf)) : 0;
+    t->boxes    = b ? b : t->boxes;
+    if (!b)
+    {
+      return false;
+    }
+    t->citems = c;
+  }
+  if (t->nnodes + 2 > t->cnodes)
+  {
+    size_t c     = t->cnodes ? 2 * t->cnodes : 32;
+    bvhf_node *n = (bvhf_node *) _gm_realloc(t->nodes, c * sizeof(bvhf_node));
+    if (!n)
+    {
+      return false;
+    }
+    t->nodes  = n;
+    t->cnodes = c;
+  }
+  uint32_t id  = (uint32_t) t->nitems++;
+  t->items[id] = id;
+  t->boxes[id] = box;
+  bvhf_node leaf = {box, id, 1};
+  if (t->nnodes == 0)
+  {
+    t->nodes[t->nnodes++] = leaf;
+    return true;
+  }
+  uint32_t i = 0;
+  while (t->nodes[i].count == 0)
+  {
+    bvhf_node *l    = t->nodes + t->nodes[i].first;
+    float gl        = aabbf_area(aabbf_union(l[0].box, box)) -
+                      aabbf_area(l[0].box);
+    float gr        = aabbf_area(aabbf_union(l[1].box, box)) -
+                      aabbf_area(l[1].box);
+    t->nodes[i].box = aabbf_union(t->nodes[i].box, box);
+    i               = t->nodes[i].first + (gl <= gr ? 0 : 1);
+  }
+  uint32_t k       = (uint32_t) t->nnodes;
+  t->nodes[k]      = t->nodes[i];
+  t->nodes[k + 1]  = leaf;
+  t->nodes[i]      = (bvhf_node){aabbf_union(t->nodes[i].box, box), k, 0};
+  t->nnodes       += 2;
+  return true;
+}
+
+// traversal stack, on the c stack until a tree is deeper than it allows
+typedef struct
+{
+  uint32_t *v;
+  size_t n;
+  size_t c;
+  uint32_t local[64];
+} _gm_bvhf_stack;
+
+GM_CDECL bool _gm_bvhf_push(_gm_bvhf_stack *s, const uint32_t v)
+{
+  if (s->n == s->c)
+  {
+    uint32_t *g = (uint32_t *) _gm_malloc(2 * s->c * sizeof(uint32_t));
+    if (!g)
+    {
+      return false;
+    }
+    for (size_t i = 0; i < s->n; ++i)
+    {
+      g[i] = s->v[i];
+    }
+    if (s->v != s->local)
+    {
+      _gm_free(s->v);
+    }
+    s->v = g;
+    s->c *= 2;
+  }
+  s->v[s->n++] = v;
+  return true;
+}
+
+GM_CDECL void _gm_bvhf_stack_init(_gm_bvhf_stack *s)
+{
+  s->v = s->local;
+  s->n = 0;
+  s->c = sizeof s->local / sizeof s->local[0];
+}
+
+GM_CDECL void _gm_bvhf_stack_free(_gm_bvhf_stack *s)
+{
+  if (s->v != s->local)
+  {
+    _gm_free(s->v);
+  }
+}
+
+// slab test over s in [0, tmax], inv holding 1 / d per axis
+// fminf and fmaxf drop the nan from an origin on a slab of a zero axis
+GM_CDECL bool _gm_bvhf_slab(const aabbf b, const vec3f o, const vec3f inv,
+                            const float tmax, float *tnear)
+{
+  float t0 = 0, t1 = tmax;
+  for (size_t k = 0; k < 3; ++k)
+  {
+    float a = (b.min.a[k] - o.a[k]) * inv.a[k];
+    float c = (b.max.a[k] - o.a[k]) * inv.a[k];
+    t0      = fmaxf(t0, fminf(a, c));
+    t1      = fminf(t1, fmaxf(a, c));
+  }
+  *tnear = t0;
+  return t0 <= t1;
+}
+
+// the two children of an inner node are tested together and the tests
+// return bit j set when child j passes
+// with simd, each axis takes one register holding
+// {min 0, min 1, max 0, max 1}
+#if defined(GM_SIMD_SSE) || defined(GM_SIMD_NEON)
+GM_CDECL _gm_f4 _gm_bvhf_axis(const bvhf_node *c, const size_t k)
+{
+  return _gm_f4_setr(c[0].box.min.a[k], c[1].box.min.a[k], c[0].box.max.a[k],
+                     c[1].box.max.a[k]);
+}
+
+// min <= q.max and -max <= -q.min in one compare per axis
+GM_CDECL int _gm_bvhf_overlaps2(const bvhf_node *c, const aabbf q)
+{
+  const _gm_f4 flip = _gm_f4_setr(1, 1, -1, -1);
+  int m             = 0xf;
+  for (size_t k = 0; k < 3; ++k)
+  {
+    _gm_f4 r = _gm_f4_setr(q.max.a[k], q.max.a[k], q.min.a[k], q.min.a[k]);
+    m &= _gm_f4_le_mask(_gm_f4_mul(_gm_bvhf_axis(c, k), flip),
+                        _gm_f4_mul(r, flip));
+  }
+  return m & m >> 2;
+}
+
+// the squared distance from the centre to each box, clamped in lanes 0 and 1
+// against the opposite half of the register
+GM_CDECL int _gm_bvhf_overlaps2_spheref(const bvhf_node *c, const spheref s)
+{
+  _gm_f4 d2 = _gm_f4_set1(0);
+  for (size_t k = 0; k < 3; ++k)
+  {
+    _gm_f4 b = _gm_bvhf_axis(c, k);
+    _gm_f4 p = _gm_f4_set1(s.c.a[k]);
+    _gm_f4 d = _gm_f4_sub(_gm_f4_fmax(b, _gm_f4_fmin(p, _gm_f4_zwxy(b))), p);
+    d2       = _gm_f4_add(d2, _gm_f4_mul(d, d));
+  }
+  return _gm_f4_le_mask(d2, _gm_f4_set1(s.r * s.r)) & 3;
+}
+
+GM_CDECL int _gm_bvhf_slab2(const bvhf_node *c, const vec3f o,
+                            const vec3f inv, const float tmax, float *tnear)
+{
+  _gm_f4 t0 = _gm_f4_set1(0);
+  _gm_f4 t1 = _gm_f4_set1(tmax);
+  float v[4];
+  for (size_t k = 0; k < 3; ++k)
+  {
+    _gm_f4 t = _gm_f4_mul(_gm_f4_sub(_gm_bvhf_axis(c, k), _gm_f4_set1(o.a[k])),
+                          _gm_f4_set1(inv.a[k]));
+    _gm_f4 u = _gm_f4_zwxy(t);
+    t0       = _gm_f4_fmax(t0, _gm_f4_fmin(t, u));
+    t1       = _gm_f4_fmin(t1, _gm_f4_fmax(t, u));
+  }
+  _gm_f4_store(v, t0);
+  tnear[0] = v[0];
+  tnear[1] = v[1];
+  return _gm_f4_le_mask(t0, t1) & 3;
+}
+#else
+GM_CDECL int _gm_bvhf_overlaps2(const bvhf_node *c, const aabbf q)
+{
+  return aabbf_overlaps(c[0].box, q) | aabbf_overlaps(c[1].box, q) << 1;
+}
+
+GM_CDECL int _gm_bvhf_overlaps2_spheref(const bvhf_node *c, const spheref s)
+{
+  return aabbf_overlaps_spheref(c[0].box, s) |
+         aabbf_overlaps_spheref(c[1].box, s) << 1;
+}
+
+GM_CDECL int _gm_bvhf_slab2(const bvhf_node *c, const vec3f o,
+                            const vec3f inv, const float tmax, float *tnear)
+{
+  return _gm_bvhf_slab(c[0].box, o, inv, tmax, tnear) |
+         _gm_bvhf_slab(c[1].box, o, inv, tmax, tnear + 1) << 1;
+}
+#endif
+
+GM_CDECL int _gm_bvhf_containsp2(const bvhf_node *c, const vec3f p)
+{
+  return _gm_bvhf_overlaps2(c, (aabbf){p, p});
+}
+
+// overlap queries write up to cap matching ids to out and return the total
+// number of matches, which may be larger than cap
+// TEST checks one box against the query and TEST2 both children of a node
+#define GM_BVH_QUERY(OPER, QTYPENAME, TEST, TEST2)                             \
+  GM_CDECL size_t GM_OPERNAME(bvhf, OPER)(                                     \
+    const bvhf *t, const QTYPENAME q, uint32_t *out, const size_t cap)         \
+  {                                                                            \
+    size_t hits = 0;                                                           \
+    _gm_bvhf_stack s;                                                          \
+    _gm_bvhf_stack_init(&s);                                                   \
+    if (t->nnodes && TEST(t->nodes[0].box, q))                                 \
+    {                                                                          \
+      _gm_bvhf_push(&s, 0);                                                    \
+    }                                                                          \
+    while (s.n > 0)                                                            \
+    {                                                                          \
+      const bvhf_node *n = t->nodes + s.v[--s.n];                              \
+      if (n->count)                                                            \
+      {                                                                        \
+        for (uint32_t j = 0; j < n->count; ++j)                                \
+        {                                                                      \
+          uint32_t id = t->items[n->first + j];                                \
+          if (TEST(t->boxes[id], q))                                           \
+          {                                                                    \
+            if (hits < cap)                                                    \
+            {                                                                  \
+              out[hits] = id;                                                  \
+            }                                                                  \
+            hits++;                                                            \
+          }                                                                    \
+        }                                                                      \
+        continue;                                                              \
+      }                                                                        \
+      int m = TEST2(t->nodes + n->first, q);                                   \
+      for (uint32_t j = 0; j < 2; ++j)                                         \
+      {                                                                        \
+        if ((m >> j & 1) && !_gm_bvhf_push(&s, n->first + j))                  \
+        {                                                                      \
+          s.n = 0;                                                             \
+          break;                                                               \
+        }                                                                      \
+      }                                                                        \
+    }                                                                          \
+    _gm_bvhf_stack_free(&s);                                                   \
+    return hits;                                                               \
+  }
+
+GM_BVH_QUERY(query_aabbf, aabbf, aabbf_overlaps, _gm_bvhf_overlaps2)
+GM_BVH_QUERY(query_spheref, spheref, aabbf_overlaps_spheref,
+             _gm_bvhf_overlaps2_spheref)
+GM_BVH_QUERY(query_point, vec3f, aabbf_containsp, _gm_bvhf_containsp2)
+
+// the nearest primitive along o + s d for s in [0, tmax]
+// hit returns the distance to item id, or a negative value on a miss, and
+// subtrees entered beyond the best distance so far are skipped
+typedef float (*bvhf_hit_fn)(void *user, const uint32_t id, const vec3f o,
+                             const vec3f d, const float tmax);
+
+GM_CDECL bool bvhf_raycast(const bvhf *t, const vec3f o, const vec3f d,
+                           float tmax, bvhf_hit_fn hit, void *user,
+                           uint32_t *id, float *dist)
+{
+  vec3f inv  = v3f(1 / d.x, 1 / d.y, 1 / d.z);
+  bool found = false;
+  float tn[2];
+  _gm_bvhf_stack s;
+  _gm_bvhf_stack_init(&s);
+  if (t->nnodes && _gm_bvhf_slab(t->nodes[0].box, o, inv, tmax, tn))
+  {
+    _gm_bvhf_push(&s, 0);
+  }
+  while (s.n > 0)
+  {
+    const bvhf_node *n = t->nodes + s.v[--s.n];
+    if (!_gm_bvhf_slab(n->box, o, inv, tmax, tn))
+    {
+      continue;
+    }
+    if (n->count)
+    {
+      for (uint32_t j = 0; j < n->count; ++j)
+      {
+        uint32_t i = t->items[n->first + j];
+        float h    = hit(user, i, o, d, tmax);
+        if (h >= 0 && h <= tmax)
+        {
+          tmax  = h;
+          *id   = i;
+          found = true;
+        }
+      }
+      continue;
+    }
+    int m              = _gm_bvhf_slab2(t->nodes + n->first, o, inv, tmax, tn);
+    bool h0            = m & 1;
+    bool h1            = m >> 1;
+    // the nearer child is pushed last so it is searched first
+    uint32_t first     = n->first + (h0 && h1 && tn[1] < tn[0] ? 1 : 0);
+    uint32_t second    = n->first + n->first + 1 - first;
+    bool ok            = true;
+    if (h0 && h1)
+    {
+      ok = _gm_bvhf_push(&s, second) && _gm_bvhf_push(&s, first);
+    }
+    else if (h0 || h1)
+    {
+      ok = _gm_bvhf_push(&s, n->first + (h0 ? 0 : 1));
+    }
+    if (!ok)
+    {
+      break;
+    }
+  }
+  _gm_bvhf_stack_free(&s);
+  if (found)
+  {
+    *dist = tmax;
+  }
+  return found;
+}
+
+// every item whose box the ray meets within [0, tmax], nearer subtrees
+// first; writes up to cap ids to out and returns the total
+GM_CDECL size_t bvhf_raycast_all(const bvhf *t, const vec3f o, const vec3f d,
+                                 const float tmax, uint32_t *out,
+                                 const size_t cap)
+{
+  vec3f inv   = v3f(1 / d.x, 1 / d.y, 1 / d.z);
+  size_t hits = 0;
+  float tn[2];
+  _gm_bvhf_stack s;
+  _gm_bvhf_stack_init(&s);
+  if (t->nnodes && _gm_bvhf_slab(t->nodes[0].box, o, inv, tmax, tn))
+  {
+    _gm_bvhf_push(&s, 0);
+  }
+  while (s.n > 0)
+  {
+    const bvhf_node *n = t->nodes + s.v[--s.n];
+    if (n->count)
+    {
+      for (uint32_t j = 0; j < n->count; ++j)
+      {
+        uint32_t i = t->items[n->first + j];
+        if (_gm_bvhf_slab(t->boxes[i], o, inv, tmax, tn))
+        {
+          if (hits < cap)
+          {
+            out[hits] = i;
+          }
+          hits++;
+        }
+      }
+      continue;
+    }
+    int m              = _gm_bvhf_slab2(t->nodes + n->first, o, inv, tmax, tn);
+    bool h0            = m & 1;
+    bool h1            = m >> 1;
+    uint32_t first     = n->first + (h0 && h1 && tn[1] < tn[0] ? 1 : 0);
+    uint32_t second    = n->first + n->first + 1 - first;
+    bool ok            = true;
+    if (h0 && h1)
+    {
+      ok = _gm_bvhf_push(&s, second) && _gm_bvhf_push(&s, first);
+    }
+    else if (h0 || h1)
+    {
+      ok = _gm_bvhf_push(&s, n->first + (h0 ? 0 : 1));
+    }
+    if (!ok)
+    {
+      break;
+    }
+  }
+  _gm_bvhf_stack_free(&s);
+  return hits;
+}
+
+// compact storage formats for snapshots and streamed state, each with a
+// scalar encode/decode pair and an array kernel
+// half floats are ieee binary16 with round to nearest even, normals are
+// expected to be unit length, quaternions are stored as the smallest three
+// components with the index of the dropped one
+
+typedef struct
+{
+  uint16_t a[3];
+} vec3h;
+
+typedef struct
+{
+  uint16_t a[4];
+} vec4h;
+
+typedef struct
+{
+  int16_t a[3];
+} vec3sn16;
+
+typedef struct
+{
+  uint8_t a[3];
+} vec3un8;
+
+typedef struct
+{
+  uint16_t a[3];
+} quat48;
+
+GM_CDECL uint16_t f2h(const float f)
+{
+  union
+  {
+    float f;
+    uint32_t u;
+  } v        = {f};
+  uint32_t s = (v.u >> 16) & 0x8000u;
+  uint32_t a = v.u & 0x7fffffffu;
+  if (a >= 0x47800000u)
+  {
+    // past the largest finite half, nan keeps a quiet payload
+    return (uint16_t) (s | (a > 0x7f800000u ? 0x7e00u : 0x7c00u));
+  }
+  if (a < 0x38800000u)
+  {
+    // subnormal, adding 0.5 lets the fpu round to a multiple of 2^-24
+    union
+    {
+      float f;
+      uint32_t u;
+    } d = {fabsf(f) + 0.5f};
+    return (uint16_t) (s | (d.u - 0x3f000000u));
+  }
+  uint32_t m = a - 0x38000000u;
+  m += 0x0fffu + ((m >> 13) & 1);
+  return (uint16_t) (s | (m >> 13));
+}
+
+GM_CDECL float h2f(const uint16_t h)
+{
+  uint32_t s = (uint32_t) (h & 0x8000u) << 16;
+  uint32_t e = (h >> 10) & 0x1fu;
+  uint32_t m = h & 0x3ffu;
+  union
+  {
+    uint32_t u;
+    float f;
+  } v;
+  if (e == 0)
+  {
+    float f = (float) m * 5.96046448e-8f;
+    return s ? -f : f;
+  }
+  v.u = s | (e == 31 ? 0x7f800000u : (e + 112) << 23) | m << 13;
+  return v.f;
+}
+
+GM_CDECL void f2h_many(const float *in, uint16_t *out, size_t n)
+{
+  size_t i = 0;
+#if defined(GM_SIMD_SSE) && defined(__F16C__)
+  for (; i + 4 <= n; i += 4)
+  {
+    __m128i h = _mm_cvtps_ph(_mm_loadu_ps(in + i), _MM_FROUND_TO_NEAREST_INT);
+    _mm_storel_epi64((__m128i *) (out + i), h);
+  }
+#elif defined(GM_SIMD_NEON)
+  for (; i + 4 <= n; i += 4)
+  {
+    vst1_u16(out + i, vreinterpret_u16_f16(vcvt_f16_f32(vld1q_f32(in + i))));
+  }
+#endif
+  for (; i < n; ++i)
+  {
+    out[i] = f2h(in[i]);
+  }
+}
+
+GM_CDECL void h2f_many(const uint16_t *in, float *out, size_t n)
+{
+  size_t i = 0;
+#if defined(GM_SIMD_SSE) && defined(__F16C__)
+  for (; i + 4 <= n; i += 4)
+  {
+    __m128i h = _mm_loadl_epi64((const __m128i *) (in + i));
+    _mm_storeu_ps(out + i, _mm_cvtph_ps(h));
+  }
+#elif defined(GM_SIMD_NEON)
+  for (; i + 4 <= n; i += 4)
+  {
+    vst1q_f32(out + i, vcvt_f32_f16(vreinterpret_f16_u16(vld1_u16(in + i))));
+  }
+#endif
+  for (; i < n; ++i)
+  {
+    out[i] = h2f(in[i]);
+  }
+}
+
+GM_CDECL vec3h v3h_from_v3f(const vec3f v)
+{
+  vec3h h;
+  f2h_many(v.a, h.a, 3);
+  return h;
+}
+
+GM_CDECL vec3f v3f_from_v3h(const vec3h h)
+{
+  vec3f v;
+  h2f_many(h.a, v.a, 3);
+  return v;
+}
+
+GM_CDECL vec4h v4h_from_v4f(const vec4f v)
+{
+  vec4h h;
+  f2h_many(v.a, h.a, 4);
+  return h;
+}
+
+GM_CDECL vec4f v4f_from_v4h(const vec4h h)
+{
+  vec4f v;
+  h2f_many(h.a, v.a, 4);
+  return v;
+}
+
+// arrays of vectors are contiguous components, so they convert as one run
+GM_CDECL void v3h_from_v3f_many(const vec3f *in, vec3h *out, size_t n)
+{
+  f2h_many(in->a, out->a, 3 * n);
+}
+
+GM_CDECL void v3f_from_v3h_many(const vec3h *in, vec3f *out, size_t n)
+{
+  h2f_many(in->a, out->a, 3 * n);
+}
+
+// rounds half away from zero, _gm_f4_quantize below is the 4-wide form
+GM_CDECL int32_t _gm_quantize(const float x, const float scale)
+{
+  float c = x < -1 ? -1 : (x > 1 ? 1 : x);
+  return (int32_t) (c * scale + (c < 0 ? -0.5f : 0.5f));
+}
+
+GM_CDECL void _gm_snorm16_many(const float *in, int16_t *out, size_t n)
+{
+  for (size_t i = 0; i < n; ++i)
+  {
+    out[i] = (int16_t) _gm_quantize(in[i], 32767);
+  }
+}
+
+GM_CDECL void _gm_from_snorm16_many(const int16_t *in, float *out, size_t n)
+{
+  for (size_t i = 0; i < n; ++i)
+  {
+    float f = (float) in[i] * (1.0f / 32767);
+    out[i]  = f < -1 ? -1 : f;
+  }
+}
+
+// [-1, 1] to [0, 255] with 0 at 127.5
+GM_CDECL void _gm_unorm8_many(const float *in, uint8_t *out, size_t n)
+{
+  for (size_t i = 0; i < n; ++i)
+  {
+    float c = in[i] < -1 ? -1 : (in[i] > 1 ? 1 : in[i]);
+    out[i]  = (uint8_t) (int32_t) (c * 127.5f + 128);
+  }
+}
+
+GM_CDECL void _gm_from_unorm8_many(const uint8_t *in, float *out, size_t n)
+{
+  for (size_t i = 0; i < n; ++i)
+  {
+    out[i] = (float) in[i] * (2.0f / 255) - 1;
+  }
+}
+
+GM_CDECL vec3sn16 v3sn16_from_v3f(const vec3f v)
+{
+  vec3sn16 s;
+  _gm_snorm16_many(v.a, s.a, 3);
+  return s;
+}
+
+GM_CDECL vec3f v3f_from_v3sn16(const vec3sn16 s)
+{
+  vec3f v;
+  _gm_from_snorm16_many(s.a, v.a, 3);
+  return v;
+}
+
+GM_CDECL vec3un8 v3un8_from_v3f(const vec3f v)
+{
+  vec3un8 s;
+  _gm_unorm8_many(v.a, s.a, 3);
+  return s;
+}
+
+GM_CDECL vec3f v3f_from_v3un8(const vec3un8 s)
+{
+  vec3f v;
+  _gm_from_unorm8_many(s.a, v.a, 3);
+  return v;
+}
+
+GM_CDECL void v3sn16_from_v3f_many(const vec3f *in, vec3sn16 *out, size_t n)
+{
+  _gm_snorm16_many(in->a, out->a, 3 * n);
+}
+
+GM_CDECL void v3f_from_v3sn16_many(const vec3sn16 *in, vec3f *out, size_t n)
+{
+  _gm_from_snorm16_many(in->a, out->a, 3 * n);
+}
+
+GM_CDECL void v3un8_from_v3f_many(const vec3f *in, vec3un8 *out, size_t n)
+{
+  _gm_unorm8_many(in->a, out->a, 3 * n);
+}
+
+GM_CDECL void v3f_from_v3un8_many(const vec3un8 *in, vec3f *out, size_t n)
+{
+  _gm_from_unorm8_many(in->a, out->a, 3 * n);
+}
+
+// octahedral normals, the unit sphere folded onto the [-1, 1] square as in
+// cigolle et al., with x in the low half of the code and y in the high half
+// oct32 stores two snorm16 and is within 2e-5 rad, oct16 two snorm8
+GM_CDECL vec2f _gm_oct_encode(const vec3f v)
+{
+  float l = fabsf(v.x) + fabsf(v.y) + fabsf(v.z);
+  float x = l > 0 ? v.x / l : 0, y = l > 0 ? v.y / l : 0;
+  if (v.z < 0)
+  {
+    float fx = (1 - fabsf(y)) * (x < 0 ? -1.0f : 1.0f);
+    y        = (1 - fabsf(x)) * (y < 0 ? -1.0f : 1.0f);
+    x        = fx;
+  }
+  return v2f(x, y);
+}
+
+GM_CDECL vec3f _gm_oct_decode(const float x, const float y)
+{
+  float z = 1 - fabsf(x) - fabsf(y);
+  float t = z < 0 ? -z : 0;
+  vec3f v = v3f(x + (x < 0 ? t : -t), y + (y < 0 ? t : -t), z);
+  // full precision whatever GM_FAST_MATH says, the code is already lossy
+  return v3f_smul(v, 1 / sqrtf(v3f_sqlen(v)));
+}
+
+GM_CDECL uint32_t oct32_from_v3f(const vec3f v)
+{
+  vec2f p = _gm_oct_encode(v);
+  return (uint16_t) _gm_quantize(p.x, 32767) |
+         (uint32_t) (uint16_t) _gm_quantize(p.y, 32767) << 16;
+}
+
+GM_CDECL vec3f v3f_from_oct32(const uint32_t c)
+{
+  return _gm_oct_decode((float) (int16_t) (c & 0xffffu) / 32767,
+                        (float) (int16_t) (c >> 16) / 32767);
+}
+
+GM_CDECL uint16_t oct16_from_v3f(const vec3f v)
+{
+  vec2f p = _gm_oct_encode(v);
+  return (uint16_t) ((uint8_t) _gm_quantize(p.x, 127) |
+                     (uint8_t) _gm_quantize(p.y, 127) << 8);
+}
+
+GM_CDECL vec3f v3f_from_oct16(const uint16_t c)
+{
+  return _gm_oct_decode((float) (int8_t) (c & 0xffu) / 127,
+                        (float) (int8_t) (c >> 8) / 127);
+}
+
+#if defined(GM_SIMD_SSE) || defined(GM_SIMD_NEON)
+// lane-wise _gm_quantize, selects stand in for its branches
+GM_CDECL _gm_i4 _gm_f4_quantize(const _gm_f4 x, const float scale)
+{
+  _gm_f4 one = _gm_f4_set1(1), neg = _gm_f4_set1(-1);
+  _gm_f4 c   = _gm_f4_select(_gm_f4_lt(x, neg), neg,
+                             _gm_f4_select(_gm_f4_lt(one, x), one, x));
+  _gm_f4 h   = _gm_f4_select(_gm_f4_lt(c, _gm_f4_set1(0)), _gm_f4_set1(-0.5f),
+                             _gm_f4_set1(0.5f));
+  return _gm_i4_from_f4(_gm_f4_add(_gm_f4_mul(c, _gm_f4_set1(scale)), h));
+}
+
+// -1 where a lane is negative, 1 elsewhere
+GM_CDECL _gm_f4 _gm_f4_signf(const _gm_f4 v)
+{
+  return _gm_f4_select(_gm_f4_lt(v, _gm_f4_set1(0)), _gm_f4_set1(-1),
+                       _gm_f4_set1(1));
+}
+#endif
+
+// four normals at a time with the fold done by selects, the same codes as
+// oct32_from_v3f and v3f_from_oct32
+GM_CDECL void oct32_from_v3f_many(const vec3f *in, uint32_t *out, size_t n)
+{
+  size_t i = 0;
+#if defined(GM_SIMD_SSE) || defined(GM_SIMD_NEON)
+  _gm_f4 zero = _gm_f4_set1(0), one = _gm_f4_set1(1);
+  for (; i + 4 <= n; i += 4)
+  {
+    _gm_f4 x, y, z;
+    _gm_f4_load3(in[i].a, x, y, z);
+    _gm_f4 l =
+      _gm_f4_add(_gm_f4_add(_gm_f4_abs(x), _gm_f4_abs(y)), _gm_f4_abs(z));
+    _gm_f4 p = _gm_f4_lt(zero, l);
+    x        = _gm_f4_select(p, _gm_f4_div(x, l), zero);
+    y        = _gm_f4_select(p, _gm_f4_div(y, l), zero);
+    p        = _gm_f4_lt(z, zero);
+    _gm_f4 fx =
+      _gm_f4_mul(_gm_f4_sub(one, _gm_f4_abs(y)), _gm_f4_signf(x));
+    _gm_f4 fy =
+      _gm_f4_mul(_gm_f4_sub(one, _gm_f4_abs(x)), _gm_f4_signf(y));
+    _gm_i4 qx = _gm_f4_quantize(_gm_f4_select(p, fx, x), 32767);
+    _gm_i4 qy = _gm_f4_quantize(_gm_f4_select(p, fy, y), 32767);
+    _gm_i4_store(out + i, _gm_i4_or(_gm_i4_and(qx, _gm_i4_set1(0xffff)),
+                                    _gm_i4_shl(qy, 16)));
+  }
+#endif
+  for (; i < n; ++i)
+  {
+    out[i] = oct32_from_v3f(in[i]);
+  }
+}
+
+GM_CDECL void v3f_from_oct32_many(const uint32_t *in, vec3f *out, size_t n)
+{
+  size_t i = 0;
+#if defined(GM_SIMD_SSE) || defined(GM_SIMD_NEON)
+  _gm_f4 zero = _gm_f4_set1(0), s = _gm_f4_set1(32767);
+  for (; i + 4 <= n; i += 4)
+  {
+    _gm_i4 c = _gm_i4_load(in + i);
+    _gm_f4 x = _gm_f4_div(_gm_f4_from_i4(_gm_i4_sar(_gm_i4_shl(c, 16), 16)), s);
+    _gm_f4 y = _gm_f4_div(_gm_f4_from_i4(_gm_i4_sar(c, 16)), s);
+    _gm_f4 z =
+      _gm_f4_sub(_gm_f4_sub(_gm_f4_set1(1), _gm_f4_abs(x)), _gm_f4_abs(y));
+    _gm_f4 t  = _gm_f4_select(_gm_f4_lt(z, zero), _gm_f4_sub(zero, z), zero);
+    _gm_f4 nt = _gm_f4_mul(t, _gm_f4_set1(-1));
+    x         = _gm_f4_add(x, _gm_f4_select(_gm_f4_lt(x, zero), t, nt));
+    y         = _gm_f4_add(y, _gm_f4_select(_gm_f4_lt(y, zero), t, nt));
+    _gm_f4 r  = _gm_f4_div(
+      _gm_f4_set1(1),
+      _gm_f4_sqrt(_gm_f4_add(_gm_f4_add(_gm_f4_mul(x, x), _gm_f4_mul(y, y)),
+                             _gm_f4_mul(z, z))));
+    _gm_f4_store3(out[i].a, _gm_f4_mul(x, r), _gm_f4_mul(y, r),
+                  _gm_f4_mul(z, r));
+  }
+#endif
+  for (; i < n; ++i)
+  {
+    out[i] = v3f_from_oct32(in[i]);
+  }
+}
+
+// the largest component is dropped and rebuilt from the unit norm, the
+// other three lie in [-1/sqrt2, 1/sqrt2] and take BITS bits each
+// q and -q are the same rotation, so the dropped component is made positive
+GM_CDECL uint64_t _gm_q3_pack(const quatf q, const uint32_t bits)
+{
+  size_t m = 0;
+  for (size_t k = 1; k < 4; ++k)
+  {
+    m = fabsf(q.a[k]) > fabsf(q.a[m]) ? k : m;
+  }
+  float s     = q.a[m] < 0 ? -1.0f : 1.0f;
+  float top   = (float) ((1u << bits) - 1);
+  uint64_t c  = m;
+  uint32_t sh = 2;
+  for (size_t k = 0; k < 4; ++k)
+  {
+    if (k == m)
+    {
+      continue;
+    }
+    float v = s * q.a[k] * 0.707106781f + 0.5f;
+    v       = v < 0 ? 0 : (v > 1 ? 1 : v);
+    c |= (uint64_t) (uint32_t) (v * top + 0.5f) << sh;
+    sh += bits;
+  }
+  return c;
+}
+
+GM_CDECL quatf _gm_q3_unpack(const uint64_t c, const uint32_t bits)
+{
+  size_t m    = (size_t) (c & 3);
+  uint64_t mk = (1u << bits) - 1;
+  float top   = (float) mk;
+  uint32_t sh = 2;
+  float sum   = 0;
+  quatf q;
+  for (size_t k = 0; k < 4; ++k)
+  {
+    if (k == m)
+    {
+      continue;
+    }
+    float u = (float) ((c >> sh) & mk) / top;
+    q.a[k]  = (u - 0.5f) * 1.41421356f;
+    sum += q.a[k] * q.a[k];
+    sh += bits;
+  }
+  q.a[m] = sqrtf(sum < 1 ? 1 - sum : 0);
+  return q;
+}
+
+// 2 + 3 x 10 bits, within about 1e-3 per component
+GM_CDECL uint32_t q32_from_qf(const quatf q)
+{
+  return (uint32_t) _gm_q3_pack(q, 10);
+}
+
+GM_CDECL quatf qf_from_q32(const uint32_t c)
+{
+  return _gm_q3_unpack(c, 10);
+}
+
+// 2 + 3 x 15 bits, within about 3e-5 per component
+GM_CDECL quat48 q48_from_qf(const quatf q)
+{
+  uint64_t c = _gm_q3_pack(q, 15);
+  return (quat48){{(uint16_t) c, (uint16_t) (c >> 16), (uint16_t) (c >> 32)}};
+}
+
+GM_CDECL quatf qf_from_q48(const quat48 p)
+{
+  return _gm_q3_unpack((uint64_t) p.a[0] | (uint64_t) p.a[1] << 16 |
+                         (uint64_t) p.a[2] << 32,
+                       15);
+}
+
+#if defined(GM_SIMD_SSE) || defined(GM_SIMD_NEON)
+// _gm_q3_pack for q[0] to q[3] at once, f[0] gets the dropped index and
+// f[1] to f[3] the kept components in order; the index is carried in float
+// lanes so the field choice is three selects rather than a shift per lane
+GM_CDECL void _gm_q3_pack4(const quatf *q, const uint32_t bits, _gm_i4 *f)
+{
+  _gm_f4 c[4] = {_gm_f4_load(q[0].a), _gm_f4_load(q[1].a),
+                 _gm_f4_load(q[2].a), _gm_f4_load(q[3].a)};
+  _gm_f4_transpose(c[0], c[1], c[2], c[3]);
+  _gm_f4 b = c[0], m = _gm_f4_set1(0);
+  for (int k = 1; k < 4; ++k)
+  {
+    _gm_f4 g = _gm_f4_lt(_gm_f4_abs(b), _gm_f4_abs(c[k]));
+    b        = _gm_f4_select(g, c[k], b);
+    m        = _gm_f4_select(g, _gm_f4_set1((float) k), m);
+  }
+  _gm_f4 s = _gm_f4_signf(b), top = _gm_f4_set1((float) ((1u << bits) - 1));
+  _gm_f4 zero = _gm_f4_set1(0), one = _gm_f4_set1(1), h = _gm_f4_set1(0.5f);
+  _gm_f4 v[3] = {_gm_f4_select(_gm_f4_eq(m, zero), c[1], c[0]),
+                 _gm_f4_select(_gm_f4_le(m, one), c[2], c[1]),
+                 _gm_f4_select(_gm_f4_le(m, _gm_f4_set1(2)), c[3], c[2])};
+  f[0] = _gm_i4_from_f4(m);
+  for (int k = 0; k < 3; ++k)
+  {
+    _gm_f4 u =
+      _gm_f4_add(_gm_f4_mul(_gm_f4_mul(s, v[k]), _gm_f4_set1(0.707106781f)), h);
+    u = _gm_f4_select(_gm_f4_lt(u, zero), zero,
+                      _gm_f4_select(_gm_f4_lt(one, u), one, u));
+    f[k + 1] = _gm_i4_from_f4(_gm_f4_add(_gm_f4_mul(u, top), h));
+  }
+}
+
+// the inverse of _gm_q3_pack4 into out[0] to out[3]
+GM_CDECL void _gm_q3_unpack4(const _gm_i4 *f, const uint32_t bits, quatf *out)
+{
+  _gm_f4 top = _gm_f4_set1((float) ((1u << bits) - 1)), v[3];
+  _gm_f4 sum = _gm_f4_set1(0), one = _gm_f4_set1(1);
+  for (int k = 0; k < 3; ++k)
+  {
+    _gm_f4 u = _gm_f4_div(_gm_f4_from_i4(f[k + 1]), top);
+    u        = _gm_f4_sub(u, _gm_f4_set1(0.5f));
+    v[k]     = _gm_f4_mul(u, _gm_f4_set1(1.41421356f));
+    sum      = _gm_f4_add(sum, _gm_f4_mul(v[k], v[k]));
+  }
+  _gm_f4 d = _gm_f4_sqrt(
+    _gm_f4_select(_gm_f4_lt(sum, one), _gm_f4_sub(one, sum), _gm_f4_set1(0)));
+  _gm_f4 m    = _gm_f4_from_i4(f[0]);
+  _gm_f4 c[4] = {v[0], v[1], v[2], d};
+  for (int k = 3; k > 0; --k)
+  {
+    _gm_f4 kf = _gm_f4_set1((float) k);
+    c[k]      = _gm_f4_select(_gm_f4_lt(m, kf), v[k - 1],
+                              _gm_f4_select(_gm_f4_eq(m, kf), d, c[k]));
+  }
+  c[0] = _gm_f4_select(_gm_f4_eq(m, _gm_f4_set1(0)), d, v[0]);
+  _gm_f4_transpose(c[0], c[1], c[2], c[3]);
+  for (int k = 0; k < 4; ++k)
+  {
+    _gm_f4_store(out[k].a, c[k]);
+  }
+}
+#endif
+
+GM_CDECL void q32_from_qf_many(const quatf *in, uint32_t *out, size_t n)
+{
+  size_t i = 0;
+#if defined(GM_SIMD_SSE) || defined(GM_SIMD_NEON)
+  for (; i + 4 <= n; i += 4)
+  {
+    _gm_i4 f[4];
+    _gm_q3_pack4(in + i, 10, f);
+    _gm_i4 c = _gm_i4_or(f[0], _gm_i4_shl(f[1], 2));
+    c = _gm_i4_or(c, _gm_i4_or(_gm_i4_shl(f[2], 12), _gm_i4_shl(f[3], 22)));
+    _gm_i4_store(out + i, c);
+  }
+#endif
+  for (; i < n; ++i)
+  {
+    out[i] = q32_from_qf(in[i]);
+  }
+}
+
+GM_CDECL void qf_from_q32_many(const uint32_t *in, quatf *out, size_t n)
+{
+  size_t i = 0;
+#if defined(GM_SIMD_SSE) || defined(GM_SIMD_NEON)
+  _gm_i4 mk = _gm_i4_set1(0x3ff);
+  for (; i + 4 <= n; i += 4)
+  {
+    _gm_i4 c    = _gm_i4_load(in + i);
+    _gm_i4 f[4] = {_gm_i4_and(c, _gm_i4_set1(3)),
+                   _gm_i4_and(_gm_i4_shr(c, 2), mk),
+                   _gm_i4_and(_gm_i4_shr(c, 12), mk), _gm_i4_shr(c, 22)};
+    _gm_q3_unpack4(f, 10, out + i);
+  }
+#endif
+  for (; i < n; ++i)
+  {
+    out[i] = qf_from_q32(in[i]);
+  }
+}
+
+// the 47-bit codes are split into a low word holding the index and the
+// first two fields and a high word with the third, quat48 is not 4-byte
+// aligned so both go through the stack
+GM_CDECL void q48_from_qf_many(const quatf *in, quat48 *out, size_t n)
+{
+  size_t i = 0;
+#if defined(GM_SIMD_SSE) || defined(GM_SIMD_NEON)
+  for (; i + 4 <= n; i += 4)
+  {
+    _gm_i4 f[4];
+    uint32_t lo[4], hi[4];
+    _gm_q3_pack4(in + i, 15, f);
+    _gm_i4 c = _gm_i4_or(f[0], _gm_i4_shl(f[1], 2));
+    _gm_i4_store(lo, _gm_i4_or(c, _gm_i4_shl(f[2], 17)));
+    _gm_i4_store(hi, f[3]);
+    for (size_t k = 0; k < 4; ++k)
+    {
+      out[i + k] = (quat48){
+        {(uint16_t) lo[k], (uint16_t) (lo[k] >> 16), (uint16_t) hi[k]}};
+    }
+  }
+#endif
+  for (; i < n; ++i)
+  {
+    out[i] = q48_from_qf(in[i]);
+  }
+}
+
+GM_CDECL void qf_from_q48_many(const quat48 *in, quatf *out, size_t n)
+{
+  size_t i = 0;
+#if defined(GM_SIMD_SSE) || defined(GM_SIMD_NEON)
+  _gm_i4 mk = _gm_i4_set1(0x7fff);
+  for (; i + 4 <= n; i += 4)
+  {
+    uint32_t lo[4], hi[4];
+    for (size_t k = 0; k < 4; ++k)
+    {
+      lo[k] = (uint32_t) in[i + k].a[0] | (uint32_t) in[i + k].a[1] << 16;
+      hi[k] = in[i + k].a[2];
+    }
+    _gm_i4 c    = _gm_i4_load(lo);
+    _gm_i4 f[4] = {_gm_i4_and(c, _gm_i4_set1(3)),
+                   _gm_i4_and(_gm_i4_shr(c, 2), mk), _gm_i4_shr(c, 17),
+                   _gm_i4_load(hi)};
+    _gm_q3_unpack4(f, 15, out + i);
+  }
+#endif
+  for (; i < n; ++i)
+  {
+    out[i] = qf_from_q48(in[i]);
+  }
+}
+
+// transform hierarchy with each node's local translation, rotation and
+// scale in component arrays, nodes are added parent first so a forward pass
+// sees every parent before its children
+// xformf_update only recomputes nodes that were set or touched and the
+// subtrees under them; zero-initialize an xformf before the first add
+
+#define GM_XFORM_ROOT UINT32_MAX
+// with openmp, update levels of at least this many dirty nodes run in
+// parallel, nodes on one level depend only on the level above
+#ifndef GM_XFORM_PARALLEL_MIN
+#define GM_XFORM_PARALLEL_MIN 1024
+#endif
+
+typedef struct
+{
+  vec3f *t;
+  quatf *r;
+  vec3f *s;
+  mat4f *world;
+  // GM_XFORM_ROOT for roots
+  uint32_t *parent;
+  uint32_t *depth;
+  byte *dirty;
+  // scratch for xformf_update, dirty nodes bucketed by depth
+  uint32_t *order;
+  uint32_t *levels;
+  size_t n;
+  size_t cap;
+  size_t nlevels;
+} xformf;
+
+GM_CDECL void xformf_free(xformf *x)
+{
+  _gm_free(x->t);
+  _gm_free(x->r);
+  _gm_free(x->s);
+  _gm_free(x->world);
+  _gm_free(x->parent);
+  _gm_free(x->depth);
+  _gm_free(x->dirty);
+  _gm_free(x->order);
+  _gm_free(x->levels);
+  *x = (xformf){0};
+}
+
+#define _GM_XFORM_GROW(F, T, C)                                                \
+  do                                                                           \
+  {                                                                            \
+    T *_p = (T *) _gm_realloc(x->F, (C) * sizeof(T));                          \
+    if (!_p)                                                                   \
+    {                                                                          \
+      return GM_XFORM_ROOT;                                                    \
+    }                                                                          \
+    x->F = _p;                                                                 \
+  } while (0)
+
+// the new node's index, or GM_XFORM_ROOT when parent is not an existing
+// node or allocation fails
+GM_CDECL uint32_t xformf_add(xformf *x, const uint32_t parent, const vec3f t,
+                             const quatf r, const vec3f s)
+{
+  if ((parent != GM_XFORM_ROOT && parent >= x->n) || x->n >= GM_XFORM_ROOT)
+  {
+    return GM_XFORM_ROOT;
+  }
+  uint32_t d = parent == GM_XFORM_ROOT ? 0 : x->depth[parent] + 1;
+  if (x->n == x->cap)
+  {
+    size_t c = x->cap ? 2 * x->cap : 64;
+    _GM_XFORM_GROW(t, vec3f, c);
+    _GM_XFORM_GROW(r, quatf, c);
+    _GM_XFORM_GROW(s, vec3f, c);
+    _GM_XFORM_GROW(world, mat4f, c);
+    _GM_XFORM_GROW(parent, uint32_t, c);
+    _GM_XFORM_GROW(depth, uint32_t, c);
+    _GM_XFORM_GROW(dirty, byte, c);
+    _GM_XFORM_GROW(order, uint32_t, c);
+    x->cap = c;
+  }
+  if (d + 1 > x->nlevels)
+  {
+    _GM_XFORM_GROW(levels, uint32_t, d + 2);
+    x->nlevels = d + 1;
+  }
+  uint32_t i   = (uint32_t) x->n++;
+  x->t[i]      = t;
+  x->r[i]      = r;
+  x->s[i]      = s;
+  x->world[i]  = m4f_ident;
+  x->parent[i] = parent;
+  x->depth[i]  = d;
+  x->dirty[i]  = 1;
+  return i;
+}
+
+#undef _GM_XFORM_GROW
+
+GM_CDECL void xformf_set(xformf *x, const uint32_t i, const vec3f t,
+                         const quatf r, const vec3f s)
+{
+  x->t[i]     = t;
+  x->r[i]     = r;
+  x->s[i]     = s;
+  x->dirty[i] = 1;
+}
+
+// after writing x->t, x->r or x->s directly
+GM_CDECL void xformf_touch(xformf *x, const uint32_t i)
+{
+  x->dirty[i] = 1;
+}
+
+// local matrices of up to eight nodes as t * r * s, lanes are gathered
+// into components so the arithmetic runs eight wide
+GM_CDECL void _gm_xformf_local8(xformf *x, const uint32_t *id, const size_t m)
+{
+  float q[4][8], t[3][8], s[3][8], a[12][8];
+  for (size_t i = 0; i < 8; ++i)
+  {
+    uint32_t j = id[i < m ? i : 0];
+    for (size_t k = 0; k < 4; ++k)
+    {
+      q[k][i] = x->r[j].a[k];
+    }
+    for (size_t k = 0; k < 3; ++k)
+    {
+      t[k][i] = x->t[j].a[k];
+      s[k][i] = x->s[j].a[k];
+    }
+  }
+  for (size_t i = 0; i < 8; ++i)
+  {
+    float xx = q[1][i] * q[1][i], yy = q[2][i] * q[2][i];
+    float zz = q[3][i] * q[3][i], xy = q[1][i] * q[2][i];
+    float xz = q[1][i] * q[3][i], yz = q[2][i] * q[3][i];
+    float wx = q[0][i] * q[1][i], wy = q[0][i] * q[2][i];
+    float wz = q[0][i] * q[3][i];
+    a[0][i]  = (1 - 2 * (yy + zz)) * s[0][i];
+    a[1][i]  = 2 * (xy - wz) * s[1][i];
+    a[2][i]  = 2 * (xz + wy) * s[2][i];
+    a[3][i]  = t[0][i];
+    a[4][i]  = 2 * (xy + wz) * s[0][i];
+    a[5][i]  = (1 - 2 * (xx + zz)) * s[1][i];
+    a[6][i]  = 2 * (yz - wx) * s[2][i];
+    a[7][i]  = t[1][i];
+    a[8][i]  = 2 * (xz - wy) * s[0][i];
+    a[9][i]  = 2 * (yz + wx) * s[1][i];
+    a[10][i] = (1 - 2 * (xx + yy)) * s[2][i];
+    a[11][i] = t[2][i];
+  }
+  for (size_t i = 0; i < m; ++i)
+  {
+    mat4f *w = x->world + id[i];
+    for (size_t k = 0; k < 12; ++k)
+    {
+      w->a[k] = a[k][i];
+    }
+    w->a[12] = 0;
+    w->a[13] = 0;
+    w->a[14] = 0;
+    w->a[15] = 1;
+  }
+}
+
+// recomputes the world matrices of dirty nodes and their descendants,
+// returning how many were recomputed
+GM_CDECL size_t xformf_update(xformf *x)
+{
+  if (x->n == 0)
+  {
+    return 0;
+  }
+  uint32_t *lv = x->levels;
+  for (size_t d = 0; d <= x->nlevels; ++d)
+  {
+    lv[d] = 0;
+  }
+  for (size_t i = 0; i < x->n; ++i)
+  {
+    uint32_t p = x->parent[i];
+    x->dirty[i] |= p != GM_XFORM_ROOT && x->dirty[p];
+    lv[x->depth[i] + 1] += x->dirty[i];
+  }
+  for (size_t d = 1; d <= x->nlevels; ++d)
+  {
+    lv[d] += lv[d - 1];
+  }
+  // counting sort by depth, leaving lv[d] at the end of level d
+  for (size_t i = 0; i < x->n; ++i)
+  {
+    if (x->dirty[i])
+    {
+      x->order[lv[x->depth[i]]++] = (uint32_t) i;
+    }
+  }
+  size_t m   = lv[x->nlevels - 1];
+  long nb    = (long) ((m + 7) / 8);
+  bool multi = m >= GM_XFORM_PARALLEL_MIN;
+  (void) multi;
+#ifdef _OPENMP
+#pragma omp parallel for if (multi)
+#endif
+  for (long b = 0; b < nb; ++b)
+  {
+    size_t lo = (size_t) b * 8;
+    _gm_xformf_local8(x, x->order + lo, m - lo < 8 ? m - lo : 8);
+  }
+  for (size_t d = 1; d < x->nlevels; ++d)
+  {
+    long lo = (long) lv[d - 1], hi = (long) lv[d];
+    multi   = hi - lo >= GM_XFORM_PARALLEL_MIN;
+#ifdef _OPENMP
+#pragma omp parallel for if (multi)
+#endif
+    for (long k = lo; k < hi; ++k)
+    {
+      uint32_t i  = x->order[k];
+      x->world[i] = m4f_mul(x->world[i], x->world[x->parent[i]]);
+    }
+  }
+  for (size_t k = 0; k < m; ++k)
+  {
+    x->dirty[x->order[k]] = 0;
+  }
+  return m;
+}
+
+// piecewise cubic splines, p(t) = [t^3 t^2 t 1] * basis * controls for the
+// four controls of a segment
+// segments advance by stride controls: 1 for catmull-rom and b-splines, 3
+// for bezier curves, 2 for hermite curves with points and tangents
+// interleaved; u runs from 0 to the segment count, clamped at both ends
+
+typedef struct
+{
+  mat4f basis;
+  size_t stride;
+} splinef;
+
+GM_CDECL splinef splinef_catmull(void)
+{
+  return (splinef){m4f_catmull, 1};
+}
+
+GM_CDECL splinef splinef_bezier(void)
+{
+  return (splinef){m4f_bezier, 3};
+}
+
+GM_CDECL splinef splinef_bspline(void)
+{
+  return (splinef){m4f_bspline, 1};
+}
+
+GM_CDECL splinef splinef_hermite(void)
+{
+  return (splinef){m4f_hermite, 2};
+}
+
+GM_CDECL size_t splinef_segments(const splinef *s, const size_t n)
+{
+  return n < 4 ? 0 : (n - 4) / s->stride + 1;
+}
+
+// control weights at t, and their derivative in t
+GM_CDECL vec4f splinef_weights(const mat4f b, const float t)
+{
+  float p[4] = {t * t * t, t * t, t, 1};
+  vec4f w;
+  for (size_t j = 0; j < 4; ++j)
+  {
+    w.a[j] = p[0] * b.a[j] + p[1] * b.a[4 + j] + p[2] * b.a[8 + j] +
+             p[3] * b.a[12 + j];
+  }
+  return w;
+}
+
+GM_CDECL vec4f splinef_dweights(const mat4f b, const float t)
+{
+  float p[3] = {3 * t * t, 2 * t, 1};
+  vec4f w;
+  for (size_t j = 0; j < 4; ++j)
+  {
+    w.a[j] = p[0] * b.a[j] + p[1] * b.a[4 + j] + p[2] * b.a[8 + j];
+  }
+  return w;
+}
+
+// the first control of u's segment and the parameter within it
+GM_CDECL size_t _gm_splinef_locate(const splinef *s, const size_t n,
+                                   const float u, float *t)
+{
+  size_t m = splinef_segments(s, n);
+  float c  = u < 0 ? 0 : (u > (float) m ? (float) m : u);
+  size_t i = (size_t) c;
+  i        = i < m ? i : m - 1;
+  *t       = c - (float) i;
+  return i * s->stride;
+}
+
+// up to c parameters located at once, lanes past c repeat the first
+GM_CDECL float_x8 _gm_splinef_locate8(const splinef *s, const size_t n,
+                                      const float *u, const size_t c,
+                                      size_t *at)
+{
+  float_x8 t;
+  for (size_t j = 0; j < 8; ++j)
+  {
+    at[j] = _gm_splinef_locate(s, n, u[j < c ? j : 0], t.a + j);
+  }
+  return t;
+}
+
+// splinef_weights for eight parameters, w[k] weighs control k
+GM_CDECL void _gm_splinef_weights8(const mat4f b, const float_x8 t,
+                                   float_x8 *w)
+{
+  float_x8 t2 = f_x8_mul(t, t), t3 = f_x8_mul(t2, t);
+  for (size_t k = 0; k < 4; ++k)
+  {
+    float_x8 v = f_x8_madd(t, f_x8_set1(b.a[8 + k]), f_x8_set1(b.a[12 + k]));
+    v          = f_x8_madd(t2, f_x8_set1(b.a[4 + k]), v);
+    w[k]       = f_x8_madd(t3, f_x8_set1(b.a[k]), v);
+  }
+}
+
+// cumulative chord length at evenly spaced u, for sampling at constant speed
+// zero-initialize an arclenf before the first build
+typedef struct
+{
+  float *s;
+  size_t n;
+  // the segment count, u of sample i is i * segments / (n - 1)
+  float segments;
+} arclenf;
+
+GM_CDECL void arclenf_free(arclenf *a)
+{
+  _gm_free(a->s);
+  *a = (arclenf){0};
+}
+
+#define GM_SPLINE_OP(TYPENAME, SHORTNAME, XTYPENAME, XSHORTNAME, N)            \
+  GM_CDECL TYPENAME _gm_##SHORTNAME##_spline_w(                                \
+    const TYPENAME *p, const vec4f w)                                          \
+  {                                                                            \
+    TYPENAME v;                                                                \
+    for (size_t k = 0; k < N; ++k)                                             \
+    {                                                                          \
+      v.a[k] = w.a[0] * p[0].a[k] + w.a[1] * p[1].a[k] +                       \
+               w.a[2] * p[2].a[k] + w.a[3] * p[3].a[k];                        \
+    }                                                                          \
+    return v;                                                                  \
+  }                                                                            \
+  /* n must be at least 4 */                                                   \
+  GM_CDECL TYPENAME SHORTNAME##_spline(const splinef *s, const TYPENAME *p,    \
+                                       const size_t n, const float u)          \
+  {                                                                            \
+    float t;                                                                   \
+    size_t i = _gm_splinef_locate(s, n, u, &t);                                \
+    return _gm_##SHORTNAME##_spline_w(p + i, splinef_weights(s->basis, t));    \
+  }                                                                            \
+  /* d/du, the tangent scaled by the segment's speed */                        \
+  GM_CDECL TYPENAME SHORTNAME##_spline_deriv(                                  \
+    const splinef *s, const TYPENAME *p, const size_t n, const float u)        \
+  {                                                                            \
+    float t;                                                                   \
+    size_t i = _gm_splinef_locate(s, n, u, &t);                                \
+    return _gm_##SHORTNAME##_spline_w(p + i, splinef_dweights(s->basis, t));   \
+  }                                                                            \
+  /* eight parameters per step through the float_x8 operators */               \
+  GM_CDECL void SHORTNAME##_spline_many(const splinef *s, const TYPENAME *p,   \
+                                        const size_t n, const float *u,        \
+                                        TYPENAME *out, const size_t m)         \
+  {                                                                            \
+    for (size_t i = 0; i < m; i += 8)                                          \
+    {                                                                          \
+      size_t c = m - i < 8 ? m - i : 8, at[8];                                 \
+      float_x8 w[4];                                                           \
+      _gm_splinef_weights8(s->basis,                                           \
+                           _gm_splinef_locate8(s, n, u + i, c, at), w);        \
+      XTYPENAME v;                                                             \
+      for (size_t j = 0; j < 4; ++j)                                           \
+      {                                                                        \
+        TYPENAME g[8];                                                         \
+        for (size_t l = 0; l < 8; ++l)                                         \
+        {                                                                      \
+          g[l] = p[at[l] + j];                                                 \
+        }                                                                      \
+        XTYPENAME x = XSHORTNAME##_pack(g, 8);                                 \
+        for (size_t k = 0; k < N; ++k)                                         \
+        {                                                                      \
+          v.a[k] = j == 0 ? f_x8_mul(w[0], x.a[k])                             \
+                          : f_x8_madd(w[j], x.a[k], v.a[k]);                   \
+        }                                                                      \
+      }                                                                        \
+      XSHORTNAME##_unpack(v, out + i, c);                                      \
+    }                                                                          \
+  }                                                                            \
+  /* samples is clamped to at least 2, false when allocation fails or the */   \
+  /* curve has no segments */                                                  \
+  GM_CDECL bool SHORTNAME##_arclen_build(arclenf *a, const splinef *s,         \
+                                         const TYPENAME *p, const size_t n,    \
+                                         size_t samples)                       \
+  {                                                                            \
+    size_t m = splinef_segments(s, n);                                         \
+    samples  = samples < 2 ? 2 : samples;                                      \
+    if (m == 0)                                                                \
+    {                                                                          \
+      return false;                                                            \
+    }                                                                          \
+    float *d = (float *) _gm_realloc(a->s, samples * sizeof(float));           \
+    if (!d)                                                                    \
+    {                                                                          \
+      return false;                                                            \
+    }                                                                          \
+    a->s        = d;                                                           \
+    a->n        = samples;                                                     \
+    a->segments = (float) m;                                                   \
+    float *u    = (float *) _gm_malloc(samples * sizeof(float));               \
+    TYPENAME *q = (TYPENAME *) _gm_malloc(samples * sizeof(TYPENAME));         \
+    if (!u || !q)                                                              \
+    {                                                                          \
+      _gm_free(u);                                                             \
+      _gm_free(q);                                                             \
+      return false;                                                            \
+    }                                                                          \
+    for (size_t i = 0; i < samples; ++i)                                       \
+    {                                                                          \
+      u[i] = (float) m * (float) i / (float) (samples - 1);                    \
+    }                                                                          \
+    SHORTNAME##_spline_many(s, p, n, u, q, samples);                           \
+    d[0] = 0;                                                                  \
+    for (size_t i = 1; i < samples; ++i)                                       \
+    {                                                                          \
+      d[i] = d[i - 1] + SHORTNAME##_distance(q[i - 1], q[i]);                  \
+    }                                                                          \
+    _gm_free(u);                                                               \
+    _gm_free(q);                                                               \
+    return true;                                                               \
+  }
+
+GM_SPLINE_OP(vec2f, v2f, vec2f_x8, v2f_x8, 2);
+GM_SPLINE_OP(vec3f, v3f, vec3f_x8, v3f_x8, 3);
+
+#undef GM_SPLINE_OP
+
+// a normalized blend of the four rotations, each flipped into the
+// hemisphere of the one before so the curve takes the short way round
+GM_CDECL quatf qf_spline(const splinef *s, const quatf *p, const size_t n,
+                         const float u)
+{
+  float t;
+  size_t i = _gm_splinef_locate(s, n, u, &t);
+  quatf q[4];
+  q[0] = p[i];
+  for (size_t k = 1; k < 4; ++k)
+  {
+    q[k] = qf_dot(q[k - 1], p[i + k]) < 0 ? qf_smul(p[i + k], -1) : p[i + k];
+  }
+  vec4f w = splinef_weights(s->basis, t);
+  quatf v = qf_zero;
+  for (size_t k = 0; k < 4; ++k)
+  {
+    v = qf_add(v, qf_smul(q[k], w.a[k]));
+  }
+  return qf_normalize(v);
+}
+
+GM_CDECL void qf_spline_many(const splinef *s, const quatf *p, const size_t n,
+                             const float *u, quatf *out, const size_t m)
+{
+  float_x8 zero = f_x8_set1(0), one = f_x8_set1(1), neg = f_x8_set1(-1);
+  for (size_t i = 0; i < m; i += 8)
+  {
+    size_t c = m - i < 8 ? m - i : 8, at[8];
+    float_x8 w[4];
+    _gm_splinef_weights8(s->basis, _gm_splinef_locate8(s, n, u + i, c, at),
+                         w);
+    quatf_x8 q, v;
+    for (size_t j = 0; j < 4; ++j)
+    {
+      quatf g[8];
+      for (size_t l = 0; l < 8; ++l)
+      {
+        g[l] = p[at[l] + j];
+      }
+      quatf_x8 x = qf_x8_pack(g, 8);
+      if (j > 0)
+      {
+        float_x8 f = f_x8_ltsel(qf_x8_dot(q, x), zero, neg, one);
+        for (size_t k = 0; k < 4; ++k)
+        {
+          x.a[k] = f_x8_mul(x.a[k], f);
+        }
+      }
+      for (size_t k = 0; k < 4; ++k)
+      {
+        v.a[k] = j == 0 ? f_x8_mul(w[0], x.a[k])
+                        : f_x8_madd(w[j], x.a[k], v.a[k]);
+      }
+      q = x;
+    }
+    qf_x8_unpack(qf_x8_normalize(v), out + i, c);
+  }
+}
+
+GM_CDECL float arclenf_length(const arclenf *a)
+{
+  return a->s[a->n - 1];
+}
+
+// the u at distance d along the curve, by binary search and a linear step
+// between samples, d is clamped to [0, length]
+GM_CDECL float arclenf_param(const arclenf *a, const float d)
+{
+  size_t lo = 0, hi = a->n - 1;
+  if (d <= 0)
+  {
+    return 0;
+  }
+  if (d >= a->s[hi])
+  {
+    return a->segments;
+  }
+  while (hi - lo > 1)
+  {
+    size_t mid = (lo + hi) / 2;
+    if (a->s[mid] <= d)
+    {
+      lo = mid;
+    }
+    else
+    {
+      hi = mid;
+    }
+  }
+  float span = a->s[hi] - a->s[lo];
+  float f    = span > 0 ? (d - a->s[lo]) / span : 0;
+  return ((float) lo + f) * a->segments / (float) (a->n - 1);
+}
+
+GM_CDECL void arclenf_params(const arclenf *a, const float *d, float *u,
+                             const size_t m)
+{
+  for (size_t i = 0; i < m; ++i)
+  {
+    u[i] = arclenf_param(a, d[i]);
+  }
+}
+
+// counter-based random numbers, philox 4x32-10 of salmon et al.: the n-th
+// block of a stream is a pure function of (seed, stream, n), so streams
+// are reproducible, independent and can be skipped ahead freely
+// array fills draw eight blocks per step, the rounds run on integer lanes
+
+typedef struct
+{
+  uint32_t key[2];
+  uint32_t stream[2];
+  // the next block
+  uint64_t counter;
+} rngf;
+
+GM_CDECL rngf rngf_new(const uint64_t seed, const uint64_t stream)
+{
+  return (rngf){{(uint32_t) seed, (uint32_t) (seed >> 32)},
+                {(uint32_t) stream, (uint32_t) (stream >> 32)},
+                0};
+}
+
+// the ten rounds on one block, in place
+GM_CDECL void _gm_philox(uint32_t c[4], uint32_t k0, uint32_t k1)
+{
+  for (size_t round = 0; round < 10; ++round)
+  {
+    uint64_t p0 = (uint64_t) 0xd2511f53u * c[0];
+    uint64_t p1 = (uint64_t) 0xcd9e8d57u * c[2];
+    uint32_t n0 = (uint32_t) (p1 >> 32) ^ c[1] ^ k0;
+    uint32_t n2 = (uint32_t) (p0 >> 32) ^ c[3] ^ k1;
+    c[1]        = (uint32_t) p1;
+    c[3]        = (uint32_t) p0;
+    c[0]        = n0;
+    c[2]        = n2;
+    k0 += 0x9e3779b9u;
+    k1 += 0xbb67ae85u;
+  }
+}
+
+#if defined(GM_SIMD_SSE) || defined(GM_SIMD_NEON)
+// _gm_philox on four blocks, one per lane
+GM_CDECL void _gm_philox4(_gm_i4 c[4], uint32_t k0, uint32_t k1)
+{
+  for (size_t round = 0; round < 10; ++round)
+  {
+    _gm_i4 h0, h1;
+    _gm_i4 l0 = _gm_i4_mulx(c[0], 0xd2511f53u, &h0);
+    _gm_i4 l1 = _gm_i4_mulx(c[2], 0xcd9e8d57u, &h1);
+    c[0]      = _gm_i4_xor(_gm_i4_xor(h1, c[1]), _gm_i4_set1(k0));
+    c[2]      = _gm_i4_xor(_gm_i4_xor(h0, c[3]), _gm_i4_set1(k1));
+    c[1]      = l1;
+    c[3]      = l0;
+    k0 += 0x9e3779b9u;
+    k1 += 0xbb67ae85u;
+  }
+}
+#endif
+
+// eight consecutive blocks from the counter, 32 words lane-major
+GM_CDECL void _gm_philox8(rngf *r, uint32_t out[4][8])
+{
+  for (size_t i = 0; i < 8; ++i)
+  {
+    uint64_t n = r->counter + i;
+    out[0][i]  = (uint32_t) n;
+    out[1][i]  = (uint32_t) (n >> 32);
+    out[2][i]  = r->stream[0];
+    out[3][i]  = r->stream[1];
+  }
+  size_t i = 0;
+#if defined(GM_SIMD_SSE) || defined(GM_SIMD_NEON)
+  for (; i < 8; i += 4)
+  {
+    _gm_i4 c[4];
+    for (size_t k = 0; k < 4; ++k)
+    {
+      c[k] = _gm_i4_load(out[k] + i);
+    }
+    _gm_philox4(c, r->key[0], r->key[1]);
+    for (size_t k = 0; k < 4; ++k)
+    {
+      _gm_i4_store(out[k] + i, c[k]);
+    }
+  }
+#endif
+  for (; i < 8; ++i)
+  {
+    uint32_t c[4] = {out[0][i], out[1][i], out[2][i], out[3][i]};
+    _gm_philox(c, r->key[0], r->key[1]);
+    for (size_t k = 0; k < 4; ++k)
+    {
+      out[k][i] = c[k];
+    }
+  }
+  r->counter += 8;
+}
+
+// every call starts on a fresh block, so a fill of n words always uses
+// ceil(n / 4) blocks whatever was drawn before
+GM_CDECL void rngf_u32_many(rngf *r, uint32_t *out, const size_t n)
+{
+  uint32_t w[4][8];
+  for (size_t i = 0; i < n; i += 32)
+  {
+    uint64_t c = r->counter;
+    _gm_philox8(r, w);
+    size_t m = n - i < 32 ? n - i : 32;
+    for (size_t j = 0; j < m; ++j)
+    {
+      out[i + j] = w[j % 4][j / 4];
+    }
+    r->counter = c + (m + 3) / 4;
+  }
+}
+
+// uniform in [0, 1), 24 bits each
+GM_CDECL void rngf_float_many(rngf *r, float *out, const size_t n)
+{
+  uint32_t u[256];
+  for (size_t i = 0; i < n; i += 256)
+  {
+    size_t m = n - i < 256 ? n - i : 256;
+    rngf_u32_many(r, u, m);
+    for (size_t j = 0; j < m; ++j)
+    {
+      out[i + j] = (float) (u[j] >> 8) * 5.96046448e-8f;
+    }
+  }
+}
+
+GM_CDECL uint32_t rngf_u32(rngf *r)
+{
+  uint32_t u;
+  rngf_u32_many(r, &u, 1);
+  return u;
+}
+
+GM_CDECL float rngf_float(rngf *r)
+{
+  float f;
+  rngf_float_many(r, &f, 1);
+  return f;
+}
+
+// the fills below draw their uniforms in chunks and transform them eight
+// lanes at a time
+#define GM_RNG_CHUNK 64
+
+GM_CDECL void rngf_v2f_box(rngf *r, const vec2f min, const vec2f max,
+                           vec2f *out, const size_t n)
+{
+  rngf_float_many(r, out->a, 2 * n);
+  for (size_t i = 0; i < n; ++i)
+  {
+    out[i].x = min.x + (max.x - min.x) * out[i].x;
+    out[i].y = min.y + (max.y - min.y) * out[i].y;
+  }
+}
+
+GM_CDECL void rngf_v3f_box(rngf *r, const vec3f min, const vec3f max,
+                           vec3f *out, const size_t n)
+{
+  rngf_float_many(r, out->a, 3 * n);
+  for (size_t i = 0; i < n; ++i)
+  {
+    out[i].x = min.x + (max.x - min.x) * out[i].x;
+    out[i].y = min.y + (max.y - min.y) * out[i].y;
+    out[i].z = min.z + (max.z - min.z) * out[i].z;
+  }
+}
+
+// uniform over the unit disk by area
+GM_CDECL void rngf_v2f_disk(rngf *r, vec2f *out, const size_t n)
+{
+  rngf_float_many(r, out->a, 2 * n);
+  for (size_t i = 0; i < n; ++i)
+  {
+    float s, c, d = sqrtf(out[i].x);
+    fast_sincosf(6.28318531f * out[i].y, &s, &c);
+    out[i] = v2f(d * c, d * s);
+  }
+}
+
+// uniform on the unit sphere, by archimedes' z and a uniform longitude
+GM_CDECL void rngf_v3f_sphere(rngf *r, vec3f *out, const size_t n)
+{
+  float u[2 * GM_RNG_CHUNK];
+  for (size_t i = 0; i < n; i += GM_RNG_CHUNK)
+  {
+    size_t m = n - i < GM_RNG_CHUNK ? n - i : GM_RNG_CHUNK;
+    rngf_float_many(r, u, 2 * m);
+    for (size_t j = 0; j < m; ++j)
+    {
+      float z = 1 - 2 * u[2 * j], s, c;
+      float d = sqrtf(1 - z * z > 0 ? 1 - z * z : 0);
+      fast_sincosf(6.28318531f * u[2 * j + 1], &s, &c);
+      out[i + j] = v3f(d * c, d * s, z);
+    }
+  }
+}
+
+// uniform over rotations, shoemake's subgroup algorithm
+GM_CDECL void rngf_qf_uniform(rngf *r, quatf *out, const size_t n)
+{
+  rngf_float_many(r, out->a, 4 * n);
+  for (size_t i = 0; i < n; ++i)
+  {
+    float u0 = out[i].a[0], s1, c1, s2, c2;
+    float a  = sqrtf(1 - u0), b = sqrtf(u0);
+    fast_sincosf(6.28318531f * out[i].a[1], &s1, &c1);
+    fast_sincosf(6.28318531f * out[i].a[2], &s2, &c2);
+    out[i] = (quatf){{b * c2, a * s1, a * c1, b * s2}};
+  }
+}
+
+#undef GM_RNG_CHUNK
+
+// gradient noise after perlin's improved noise, with lattice gradients
+// picked by an integer hash of the cell and seed rather than a permutation
+// table so each lane computes independently; zero on lattice points and
+// roughly within [-1, 1]
+
+GM_CDECL uint32_t _gm_noise_hash(uint32_t h)
+{
+  h ^= h >> 16;
+  h *= 0x7feb352du;
+  h ^= h >> 15;
+  h *= 0x846ca68bu;
+  h ^= h >> 16;
+  return h;
+}
+
+// floor for the lattice cell, written to vectorize where floorf may not
+GM_CDECL int32_t _gm_noise_floor(const float x)
+{
+  int32_t i = (int32_t) x;
+  return i - (x < (float) i);
+}
+
+GM_CDECL float _gm_noise_fade(const float t)
+{
+  return t * t * t * (t * (t * 6 - 15) + 10);
+}
+
+GM_CDECL float _gm_perlin2(const float px, const float py, const uint32_t seed)
+{
+  int32_t ix = _gm_noise_floor(px), iy = _gm_noise_floor(py);
+  float fx = px - (float) ix, fy = py - (float) iy;
+  float g[4];
+  for (uint32_t c = 0; c < 4; ++c)
+  {
+    uint32_t cx = c & 1, cy = c >> 1;
+    uint32_t h  = _gm_noise_hash(((uint32_t) ix + cx) * 0x8da6b343u ^
+                                 ((uint32_t) iy + cy) * 0xd8163841u ^ seed);
+    float x = fx - (float) cx, y = fy - (float) cy;
+    // four diagonals and four axes
+    float d = ((h & 1) ? -x : x) + ((h & 2) ? -y : y);
+    float a = (h & 2) ? ((h & 1) ? -y : y) : ((h & 1) ? -x : x);
+    g[c]    = (h & 4) ? a : 0.7071f * d;
+  }
+  float u = _gm_noise_fade(fx), w = _gm_noise_fade(fy);
+  float a = g[0] + u * (g[1] - g[0]), b = g[2] + u * (g[3] - g[2]);
+  return 1.4142f * (a + w * (b - a));
+}
+
+GM_CDECL float _gm_perlin3(const float px, const float py, const float pz,
+                           const uint32_t seed)
+{
+  int32_t ix = _gm_noise_floor(px), iy = _gm_noise_floor(py);
+  int32_t iz = _gm_noise_floor(pz);
+  float fx = px - (float) ix, fy = py - (float) iy, fz = pz - (float) iz;
+  float g[8];
+  for (uint32_t c = 0; c < 8; ++c)
+  {
+    uint32_t cx = c & 1, cy = (c >> 1) & 1, cz = c >> 2;
+    uint32_t h  = _gm_noise_hash(((uint32_t) ix + cx) * 0x8da6b343u ^
+                                 ((uint32_t) iy + cy) * 0xd8163841u ^
+                                 ((uint32_t) iz + cz) * 0xcb1ab31fu ^ seed);
+    float x = fx - (float) cx, y = fy - (float) cy, z = fz - (float) cz;
+    // perlin's twelve cube edge directions, four of them repeated
+    h &= 15;
+    float a = h < 8 ? x : y;
+    float b = h < 4 ? y : (h == 12 || h == 14 ? x : z);
+    g[c]    = ((h & 1) ? -a : a) + ((h & 2) ? -b : b);
+  }
+  float u = _gm_noise_fade(fx), w = _gm_noise_fade(fy);
+  float t = _gm_noise_fade(fz);
+  for (size_t k = 0; k < 4; ++k)
+  {
+    g[k] = g[2 * k] + u * (g[2 * k + 1] - g[2 * k]);
+  }
+  float a = g[0] + w * (g[1] - g[0]), b = g[2] + w * (g[3] - g[2]);
+  return a + t * (b - a);
+}
+
+static const uint32_t _gm_noise_m[4] = {0x8da6b343u, 0xd8163841u, 0xcb1ab31fu,
+                                        0x165667b1u};
+
+GM_CDECL float _gm_perlin4(const float *p, const uint32_t seed)
+{
+  int32_t ip[4];
+  float f[4], s[4], g[16];
+  for (size_t k = 0; k < 4; ++k)
+  {
+    ip[k] = _gm_noise_floor(p[k]);
+    f[k]  = p[k] - (float) ip[k];
+    s[k]  = _gm_noise_fade(f[k]);
+  }
+  for (uint32_t c = 0; c < 16; ++c)
+  {
+    uint32_t h = seed;
+    float d[4];
+    for (uint32_t k = 0; k < 4; ++k)
+    {
+      uint32_t ck = (c >> k) & 1;
+      h ^= ((uint32_t) ip[k] + ck) * _gm_noise_m[k];
+      d[k] = f[k] - (float) ck;
+    }
+    h = _gm_noise_hash(h);
+    // the 32 edges of the tesseract, one axis dropped and three signs
+    uint32_t z = (h >> 3) & 3;
+    float a    = z == 0 ? d[1] : d[0];
+    float b    = z <= 1 ? d[2] : d[1];
+    float e    = z <= 2 ? d[3] : d[2];
+    g[c] = ((h & 1) ? -a : a) + ((h & 2) ? -b : b) + ((h & 4) ? -e : e);
+  }
+  for (size_t k = 0, w = 16; k < 4; ++k, w /= 2)
+  {
+    for (size_t j = 0; j < w / 2; ++j)
+    {
+      g[j] = g[2 * j] + s[k] * (g[2 * j + 1] - g[2 * j]);
+    }
+  }
+  return 0.8f * g[0];
+}
+
+#if defined(GM_SIMD_SSE) || defined(GM_SIMD_NEON)
+// the scalar noise helpers on four lanes; the gradients are chosen by
+// selects on the hash bits and their signs flipped with xor
+
+GM_CDECL _gm_i4 _gm_noise_hash4(_gm_i4 h)
+{
+  h = _gm_i4_xor(h, _gm_i4_shr(h, 16));
+  h = _gm_i4_mullo(h, 0x7feb352du);
+  h = _gm_i4_xor(h, _gm_i4_shr(h, 15));
+  h = _gm_i4_mullo(h, 0x846ca68bu);
+  return _gm_i4_xor(h, _gm_i4_shr(h, 16));
+}
+
+// the lattice cell of each lane, with the offset into it in *f
+GM_CDECL _gm_i4 _gm_noise_cell4(const _gm_f4 x, _gm_f4 *f)
+{
+  _gm_f4 t = _gm_f4_from_i4(_gm_i4_from_f4(x));
+  _gm_f4 m = _gm_f4_and(_gm_f4_lt(x, t), _gm_f4_set1(1));
+  t        = _gm_f4_sub(t, m);
+  *f       = _gm_f4_sub(x, t);
+  return _gm_i4_from_f4(t);
+}
+
+GM_CDECL _gm_f4 _gm_noise_fade4(const _gm_f4 t)
+{
+  _gm_f4 p = _gm_f4_madd(t, _gm_f4_set1(6), _gm_f4_set1(-15));
+  p        = _gm_f4_madd(t, p, _gm_f4_set1(10));
+  return _gm_f4_mul(_gm_f4_mul(_gm_f4_mul(t, t), t), p);
+}
+
+GM_CDECL _gm_f4 _gm_noise_lerp4(const _gm_f4 a, const _gm_f4 b,
+                                const _gm_f4 t)
+{
+  return _gm_f4_madd(t, _gm_f4_sub(b, a), a);
+}
+
+// mask of the lanes with bit b of h set
+GM_CDECL _gm_f4 _gm_noise_bit4(const _gm_i4 h, const uint32_t b)
+{
+  _gm_i4 m = _gm_i4_set1(1u << b);
+  return _gm_i4_eq(_gm_i4_and(h, m), m);
+}
+
+// v negated in the lanes with bit b of h set
+GM_CDECL _gm_f4 _gm_noise_sign4(const _gm_f4 v, const _gm_i4 h,
+                                const uint32_t b)
+{
+  return _gm_f4_signxor(
+    v, _gm_i4_and(_gm_i4_shl(h, 31 - b), _gm_i4_set1(0x80000000u)));
+}
+
+// the hash of corner c of the cells at ip, bit k of c offsets axis k
+GM_CDECL _gm_i4 _gm_noise_corner4(const _gm_i4 *ip, const size_t n,
+                                  const uint32_t c, const uint32_t seed)
+{
+  _gm_i4 h = _gm_i4_set1(seed);
+  for (size_t k = 0; k < n; ++k)
+  {
+    _gm_i4 i = _gm_i4_add(ip[k], _gm_i4_set1((c >> k) & 1));
+    h        = _gm_i4_xor(h, _gm_i4_mullo(i, _gm_noise_m[k]));
+  }
+  return _gm_noise_hash4(h);
+}
+
+GM_CDECL _gm_f4 _gm_perlin2_f4(const _gm_f4 px, const _gm_f4 py,
+                               const uint32_t seed)
+{
+  _gm_f4 fx, fy;
+  _gm_i4 ip[2] = {_gm_noise_cell4(px, &fx), _gm_noise_cell4(py, &fy)};
+  _gm_f4 g[4];
+  for (uint32_t c = 0; c < 4; ++c)
+  {
+    _gm_i4 h = _gm_noise_corner4(ip, 2, c, seed);
+    _gm_f4 x = _gm_f4_sub(fx, _gm_f4_set1((float) (c & 1)));
+    _gm_f4 y = _gm_f4_sub(fy, _gm_f4_set1((float) (c >> 1)));
+    _gm_f4 d = _gm_f4_add(_gm_noise_sign4(x, h, 0), _gm_noise_sign4(y, h, 1));
+    _gm_f4 a =
+      _gm_noise_sign4(_gm_f4_select(_gm_noise_bit4(h, 1), y, x), h, 0);
+    g[c] = _gm_f4_select(_gm_noise_bit4(h, 2), a,
+                         _gm_f4_mul(_gm_f4_set1(0.7071f), d));
+  }
+  _gm_f4 u = _gm_noise_fade4(fx), w = _gm_noise_fade4(fy);
+  _gm_f4 a = _gm_noise_lerp4(g[0], g[1], u), b = _gm_noise_lerp4(g[2], g[3], u);
+  return _gm_f4_mul(_gm_f4_set1(1.4142f), _gm_noise_lerp4(a, b, w));
+}
+
+GM_CDECL _gm_f4 _gm_perlin3_f4(const _gm_f4 px, const _gm_f4 py,
+                               const _gm_f4 pz, const uint32_t seed)
+{
+  _gm_f4 fx, fy, fz;
+  _gm_i4 ip[3] = {_gm_noise_cell4(px, &fx), _gm_noise_cell4(py, &fy),
+                  _gm_noise_cell4(pz, &fz)};
+  _gm_f4 g[8];
+  for (uint32_t c = 0; c < 8; ++c)
+  {
+    _gm_i4 h = _gm_i4_and(_gm_noise_corner4(ip, 3, c, seed), _gm_i4_set1(15));
+    _gm_f4 x = _gm_f4_sub(fx, _gm_f4_set1((float) (c & 1)));
+    _gm_f4 y = _gm_f4_sub(fy, _gm_f4_set1((float) ((c >> 1) & 1)));
+    _gm_f4 z = _gm_f4_sub(fz, _gm_f4_set1((float) (c >> 2)));
+    _gm_f4 a = _gm_f4_select(_gm_i4_lt(h, _gm_i4_set1(8)), x, y);
+    _gm_f4 e = _gm_f4_or(_gm_i4_eq(h, _gm_i4_set1(12)),
+                         _gm_i4_eq(h, _gm_i4_set1(14)));
+    _gm_f4 b = _gm_f4_select(_gm_i4_lt(h, _gm_i4_set1(4)), y,
+                             _gm_f4_select(e, x, z));
+    g[c] = _gm_f4_add(_gm_noise_sign4(a, h, 0), _gm_noise_sign4(b, h, 1));
+  }
+  _gm_f4 u = _gm_noise_fade4(fx), w = _gm_noise_fade4(fy);
+  _gm_f4 t = _gm_noise_fade4(fz);
+  for (size_t k = 0; k < 4; ++k)
+  {
+    g[k] = _gm_noise_lerp4(g[2 * k], g[2 * k + 1], u);
+  }
+  _gm_f4 a = _gm_noise_lerp4(g[0], g[1], w), b = _gm_noise_lerp4(g[2], g[3], w);
+  return _gm_noise_lerp4(a, b, t);
+}
+
+GM_CDECL _gm_f4 _gm_perlin4_f4(const _gm_f4 *p, const uint32_t seed)
+{
+  _gm_i4 ip[4];
+  _gm_f4 f[4], s[4], g[16];
+  for (size_t k = 0; k < 4; ++k)
+  {
+    ip[k] = _gm_noise_cell4(p[k], f + k);
+    s[k]  = _gm_noise_fade4(f[k]);
+  }
+  for (uint32_t c = 0; c < 16; ++c)
+  {
+    _gm_i4 h = _gm_noise_corner4(ip, 4, c, seed);
+    _gm_f4 d[4];
+    for (uint32_t k = 0; k < 4; ++k)
+    {
+      d[k] = _gm_f4_sub(f[k], _gm_f4_set1((float) ((c >> k) & 1)));
+    }
+    _gm_i4 z = _gm_i4_and(_gm_i4_shr(h, 3), _gm_i4_set1(3));
+    _gm_f4 a = _gm_f4_select(_gm_i4_eq(z, _gm_i4_set1(0)), d[1], d[0]);
+    _gm_f4 b = _gm_f4_select(_gm_i4_lt(z, _gm_i4_set1(2)), d[2], d[1]);
+    _gm_f4 e = _gm_f4_select(_gm_i4_lt(z, _gm_i4_set1(3)), d[3], d[2]);
+    g[c] = _gm_f4_add(_gm_f4_add(_gm_noise_sign4(a, h, 0),
+                                 _gm_noise_sign4(b, h, 1)),
+                      _gm_noise_sign4(e, h, 2));
+  }
+  for (size_t k = 0, w = 16; k < 4; ++k, w /= 2)
+  {
+    for (size_t j = 0; j < w / 2; ++j)
+    {
+      g[j] = _gm_noise_lerp4(g[2 * j], g[2 * j + 1], s[k]);
+    }
+  }
+  return _gm_f4_mul(_gm_f4_set1(0.8f), g[0]);
+}
+#endif
+
+GM_CDECL float_x8 perlin2_x8(const vec2f_x8 p, const uint32_t seed)
+{
+  float_x8 v;
+  size_t i = 0;
+#if defined(GM_SIMD_SSE) || defined(GM_SIMD_NEON)
+  for (; i < 8; i += 4)
+  {
+    _gm_f4_store(v.a + i, _gm_perlin2_f4(_gm_f4_load(p.x.a + i),
+                                         _gm_f4_load(p.y.a + i), seed));
+  }
+#endif
+  for (; i < 8; ++i)
+  {
+    v.a[i] = _gm_perlin2(p.x.a[i], p.y.a[i], seed);
+  }
+  return v;
+}
+
+GM_CDECL float_x8 perlin3_x8(const vec3f_x8 p, const uint32_t seed)
+{
+  float_x8 v;
+  size_t i = 0;
+#if defined(GM_SIMD_SSE) || defined(GM_SIMD_NEON)
+  for (; i < 8; i += 4)
+  {
+    _gm_f4_store(v.a + i,
+                 _gm_perlin3_f4(_gm_f4_load(p.x.a + i), _gm_f4_load(p.y.a + i),
+                                _gm_f4_load(p.z.a + i), seed));
+  }
+#endif
+  for (; i < 8; ++i)
+  {
+    v.a[i] = _gm_perlin3(p.x.a[i], p.y.a[i], p.z.a[i], seed);
+  }
+  return v;
+}
+
+GM_CDECL float_x8 perlin4_x8(const vec4f_x8 p, const uint32_t seed)
+{
+  float_x8 v;
+  size_t i = 0;
+#if defined(GM_SIMD_SSE) || defined(GM_SIMD_NEON)
+  for (; i < 8; i += 4)
+  {
+    _gm_f4 q[4];
+    for (size_t k = 0; k < 4; ++k)
+    {
+      q[k] = _gm_f4_load(p.a[k].a + i);
+    }
+    _gm_f4_store(v.a + i, _gm_perlin4_f4(q, seed));
+  }
+#endif
+  for (; i < 8; ++i)
+  {
+    float q[4] = {p.a[0].a[i], p.a[1].a[i], p.a[2].a[i], p.a[3].a[i]};
+    v.a[i]     = _gm_perlin4(q, seed);
+  }
+  return v;
+}
+
+GM_CDECL float perlin2(const vec2f p, const uint32_t seed)
+{
+  return perlin2_x8(v2f_x8_set1(p), seed).a[0];
+}
+
+GM_CDECL float perlin3(const vec3f p, const uint32_t seed)
+{
+  return perlin3_x8(v3f_x8_set1(p), seed).a[0];
+}
+
+GM_CDECL float perlin4(const vec4f p, const uint32_t seed)
+{
+  return perlin4_x8(v4f_x8_set1(p), seed).a[0];
+}
+
+GM_CDECL void perlin3_many(const vec3f *p, float *out, const size_t n,
+                           const uint32_t seed)
+{
+  for (size_t i = 0; i < n; i += 8)
+  {
+    size_t m   = n - i < 8 ? n - i : 8;
+    float_x8 v = perlin3_x8(v3f_x8_pack(p + i, m), seed);
+    for (size_t j = 0; j < m; ++j)
+    {
+      out[i + j] = v.a[j];
+    }
+  }
+}
+
+// morton (z-order) codes: 2d keeps all 32 bits of each axis in 64, 3d the
+// low 21 bits of each in 63; coordinates are biased so signed order maps to
+// code order, covering all of int for 2d and [-2^20, 2^20) for 3d
+// bmi2 targets deposit and extract the bits directly
+
+#define GM_MORTON2_X 0x5555555555555555ull
+#define GM_MORTON3_X 0x1249249249249249ull
+
+GM_CDECL uint64_t _gm_morton_spread2(const uint32_t v)
+{
+#ifdef __BMI2__
+  return _pdep_u64(v, GM_MORTON2_X);
+#else
+  uint64_t x = v;
+  x          = (x | (x << 16)) & 0x0000ffff0000ffffull;
+  x          = (x | (x << 8)) & 0x00ff00ff00ff00ffull;
+  x          = (x | (x << 4)) & 0x0f0f0f0f0f0f0f0full;
+  x          = (x | (x << 2)) & 0x3333333333333333ull;
+  x          = (x | (x << 1)) & GM_MORTON2_X;
+  return x;
+#endif
+}
+
+GM_CDECL uint32_t _gm_morton_compact2(const uint64_t v)
+{
+#ifdef __BMI2__
+  return (uint32_t) _pext_u64(v, GM_MORTON2_X);
+#else
+  uint64_t x = v & GM_MORTON2_X;
+  x          = (x | (x >> 1)) & 0x3333333333333333ull;
+  x          = (x | (x >> 2)) & 0x0f0f0f0f0f0f0f0full;
+  x          = (x | (x >> 4)) & 0x00ff00ff00ff00ffull;
+  x          = (x | (x >> 8)) & 0x0000ffff0000ffffull;
+  x          = (x | (x >> 16)) & 0x00000000ffffffffull;
+  return (uint32_t) x;
+#endif
+}
+
+GM_CDECL uint64_t _gm_morton_spread3(const uint32_t v)
+{
+#ifdef __BMI2__
+  return _pdep_u64(v, GM_MORTON3_X);
+#else
+  uint64_t x = v & 0x1fffff;
+  x          = (x | (x << 32)) & 0x001f00000000ffffull;
+  x          = (x | (x << 16)) & 0x001f0000ff0000ffull;
+  x          = (x | (x << 8)) & 0x100f00f00f00f00full;
+  x          = (x | (x << 4)) & 0x10c30c30c30c30c3ull;
+  x          = (x | (x << 2)) & GM_MORTON3_X;
+  return x;
+#endif
+}
+
+GM_CDECL uint32_t _gm_morton_compact3(const uint64_t v)
+{
+#ifdef __BMI2__
+  return (uint32_t) _pext_u64(v, GM_MORTON3_X);
+#else
+  uint64_t x = v & GM_MORTON3_X;
+  x          = (x | (x >> 2)) & 0x10c30c30c30c30c3ull;
+  x          = (x | (x >> 4)) & 0x100f00f00f00f00full;
+  x          = (x | (x >> 8)) & 0x001f0000ff0000ffull;
+  x          = (x | (x >> 16)) & 0x001f00000000ffffull;
+  x          = (x | (x >> 32)) & 0x00000000001fffffull;
+  return (uint32_t) x;
+#endif
+}
+
+GM_CDECL uint64_t morton2_from_v2i(const vec2i v)
+{
+  return _gm_morton_spread2((uint32_t) v.x ^ 0x80000000u) |
+         _gm_morton_spread2((uint32_t) v.y ^ 0x80000000u) << 1;
+}
+
+GM_CDECL vec2i v2i_from_morton2(const uint64_t m)
+{
+  return v2i((int) (_gm_morton_compact2(m) ^ 0x80000000u),
+             (int) (_gm_morton_compact2(m >> 1) ^ 0x80000000u));
+}
+
+GM_CDECL uint64_t morton3_from_v3i(const vec3i v)
+{
+  return _gm_morton_spread3((uint32_t) v.x + 0x100000u) |
+         _gm_morton_spread3((uint32_t) v.y + 0x100000u) << 1 |
+         _gm_morton_spread3((uint32_t) v.z + 0x100000u) << 2;
+}
+
+GM_CDECL vec3i v3i_from_morton3(const uint64_t m)
+{
+  return v3i((int) _gm_morton_compact3(m) - 0x100000,
+             (int) _gm_morton_compact3(m >> 1) - 0x100000,
+             (int) _gm_morton_compact3(m >> 2) - 0x100000);
+}
+
+GM_CDECL void morton2_from_v2i_many(const vec2i *v, uint64_t *out,
+                                    const size_t n)
+{
+  for (size_t i = 0; i < n; ++i)
+  {
+    out[i] = morton2_from_v2i(v[i]);
+  }
+}
+
+GM_CDECL void morton3_from_v3i_many(const vec3i *v, uint64_t *out,
+                                    const size_t n)
+{
+  for (size_t i = 0; i < n; ++i)
+  {
+    out[i] = morton3_from_v3i(v[i]);
+  }
+}
+
+#undef GM_MORTON2_X
+#undef GM_MORTON3_X
+
+// the grid cell holding each position, floor(p / cell) per axis
+GM_CDECL void v3i_cells_many(const vec3f *p, const float cell, vec3i *out,
+                             const size_t n)
+{
+  const float *f = (const float *) p;
+  int *c         = (int *) out;
+  float inv      = 1 / cell;
+  size_t i = 0, m = 3 * n;
+#if defined(GM_SIMD_SSE)
+  __m128 s = _mm_set1_ps(inv);
+  for (; i < (m & ~(size_t) 3); i += 4)
+  {
+    __m128 x  = _mm_mul_ps(_mm_loadu_ps(f + i), s);
+    __m128i t = _mm_cvttps_epi32(x);
+    // truncation rounds negatives up, so step down where it did
+    __m128i up = _mm_castps_si128(_mm_cmplt_ps(x, _mm_cvtepi32_ps(t)));
+    _mm_storeu_si128((__m128i *) (c + i), _mm_add_epi32(t, up));
+  }
+#elif defined(GM_SIMD_NEON)
+  float32x4_t s = vdupq_n_f32(inv);
+  for (; i < (m & ~(size_t) 3); i += 4)
+  {
+    vst1q_s32(c + i, vcvtmq_s32_f32(vmulq_f32(vld1q_f32(f + i), s)));
+  }
+#endif
+  for (; i < m; ++i)
+  {
+    c[i] = (int) floorf(f[i] * inv);
+  }
+}
+
+// uniform grid of points hashed by cell, for fixed radius neighbour
+// queries in place of testing every pair
+// cells are hashed into a power of two bucket count, at least twice the
+// point count, and each bucket holds its points contiguously
+
+typedef struct
+{
+  float cell;
+  // bucket b holds slots [start[b], start[b + 1])
+  uint32_t *start;
+  size_t nbuckets;
+  // by slot: point id, cell and position
+  uint32_t *items;
+  vec3i *cells;
+  vec3f *points;
+  size_t n;
+} hashgridf;
+
+GM_CDECL void hashgridf_free(hashgridf *g)
+{
+  _gm_free(g->start);
+  _gm_free(g->items);
+  _gm_free(g->cells);
+  _gm_free(g->points);
+  *g = (hashgridf){0};
+}
+
+GM_CDECL uint32_t v3i_hash(const vec3i c)
+{
+  return ((uint32_t) c.x * 73856093u) ^ ((uint32_t) c.y * 19349663u) ^
+         ((uint32_t) c.z * 83492791u);
+}
+
+GM_CDECL bool hashgridf_build(hashgridf *g, const vec3f *p, const size_t n,
+                              const float cell)
+{
+  hashgridf_free(g);
+  size_t nb = 16;
+  while (nb < 2 * n)
+  {
+    nb *= 2;
+  }
+  vec3i *cells = (vec3i *) _gm_malloc((n ? n : 1) * sizeof(vec3i));
+  g->start     = (uint32_t *) _gm_malloc((nb + 1) * sizeof(uint32_t));
+  g->items     = (uint32_t *) _gm_malloc((n ? n : 1) * sizeof(uint32_t));
+  g->cells     = (vec3i *) _gm_malloc((n ? n : 1) * sizeof(vec3i));
+  g->points    = (vec3f *) _gm_malloc((n ? n : 1) * sizeof(vec3f));
+  if (!cells || !g->start || !g->items || !g->cells || !g->points)
+  {
+    _gm_free(cells);
+    hashgridf_free(g);
+    return false;
+  }
+  g->cell     = cell;
+  g->nbuckets = nb;
+  g->n        = n;
+  v3i_cells_many(p, cell, cells, n);
+  // counting sort by bucket
+  for (size_t b = 0; b <= nb; ++b)
+  {
+    g->start[b] = 0;
+  }
+  for (size_t i = 0; i < n; ++i)
+  {
+    g->start[(v3i_hash(cells[i]) & (nb - 1)) + 1]++;
+  }
+  for (size_t b = 0; b < nb; ++b)
+  {
+    g->start[b + 1] += g->start[b];
+  }
+  for (size_t i = 0; i < n; ++i)
+  {
+    uint32_t s   = g->start[v3i_hash(cells[i]) & (nb - 1)]++;
+    g->items[s]  = (uint32_t) i;
+    g->cells[s]  = cells[i];
+    g->points[s] = p[i];
+  }
+  // the scatter advanced each start to the next bucket's start
+  for (size_t b = nb; b > 0; --b)
+  {
+    g->start[b] = g->start[b - 1];
+  }
+  g->start[0] = 0;
+  _gm_free(cells);
+  return true;
+}
+
+// ids of the points within r of c, writing up to cap of them to out and
+// returning the total number found, which may be larger than cap
+GM_CDECL size_t hashgridf_query(const hashgridf *g, const vec3f c,
+                                const float r, uint32_t *out,
+                                const size_t cap)
+{
+  if (g->n == 0)
+  {
+    return 0;
+  }
+  vec3f e     = v3f(r, r, r);
+  vec3f lo[2] = {v3f_sub(c, e), v3f_add(c, e)};
+  vec3i b[2];
+  v3i_cells_many(lo, g->cell, b, 2);
+  size_t hits = 0;
+  float r2    = r * r;
+  for (int z = b[0].z; z <= b[1].z; ++z)
+  {
+    for (int y = b[0].y; y <= b[1].y; ++y)
+    {
+      for (int x = b[0].x; x <= b[1].x; ++x)
+      {
+        vec3i k    = v3i(x, y, z);
+        uint32_t h = v3i_hash(k) & (uint32_t) (g->nbuckets - 1);
+        for (uint32_t s = g->start[h]; s < g->start[h + 1]; ++s)
+        {
+          // other cells can share the bucket
+          if (g->cells[s].x != x || g->cells[s].y != y || g->cells[s].z != z ||
+              v3f_sqlen(v3f_sub(g->points[s], c)) > r2)
+          {
+            continue;
+          }
+          if (hits < cap)
+          {
+            out[hits] = g->items[s];
+          }
+          hits++;
+        }
+      }
+    }
+  }
+  return hits;
+}
+
+// sweep and prune broadphase over boxes given as min and max corners
+// bodies stay sorted by their min on the sweep axis between updates, so
+// small motions cost an insertion sort pass over nearly sorted keys; a
+// changed body count, a new sweep axis or heavy reordering sorts afresh
+// with a merge sort, parallel under openmp for large sets
+
+// with openmp, full sorts and sweeps of at least this many bodies run in
+// parallel
+#ifndef GM_SAP_PARALLEL_MIN
+#define GM_SAP_PARALLEL_MIN 16384
+#endif
+
+typedef struct
+{
+  // a < b
+  uint32_t a;
+  uint32_t b;
+} sapf_pair;
+
+typedef struct
+{
+  // body ids in sweep order with their sort keys
+  uint32_t *order;
+  float *keys;
+  // bounds in sweep order, five runs of n: the max on the sweep axis, then
+  // min and max on each of the other two axes
+  float *bounds;
+  // merge sort scratch, then hit counts for the sweep
+  uint32_t *torder;
+  float *tkeys;
+  size_t n;
+  uint32_t axis;
+  // overlapping pairs from the last update, reused across updates
+  sapf_pair *pairs;
+  size_t npairs;
+  size_t cpairs;
+} sapf;
+
+GM_CDECL void sapf_free(sapf *s)
+{
+  _gm_free(s->order);
+  _gm_free(s->keys);
+  _gm_free(s->bounds);
+  _gm_free(s->torder);
+  _gm_free(s->tkeys);
+  _gm_free(s->pairs);
+  *s = (sapf){0};
+}
+
+// gives up, leaving the keys partly sorted, once more than moves keys
+// have been shifted
+GM_CDECL bool _gm_sap_isort(float *k, uint32_t *v, const size_t n,
+                            size_t moves)
+{
+  for (size_t i = 1; i < n; ++i)
+  {
+    float kk    = k[i];
+    uint32_t vv = v[i];
+    size_t j    = i;
+    for (; j > 0 && k[j - 1] > kk; --j)
+    {
+      k[j] = k[j - 1];
+      v[j] = v[j - 1];
+    }
+    k[j] = kk;
+    v[j] = vv;
+    if (i - j > moves)
+    {
+      return false;
+    }
+    moves -= i - j;
+  }
+  return true;
+}
+
+GM_CDECL void _gm_sap_merge(const float *k, const uint32_t *v, float *ko,
+                            uint32_t *vo, const size_t lo, const size_t mid,
+                            const size_t hi)
+{
+  size_t i = lo, j = mid, o = lo;
+  while (i < mid && j < hi)
+  {
+    bool r  = k[j] < k[i];
+    ko[o]   = r ? k[j] : k[i];
+    vo[o++] = r ? v[j++] : v[i++];
+  }
+  for (; i < mid; ++i, ++o)
+  {
+    ko[o] = k[i];
+    vo[o] = v[i];
+  }
+  for (; j < hi; ++j, ++o)
+  {
+    ko[o] = k[j];
+    vo[o] = v[j];
+  }
+}
+
+// bottom-up merge sort from insertion sorted runs, each pass's runs and
+// merges being independent
+GM_CDECL void _gm_sap_sort(sapf *s)
+{
+  const size_t run = 32;
+  size_t n         = s->n;
+  long nr          = (long) ((n + run - 1) / run);
+  bool multi       = n >= GM_SAP_PARALLEL_MIN;
+  (void) multi;
+#ifdef _OPENMP
+#pragma omp parallel for if (multi)
+#endif
+  for (long r = 0; r < nr; ++r)
+  {
+    size_t lo = (size_t) r * run;
+    _gm_sap_isort(s->keys + lo, s->order + lo, n - lo < run ? n - lo : run,
+                  SIZE_MAX);
+  }
+  float *k = s->keys, *tk = s->tkeys;
+  uint32_t *v = s->order, *tv = s->torder;
+  for (size_t w = run; w < n; w *= 2)
+  {
+    long nm = (long) ((n + 2 * w - 1) / (2 * w));
+#ifdef _OPENMP
+#pragma omp parallel for if (multi)
+#endif
+    for (long m = 0; m < nm; ++m)
+    {
+      size_t lo  = (size_t) m * 2 * w;
+      size_t mid = lo + w < n ? lo + w : n;
+      size_t hi  = lo + 2 * w < n ? lo + 2 * w : n;
+      _gm_sap_merge(k, v, tk, tv, lo, mid, hi);
+    }
+    float *fk    = k;
+    uint32_t *fv = v;
+    k            = tk;
+    v            = tv;
+    tk           = fk;
+    tv           = fv;
+  }
+  // passes alternate buffers, keep the sorted ones as the live arrays
+  s->keys   = k;
+  s->order  = v;
+  s->tkeys  = tk;
+  s->torder = tv;
+}
+
+// the axis along which box centres spread the most
+GM_CDECL uint32_t _gm_sap_axis(const vec3f *min, const vec3f *max,
+                               const size_t n)
+{
+  double sum[3] = {0}, sq[3] = {0};
+  for (size_t i = 0; i < n; ++i)
+  {
+    for (size_t k = 0; k < 3; ++k)
+    {
+      double c = 0.5 * ((double) min[i].a[k] + max[i].a[k]);
+      sum[k]  += c;
+      sq[k]   += c * c;
+    }
+  }
+  uint32_t axis = 0;
+  double best   = -1;
+  for (uint32_t k = 0; k < 3; ++k)
+  {
+    double var = sq[k] - sum[k] * sum[k] / (double) (n ? n : 1);
+    if (var > best)
+    {
+      best = var;
+      axis = k;
+    }
+  }
+  return axis;
+}
+
+// bodies after i in sweep order whose interval on the sweep axis starts
+// before body i's ends, all overlapping it on that axis, end at the result
+GM_CDECL size_t _gm_sap_end(const sapf *s, const size_t i)
+{
+  float e   = s->bounds[i];
+  size_t lo = i + 1, hi = s->n;
+  while (lo < hi)
+  {
+    size_t mid = lo + (hi - lo) / 2;
+    if (s->keys[mid] <= e)
+    {
+      lo = mid + 1;
+    }
+    else
+    {
+      hi = mid;
+    }
+  }
+  return lo;
+}
+
+// counts, or with out writes, body i's overlaps among the candidates after
+// it, testing only the two other axes; the counting loop vectorizes
+GM_CDECL uint32_t _gm_sap_sweep(const sapf *s, const size_t i,
+                                sapf_pair *out)
+{
+  size_t n        = s->n, e = _gm_sap_end(s, i);
+  const float *u0 = s->bounds + n, *u1 = u0 + n, *w0 = u1 + n, *w1 = w0 + n;
+  float a0        = u0[i], a1 = u1[i], b0 = w0[i], b1 = w1[i];
+  uint32_t hits   = 0;
+  if (!out)
+  {
+    for (size_t j = i + 1; j < e; ++j)
+    {
+      hits += (u0[j] <= a1) & (a0 <= u1[j]) & (w0[j] <= b1) & (b0 <= w1[j]);
+    }
+    return hits;
+  }
+  for (size_t j = i + 1; j < e; ++j)
+  {
+    if ((u0[j] <= a1) & (a0 <= u1[j]) & (w0[j] <= b1) & (b0 <= w1[j]))
+    {
+      uint32_t a = s->order[i], b = s->order[j];
+      out[hits++] = a < b ? (sapf_pair){a, b} : (sapf_pair){b, a};
+    }
+  }
+  return hits;
+}
+
+// re-sorts the n bodies with the given bounds, indexed by body id, and
+// collects every overlapping pair into pairs; false if allocation fails
+GM_CDECL bool sapf_update(sapf *s, const vec3f *min, const vec3f *max,
+                          const size_t n)
+{
+  bool fresh = n != s->n;
+  if (fresh)
+  {
+    size_t c   = n ? n : 1;
+    void *p[5] = {_gm_realloc(s->order, c * sizeof(uint32_t)),
+                  _gm_realloc(s->keys, c * sizeof(float)),
+                  _gm_realloc(s->bounds, 5 * c * sizeof(float)),
+                  _gm_realloc(s->torder, c * sizeof(uint32_t)),
+                  _gm_realloc(s->tkeys, c * sizeof(float))};
+    s->order  = p[0] ? (uint32_t *) p[0] : s->order;
+    s->keys   = p[1] ? (float *) p[1] : s->keys;
+    s->bounds = p[2] ? (float *) p[2] : s->bounds;
+    s->torder = p[3] ? (uint32_t *) p[3] : s->torder;
+    s->tkeys  = p[4] ? (float *) p[4] : s->tkeys;
+    if (!p[0] || !p[1] || !p[2] || !p[3] || !p[4])
+    {
+      sapf_free(s);
+      return false;
+    }
+    for (size_t i = 0; i < n; ++i)
+    {
+      s->order[i] = (uint32_t) i;
+    }
+    s->n = n;
+  }
+  s->npairs     = 0;
+  uint32_t axis = _gm_sap_axis(min, max, n);
+  fresh         = fresh || axis != s->axis;
+  s->axis       = axis;
+  for (size_t i = 0; i < n; ++i)
+  {
+    s->keys[i] = min[s->order[i]].a[axis];
+  }
+  // insertion sort shifts each key past every key it crossed, cheap while
+  // bodies only pass near neighbours and abandoned for the full sort once
+  // that costs more than a few passes
+  if (fresh || !_gm_sap_isort(s->keys, s->order, n, 4 * n))
+  {
+    _gm_sap_sort(s);
+  }
+  uint32_t u = axis == 0 ? 1 : 0, w = axis == 2 ? 1 : 2;
+  float *b   = s->bounds;
+  for (size_t i = 0; i < n; ++i)
+  {
+    const vec3f lo = min[s->order[i]], hi = max[s->order[i]];
+    b[i]           = hi.a[axis];
+    b[n + i]       = lo.a[u];
+    b[2 * n + i]   = hi.a[u];
+    b[3 * n + i]   = lo.a[w];
+    b[4 * n + i]   = hi.a[w];
+  }
+  // count each body's pairs, then write them at their prefix offsets
+  uint32_t *count = s->torder;
+  bool multi      = n >= GM_SAP_PARALLEL_MIN;
+  (void) multi;
+#ifdef _OPENMP
+#pragma omp parallel for if (multi)
+#endif
+  for (long i = 0; i < (long) n; ++i)
+  {
+    count[i] = _gm_sap_sweep(s, (size_t) i, NULL);
+  }
+  size_t total = 0;
+  for (size_t i = 0; i < n; ++i)
+  {
+    uint32_t c = count[i];
+    count[i]   = (uint32_t) total;
+    total     += c;
+  }
+  if (total > s->cpairs)
+  {
+    size_t c     = total + total / 2;
+    sapf_pair *p = (sapf_pair *) _gm_realloc(s->pairs, c * sizeof(sapf_pair));
+    if (!p)
+    {
+      return false;
+    }
+    s->pairs  = p;
+    s->cpairs = c;
+  }
+#ifdef _OPENMP
+#pragma omp parallel for if (multi)
+#endif
+  for (long i = 0; i < (long) n; ++i)
+  {
+    bool last = i + 1 == (long) n;
+    if (last ? count[i] < total : count[i] < count[i + 1])
+    {
+      _gm_sap_sweep(s, (size_t) i, s->pairs + count[i]);
+    }
+  }
+  s->npairs = total;
+  return true;
+}
+
+// dual quaternions for rigid transforms, r the rotation and d half the
+// translation times r, composing like quaternions: dqf_mul(a, b) applies
+// b first
+
+typedef struct
+{
+  quatf r;
+  quatf d;
+} dquatf;
+
+GM_CONST dquatf dqf_ident = {{{1, 0, 0, 0}}, {{0, 0, 0, 0}}};
+
+GM_CDECL dquatf dqf_from_rt(const quatf r, const vec3f t)
+{
+  return (dquatf){r, qf_smul(qf_mul(qf(0, t.x, t.y, t.z), r), 0.5f)};
+}
+
+GM_CDECL dquatf dqf_mul(const dquatf a, const dquatf b)
+{
+  return (dquatf){qf_mul(a.r, b.r),
+                  qf_add(qf_mul(a.r, b.d), qf_mul(a.d, b.r))};
+}
+
+// unit rotation with the dual part made orthogonal to it
+GM_CDECL dquatf dqf_normalize(const dquatf q)
+{
+  float l = qf_len(q.r);
+  l       = l > 0 ? 1 / l : 0;
+  quatf r = qf_smul(q.r, l), d = qf_smul(q.d, l);
+  return (dquatf){r, qf_sub(d, qf_smul(r, qf_dot(r, d)))};
+}
+
+GM_CDECL vec3f dqf_translation(const dquatf q)
+{
+  quatf t = qf_mul(q.d, qf_conj(q.r));
+  return v3f(2 * t.a[1], 2 * t.a[2], 2 * t.a[3]);
+}
+
+GM_CDECL vec3f dqf_transform(const dquatf q, const vec3f p)
+{
+  vec4f v = qf_rotv(q.r, v4f(p.x, p.y, p.z, 0));
+  return v3f_add(v3f(v.x, v.y, v.z), dqf_translation(q));
+}
+
+GM_CDECL mat4f dqf_m4f(const dquatf q)
+{
+  mat3f r = qf_rotm(q.r);
+  vec3f t = dqf_translation(q);
+  return m4f(r.a[0], r.a[1], r.a[2], t.x, r.a[3], r.a[4], r.a[5], t.y,
+             r.a[6], r.a[7], r.a[8], t.z, 0, 0, 0, 1);
+}
+
+// skinning with four influences per vertex over structure-of-arrays
+// streams; with GM_SIMD four vertices go per step, each blending its joints
+// a row at a time before the blends are transposed so the transforms run
+// across the four vertices
+// linear blend skinning blends joint matrices, dual quaternion skinning
+// blends rigid joints without the volume loss of linear blending
+
+typedef struct
+{
+  const float *x;
+  const float *y;
+  const float *z;
+  // null to skip normals
+  const float *nx;
+  const float *ny;
+  const float *nz;
+  // joint ids into the palette, with weights summing to one
+  const uint16_t *joint[4];
+  const float *weight[4];
+} skinf_in;
+
+typedef struct
+{
+  float *x;
+  float *y;
+  float *z;
+  float *nx;
+  float *ny;
+  float *nz;
+} skinf_out;
+
+GM_CDECL void _gm_skinf_lbs1(const mat4f *palette, const skinf_in *in,
+                             skinf_out *out, const size_t i,
+                             const bool normals)
+{
+  float a[12];
+  for (size_t r = 0; r < 12; ++r)
+  {
+    a[r] = in->weight[0][i] * palette[in->joint[0][i]].a[r] +
+           in->weight[1][i] * palette[in->joint[1][i]].a[r] +
+           in->weight[2][i] * palette[in->joint[2][i]].a[r] +
+           in->weight[3][i] * palette[in->joint[3][i]].a[r];
+  }
+  float x = in->x[i], y = in->y[i], z = in->z[i];
+  out->x[i] = a[0] * x + a[1] * y + a[2] * z + a[3];
+  out->y[i] = a[4] * x + a[5] * y + a[6] * z + a[7];
+  out->z[i] = a[8] * x + a[9] * y + a[10] * z + a[11];
+  if (normals)
+  {
+    x       = in->nx[i];
+    y       = in->ny[i];
+    z       = in->nz[i];
+    vec3f n = v3f(a[0] * x + a[1] * y + a[2] * z,
+                  a[4] * x + a[5] * y + a[6] * z,
+                  a[8] * x + a[9] * y + a[10] * z);
+    n       = v3f_normalize(n);
+    out->nx[i] = n.x;
+    out->ny[i] = n.y;
+    out->nz[i] = n.z;
+  }
+}
+
+// blends the influences of vertex i into q, flipped into the first one's
+// hemisphere, and returns 1 / |q.r|
+GM_CDECL float _gm_skinf_dqblend(const dquatf *palette, const skinf_in *in,
+                                 const size_t i, float q[8])
+{
+  const dquatf *f = palette + in->joint[0][i];
+  for (size_t c = 0; c < 4; ++c)
+  {
+    q[c]     = in->weight[0][i] * f->r.a[c];
+    q[c + 4] = in->weight[0][i] * f->d.a[c];
+  }
+  for (size_t k = 1; k < 4; ++k)
+  {
+    const dquatf *g = palette + in->joint[k][i];
+    float w         = in->weight[k][i];
+    w               = qf_dot(f->r, g->r) < 0 ? -w : w;
+    for (size_t c = 0; c < 4; ++c)
+    {
+      q[c]     += w * g->r.a[c];
+      q[c + 4] += w * g->d.a[c];
+    }
+  }
+  float s = q[0] * q[0] + q[1] * q[1] + q[2] * q[2] + q[3] * q[3];
+  return s > 0 ? 1 / _gm_float_lensqrt(s) : 0;
+}
+
+GM_CDECL void _gm_skinf_dqs1(const dquatf *palette, const skinf_in *in,
+                             skinf_out *out, const size_t i,
+                             const bool normals)
+{
+  float q[8];
+  float s    = _gm_skinf_dqblend(palette, in, i, q);
+  dquatf b   = {{{q[0] * s, q[1] * s, q[2] * s, q[3] * s}},
+                {{q[4] * s, q[5] * s, q[6] * s, q[7] * s}}};
+  vec3f p    = dqf_transform(b, v3f(in->x[i], in->y[i], in->z[i]));
+  out->x[i]  = p.x;
+  out->y[i]  = p.y;
+  out->z[i]  = p.z;
+  if (normals)
+  {
+    vec4f n    = qf_rotv(b.r, v4f(in->nx[i], in->ny[i], in->nz[i], 0));
+    out->nx[i] = n.x;
+    out->ny[i] = n.y;
+    out->nz[i] = n.z;
+  }
+}
+
+// normals take the blended upper 3x3 and are renormalized, which is exact
+// for joints without non-uniform scale
+GM_CDECL void skinf_lbs(const mat4f *palette, const skinf_in *in,
+                        skinf_out *out, const size_t n)
+{
+  bool normals = in->nx && out->nx;
+  size_t i     = 0;
+#if defined(GM_SIMD_SSE) || defined(GM_SIMD_NEON)
+  for (; i + 4 <= n; i += 4)
+  {
+    // a[r][v], row r of vertex i + v's blend
+    _gm_f4 a[3][4];
+    for (size_t v = 0; v < 4; ++v)
+    {
+      for (size_t r = 0; r < 3; ++r)
+      {
+        _gm_f4 acc = _gm_f4_mul(_gm_f4_set1(in->weight[0][i + v]),
+                                _gm_f4_load(palette[in->joint[0][i + v]].a +
+                                            r * 4));
+        for (size_t k = 1; k < 4; ++k)
+        {
+          acc = _gm_f4_madd(_gm_f4_set1(in->weight[k][i + v]),
+                            _gm_f4_load(palette[in->joint[k][i + v]].a +
+                                        r * 4),
+                            acc);
+        }
+        a[r][v] = acc;
+      }
+    }
+    _gm_f4 x = _gm_f4_load(in->x + i), y = _gm_f4_load(in->y + i);
+    _gm_f4 z = _gm_f4_load(in->z + i), nx, ny, nz;
+    if (normals)
+    {
+      nx = _gm_f4_load(in->nx + i);
+      ny = _gm_f4_load(in->ny + i);
+      nz = _gm_f4_load(in->nz + i);
+    }
+    _gm_f4 on[3];
+    float *op[3] = {out->x, out->y, out->z};
+    for (size_t r = 0; r < 3; ++r)
+    {
+      // columns of row r across the four vertices
+      _gm_f4_transpose(a[r][0], a[r][1], a[r][2], a[r][3]);
+      _gm_f4 o = _gm_f4_madd(a[r][0], x, a[r][3]);
+      o        = _gm_f4_madd(a[r][1], y, o);
+      _gm_f4_store(op[r] + i, _gm_f4_madd(a[r][2], z, o));
+      if (normals)
+      {
+        on[r] = _gm_f4_mul(a[r][0], nx);
+        on[r] = _gm_f4_madd(a[r][1], ny, on[r]);
+        on[r] = _gm_f4_madd(a[r][2], nz, on[r]);
+      }
+    }
+    if (normals)
+    {
+      _gm_f4 l = _gm_f4_madd(on[0], on[0],
+                             _gm_f4_madd(on[1], on[1],
+                                         _gm_f4_mul(on[2], on[2])));
+      l        = _gm_f4_zero_to_one(_gm_f4_sqrt(l));
+      _gm_f4_store(out->nx + i, _gm_f4_div(on[0], l));
+      _gm_f4_store(out->ny + i, _gm_f4_div(on[1], l));
+      _gm_f4_store(out->nz + i, _gm_f4_div(on[2], l));
+    }
+  }
+#endif
+  for (; i < n; ++i)
+  {
+    _gm_skinf_lbs1(palette, in, out, i, normals);
+  }
+}
+
+GM_CDECL void skinf_dqs(const dquatf *palette, const skinf_in *in,
+                        skinf_out *out, const size_t n)
+{
+  bool normals = in->nx && out->nx;
+  size_t i     = 0;
+#if defined(GM_SIMD_SSE) || defined(GM_SIMD_NEON)
+  for (; i + 4 <= n; i += 4)
+  {
+    float q[4][8], s[4];
+    for (size_t v = 0; v < 4; ++v)
+    {
+      s[v] = _gm_skinf_dqblend(palette, in, i + v, q[v]);
+    }
+    _gm_f4 rw = _gm_f4_load(q[0]), rx = _gm_f4_load(q[1]);
+    _gm_f4 ry = _gm_f4_load(q[2]), rz = _gm_f4_load(q[3]);
+    _gm_f4 dw = _gm_f4_load(q[0] + 4), dx = _gm_f4_load(q[1] + 4);
+    _gm_f4 dy = _gm_f4_load(q[2] + 4), dz = _gm_f4_load(q[3] + 4);
+    _gm_f4_transpose(rw, rx, ry, rz);
+    _gm_f4_transpose(dw, dx, dy, dz);
+    _gm_f4 sc = _gm_f4_load(s);
+    rw        = _gm_f4_mul(rw, sc);
+    rx        = _gm_f4_mul(rx, sc);
+    ry        = _gm_f4_mul(ry, sc);
+    rz        = _gm_f4_mul(rz, sc);
+    // the translation 2 (rw d - dw r + r x d) over the vector parts, with
+    // d still unnormalized
+    _gm_f4 t2 = _gm_f4_add(sc, sc);
+    _gm_f4 t[3];
+    t[0] = _gm_f4_sub(_gm_f4_madd(ry, dz, _gm_f4_mul(rw, dx)),
+                      _gm_f4_madd(rz, dy, _gm_f4_mul(dw, rx)));
+    t[1] = _gm_f4_sub(_gm_f4_madd(rz, dx, _gm_f4_mul(rw, dy)),
+                      _gm_f4_madd(rx, dz, _gm_f4_mul(dw, ry)));
+    t[2] = _gm_f4_sub(_gm_f4_madd(rx, dy, _gm_f4_mul(rw, dz)),
+                      _gm_f4_madd(ry, dx, _gm_f4_mul(dw, rz)));
+    const float *ip[2][3] = {{in->x, in->y, in->z}, {in->nx, in->ny, in->nz}};
+    float *op[2][3] = {{out->x, out->y, out->z}, {out->nx, out->ny, out->nz}};
+    for (size_t k = 0; k < (normals ? 2u : 1u); ++k)
+    {
+      // v + 2 r x (r x v + rw v)
+      _gm_f4 x  = _gm_f4_load(ip[k][0] + i), y = _gm_f4_load(ip[k][1] + i);
+      _gm_f4 z  = _gm_f4_load(ip[k][2] + i);
+      _gm_f4 cx = _gm_f4_madd(rw, x, _gm_f4_sub(_gm_f4_mul(ry, z),
+                                                _gm_f4_mul(rz, y)));
+      _gm_f4 cy = _gm_f4_madd(rw, y, _gm_f4_sub(_gm_f4_mul(rz, x),
+                                                _gm_f4_mul(rx, z)));
+      _gm_f4 cz = _gm_f4_madd(rw, z, _gm_f4_sub(_gm_f4_mul(rx, y),
+                                                _gm_f4_mul(ry, x)));
+      _gm_f4 two = _gm_f4_set1(2);
+      x = _gm_f4_madd(two, _gm_f4_sub(_gm_f4_mul(ry, cz), _gm_f4_mul(rz, cy)),
+                      x);
+      y = _gm_f4_madd(two, _gm_f4_sub(_gm_f4_mul(rz, cx), _gm_f4_mul(rx, cz)),
+                      y);
+      z = _gm_f4_madd(two, _gm_f4_sub(_gm_f4_mul(rx, cy), _gm_f4_mul(ry, cx)),
+                      z);
+      if (k == 0)
+      {
+        x = _gm_f4_madd(t2, t[0], x);
+        y = _gm_f4_madd(t2, t[1], y);
+        z = _gm_f4_madd(t2, t[2], z);
+      }
+      _gm_f4_store(op[k][0] + i, x);
+      _gm_f4_store(op[k][1] + i, y);
+      _gm_f4_store(op[k][2] + i, z);
+    }
+  }
+#endif
+  for (; i < n; ++i)
+  {
+    _gm_skinf_dqs1(palette, in, out, i, normals);
+  }
+}
+
 #ifdef __cplusplus
 }
 #endif
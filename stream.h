@@ -42,6 +42,16 @@ index in the stream.
 - `stream_popb(stream_t*, size_t)`: Pops bytes from the end of the stream.
 - `stream_deqb(stream_t*, size_t)`: Dequeues bytes from the beginning of the
 stream.
+- `stream_ring(stream_t*, size_t)`: Switches the stream to ring-buffer mode with
+at least the given power-of-two capacity.
+- `stream_rspans(stream_t*, BYTE*[2], size_t[2])`: Gets the readable bytes as up
+to two contiguous spans, returning the span count.
+- `stream_wspans(stream_t*, BYTE*[2], size_t[2])`: Gets the free space after the
+end of the stream as up to two contiguous spans, returning the span count.
+- `stream_commitb(stream_t*, size_t)`: Appends bytes already written into the
+writable spans.
+- `stream_skipb(stream_t*, size_t)`: Drops bytes from the beginning of the
+stream without copying them.
 - `stream_seek(stream_t*, ptrdiff_t, int)`: Seeks to a position in the stream.
 - `stream_tell(stream_t*)`: Tells the current position in the stream.
 - `stream_read(stream_t*, void*, size_t, size_t)`: Reads bytes from the stream
@@ -49,6 +59,73 @@ into a buffer.
 - `stream_write(stream_t*, const void*, size_t, size_t)`: Writes bytes to the
 stream from a buffer.
 
+### Ring Buffers
+
+A stream switched with `stream_ring` keeps its bytes in a power-of-two buffer
+between head and tail indices that wrap around, so `stream_enqb` and
+`stream_deqb` never move the payload once the capacity has settled. A dequeue
+that straddles the end of the buffer copies only its wrapped bytes just past
+the end to hand back a contiguous pointer; `stream_rspans` with `stream_skipb`
+and `stream_wspans` with `stream_commitb` avoid even that, e.g. for `writev` and
+`readv`. `stream_begptr`, `stream_endptr`, seeking and the iterators address a
+linear stream only.
+
+### Concurrent Queues
+
+- `stream_spsc(size_t)`: Creates a lock-free single-producer single-consumer
+byte queue with at least the given power-of-two capacity.
+- `stream_spsc_pushb(stream_spsc_t*, size_t, BYTE*)`: Pushes all of the bytes
+and publishes them, or nothing if the queue is too full.
+- `stream_spsc_writeb(stream_spsc_t*, size_t, BYTE*)`: Pushes the bytes without
+publishing them, so that a batch costs one `stream_spsc_flush`.
+- `stream_spsc_flush(stream_spsc_t*)`: Publishes the written bytes.
+- `stream_spsc_deqb(stream_spsc_t*, size_t, BYTE*)`: Dequeues up to N bytes into
+a buffer, returning how many were dequeued.
+- `stream_spsc_length(stream_spsc_t*)`: Returns the published length.
+- `stream_spsc_free(stream_spsc_t*)`: Frees the queue.
+- `stream_mpmc(size_t, size_t)`: Creates a bounded lock-free multi-producer
+multi-consumer queue with at least the given power-of-two count of slots, each
+holding up to the given count of bytes.
+- `stream_mpmc_pushb(stream_mpmc_t*, size_t, BYTE*)`: Pushes the bytes as one
+message, or nothing if the queue is full or they exceed a slot.
+- `stream_mpmc_deqb(stream_mpmc_t*, size_t, BYTE*)`: Dequeues one message into
+a buffer of N bytes, truncating it to fit, and returns the bytes dequeued.
+- `stream_mpmc_free(stream_mpmc_t*)`: Frees the queue.
+
+Producers and consumers spin on nothing; a full push or empty dequeue returns
+zero straight away. Bytes from one producer arrive in order. The MPMC queue
+keeps each push as a message, since bytes pushed concurrently would otherwise
+interleave.
+
+### Segmented Streams
+
+- `stream_pool(size_t)`: Creates a pool of chunks of the given size.
+- `stream_pool_free(stream_pool_t*)`: Frees the pool's idle chunks and the pool,
+once every chain drawing from it has been freed.
+- `stream_chain(stream_pool_t*)`: Creates a segmented stream drawing chunks from
+a pool, or from a pool of its own of `STREAM_CHUNK_SIZE` chunks for null.
+- `stream_chain_length(stream_chain_t*)`: Returns the length of the chain.
+- `stream_chain_pushb(stream_chain_t*, size_t, BYTE*)`: Pushes bytes onto the
+end of the chain.
+- `stream_chain_insb(stream_chain_t*, size_t, BYTE*, size_t)`: Inserts N bytes
+at a specific index in the chain.
+- `stream_chain_deqb(stream_chain_t*, size_t, BYTE*)`: Dequeues up to N bytes
+into a buffer, or drops them for null, returning how many were dequeued.
+- `stream_chain_copy(stream_chain_t*, size_t, size_t, BYTE*)`: Copies up to N
+bytes from an index into a buffer, returning how many were copied.
+- `stream_chain_iov(stream_chain_t*, stream_iovec_t*, size_t)`: Fills up to N
+iovecs with the chain's segments in order, returning how many were filled.
+- `stream_chain_free(stream_chain_t*)`: Frees the chain, returning its chunks
+to the pool.
+
+A chain keeps its bytes in segments, each a span of a fixed-size chunk. Pushes
+fill the last chunk and then take new ones, so the bytes already in the chain
+are never copied or moved; an insert splits the segment it lands in and adds
+segments for the new bytes. `stream_iovec_t` is `struct iovec` on POSIX, so the
+filled array goes straight to `writev` or `sendmsg`, after which
+`stream_chain_deqb` with a null buffer drops what was written. Pools and chains
+are not thread-safe.
+
 ### Stream Iterators
 
 - `streamiter(stream_t*)`: Creates an iterator for the stream.
@@ -92,6 +169,7 @@ extern "C" {
 #if defined(_WIN32) && !defined(_CRT_SECURE_NO_WARNINGS)
 #define _CRT_SECURE_NO_WARNINGS
 #endif
+#include <stddef.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -101,12 +179,20 @@ extern "C" {
 #define BYTE uint8_t
 #endif
 
+#ifndef _WIN32
+#include <sys/uio.h>
+#endif
+
 typedef struct stream_t
 {
   BYTE *buffer;
   size_t offset;
   size_t length;
   size_t capacity;
+  // capacity - 1 in ring mode, otherwise zero
+  size_t mask;
+  // bytes allocated past the capacity for dequeues that wrap
+  size_t spill;
 } stream_t;
 
 typedef struct streamiter_t
@@ -122,6 +208,97 @@ typedef struct streamiter_t *rstreamiter_t;
 #define STREAM_MIN_CAPACITY 32
 #endif
 
+#ifndef STREAM_CHUNK_SIZE
+#define STREAM_CHUNK_SIZE 65536
+#endif
+
+#ifndef STREAM_CACHE_LINE
+#define STREAM_CACHE_LINE 64
+#endif
+
+// indices run freely and are masked into the ring, which keeps full and
+// empty apart; each side's fields sit on their own cache line, caching the
+// other side's index so it is only reloaded when it looks short
+typedef struct stream_spsc_t
+{
+  // ring storage, with offset and length unused
+  stream_t ring;
+  char _pad0[STREAM_CACHE_LINE];
+  // consumer side
+  size_t head;
+  size_t tailcache;
+  char _pad1[STREAM_CACHE_LINE - 2 * sizeof(size_t)];
+  // producer side, writing at pending and publishing up to tail
+  size_t tail;
+  size_t pending;
+  size_t headcache;
+  char _pad2[STREAM_CACHE_LINE - 3 * sizeof(size_t)];
+} stream_spsc_t;
+
+// cells of stride bytes hold a sequence number, a length and the payload;
+// a cell is free to push at position p when its sequence is p and holds a
+// message to dequeue when it is p + 1
+typedef struct stream_mpmc_t
+{
+  // cells start at the first cache line boundary inside block
+  BYTE *block;
+  BYTE *cells;
+  size_t mask;
+  size_t stride;
+  size_t slotsize;
+  char _pad0[STREAM_CACHE_LINE];
+  size_t enq;
+  char _pad1[STREAM_CACHE_LINE - sizeof(size_t)];
+  size_t deq;
+  char _pad2[STREAM_CACHE_LINE - sizeof(size_t)];
+} stream_mpmc_t;
+
+#ifdef _WIN32
+typedef struct stream_iovec_t
+{
+  void *iov_base;
+  size_t iov_len;
+} stream_iovec_t;
+#else
+typedef struct iovec stream_iovec_t;
+#endif
+
+typedef struct stream_chunk_t
+{
+  // next idle chunk in the pool
+  struct stream_chunk_t *next;
+  // segments referencing the chunk, plus one while a chain fills it
+  size_t refs;
+  // bytes handed out from the start of data
+  size_t used;
+  BYTE data[];
+} stream_chunk_t;
+
+typedef struct stream_pool_t
+{
+  size_t chunksize;
+  stream_chunk_t *idle;
+} stream_pool_t;
+
+typedef struct stream_seg_t
+{
+  stream_chunk_t *chunk;
+  BYTE *ptr;
+  size_t length;
+} stream_seg_t;
+
+typedef struct stream_chain_t
+{
+  stream_pool_t *pool;
+  // the chunk being filled
+  stream_chunk_t *fill;
+  stream_seg_t *segs;
+  size_t nsegs;
+  size_t capsegs;
+  size_t length;
+  int ownpool;
+} stream_chain_t;
+
 #ifndef STREAM_NO_SHORT_NAMES
 #define slength stream_length
 #define slengthu stream_lengthu
@@ -132,6 +309,11 @@ typedef struct streamiter_t *rstreamiter_t;
 #define sendptr stream_endptr
 #define ssetcap stream_setcap
 #define ssetlen stream_setlen
+#define sring stream_ring
+#define srspans stream_rspans
+#define swspans stream_wspans
+#define scommitb stream_commitb
+#define sskipb stream_skipb
 #define spushb stream_pushb
 #define sinsb stream_insb
 #define sinsbz stream_insbz
@@ -169,9 +351,15 @@ typedef struct streamiter_t *rstreamiter_t;
 #define stream_free(Stream) (_stream_free(Stream), (Stream) = 0)
 #define stream_clear(Stream) (_stream_clear(Stream))
 #define stream_setcap(Stream, Capacity)                                        \
-  ((Stream) = _stream_setcap(stream, Capacity))
+  ((Stream) = _stream_setcap(Stream, Capacity))
 #define stream_growcap(Stream, Capacity)                                       \
-  ((Stream) = _stream_growcap(stream, Capacity))
+  ((Stream) = _stream_growcap(Stream, Capacity))
+#define stream_ring(Stream, Capacity)                                          \
+  ((Stream) = _stream_ring(Stream, Capacity))
+#define stream_rspans(Stream, Ptrs, Lens) (_stream_rspans(Stream, Ptrs, Lens))
+#define stream_wspans(Stream, Ptrs, Lens) (_stream_wspans(Stream, Ptrs, Lens))
+#define stream_commitb(Stream, Len) (_stream_commitb(Stream, Len))
+#define stream_skipb(Stream, Len) (_stream_skipb(Stream, Len))
 #define stream_pushb(Stream, Len, Bytes)                                       \
   ((Stream) = _stream_pushb(Stream, Len, (BYTE *) Bytes))
 #define stream_enqb stream_pushb
@@ -188,6 +376,36 @@ typedef struct streamiter_t *rstreamiter_t;
   (_stream_read(Stream, DataPtre, Size, Count))
 #define stream_write(Stream, DataPtr, Size, Count)                             \
   (_stream_write(Stream, DataPtre, Size, Count))
+#define stream_spsc(Capacity) (_stream_spsc(Capacity))
+#define stream_spsc_pushb(Queue, Len, Bytes)                                   \
+  (_stream_spsc_pushb(Queue, Len, (const BYTE *) Bytes))
+#define stream_spsc_writeb(Queue, Len, Bytes)                                  \
+  (_stream_spsc_writeb(Queue, Len, (const BYTE *) Bytes))
+#define stream_spsc_flush(Queue) (_stream_spsc_flush(Queue))
+#define stream_spsc_deqb(Queue, Len, Out)                                      \
+  (_stream_spsc_deqb(Queue, Len, (BYTE *) Out))
+#define stream_spsc_length(Queue) (_stream_spsc_length(Queue))
+#define stream_spsc_free(Queue) (_stream_spsc_free(Queue), (Queue) = 0)
+#define stream_mpmc(Slots, SlotSize) (_stream_mpmc(Slots, SlotSize))
+#define stream_mpmc_pushb(Queue, Len, Bytes)                                   \
+  (_stream_mpmc_pushb(Queue, Len, (const BYTE *) Bytes))
+#define stream_mpmc_deqb(Queue, Len, Out)                                      \
+  (_stream_mpmc_deqb(Queue, Len, (BYTE *) Out))
+#define stream_mpmc_free(Queue) (_stream_mpmc_free(Queue), (Queue) = 0)
+#define stream_pool(ChunkSize) (_stream_pool(ChunkSize))
+#define stream_pool_free(Pool) (_stream_pool_free(Pool), (Pool) = 0)
+#define stream_chain(Pool) (_stream_chain(Pool))
+#define stream_chain_length(Chain) ((Chain) ? (Chain)->length : 0)
+#define stream_chain_pushb(Chain, Len, Bytes)                                  \
+  (_stream_chain_insb(Chain, Len, (const BYTE *) Bytes, (size_t) -1))
+#define stream_chain_insb(Chain, Len, Bytes, Idx)                              \
+  (_stream_chain_insb(Chain, Len, (const BYTE *) Bytes, Idx))
+#define stream_chain_deqb(Chain, Len, Out)                                     \
+  (_stream_chain_deqb(Chain, Len, (BYTE *) Out))
+#define stream_chain_copy(Chain, Idx, Len, Out)                                \
+  (_stream_chain_copy(Chain, Idx, Len, (BYTE *) Out))
+#define stream_chain_iov(Chain, Iov, Max) (_stream_chain_iov(Chain, Iov, Max))
+#define stream_chain_free(Chain) (_stream_chain_free(Chain), (Chain) = 0)
 #define streamiter(Stream) (_streamiter(Stream))
 #define streamiter_reset(StreamIter) (_streamiter_reset(StreamIter))
 #define streamiter_curr(StreamIter) (_streamiter_curr(StreamIter))
@@ -205,6 +423,11 @@ extern int _stream_clear(stream_t *stream);
 extern stream_t *_stream_setcap(stream_t *stream, const size_t capacity);
 extern stream_t *_stream_growcap(stream_t *stream, const size_t mincap);
 extern stream_t *_stream_reoffset(stream_t *stream, const size_t pos);
+extern stream_t *_stream_ring(stream_t *stream, const size_t capacity);
+extern size_t _stream_rspans(stream_t *stream, BYTE *ptrs[2], size_t lens[2]);
+extern size_t _stream_wspans(stream_t *stream, BYTE *ptrs[2], size_t lens[2]);
+extern size_t _stream_commitb(stream_t *stream, const size_t length);
+extern size_t _stream_skipb(stream_t *stream, const size_t length);
 extern stream_t *_stream_pushbz(stream_t *stream, const size_t length);
 extern stream_t *_stream_insbz(stream_t *stream, const size_t length,
                                const size_t i);
@@ -219,6 +442,34 @@ extern size_t _stream_read(stream_t *stream, void *ptr, size_t size,
                            size_t count);
 extern size_t _stream_write(stream_t *stream, const void *ptr, size_t size,
                             size_t count);
+extern stream_spsc_t *_stream_spsc(const size_t capacity);
+extern int _stream_spsc_writeb(stream_spsc_t *queue, const size_t length,
+                               const BYTE *Bytes);
+extern void _stream_spsc_flush(stream_spsc_t *queue);
+extern int _stream_spsc_pushb(stream_spsc_t *queue, const size_t length,
+                              const BYTE *Bytes);
+extern size_t _stream_spsc_deqb(stream_spsc_t *queue, const size_t length,
+                                BYTE *out);
+extern size_t _stream_spsc_length(stream_spsc_t *queue);
+extern void _stream_spsc_free(stream_spsc_t *queue);
+extern stream_mpmc_t *_stream_mpmc(const size_t slots, const size_t slotsize);
+extern int _stream_mpmc_pushb(stream_mpmc_t *queue, const size_t length,
+                              const BYTE *Bytes);
+extern size_t _stream_mpmc_deqb(stream_mpmc_t *queue, const size_t length,
+                                BYTE *out);
+extern void _stream_mpmc_free(stream_mpmc_t *queue);
+extern stream_pool_t *_stream_pool(const size_t chunksize);
+extern void _stream_pool_free(stream_pool_t *pool);
+extern stream_chain_t *_stream_chain(stream_pool_t *pool);
+extern int _stream_chain_insb(stream_chain_t *chain, size_t length,
+                              const BYTE *Bytes, const size_t i);
+extern size_t _stream_chain_deqb(stream_chain_t *chain, const size_t length,
+                                 BYTE *out);
+extern size_t _stream_chain_copy(stream_chain_t *chain, const size_t i,
+                                 const size_t length, BYTE *out);
+extern size_t _stream_chain_iov(stream_chain_t *chain, stream_iovec_t *iov,
+                                const size_t max);
+extern void _stream_chain_free(stream_chain_t *chain);
 extern streamiter_t _streamiter(stream_t *stream);
 extern void _streamiter_reset(streamiter_t iter);
 extern BYTE _streamiter_next(streamiter_t iter);
@@ -260,6 +511,61 @@ extern int _rstreamiter_hasnext(rstreamiter_t iter);
 #define max(L, R) ((L) > (R) ? (L) : (R))
 #endif
 
+// atomics on size_t for the queues. msvc gets explicit intrinsics, since
+// whether a volatile access orders anything depends on /volatile, which is
+// iso by default on arm64
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#if defined(_M_ARM64)
+#define _stream_load_relaxed(P)                                                \
+  ((size_t) __iso_volatile_load64((const volatile __int64 *) (P)))
+#define _stream_load_acquire(P)                                                \
+  ((size_t) __ldar64((volatile unsigned __int64 *) (P)))
+#define _stream_store_release(P, V)                                            \
+  __stlr64((volatile unsigned __int64 *) (P), (unsigned __int64) (V))
+#elif defined(_M_IX86) || defined(_M_X64)
+// x86 keeps loads and stores in order, so only the compiler needs fencing
+#define _stream_load_relaxed(P) (*(volatile size_t *) (P))
+STREAM_CDECL size_t _stream_load_acquire(const size_t *p)
+{
+  size_t v = *(volatile const size_t *) p;
+  _ReadWriteBarrier();
+  return v;
+}
+STREAM_CDECL void _stream_store_release(size_t *p, const size_t v)
+{
+  _ReadWriteBarrier();
+  *(volatile size_t *) p = v;
+}
+#else
+// 32-bit arm falls back to full barriers
+#define _stream_load_relaxed(P) (*(volatile size_t *) (P))
+#define _stream_load_acquire(P)                                                \
+  ((size_t) _InterlockedOr((volatile long *) (P), 0))
+#define _stream_store_release(P, V)                                            \
+  ((void) _InterlockedExchange((volatile long *) (P), (long) (V)))
+#endif
+#else
+#define _stream_load_relaxed(P) __atomic_load_n(P, __ATOMIC_RELAXED)
+#define _stream_load_acquire(P) __atomic_load_n(P, __ATOMIC_ACQUIRE)
+#define _stream_store_release(P, V) __atomic_store_n(P, V, __ATOMIC_RELEASE)
+#endif
+
+// swaps *p from e to d, returning whether it held e
+STREAM_CDECL int _stream_cas(size_t *p, size_t e, const size_t d)
+{
+#if defined(_MSC_VER) && !defined(__clang__) && defined(_WIN64)
+  return (size_t) _InterlockedCompareExchange64((volatile __int64 *) p,
+                                                (__int64) d, (__int64) e) == e;
+#elif defined(_MSC_VER) && !defined(__clang__)
+  return (size_t) _InterlockedCompareExchange((volatile long *) p, (long) d,
+                                              (long) e) == e;
+#else
+  return __atomic_compare_exchange_n(p, &e, d, 1, __ATOMIC_RELAXED,
+                                     __ATOMIC_RELAXED);
+#endif
+}
+
 STREAM_CDECL int _stream_free(stream_t *stream)
 {
   if (!stream || !stream->buffer)
@@ -281,43 +587,144 @@ STREAM_CDECL int _stream_clear(stream_t *stream)
   return 1;
 }
 
+STREAM_CDECL size_t _stream_pow2(size_t n)
+{
+  size_t p = STREAM_MIN_CAPACITY;
+  while (p < n)
+  {
+    p <<= 1;
+  }
+  return p;
+}
+
+// reallocates a ring with the bytes unwrapped to the start of the buffer
+STREAM_CDECL stream_t *_stream_ring_resize(stream_t *stream,
+                                           const size_t capacity)
+{
+  BYTE *buffer = (BYTE *) malloc(capacity);
+  if (!buffer)
+  {
+    fprintf(stderr, "ERROR: Memory allocation error");
+    return NULL;
+  }
+  size_t first = min(stream->length, stream->capacity - stream->offset);
+  memcpy(buffer, stream->buffer + stream->offset, first);
+  memcpy(buffer + first, stream->buffer, stream->length - first);
+  free(stream->buffer);
+  stream->buffer   = buffer;
+  stream->offset   = 0;
+  stream->capacity = capacity;
+  stream->mask     = capacity - 1;
+  stream->spill    = 0;
+  return stream;
+}
+
+// ensures room for length more bytes at the end of a ring
+STREAM_CDECL stream_t *_stream_ring_reserve(stream_t *stream,
+                                            const size_t length)
+{
+  if (stream->length + length <= stream->capacity)
+  {
+    return stream;
+  }
+  return _stream_ring_resize(stream, _stream_pow2(stream->length + length));
+}
+
+// copies length bytes into a ring from index i on, or zeroes them for null
+STREAM_CDECL void _stream_ring_put(stream_t *stream, size_t i,
+                                   const BYTE *Bytes, const size_t length)
+{
+  i            = i & stream->mask;
+  size_t first = min(length, stream->capacity - i);
+  if (Bytes)
+  {
+    memcpy(stream->buffer + i, Bytes, first);
+    memcpy(stream->buffer, Bytes + first, length - first);
+  }
+  else
+  {
+    memset(stream->buffer + i, 0, first);
+    memset(stream->buffer, 0, length - first);
+  }
+}
+
+// copies length bytes out of a ring from index i on
+STREAM_CDECL void _stream_ring_get(const stream_t *stream, size_t i, BYTE *out,
+                                   const size_t length)
+{
+  i            = i & stream->mask;
+  size_t first = min(length, stream->capacity - i);
+  memcpy(out, stream->buffer + i, first);
+  memcpy(out + first, stream->buffer, length - first);
+}
+
+// returns length bytes of a ring from index i on as one span, copying any
+// wrapped bytes into the spill past the end of the buffer. returns NULL
+// without touching the stream if the spill cannot be allocated.
+STREAM_CDECL STREAM_VOlATILE BYTE *_stream_ring_span(stream_t *stream,
+                                                     size_t i,
+                                                     const size_t length)
+{
+  i            = i & stream->mask;
+  size_t first = min(length, stream->capacity - i);
+  size_t rest  = length - first;
+  if (rest > stream->spill)
+  {
+    BYTE *buffer = (BYTE *) realloc(stream->buffer, stream->capacity + rest);
+    if (!buffer)
+    {
+      fprintf(stderr, "ERROR: Memory allocation error");
+      return NULL;
+    }
+    stream->buffer = buffer;
+    stream->spill  = rest;
+  }
+  memcpy(stream->buffer + stream->capacity, stream->buffer, rest);
+  return stream->buffer + i;
+}
+
 STREAM_CDECL stream_t *_stream_setcap(stream_t *stream, const size_t capacity)
 {
   size_t mincap =
     capacity < STREAM_MIN_CAPACITY ? STREAM_MIN_CAPACITY : capacity;
   if (!stream)
   {
-    stream = (stream_t *) malloc(sizeof(stream_t));
+    stream = (stream_t *) calloc(1, sizeof(stream_t));
     if (!stream)
     {
       fprintf(stderr, "ERROR: Memory allocation error");
       return NULL;
     }
-    stream->offset = 0;
-    stream->length = 0;
-    stream->buffer = (BYTE *) malloc(mincap);
-    if (!stream->buffer)
-    {
-      fprintf(stderr, "ERROR: Memory allocation error");
-      return NULL;
-    }
+  }
+  if (stream->mask)
+  {
+    mincap = _stream_pow2(max(mincap, stream->length));
+    return mincap == stream->capacity ? stream
+                                      : _stream_ring_resize(stream, mincap);
   }
   if (stream->capacity == mincap)
   {
     return stream;
   }
-  stream->buffer = (BYTE *) realloc(stream->buffer, mincap);
-  if (!stream->buffer)
+  if (stream->offset + stream->length > mincap)
+  {
+    stream         = _stream_reoffset(stream, 0);
+    stream->length = min(stream->length, mincap);
+  }
+  BYTE *buffer = (BYTE *) realloc(stream->buffer, mincap);
+  if (!buffer)
   {
     fprintf(stderr, "ERROR: Memory allocation error");
     return NULL;
   }
+  stream->buffer   = buffer;
+  stream->capacity = mincap;
   return stream;
 }
 
 STREAM_CDECL stream_t *_stream_growcap(stream_t *stream, const size_t mincap)
 {
-  if (!stream || (stream_lengthu(stream) < mincap))
+  if (!stream || (stream_capacityu(stream) < mincap))
   {
     return _stream_setcap(stream, mincap);
   }
@@ -326,7 +733,7 @@ STREAM_CDECL stream_t *_stream_growcap(stream_t *stream, const size_t mincap)
 
 STREAM_CDECL stream_t *_stream_reoffset(stream_t *stream, const size_t pos)
 {
-  if (!stream)
+  if (!stream || stream->mask)
   {
     return stream;
   }
@@ -335,20 +742,162 @@ STREAM_CDECL stream_t *_stream_reoffset(stream_t *stream, const size_t pos)
   {
     return stream;
   }
-  memmove(stream->buffer + stream->offset, stream->buffer + i, stream->length);
+  memmove(stream->buffer + i, stream->buffer + stream->offset, stream->length);
   stream->offset = i;
-  if (stream->offset > stream->length)
+  return stream;
+}
+
+// ensures room for length more bytes at the end, moving the bytes back to
+// the start once the dequeued prefix outweighs them and growing geometrically
+// otherwise
+STREAM_CDECL stream_t *_stream_reserve(stream_t *stream, const size_t length)
+{
+  if (stream && stream->mask)
+  {
+    return _stream_ring_reserve(stream, length);
+  }
+  size_t end = stream ? stream->offset + stream->length + length : length;
+  if (stream && end > stream->capacity && stream->offset >= stream->length)
   {
     stream = _stream_reoffset(stream, 0);
+    end    = stream->length + length;
   }
-  return stream;
+  if (stream && end > stream->capacity)
+  {
+    end = max(end, stream->capacity * 2);
+  }
+  return _stream_growcap(stream, end);
+}
+
+STREAM_CDECL stream_t *_stream_ring(stream_t *stream, const size_t capacity)
+{
+  stream = _stream_growcap(stream, STREAM_MIN_CAPACITY);
+  if (!stream)
+  {
+    return NULL;
+  }
+  size_t mincap = _stream_pow2(max(capacity, stream->length));
+  if (!stream->mask)
+  {
+    // a linear stream is a ring whose bytes do not wrap
+    stream           = _stream_reoffset(stream, 0);
+    stream->capacity = max(stream->capacity, stream->length);
+    stream->mask     = 1;
+    return _stream_ring_resize(stream, mincap);
+  }
+  return mincap == stream->capacity ? stream
+                                    : _stream_ring_resize(stream, mincap);
+}
+
+STREAM_CDECL size_t _stream_rspans(stream_t *stream, BYTE *ptrs[2],
+                                   size_t lens[2])
+{
+  if (!stream || !stream->length)
+  {
+    return 0;
+  }
+  ptrs[0] = stream->buffer + stream->offset;
+  lens[0] = stream->length;
+  if (!stream->mask || stream->offset + stream->length <= stream->capacity)
+  {
+    return 1;
+  }
+  lens[0] = stream->capacity - stream->offset;
+  ptrs[1] = stream->buffer;
+  lens[1] = stream->length - lens[0];
+  return 2;
+}
+
+STREAM_CDECL size_t _stream_wspans(stream_t *stream, BYTE *ptrs[2],
+                                   size_t lens[2])
+{
+  if (!stream || !stream->buffer)
+  {
+    return 0;
+  }
+  if (!stream->mask)
+  {
+    ptrs[0] = stream_endptr(stream);
+    lens[0] = stream->capacity - stream->offset - stream->length;
+    return lens[0] ? 1 : 0;
+  }
+  size_t free_ = stream->capacity - stream->length;
+  size_t tail  = (stream->offset + stream->length) & stream->mask;
+  if (!free_)
+  {
+    return 0;
+  }
+  ptrs[0] = stream->buffer + tail;
+  lens[0] = min(free_, stream->capacity - tail);
+  if (lens[0] == free_)
+  {
+    return 1;
+  }
+  ptrs[1] = stream->buffer;
+  lens[1] = free_ - lens[0];
+  return 2;
+}
+
+STREAM_CDECL size_t _stream_commitb(stream_t *stream, const size_t length)
+{
+  if (!stream)
+  {
+    return 0;
+  }
+  size_t maxlen =
+    min(length, stream->capacity - stream->length -
+                  (stream->mask ? 0 : stream->offset));
+  stream->length += maxlen;
+  return maxlen;
+}
+
+STREAM_CDECL size_t _stream_skipb(stream_t *stream, const size_t length)
+{
+  if (!stream)
+  {
+    return 0;
+  }
+  size_t maxlen = min(length, stream->length);
+  stream->offset += maxlen;
+  stream->length -= maxlen;
+  if (stream->mask)
+  {
+    stream->offset &= stream->mask;
+  }
+  if (!stream->length)
+  {
+    stream->offset = 0;
+  }
+  return maxlen;
 }
 
 STREAM_CDECL stream_t *_stream_pushbz(stream_t *stream, const size_t length)
 {
-  size_t slen = stream_lengthu(stream);
-  stream      = _stream_growcap(stream, slen + length);
-  memset(stream->buffer + stream->offset + slen, 0, length);
+  stream = _stream_reserve(stream, length);
+  if (stream->mask)
+  {
+    _stream_ring_put(stream, stream->offset + stream->length, NULL, length);
+  }
+  else
+  {
+    memset(stream_endptr(stream), 0, length);
+  }
+  stream->length += length;
+  return stream;
+}
+
+// opens a gap of length bytes at index i, unwrapping a ring first
+STREAM_CDECL stream_t *_stream_gap(stream_t *stream, const size_t length,
+                                   const size_t i)
+{
+  stream = _stream_reserve(stream, length);
+  if (stream->mask && stream->offset)
+  {
+    stream = _stream_ring_resize(stream, stream->capacity);
+  }
+  size_t at = min(i, stream->length);
+  memmove(stream->buffer + stream->offset + at + length,
+          stream->buffer + stream->offset + at, stream->length - at);
   stream->length += length;
   return stream;
 }
@@ -356,21 +905,24 @@ STREAM_CDECL stream_t *_stream_pushbz(stream_t *stream, const size_t length)
 STREAM_CDECL stream_t *_stream_insbz(stream_t *stream, const size_t length,
                                      const size_t i)
 {
-  size_t slen = stream_lengthu(stream);
-  stream      = _stream_growcap(stream, slen + length);
-  memmove(stream->buffer + stream->offset + i + length,
-          stream->buffer + stream->offset + i, length);
-  memset(stream->buffer + stream->offset + i, 0, length);
-  stream->length += length;
+  stream = _stream_gap(stream, length, i);
+  memset(stream->buffer + stream->offset + min(i, stream->length - length), 0,
+         length);
   return stream;
 }
 
 STREAM_CDECL stream_t *_stream_pushb(stream_t *stream, const size_t length,
                                      const BYTE *Bytes)
 {
-  size_t slen = stream_lengthu(stream);
-  stream      = _stream_growcap(stream, slen + length);
-  memcpy(stream->buffer + stream->offset + slen, Bytes, length);
+  stream = _stream_reserve(stream, length);
+  if (stream->mask)
+  {
+    _stream_ring_put(stream, stream->offset + stream->length, Bytes, length);
+  }
+  else
+  {
+    memcpy(stream_endptr(stream), Bytes, length);
+  }
   stream->length += length;
   return stream;
 }
@@ -378,12 +930,9 @@ STREAM_CDECL stream_t *_stream_pushb(stream_t *stream, const size_t length,
 STREAM_CDECL stream_t *_stream_insb(stream_t *stream, const size_t length,
                                     const BYTE *Bytes, const size_t i)
 {
-  size_t slen = stream_lengthu(stream);
-  stream      = _stream_growcap(stream, slen + length);
-  memmove(stream->buffer + stream->offset + i + length,
-          stream->buffer + stream->offset + i, length);
-  memcpy(stream->buffer + stream->offset + i, Bytes, length);
-  stream->length += length;
+  stream = _stream_gap(stream, length, i);
+  memcpy(stream->buffer + stream->offset + min(i, stream->length - length),
+         Bytes, length);
   return stream;
 }
 
@@ -391,7 +940,16 @@ STREAM_CDECL STREAM_VOlATILE BYTE *_stream_popb(stream_t *stream,
                                                 const size_t length)
 {
   size_t maxlen = min(length, stream->length);
-  BYTE *result  = stream->buffer + stream->offset + stream->length - maxlen;
+  BYTE *result  = stream->mask
+                    ? _stream_ring_span(stream,
+                                       stream->offset + stream->length - maxlen,
+                                       maxlen)
+                    : stream_endptr(stream) - maxlen;
+  // a failed spill allocation leaves the bytes in the stream
+  if (!result)
+  {
+    return NULL;
+  }
   stream->length -= maxlen;
   return result;
 }
@@ -400,12 +958,22 @@ STREAM_CDECL STREAM_VOlATILE BYTE *_stream_deqb(stream_t *stream,
                                                 const size_t length)
 {
   size_t maxlen = min(length, stream->length);
+  BYTE *result  = stream->mask
+                    ? _stream_ring_span(stream, stream->offset, maxlen)
+                    : stream_begptr(stream);
+  if (!result)
+  {
+    return NULL;
+  }
   stream->length -= maxlen;
-  BYTE *result = stream->buffer + stream->offset;
   stream->offset += maxlen;
-  if (stream->offset > stream->length)
+  if (stream->mask)
   {
-    stream = _stream_reoffset(stream, 0);
+    stream->offset &= stream->mask;
+  }
+  else if (!stream->length)
+  {
+    stream->offset = 0;
   }
   return result;
 }
@@ -473,6 +1041,440 @@ STREAM_CDECL size_t _stream_write(stream_t *stream, const void *ptr,
   return count;
 }
 
+STREAM_CDECL stream_spsc_t *_stream_spsc(const size_t capacity)
+{
+  stream_spsc_t *queue = (stream_spsc_t *) calloc(1, sizeof(stream_spsc_t));
+  if (!queue)
+  {
+    fprintf(stderr, "ERROR: Memory allocation error");
+    return NULL;
+  }
+  queue->ring.capacity = _stream_pow2(capacity);
+  queue->ring.mask     = queue->ring.capacity - 1;
+  queue->ring.buffer   = (BYTE *) malloc(queue->ring.capacity);
+  if (!queue->ring.buffer)
+  {
+    fprintf(stderr, "ERROR: Memory allocation error");
+    free(queue);
+    return NULL;
+  }
+  return queue;
+}
+
+STREAM_CDECL int _stream_spsc_writeb(stream_spsc_t *queue, const size_t length,
+                                     const BYTE *Bytes)
+{
+  size_t room = queue->ring.capacity - (queue->pending - queue->headcache);
+  if (room < length)
+  {
+    queue->headcache = _stream_load_acquire(&queue->head);
+    room = queue->ring.capacity - (queue->pending - queue->headcache);
+    if (room < length)
+    {
+      return 0;
+    }
+  }
+  _stream_ring_put(&queue->ring, queue->pending, Bytes, length);
+  queue->pending += length;
+  return 1;
+}
+
+STREAM_CDECL void _stream_spsc_flush(stream_spsc_t *queue)
+{
+  _stream_store_release(&queue->tail, queue->pending);
+}
+
+STREAM_CDECL int _stream_spsc_pushb(stream_spsc_t *queue, const size_t length,
+                                    const BYTE *Bytes)
+{
+  if (!_stream_spsc_writeb(queue, length, Bytes))
+  {
+    return 0;
+  }
+  _stream_spsc_flush(queue);
+  return 1;
+}
+
+STREAM_CDECL size_t _stream_spsc_deqb(stream_spsc_t *queue,
+                                      const size_t length, BYTE *out)
+{
+  size_t head = _stream_load_relaxed(&queue->head);
+  if (queue->tailcache - head < length)
+  {
+    queue->tailcache = _stream_load_acquire(&queue->tail);
+  }
+  size_t maxlen = min(length, queue->tailcache - head);
+  if (maxlen)
+  {
+    _stream_ring_get(&queue->ring, head, out, maxlen);
+    _stream_store_release(&queue->head, head + maxlen);
+  }
+  return maxlen;
+}
+
+STREAM_CDECL size_t _stream_spsc_length(stream_spsc_t *queue)
+{
+  size_t head = _stream_load_acquire(&queue->head);
+  return _stream_load_acquire(&queue->tail) - head;
+}
+
+STREAM_CDECL void _stream_spsc_free(stream_spsc_t *queue)
+{
+  if (queue)
+  {
+    free(queue->ring.buffer);
+    free(queue);
+  }
+}
+
+STREAM_CDECL stream_mpmc_t *_stream_mpmc(const size_t slots,
+                                         const size_t slotsize)
+{
+  stream_mpmc_t *queue = (stream_mpmc_t *) calloc(1, sizeof(stream_mpmc_t));
+  if (!queue)
+  {
+    fprintf(stderr, "ERROR: Memory allocation error");
+    return NULL;
+  }
+  size_t count = 1;
+  while (count < slots)
+  {
+    count <<= 1;
+  }
+  // whole, line-aligned cache lines per cell keep neighbouring cells'
+  // writers apart; the block is over-allocated by a line to align the cells
+  size_t line     = STREAM_CACHE_LINE;
+  queue->mask     = count - 1;
+  queue->slotsize = slotsize;
+  queue->stride   = (2 * sizeof(size_t) + slotsize + line - 1) / line * line;
+  queue->block    = (BYTE *) malloc(count * queue->stride + line - 1);
+  if (!queue->block)
+  {
+    fprintf(stderr, "ERROR: Memory allocation error");
+    free(queue);
+    return NULL;
+  }
+  queue->cells =
+    queue->block + ((line - (size_t) queue->block % line) % line);
+  for (size_t i = 0; i < count; ++i)
+  {
+    *(size_t *) (queue->cells + i * queue->stride) = i;
+  }
+  return queue;
+}
+
+// the sequence number of position pos's cell, followed by its length and
+// payload
+#define _stream_mpmc_cell(Queue, Pos)                                          \
+  ((size_t *) ((Queue)->cells + ((Pos) & (Queue)->mask) * (Queue)->stride))
+
+STREAM_CDECL int _stream_mpmc_pushb(stream_mpmc_t *queue, const size_t length,
+                                    const BYTE *Bytes)
+{
+  if (length > queue->slotsize)
+  {
+    return 0;
+  }
+  size_t pos = _stream_load_relaxed(&queue->enq);
+  size_t *cell;
+  for (;;)
+  {
+    cell          = _stream_mpmc_cell(queue, pos);
+    size_t seq    = _stream_load_acquire(cell);
+    ptrdiff_t dif = (ptrdiff_t) (seq - pos);
+    if (dif == 0 && _stream_cas(&queue->enq, pos, pos + 1))
+    {
+      break;
+    }
+    if (dif < 0)
+    {
+      return 0;
+    }
+    pos = _stream_load_relaxed(&queue->enq);
+  }
+  cell[1] = length;
+  memcpy(cell + 2, Bytes, length);
+  _stream_store_release(cell, pos + 1);
+  return 1;
+}
+
+STREAM_CDECL size_t _stream_mpmc_deqb(stream_mpmc_t *queue,
+                                      const size_t length, BYTE *out)
+{
+  size_t pos = _stream_load_relaxed(&queue->deq);
+  size_t *cell;
+  for (;;)
+  {
+    cell          = _stream_mpmc_cell(queue, pos);
+    size_t seq    = _stream_load_acquire(cell);
+    ptrdiff_t dif = (ptrdiff_t) (seq - (pos + 1));
+    if (dif == 0 && _stream_cas(&queue->deq, pos, pos + 1))
+    {
+      break;
+    }
+    if (dif < 0)
+    {
+      return 0;
+    }
+    pos = _stream_load_relaxed(&queue->deq);
+  }
+  size_t maxlen = min(length, cell[1]);
+  memcpy(out, cell + 2, maxlen);
+  _stream_store_release(cell, pos + queue->mask + 1);
+  return maxlen;
+}
+
+STREAM_CDECL void _stream_mpmc_free(stream_mpmc_t *queue)
+{
+  if (queue)
+  {
+    free(queue->block);
+    free(queue);
+  }
+}
+
+STREAM_CDECL stream_pool_t *_stream_pool(const size_t chunksize)
+{
+  stream_pool_t *pool = (stream_pool_t *) calloc(1, sizeof(stream_pool_t));
+  if (!pool)
+  {
+    fprintf(stderr, "ERROR: Memory allocation error");
+    return NULL;
+  }
+  pool->chunksize = max(chunksize, (size_t) STREAM_MIN_CAPACITY);
+  return pool;
+}
+
+STREAM_CDECL void _stream_pool_free(stream_pool_t *pool)
+{
+  if (!pool)
+  {
+    return;
+  }
+  while (pool->idle)
+  {
+    stream_chunk_t *next = pool->idle->next;
+    free(pool->idle);
+    pool->idle = next;
+  }
+  free(pool);
+}
+
+STREAM_CDECL stream_chunk_t *_stream_pool_take(stream_pool_t *pool)
+{
+  stream_chunk_t *chunk = pool->idle;
+  if (chunk)
+  {
+    pool->idle = chunk->next;
+  }
+  else
+  {
+    chunk = (stream_chunk_t *) malloc(sizeof(stream_chunk_t) + pool->chunksize);
+    if (!chunk)
+    {
+      fprintf(stderr, "ERROR: Memory allocation error");
+      return NULL;
+    }
+  }
+  chunk->next = NULL;
+  chunk->refs = 1;
+  chunk->used = 0;
+  return chunk;
+}
+
+STREAM_CDECL void _stream_pool_release(stream_pool_t *pool,
+                                       stream_chunk_t *chunk)
+{
+  if (chunk && --chunk->refs == 0)
+  {
+    chunk->next = pool->idle;
+    pool->idle  = chunk;
+  }
+}
+
+STREAM_CDECL stream_chain_t *_stream_chain(stream_pool_t *pool)
+{
+  stream_chain_t *chain = (stream_chain_t *) calloc(1, sizeof(stream_chain_t));
+  if (!chain)
+  {
+    fprintf(stderr, "ERROR: Memory allocation error");
+    return NULL;
+  }
+  chain->ownpool = !pool;
+  chain->pool    = pool ? pool : _stream_pool(STREAM_CHUNK_SIZE);
+  if (!chain->pool)
+  {
+    free(chain);
+    return NULL;
+  }
+  return chain;
+}
+
+// opens room for one segment descriptor at index k
+STREAM_CDECL stream_seg_t *_stream_chain_open(stream_chain_t *chain,
+                                              const size_t k)
+{
+  if (chain->nsegs == chain->capsegs)
+  {
+    size_t cap        = max(chain->capsegs * 2, (size_t) 16);
+    stream_seg_t *seg = (stream_seg_t *) realloc(chain->segs,
+                                                 cap * sizeof(stream_seg_t));
+    if (!seg)
+    {
+      fprintf(stderr, "ERROR: Memory allocation error");
+      return NULL;
+    }
+    chain->segs    = seg;
+    chain->capsegs = cap;
+  }
+  memmove(chain->segs + k + 1, chain->segs + k,
+          (chain->nsegs - k) * sizeof(stream_seg_t));
+  chain->nsegs++;
+  return chain->segs + k;
+}
+
+STREAM_CDECL int _stream_chain_insb(stream_chain_t *chain, size_t length,
+                                    const BYTE *Bytes, const size_t i)
+{
+  // find the segment holding index i, splitting it there
+  size_t k = 0, at = min(i, chain->length);
+  for (; k < chain->nsegs && at >= chain->segs[k].length; ++k)
+  {
+    at -= chain->segs[k].length;
+  }
+  if (at)
+  {
+    stream_seg_t *seg = _stream_chain_open(chain, k + 1);
+    if (!seg)
+    {
+      return 0;
+    }
+    *seg           = seg[-1];
+    seg[-1].length = at;
+    seg->ptr += at;
+    seg->length -= at;
+    seg->chunk->refs++;
+    ++k;
+  }
+  // new bytes go after whatever the filling chunk holds, extending the
+  // previous segment when it ends right there
+  while (length)
+  {
+    stream_chunk_t *fill = chain->fill;
+    if (!fill || fill->used == chain->pool->chunksize)
+    {
+      _stream_pool_release(chain->pool, fill);
+      fill = chain->fill = _stream_pool_take(chain->pool);
+      if (!fill)
+      {
+        return 0;
+      }
+    }
+    size_t n          = min(length, chain->pool->chunksize - fill->used);
+    BYTE *ptr         = fill->data + fill->used;
+    stream_seg_t *seg = k ? chain->segs + k - 1 : NULL;
+    if (!seg || seg->chunk != fill || seg->ptr + seg->length != ptr)
+    {
+      seg = _stream_chain_open(chain, k++);
+      if (!seg)
+      {
+        return 0;
+      }
+      *seg = (stream_seg_t){fill, ptr, 0};
+      fill->refs++;
+    }
+    memcpy(ptr, Bytes, n);
+    fill->used += n;
+    seg->length += n;
+    chain->length += n;
+    Bytes += n;
+    length -= n;
+  }
+  return 1;
+}
+
+STREAM_CDECL size_t _stream_chain_deqb(stream_chain_t *chain,
+                                       const size_t length, BYTE *out)
+{
+  size_t done = 0, k = 0;
+  for (; k < chain->nsegs && done < length; ++k)
+  {
+    stream_seg_t *seg = chain->segs + k;
+    size_t n          = min(length - done, seg->length);
+    if (out)
+    {
+      memcpy(out + done, seg->ptr, n);
+    }
+    done += n;
+    seg->ptr += n;
+    seg->length -= n;
+    if (seg->length)
+    {
+      break;
+    }
+    _stream_pool_release(chain->pool, seg->chunk);
+  }
+  if (k)
+  {
+    memmove(chain->segs, chain->segs + k,
+            (chain->nsegs - k) * sizeof(stream_seg_t));
+    chain->nsegs -= k;
+  }
+  chain->length -= done;
+  return done;
+}
+
+STREAM_CDECL size_t _stream_chain_copy(stream_chain_t *chain, const size_t i,
+                                       const size_t length, BYTE *out)
+{
+  size_t done = 0, at = i;
+  for (size_t k = 0; k < chain->nsegs && done < length; ++k)
+  {
+    stream_seg_t *seg = chain->segs + k;
+    if (at >= seg->length)
+    {
+      at -= seg->length;
+      continue;
+    }
+    size_t n = min(length - done, seg->length - at);
+    memcpy(out + done, seg->ptr + at, n);
+    done += n;
+    at = 0;
+  }
+  return done;
+}
+
+STREAM_CDECL size_t _stream_chain_iov(stream_chain_t *chain,
+                                      stream_iovec_t *iov, const size_t max)
+{
+  size_t n = min(max, chain->nsegs);
+  for (size_t k = 0; k < n; ++k)
+  {
+    iov[k].iov_base = (void *) chain->segs[k].ptr;
+    iov[k].iov_len  = chain->segs[k].length;
+  }
+  return n;
+}
+
+STREAM_CDECL void _stream_chain_free(stream_chain_t *chain)
+{
+  if (!chain)
+  {
+    return;
+  }
+  for (size_t k = 0; k < chain->nsegs; ++k)
+  {
+    _stream_pool_release(chain->pool, chain->segs[k].chunk);
+  }
+  _stream_pool_release(chain->pool, chain->fill);
+  if (chain->ownpool)
+  {
+    _stream_pool_free(chain->pool);
+  }
+  free(chain->segs);
+  free(chain);
+}
+
 STREAM_CDECL streamiter_t _streamiter(stream_t *stream)
 {
   if (!stream)
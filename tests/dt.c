@@ -2,12 +2,229 @@
 #include "../dt.h"
 #include "../test.h"
 
+typedef struct test_alloc_t
+{
+  size_t live;
+  size_t total;
+} test_alloc_t;
+
+static void *test_alloc(void *user, size_t size)
+{
+  ((test_alloc_t *) user)->live++;
+  ((test_alloc_t *) user)->total++;
+  return malloc(size);
+}
+
+static void *test_resize(void *user, void *ptr, size_t old_size,
+                         size_t new_size)
+{
+  (void) user;
+  (void) old_size;
+  return realloc(ptr, new_size);
+}
+
+static void test_release(void *user, void *ptr)
+{
+  ((test_alloc_t *) user)->live--;
+  free(ptr);
+}
+
+static test_alloc_t test_counts = {0};
+static const dt_allocator_t test_counter = {test_alloc, test_resize,
+                                            test_release, &test_counts};
+
+bool test_allocator_load()
+{
+  dt_node *node = dt_loadf_ex("./res/mid.json", &test_counter);
+  bool used     = node != NULL && test_counts.total > 0 &&
+                  dt_arralloc(node->map_v - 1) == &test_counter;
+  dt_free_ex(node, &test_counter);
+  return used && test_counts.live == 0;
+}
+
+// plain dt_free must release a tree through the allocator it was loaded with
+bool test_allocator_free()
+{
+  dt_node *node = dt_loads_ex("{a: [1, 2.5, \"three\"], b: null}",
+                              &test_counter);
+  bool used     = node != NULL && node->alloc == &test_counter &&
+                  test_counts.live > 0;
+  dt_free(node);
+  return used && test_counts.live == 0 && dt_allocator() == NULL;
+}
+
+bool test_allocator_map()
+{
+  dt_kvp(long, long) *map = NULL;
+  dt_mapinit(map, &test_counter);
+  for (long i = 0; i < 1000; ++i)
+  {
+    dt_mapput(map, i, i * i);
+  }
+  for (long i = 0; i < 1000; i += 2)
+  {
+    (void) dt_mapdel(map, i);
+  }
+  long key   = 31;
+  bool found = dt_maplen(map) == 500 && dt_mapget(map, key) == 961;
+  dt_mapfree(map);
+  return found && test_counts.live == 0;
+}
+
+bool test_arralign()
+{
+  float *values = NULL;
+  dt_arralign(values, 64);
+  bool aligned = true;
+  for (int i = 0; i < 10000; ++i)
+  {
+    dt_arrput(values, (float) i);
+    aligned = aligned && ((size_t) values & 63) == 0;
+  }
+  float more[100];
+  for (int i = 0; i < 100; ++i)
+  {
+    more[i] = (float) (10000 + i);
+  }
+  size_t len  = dt_arrappend_n(values, more, 100);
+  bool intact = len == 10100 && dt_arrlen(values) == 10100;
+  for (int i = 0; i < 10100; ++i)
+  {
+    intact = intact && values[i] == (float) i;
+  }
+  dt_arrsetlen(values, 50000);
+  aligned = aligned && ((size_t) values & 63) == 0;
+  intact  = intact && dt_arrlen(values) == 50000 && values[10099] == 10099.0f;
+  dt_arrfree(values);
+  return aligned && intact;
+}
+
+bool test_arrappend()
+{
+  float more[4] = {1.0f, 2.0f, 3.0f, 4.0f};
+  float *values = NULL;
+  size_t count  = 0;
+  // Len is evaluated once, and an empty append still yields the length
+  bool ok = dt_arrappend_n(values, more, ++count) == 1 && count == 1;
+  ok      = ok && dt_arrappend_n(values, more, 0) == 1;
+  ok      = ok && dt_arrappend_n(values, more + 1, 3) == 4;
+  for (int i = 0; i < 4; ++i)
+  {
+    ok = ok && values[i] == more[i];
+  }
+  dt_arrfree(values);
+  return ok;
+}
+
+typedef dt_kvp(long, long) test_kvp;
+
+// live entries must come out in insertion order: ascending keys here
+static bool test_ordered_keys(test_kvp *map, long *expect, size_t n)
+{
+  size_t seen = 0;
+  for (ptrdiff_t i = 0; i < dt_maplen(map); ++i)
+  {
+    if (!dt_maplive(map, i))
+    {
+      continue;
+    }
+    if (seen >= n || map[i].key != expect[seen] ||
+        map[i].value != expect[seen] * 2)
+    {
+      return false;
+    }
+    ++seen;
+  }
+  return seen == n && dt_mapcount(map) == n;
+}
+
+bool test_ordered_map()
+{
+  test_kvp *map = NULL;
+  long *expect  = NULL;
+  bool ok       = true;
+  dt_mapinit_ordered(map, NULL);
+  for (long i = 0; i < 20000; ++i)
+  {
+    dt_mapput(map, i, i * 2);
+  }
+  // churn from the front so holes, compaction, and rebuilds all overlap
+  for (long i = 0; i < 20000; ++i)
+  {
+    if (i % 3 != 0)
+    {
+      (void) dt_mapdel(map, i);
+    }
+    if (i % 7 == 0)
+    {
+      long key = 20000 + i;
+      dt_mapput(map, key, key * 2);
+    }
+  }
+  for (long i = 0; i < 20000; i += 3)
+  {
+    dt_arrput(expect, i);
+  }
+  for (long i = 0; i < 20000; i += 7)
+  {
+    dt_arrput(expect, 20000 + i);
+  }
+  ok = ok && test_ordered_keys(map, expect, dt_arrlenu(expect));
+  for (size_t i = 0; i < dt_arrlenu(expect); ++i)
+  {
+    long key = expect[i];
+    ok       = ok && dt_mapget(map, key) == key * 2;
+  }
+  long missing = 1;
+  ok           = ok && dt_mapgeti(map, missing) < 0;
+  // once the deferred work catches up, holes are at most a quarter
+  for (size_t i = 0; i < dt_arrlenu(expect); ++i)
+  {
+    long key = expect[i];
+    dt_mapput(map, key, key * 2);
+  }
+  ok = ok && dt_maplenu(map) - dt_mapcount(map) <= dt_maplenu(map) / 4;
+  ok = ok && test_ordered_keys(map, expect, dt_arrlenu(expect));
+  dt_mapfree(map);
+  dt_arrfree(expect);
+  return ok;
+}
+
+bool test_ordered_smp()
+{
+  dt_kvp(char *, int) *map = NULL;
+  char key[32];
+  dt_smpinit(map, DT_SMP_STRDUP | DT_MAP_ORDERED, &test_counter);
+  for (int i = 0; i < 5000; ++i)
+  {
+    snprintf(key, sizeof(key), "k%d", i);
+    dt_smpput(map, key, i);
+  }
+  for (int i = 0; i < 5000; i += 2)
+  {
+    snprintf(key, sizeof(key), "k%d", i);
+    (void) dt_smpdel(map, key);
+  }
+  int last = -1;
+  bool ok  = dt_smpcount(map) == 2500;
+  for (ptrdiff_t i = 0; i < dt_smplen(map); ++i)
+  {
+    if (dt_smplive(map, i))
+    {
+      ok   = ok && map[i].value > last && map[i].value % 2 == 1;
+      last = map[i].value;
+    }
+  }
+  ok = ok && dt_smpget(map, "k4999") == 4999 && dt_smpgeti(map, "k0") < 0;
+  dt_smpfree(map);
+  return ok && test_counts.live == 0;
+}
+
 int main()
 {
-  const char *files[] = {"./res/test.dt", "./res/test.json", "./res/mid.json",
-                         "./res/large.json"};
+  const char *files[] = {"./res/test.dt", "./res/test.json", "./res/mid.json"};
   test_group(dt, {
-    for (int i = 0; i < 1; ++i)
+    for (size_t i = 0; i < sizeof(files) / sizeof(*files); ++i)
     {
       const char *filepath = files[i];
       dt_node *node        = dt_loadf(filepath);
@@ -17,8 +234,36 @@ int main()
       byte *bytes = dt_dumpb(node, &len);
       test_true(bytes != NULL);
 
+      dt_node *copy = dt_loadb(len, bytes);
+      test_true(copy != NULL);
+
+      char *text      = dt_dumps(node);
+      char *copy_text = dt_dumps(copy);
+      test_true(strcmp(text, copy_text) == 0);
+
+      _dt_free(text);
+      _dt_free(copy_text);
+      dt_arrfree(bytes);
+      dt_free(copy);
       dt_free(node);
     }
   });
+
+  test_group(dt_allocator, {
+    test_true(test_allocator_load());
+    test_true(test_allocator_free());
+    test_true(test_allocator_map());
+    test_true(dt_allocator() == NULL);
+  });
+
+  test_group(dt_ordered_map, {
+    test_true(test_ordered_map());
+    test_true(test_ordered_smp());
+  });
+
+  test_group(dt_arr, {
+    test_true(test_arralign());
+    test_true(test_arrappend());
+  });
   return 0;
-}
\ No newline at end of file
+}
@@ -1,5 +1,8 @@
 
 #include "../gm.h"
+#include <string.h>
+// test.h has its own double-precision feq
+#define feq test_feq
 #include "../test.h"
 
 bool test_vec2i_addition()
@@ -45,6 +48,1070 @@ bool test_quat_conjugate()
   return true;
 }
 
+static bool test_v4f_near(const vec4f l, const vec4f r)
+{
+  for (size_t i = 0; i < 4; ++i)
+  {
+    if (fabsf(l.a[i] - r.a[i]) > 1.e-4f)
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool test_v4f_ops()
+{
+  vec4f a = v4f(1, -2, 3, 0.5f);
+  vec4f b = v4f(-4, 5, 0.25f, 2);
+  vec4f c = v4f_cross(a, b);
+  vec4f n = v4f_normalize(a);
+  float l = sqrtf(1 + 4 + 9 + 0.25f);
+  return test_v4f_near(v4f_add(a, b), v4f(-3, 3, 3.25f, 2.5f)) &&
+         test_v4f_near(v4f_sub(a, b), v4f(5, -7, 2.75f, -1.5f)) &&
+         test_v4f_near(v4f_mul(a, b), v4f(-4, -10, 0.75f, 1)) &&
+         test_v4f_near(v4f_div(a, b), v4f(-0.25f, -0.4f, 12, 0.25f)) &&
+         test_v4f_near(v4f_smul(a, 2), v4f(2, -4, 6, 1)) &&
+         fabsf(v4f_dot(a, b) - (-4 - 10 + 0.75f + 1)) < 1.e-4f &&
+         fabsf(v4f_len(a) - l) < 1.e-4f &&
+         test_v4f_near(n, v4f(1 / l, -2 / l, 3 / l, 0.5f / l)) &&
+         test_v4f_near(c, v4f(-2 * 0.25f - 3 * 5, 3 * -4 - 1 * 0.25f,
+                              1 * 5 - -2 * -4, 0)) &&
+         test_v4f_near(v4f_normalize(v4f_zero), v4f_zero);
+}
+
+bool test_m4f_mul()
+{
+  mat4f l = m4f(1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6);
+  mat4f r = m4f(0.5f, -1, 2, 0, 3, 1, -2, 4, 0, 0, 1, 0, -3, 2, 1, 1);
+  mat4f v = m4f_mul(l, r);
+  for (size_t i = 0; i < 4; i++)
+  {
+    for (size_t j = 0; j < 4; j++)
+    {
+      float e = 0;
+      for (size_t k = 0; k < 4; k++)
+      {
+        e += l.a[k * 4 + i] * r.a[j * 4 + k];
+      }
+      if (fabsf(v.a[j * 4 + i] - e) > 1.e-4f)
+      {
+        return false;
+      }
+    }
+  }
+  return m4f_eq(m4f_transpose(m4f_transpose(l)), l) &&
+         m4f_eq(m4f_mul(l, m4f_ident), l);
+}
+
+bool test_m4f_mulv()
+{
+  mat4f t = m4f_tpos(v3f(3, 4, 5));
+  mat4f m = m4f(1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6);
+  vec4f p = v4f(1, 2, 3, 1);
+  return test_v4f_near(m4f_mulv(t, p), v4f(4, 6, 8, 1)) &&
+         test_v4f_near(m4f_mulv(m, p), v4f(18, 46, 14, 32));
+}
+
+bool test_quat_rotate()
+{
+  quatf a = qf_aangle(afrads(gm_pi / 2), v3f_up);
+  quatf b = qf_normalize(qf(0.5f, 1, -2, 0.25f));
+  vec4f v = v4f(1, 2, 3, 0);
+  vec4f m = v4f_zero;
+  mat3f r = qf_rotm(b);
+  for (size_t i = 0; i < 3; i++)
+  {
+    for (size_t k = 0; k < 3; k++)
+    {
+      m.a[i] += r.a[i * 3 + k] * v.a[k];
+    }
+  }
+  return test_v4f_near(qf_rotv(qf_ident, v), v) &&
+         test_v4f_near(qf_rotv(a, v4f_right), v4f(0, 0, -1, 0)) &&
+         test_v4f_near(qf_rotv(b, v), m) &&
+         test_v4f_near(qf_rotv(qf_mul(a, b), v), qf_rotv(a, qf_rotv(b, v))) &&
+         fabsf(qf_len(b) - 1) < 1.e-5f;
+}
+
+bool test_batch_kernels()
+{
+  enum
+  {
+    count = 19
+  };
+  vec3f in[count], out[count], rot[count], nrm[count];
+  float dots[count];
+  for (size_t i = 0; i < count; ++i)
+  {
+    in[i] = v3f((float) i - 7, (float) (i * i % 5) - 2, 0.5f * (float) i);
+  }
+  in[3]   = v3f_zero;
+  mat4f m = m4f_trs(v3f(3, 4, 5), v3f(30, 45, 10), v3f(2, 2, 2));
+  quatf q = qf_normalize(qf(0.5f, 1, -2, 0.25f));
+  m4f_transform_points(m, in, out, count);
+  qf_rotate_many(q, in, rot, count);
+  v3f_normalize_many(in, nrm, count);
+  v3f_dot_many(in, out, dots, count);
+  for (size_t i = 0; i < count; ++i)
+  {
+    vec4f p = m4f_mulv(m, v4f(in[i].x, in[i].y, in[i].z, 1));
+    vec4f r = qf_rotv(q, v4f(in[i].x, in[i].y, in[i].z, 0));
+    vec3f n = v3f_normalize(in[i]);
+    if (!test_v4f_near(p, v4f(out[i].x, out[i].y, out[i].z, p.w)) ||
+        !test_v4f_near(r, v4f(rot[i].x, rot[i].y, rot[i].z, 0)) ||
+        !test_v4f_near(v4f(n.x, n.y, n.z, 0),
+                       v4f(nrm[i].x, nrm[i].y, nrm[i].z, 0)) ||
+        fabsf(dots[i] - v3f_dot(in[i], out[i])) > 1.e-3f)
+    {
+      return false;
+    }
+  }
+  v3f_normalize_many(in, in, count);
+  return memcmp(in, nrm, sizeof in) == 0;
+}
+
+bool test_vec3f_x8()
+{
+  vec3f in[8], out[8];
+  for (size_t i = 0; i < 8; ++i)
+  {
+    in[i] = v3f((float) i, 2 - (float) i, 0.25f * (float) (i * i));
+  }
+  in[5]      = v3f_zero;
+  vec3f_x8 a = v3f_x8_pack(in, 8);
+  vec3f_x8 b = v3f_x8_set1(v3f(1, -2, 3));
+  vec3f_x8 c = v3f_x8_cross(a, b);
+  vec3f_x8 n = v3f_x8_normalize(a);
+  float_x8 d = v3f_x8_dot(a, b);
+  float_x8 l = v3f_x8_len(a);
+  vec3f_x8 m = v3f_x8_clamp(a, v3f_x8_set1(v3f(0, 0, 0)),
+                            v3f_x8_set1(v3f(4, 4, 4)));
+  vec3f_x8 t = v3f_x8_lerp(a, b, 0.5f);
+  for (size_t i = 0; i < 8; ++i)
+  {
+    vec3f p = in[i];
+    vec3f q = v3f(1, -2, 3);
+    if (!v3f_eq(v3f_x8_get(c, i), v3f_cross(p, q)) ||
+        !v3f_eq(v3f_x8_get(n, i), v3f_normalize(p)) ||
+        !v3f_eq(v3f_x8_get(m, i), v3f_clamp(p, v3f_zero, v3f(4, 4, 4))) ||
+        !v3f_eq(v3f_x8_get(t, i), v3f_lerp(p, q, 0.5f)) ||
+        !feq(d.a[i], v3f_dot(p, q)) || !feq(l.a[i], v3f_len(p)))
+    {
+      return false;
+    }
+  }
+  vec3f_x8 tail = v3f_x8_pack(in, 3);
+  v3f_x8_set(&tail, 3, v3f(7, 8, 9));
+  v3f_x8_unpack(v3f_x8_add(a, v3f_x8_sub(b, b)), out, 8);
+  return memcmp(in, out, sizeof in) == 0 && tail.x.a[3] == 7 &&
+         tail.z.a[3] == 9 && tail.y.a[4] == 0 && v3f_x8_get(tail, 2).y == 0;
+}
+
+static bool test_floats_near(const float *l, const float *r, size_t n,
+                             float tol)
+{
+  for (size_t i = 0; i < n; ++i)
+  {
+    if (fabsf(l[i] - r[i]) > tol)
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool test_mat_inverse()
+{
+  mat4f m  = m4f(2, 0, 1, 3, 1, 4, 0, 2, 0, 1, 5, 1, 3, 2, 1, 6);
+  mat4d md = m4d(2, 0, 1, 3, 1, 4, 0, 2, 0, 1, 5, 1, 3, 2, 1, 6);
+  mat4f s  = m4f(1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6);
+  mat4f mi = m4f_inv(m);
+  mat4d di = m4d_inv(md);
+  float dif[16];
+  for (size_t i = 0; i < 16; ++i)
+  {
+    dif[i] = (float) di.a[i];
+  }
+  mat4f si;
+  mat3f n = m3f(4, 1, 0, 2, 3, 1, 1, 5, 2);
+  mat2f p = m2f(4, 7, 2, 6);
+  mat4f a = m4f_trs(v3f(3, -4, 5), v3f(30, 10, -20), v3f(2, 3, 0.5f));
+  mat4f c = m4f_mul(a, m4f_ainv(a));
+  return test_floats_near(mi.a, dif, 16, 1.e-5f) &&
+         test_floats_near(m4f_mul(m, mi).a, m4f_ident.a, 16, 1.e-5f) &&
+         !m4f_tryinv(s, &si) && m4f_eq(m4f_inv(s), s) &&
+         test_floats_near(m3f_mul(n, m3f_inv(n)).a, m3f_ident.a, 9,
+                          1.e-5f) &&
+         test_floats_near(m2f_mul(p, m2f_inv(p)).a, m2f_ident.a, 4,
+                          1.e-5f) &&
+         test_floats_near(c.a, m4f_ident.a, 16, 1.e-5f) &&
+         test_floats_near(m4f_ainv(a).a, m4f_inv(a).a, 16, 1.e-5f);
+}
+
+// rank-deficient float input whose rounded determinant is not exactly zero
+// must be rejected, while a well-conditioned matrix of small scale is not
+bool test_mat_inverse_near_singular()
+{
+  // row 2 is 0.1 row 0 + 0.3 row 1
+  mat4f m = m4f(1.3f, 0.7f, 2.1f, 0.4f, 0.6f, 1.9f, 0.2f, 1.1f, 0.31f, 0.64f,
+                0.27f, 0.37f, 0.5f, 0.8f, 1.7f, 2.3f);
+  // row 2 is 0.1 row 0 + 0.1 row 1
+  mat3f n = m3f(1.3f, 0.7f, 2.1f, 0.6f, 1.9f, 0.2f, 0.19f, 0.26f, 0.23f);
+  mat4f a = m4f(1.3f, 0.7f, 2.1f, 3, 0.6f, 1.9f, 0.2f, 4, 0.19f, 0.26f, 0.23f,
+                5, 0, 0, 0, 1);
+  // row 1 is 1.7 row 0
+  mat2f p = m2f(0.1f, 0.3f, 0.17f, 0.51f);
+  mat4f t = m4f_smul(m4f(2, 0, 1, 3, 1, 4, 0, 2, 0, 1, 5, 1, 3, 2, 1, 6),
+                     1.e-3f);
+  mat4f mr;
+  mat3f nr;
+  mat2f pr;
+  return m4f_det(m) != 0 && !m4f_tryinv(m, &mr) && !m3f_tryinv(n, &nr) &&
+         !m4f_tryainv(a, &mr) && !m2f_tryinv(p, &pr) && m4f_tryinv(t, &mr) &&
+         test_floats_near(m4f_mul(t, mr).a, m4f_ident.a, 16, 1.e-5f);
+}
+
+bool test_mat_solve()
+{
+  // a zero leading entry forces a row swap
+  mat4f m = m4f(0, 2, 1, 1, 3, 1, 0, 2, 1, 0, 4, 1, 2, 1, 1, 5);
+  vec4f b = v4f(1, 2, 3, 4);
+  vec4f x, y;
+  // symmetric positive definite
+  mat3f s = m3f(4, 1, 2, 1, 5, 3, 2, 3, 6);
+  vec3f c = v3f(1, -2, 3);
+  vec3f z;
+  vec2f w;
+  mat4f n = m4f(1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6);
+  return m4f_lusolve(m, b, &x) && test_v4f_near(m4f_mulv(m, x), b) &&
+         m3f_cholsolve(s, c, &z) && v3f_eq(m3f_mulv(s, z), c) &&
+         !m4f_lusolve(n, b, &y) &&
+         !m2f_cholsolve(m2f(1, 2, 2, 1), v2f(1, 1), &w);
+}
+
+bool test_quat_blend()
+{
+  enum
+  {
+    count = 19
+  };
+  quatf a[count], b[count], s[count], l[count];
+  vec3f t[count], u[count], ts[count];
+  quatf rs[count];
+  for (size_t i = 0; i < count; ++i)
+  {
+    float f = (float) i;
+    a[i]    = qf_aangle(afrads(0.1f * f), v3f_normalize(v3f(1, f, 2)));
+    b[i]    = qf_aangle(afrads(2.5f - 0.1f * f), v3f_normalize(v3f(f, 1, 0)));
+    t[i]    = v3f(f, -f, 1);
+    u[i]    = v3f(2, f, 3 * f);
+  }
+  // the opposite sign of the same rotation takes the short way round
+  b[3] = qf_smul(b[3], -1);
+  qf_slerp_many(a, b, 0.3f, s, count);
+  qf_nlerp_many(a, b, 0.3f, l, count);
+  for (size_t i = 0; i < count; ++i)
+  {
+    quatf e = qf_slerp(a[i], i == 3 ? qf_smul(b[i], -1) : b[i], 0.3f);
+    quatf n = qf_nlerp(a[i], b[i], 0.3f);
+    if (!test_floats_near(s[i].a, e.a, 4, 1.e-4f) ||
+        !test_floats_near(l[i].a, n.a, 4, 1.e-5f))
+    {
+      return false;
+    }
+  }
+  posef_x8 p = pf_x8_pack(t, a, u, 8);
+  posef_x8 q = pf_x8_pack(u, b, t, 8);
+  pf_x8_blend_many(&p, &q, 0.25f, &p, 1);
+  pf_x8_unpack(p, ts, rs, ts + 8, 8);
+  for (size_t i = 0; i < 8; ++i)
+  {
+    if (!v3f_eq(ts[i], v3f_lerp(t[i], u[i], 0.25f)) ||
+        !test_floats_near(rs[i].a, qf_nlerp(a[i], b[i], 0.25f).a, 4,
+                          1.e-5f) ||
+        !v3f_eq(ts[i + 8], v3f_lerp(u[i], t[i], 0.25f)))
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool test_bounding_volumes()
+{
+  aabbf a = {v3f(-1, -1, -1), v3f(1, 1, 1)};
+  aabbf b = {v3f(0.5f, 0.5f, 0.5f), v3f(3, 3, 3)};
+  mat4f m = m4f_trs(v3f(10, 0, 0), v3f(0, 45, 0), v3f(2, 2, 2));
+  aabbf t = aabbf_transform(m, a);
+  obbf o  = obbf_from_aabbf(m, a);
+  aabbf u = obbf_to_aabbf(o);
+  obbf p  = obbf_from_aabbf(m4f_trs(v3f(10, 0, 3.2f), v3f(0, 0, 0),
+                                    v3f(1, 1, 1)),
+                            a);
+  obbf q  = obbf_from_aabbf(m4f_trs(v3f(10, 0, 4.2f), v3f(0, 0, 0),
+                                    v3f(1, 1, 1)),
+                            a);
+  vec3f pts[4] = {v3f(1, 0, 0), v3f(-1, 0, 0), v3f(0, 3, 0), v3f(0, 0, 1)};
+  spheref s    = spheref_from_points(pts, 4);
+  for (size_t i = 0; i < 4; ++i)
+  {
+    if (!spheref_containsp((spheref){s.c, s.r + 1.e-5f}, pts[i]))
+    {
+      return false;
+    }
+  }
+  return aabbf_overlaps(a, b) &&
+         !aabbf_overlaps(a, (aabbf){v3f(2, 2, 2), v3f(3, 3, 3)}) &&
+         test_floats_near(t.min.a, u.min.a, 3, 1.e-4f) &&
+         test_floats_near(t.max.a, u.max.a, 3, 1.e-4f) &&
+         feq(t.max.x - t.min.x, 4 * sqrtf(2)) && aabbf_area(b) == 37.5f &&
+         obbf_containsp(o, v3f(10, 0, 2.5f)) &&
+         !obbf_containsp(o, v3f(13, 0, 0)) && obbf_overlaps(o, p) &&
+         !obbf_overlaps(o, q) &&
+         aabbf_overlaps_spheref(a, (spheref){v3f(1.5f, 1.5f, 0), 0.8f}) &&
+         !aabbf_overlaps_spheref(a, (spheref){v3f(1.5f, 1.5f, 0), 0.6f});
+}
+
+bool test_frustum_cull()
+{
+  frustumf f = frustumf_from_m4f(m4f_tpersp(afdegs(90), 1, 1, 100));
+  enum
+  {
+    count = 11
+  };
+  aabbf b[count];
+  spheref s[count];
+  byte bm[2], sm[2];
+  for (size_t i = 0; i < count; ++i)
+  {
+    // walk the boxes across the right-hand plane at x = -z and behind the
+    // camera near the end
+    float x = 2.0f * (float) i;
+    float z = i < 9 ? -10.0f : 5.0f;
+    b[i]    = (aabbf){v3f(x - 1, -1, z - 1), v3f(x + 1, 1, z + 1)};
+    s[i]    = spheref_from_aabbf(b[i]);
+  }
+  frustumf_cull_aabbfs(&f, b, count, bm);
+  frustumf_cull_spherefs(&f, s, count, sm);
+  for (size_t i = 0; i < count; ++i)
+  {
+    if (((bm[i / 8] >> (i % 8)) & 1) != frustumf_test_aabbf(&f, b[i]) ||
+        ((sm[i / 8] >> (i % 8)) & 1) != frustumf_test_spheref(&f, s[i]))
+    {
+      return false;
+    }
+  }
+  // x - 1 <= 10 + 1 keeps boxes 0 to 6 on the inside of x = -z
+  return bm[0] == 0x7f && bm[1] == 0 && fabsf(f.p[4].d + 1) < 1.e-4f &&
+         fabsf(f.p[5].d - 100) < 1.e-3f;
+}
+
+static uint32_t test_rand(uint32_t *s)
+{
+  *s = *s * 1664525u + 1013904223u;
+  return *s >> 8;
+}
+
+static float test_box_hit(void *user, const uint32_t id, const vec3f o,
+                          const vec3f d, const float tmax)
+{
+  const aabbf *b = (const aabbf *) user + id;
+  float t0 = 0, t1 = tmax;
+  for (size_t k = 0; k < 3; ++k)
+  {
+    float a = (b->min.a[k] - o.a[k]) / d.a[k];
+    float c = (b->max.a[k] - o.a[k]) / d.a[k];
+    t0      = fmaxf(t0, fminf(a, c));
+    t1      = fminf(t1, fmaxf(a, c));
+  }
+  return t0 <= t1 ? t0 : -1;
+}
+
+static int test_cmp_u32(const void *l, const void *r)
+{
+  uint32_t a = *(const uint32_t *) l, b = *(const uint32_t *) r;
+  return (a > b) - (a < b);
+}
+
+bool test_bvh()
+{
+  enum
+  {
+    count = 1000,
+    extra = 100
+  };
+  static aabbf boxes[count + extra];
+  static uint32_t got[count + extra], want[count + extra];
+  uint32_t seed = 7;
+  for (size_t i = 0; i < count + extra; ++i)
+  {
+    vec3f c  = v3f((float) (test_rand(&seed) % 1000) / 10,
+                   (float) (test_rand(&seed) % 1000) / 10,
+                   (float) (test_rand(&seed) % 1000) / 10);
+    vec3f e  = v3f(0.5f + (float) (test_rand(&seed) % 30) / 10, 1, 0.5f);
+    boxes[i] = (aabbf){v3f_sub(c, e), v3f_add(c, e)};
+  }
+  bvhf t = {0};
+  if (!bvhf_build(&t, boxes, count))
+  {
+    return false;
+  }
+  bool ok = true;
+  for (int pass = 0; pass < 3 && ok; ++pass)
+  {
+    size_t n = pass == 2 ? count + extra : count;
+    if (pass == 1)
+    {
+      // drift every box and refit
+      for (size_t i = 0; i < count; ++i)
+      {
+        boxes[i].min.y += (float) (i % 7);
+        boxes[i].max.y += (float) (i % 7);
+      }
+      bvhf_refit(&t, boxes);
+    }
+    if (pass == 2)
+    {
+      for (size_t i = count; i < n; ++i)
+      {
+        ok = ok && bvhf_insert(&t, boxes[i]);
+      }
+    }
+    aabbf q = {v3f(20, 30, 40), v3f(45, 50, 60)};
+    spheref sq = {v3f(50, 50, 50), 12};
+    vec3f pq = aabbf_center(boxes[5]);
+    vec3f o = v3f(-5, 50, 50);
+    vec3f d = v3f_sdiv(v3f_sub(aabbf_center(boxes[3]), o), 100);
+    // along x, so two slabs divide by zero
+    vec3f ao = v3f(-5, aabbf_center(boxes[7]).y, aabbf_center(boxes[7]).z);
+    vec3f ad = v3f(1, 0, 0);
+    size_t w[5] = {0, 0, 0, 0, 0};
+    float best = INFINITY;
+    uint32_t bid = 0;
+    for (size_t i = 0; i < n; ++i)
+    {
+      w[0] += aabbf_overlaps(boxes[i], q);
+      w[1] += aabbf_overlaps_spheref(boxes[i], sq);
+      w[3] += aabbf_containsp(boxes[i], pq);
+      w[4] += test_box_hit(boxes, (uint32_t) i, ao, ad, 200) >= 0;
+      float h = test_box_hit(boxes, (uint32_t) i, o, d, 200);
+      if (h >= 0)
+      {
+        want[w[2]++] = (uint32_t) i;
+        bid          = h < best ? (uint32_t) i : bid;
+        best         = h < best ? h : best;
+      }
+    }
+    uint32_t id = 0;
+    float dist  = 0;
+    size_t h    = bvhf_raycast_all(&t, o, d, 200, got, count + extra);
+    qsort(got, h, sizeof got[0], test_cmp_u32);
+    ok = ok && w[2] > 0 && h == w[2] &&
+         memcmp(got, want, h * sizeof got[0]) == 0 &&
+         bvhf_query_aabbf(&t, q, got, count + extra) == w[0] &&
+         bvhf_query_spheref(&t, sq, got, 0) == w[1] &&
+         w[3] > 0 && bvhf_query_point(&t, pq, got, 0) == w[3] && w[4] > 0 &&
+         bvhf_raycast_all(&t, ao, ad, 200, got, 0) == w[4] &&
+         bvhf_raycast(&t, o, d, 200, test_box_hit, boxes, &id, &dist) &&
+         id == bid && dist == best;
+  }
+  for (size_t i = 1; i < t.nnodes && ok; ++i)
+  {
+    // every inner node precedes its children
+    ok = t.nodes[i].count || t.nodes[i].first > i;
+  }
+  bvhf_free(&t);
+  return ok;
+}
+
+bool test_ray_packets()
+{
+  uint32_t seed = 11;
+  vec3f v[24];
+  for (size_t i = 0; i < 24; ++i)
+  {
+    v[i] = v3f((float) (test_rand(&seed) % 200) / 10 - 10,
+               (float) (test_rand(&seed) % 200) / 10 - 10,
+               (float) (test_rand(&seed) % 200) / 10 + 5);
+  }
+  trif_x8 tri = trif_x8_pack(v, 7);
+  size_t hits = 0;
+  bool ok     = true;
+  for (size_t r = 0; r < 64 && ok; ++r)
+  {
+    vec3f o = v3f(0, 0, 0);
+    vec3f d = v3f((float) (test_rand(&seed) % 200) / 100 - 1,
+                  (float) (test_rand(&seed) % 200) / 100 - 1, 1);
+    float_x8 a, b;
+    byte m  = trif_x8_raycast(&tri, o, d, 100, &a);
+    byte mw = trif_x8_raycast_wt(&tri, o, d, 100, &b);
+    ok      = m == mw && !(m & 0x80);
+    for (size_t i = 0; i < 8 && ok; ++i)
+    {
+      ok = (m >> i & 1) ? fabsf(a.a[i] - b.a[i]) < 1.e-3f * a.a[i]
+                        : a.a[i] == INFINITY;
+      hits += m >> i & 1;
+    }
+  }
+  // a ray down the shared diagonal of a split quad and through its corner
+  vec3f q[6] = {v3f(0, 0, 0), v3f(1, 0, 0), v3f(1, 1, 0),
+                v3f(0, 0, 0), v3f(1, 1, 0), v3f(0, 1, 0)};
+  trif_x8 quad = trif_x8_pack(q, 2);
+  float_x8 qd;
+  // and the zeroed padding lanes, whose edge functions are all zero, never hit
+  byte qm = trif_x8_raycast_wt(&quad, v3f(0.3f, 0.3f, 1), v3f(0, 0, -1), 10,
+                               &qd);
+  byte cm = trif_x8_raycast_wt(&quad, v3f(1, 1, 1), v3f(0, 0, -1), 10, &qd);
+  ok      = ok && hits > 0 && (qm & 3) && !(qm & ~3) && (cm & 3) && !(cm & ~3);
+  // eight rays against one box, lane 7 is padding
+  aabbf box = {v3f(-1, -1, 4), v3f(1, 2, 6)};
+  vec3f ro[7], rd[7];
+  for (size_t i = 0; i < 7; ++i)
+  {
+    ro[i] = v3f(0, 0, 0);
+    rd[i] = v3f((float) i / 4 - 0.75f, i == 3 ? 0 : 0.25f, 1);
+  }
+  rayf_x8 rays = rayf_x8_pack(ro, rd, 100, 7);
+  float_x8 tn, tw;
+  byte m  = rayf_x8_aabbf(&rays, box, &tn);
+  byte mw = rayf_x8_aabbf_wt(&rays, box, &tw);
+  for (size_t i = 0; i < 8 && ok; ++i)
+  {
+    float h = i < 7 ? test_box_hit(&box, 0, ro[i], rd[i], 100) : -1;
+    bool b  = m >> i & 1;
+    ok      = (h >= 0) == b && (!b || fabsf(tn.a[i] - h) < 1.e-4f);
+  }
+  return ok && m != 0 && (mw & m) == m && !(mw & 0x80);
+}
+
+bool test_fast_math()
+{
+  bool ok = true;
+  for (int i = -2000; i <= 2000 && ok; ++i)
+  {
+    float x = (float) i * 0.0123f;
+    float c = (float) i / 2000;
+    ok      = fabsf(fast_sinf(x) - sinf(x)) < 2.e-7f &&
+         fabsf(fast_cosf(x) - cosf(x)) < 2.e-7f &&
+         fabsf(fast_acosf(c) - acosf(c)) < 1.e-5f &&
+         fabsf(fast_atan2f(c, x) - atan2f(c, x)) < 2.e-6f &&
+         (x <= 0 || fabsf(fast_rsqrtf(x) * sqrtf(x) - 1) < 5.e-6f);
+  }
+  vec3f v = v3f(3, -4, 12);
+  quatf a = qf_aangle(afrads(0.4f), v3f_normalize(v3f(1, 2, 2)));
+  quatf b = qf_aangle(afrads(2.1f), v3f_normalize(v3f(0, 1, 1)));
+  // b and -b are the same rotation, fslerp takes the short arc for both
+  quatf e = qf_slerp(a, b, 0.3f);
+  return ok && fabsf(v3f_flen(v) - 13) < 1.e-4f &&
+         fabsf(v3f_len(v3f_fnorm(v)) - 1) < 1.e-5f &&
+         v3f_eq(v3f_fnorm(v3f_zero), v3f_zero) &&
+         test_floats_near(qf_fslerp(a, b, 0.3f).a, e.a, 4, 1.e-4f) &&
+         test_floats_near(qf_fslerp(a, qf_smul(b, -1), 0.3f).a, e.a, 4,
+                          1.e-4f);
+}
+
+bool test_double_types()
+{
+  mat4f a  = m4f_trs(v3f(1, 2, 3), v3f(0, 0.7f, 0.2f), v3f(2, 2, 2));
+  mat4f b  = m4f_trs(v3f(-4, 0, 5), v3f(-1.1f, 0, 0), v3f(1, 3, 1));
+  quatf p  = qf_aangle(afrads(0.3f), v3f_normalize(v3f(1, 2, 3)));
+  quatf q  = qf_aangle(afrads(1.9f), v3f_normalize(v3f(-2, 1, 0)));
+  vec4f v  = v4f(1, -2, 3, 1);
+  mat4d ad = m4d_from_m4f(a), bd = m4d_from_m4f(b);
+  vec4d vd = v4d_from_v4f(v);
+  vec4f w  = v4f_from_v4d(v4d_normalize(v4d_add(vd, vd)));
+  double l = sqrt(15);
+  vec4f wr = v4f((float) (1 / l), (float) (-2 / l), (float) (3 / l),
+                 (float) (1 / l));
+  bool ok =
+    test_floats_near(m4f_from_m4d(m4d_mul(ad, bd)).a, m4f_mul(a, b).a, 16,
+                     1.e-5f) &&
+    test_floats_near(v4f_from_v4d(m4d_mulv(ad, vd)).a, m4f_mulv(a, v).a, 4,
+                     1.e-5f) &&
+    test_floats_near(m4f_from_m4d(m4d_transpose(ad)).a, m4f_transpose(a).a,
+                     16, 0) &&
+    test_floats_near(qf_from_qd(qd_mul(qd_from_qf(p), qd_from_qf(q))).a,
+                     qf_mul(p, q).a, 4, 1.e-6f) &&
+    test_floats_near(w.a, wr.a, 4, 1.e-7f) &&
+    v4d_dot(vd, vd) == 15 && v4d_len(v4d_smul(vd, 2)) == sqrt(60);
+  // centimetre offsets a thousand kilometres out survive the drop to float
+  vec3d o   = v3d(1.e6, -2.e6, 5.e5);
+  vec3d pts = v3d_add(o, v3d(0.01, 0.02, -0.03));
+  vec3f r;
+  v3d_relative_many(&pts, o, &r, 1);
+  mat4d md   = m4d_from_m4f(m4f_ident);
+  md.a[3]    = pts.x;
+  md.a[7]    = pts.y;
+  md.a[11]   = pts.z;
+  mat4f mrel = m4d_relative(md, o);
+  return ok && fabsf(r.x - 0.01f) < 1.e-6f && fabsf(r.z + 0.03f) < 1.e-6f &&
+         fabsf(mrel.a[7] - 0.02f) < 1.e-6f && mrel.a[0] == 1;
+}
+
+bool test_quantize()
+{
+  bool ok = true;
+  for (uint32_t h = 0; h < 0x10000u && ok; ++h)
+  {
+    // every non-nan half survives the trip through float
+    ok = (h & 0x7fffu) > 0x7c00u || f2h(h2f((uint16_t) h)) == h;
+  }
+  float f[11] = {1, 65504, 65520, 2049, 2051, 5.96e-8f, -0.f, -2.5f, 1.e-3f,
+                 INFINITY, 0.1f};
+  uint16_t want[11] = {0x3c00, 0x7bff, 0x7c00, 0x6800, 0x6802, 0x0001,
+                       0x8000, 0xc100, 0x1419, 0x7c00, 0x2e66};
+  uint16_t got[11];
+  f2h_many(f, got, 11);
+  ok = ok && memcmp(got, want, sizeof got) == 0;
+  // 255 so the batch kernels also run their scalar tails
+  static vec3f ns[255], nd[255];
+  static quatf qs[255], qd[255], qe[255];
+  static uint32_t oc[255], qc[255];
+  static quat48 qw[255];
+  uint32_t seed = 5;
+  for (size_t i = 0; i < 255 && ok; ++i)
+  {
+    vec3f n = v3f_normalize(v3f((float) (test_rand(&seed) % 2001) - 1000,
+                                (float) (test_rand(&seed) % 2001) - 1000,
+                                (float) (test_rand(&seed) % 2001) - 1000));
+    quatf q = qf_aangle(afrads((float) (test_rand(&seed) % 628) / 100), n);
+    ns[i]   = n;
+    qs[i]   = q;
+    vec3sn16 sn;
+    vec3f s, u;
+    v3sn16_from_v3f_many(&n, &sn, 1);
+    v3f_from_v3sn16_many(&sn, &s, 1);
+    u       = v3f_from_v3un8(v3un8_from_v3f(n));
+    quatf a = qf_from_q32(q32_from_qf(q));
+    quatf b = qf_from_q48(q48_from_qf(q));
+    b       = qf_dot(b, q) < 0 ? qf_smul(b, -1) : b;
+    ok      = test_floats_near(s.a, n.a, 3, 1.6e-5f) &&
+         test_floats_near(u.a, n.a, 3, 4.e-3f) &&
+         test_floats_near(v3f_from_oct32(oct32_from_v3f(n)).a, n.a, 3,
+                          1.e-4f) &&
+         v3f_dot(v3f_from_oct16(oct16_from_v3f(n)), n) > 0.999f &&
+         fabsf(qf_dot(a, q)) > 0.99999f &&
+         test_floats_near(b.a, q.a, 4, 5.e-5f) &&
+         test_floats_near(v3f_from_v3h(v3h_from_v3f(n)).a, n.a, 3, 5.e-4f);
+  }
+  // the batch forms give the scalar codes and decode them alike
+  oct32_from_v3f_many(ns, oc, 255);
+  v3f_from_oct32_many(oc, nd, 255);
+  q32_from_qf_many(qs, qc, 255);
+  qf_from_q32_many(qc, qd, 255);
+  q48_from_qf_many(qs, qw, 255);
+  qf_from_q48_many(qw, qe, 255);
+  for (size_t i = 0; i < 255 && ok; ++i)
+  {
+    quat48 w = q48_from_qf(qs[i]);
+    ok       = oc[i] == oct32_from_v3f(ns[i]) &&
+         qc[i] == q32_from_qf(qs[i]) && memcmp(&qw[i], &w, sizeof w) == 0 &&
+         test_floats_near(nd[i].a, v3f_from_oct32(oc[i]).a, 3, 1.e-6f) &&
+         test_floats_near(qd[i].a, qf_from_q32(qc[i]).a, 4, 1.e-6f) &&
+         test_floats_near(qe[i].a, qf_from_q48(w).a, 4, 1.e-6f);
+  }
+  return ok;
+}
+
+static vec3f test_xform_apply(const xformf *x, uint32_t i, vec3f p)
+{
+  // the chain of local transforms applied to p, leaf to root
+  for (; i != GM_XFORM_ROOT; i = x->parent[i])
+  {
+    vec4f r = qf_rotv(x->r[i], v4f(p.x * x->s[i].x, p.y * x->s[i].y,
+                                   p.z * x->s[i].z, 0));
+    p       = v3f_add(v3f(r.x, r.y, r.z), x->t[i]);
+  }
+  return p;
+}
+
+bool test_xform()
+{
+  enum
+  {
+    count = 3000
+  };
+  xformf x      = {0};
+  uint32_t seed = 9;
+  bool ok       = true;
+  for (uint32_t i = 0; i < count && ok; ++i)
+  {
+    uint32_t p = i < 4 ? GM_XFORM_ROOT : test_rand(&seed) % i;
+    vec3f axis = v3f_normalize(v3f(1, (float) (i % 5), (float) (i % 3)));
+    quatf r    = qf_aangle(afrads((float) (i % 17) * 0.3f), axis);
+    vec3f s    = v3f(1 + (float) (i % 3) * 0.25f, 1, 0.5f);
+    ok         = xformf_add(&x, p, v3f((float) (i % 7), 1, -2), r, s) == i;
+  }
+  ok = ok && xformf_add(&x, count, v3f_zero, qf_ident, v3f_one) ==
+               GM_XFORM_ROOT &&
+       xformf_update(&x) == count && xformf_update(&x) == 0;
+  // moving node 4 recomputes its subtree and nothing else
+  size_t sub = 0;
+  for (uint32_t i = 4; i < count; ++i)
+  {
+    uint32_t j = i;
+    while (j != GM_XFORM_ROOT && j != 4)
+    {
+      j = x.parent[j];
+    }
+    sub += j == 4;
+  }
+  x.t[4].y += 3;
+  xformf_touch(&x, 4);
+  ok = ok && xformf_update(&x) == sub;
+  for (uint32_t i = 0; i < count && ok; i += 7)
+  {
+    vec3f o = v3f(0.5f, -1, 2);
+    vec3f e = test_xform_apply(&x, i, o);
+    vec4f w = m4f_mulv(x.world[i], v4f(o.x, o.y, o.z, 1));
+    ok      = test_floats_near(w.a, e.a, 3, 1.e-3f * (1 + v3f_len(e)));
+  }
+  xformf_free(&x);
+  return ok;
+}
+
+bool test_splines()
+{
+  vec3f p[7] = {v3f(0, 0, 0), v3f(1, 2, 0), v3f(3, 3, 1), v3f(4, 1, 2),
+                v3f(6, 0, 2), v3f(7, 2, 1), v3f(9, 3, 0)};
+  splinef cr = splinef_catmull(), bz = splinef_bezier();
+  splinef bs = splinef_bspline(), he = splinef_hermite();
+  // catmull-rom passes through its inner controls, bezier through every
+  // third, and b-splines of evenly spaced collinear controls are lines
+  vec3f line[5] = {v3f(0, 0, 0), v3f(1, 1, 1), v3f(2, 2, 2), v3f(3, 3, 3),
+                   v3f(4, 4, 4)};
+  bool ok = splinef_segments(&cr, 7) == 4 && splinef_segments(&bz, 7) == 2 &&
+            splinef_segments(&he, 6) == 2 &&
+            test_floats_near(v3f_spline(&cr, p, 7, 2).a, p[3].a, 3, 1.e-5f) &&
+            test_floats_near(v3f_spline(&cr, p, 7, 4).a, p[5].a, 3, 1.e-5f) &&
+            test_floats_near(v3f_spline(&bz, p, 7, 1).a, p[3].a, 3, 1.e-5f) &&
+            test_floats_near(v3f_spline(&bs, line, 5, 1.25f).a,
+                             v3f(2.25f, 2.25f, 2.25f).a, 3, 1.e-5f);
+  // hermite: p0, t0, p1, t1 with the tangent as the derivative at the ends
+  vec2f h[4] = {v2f(0, 0), v2f(1, 0), v2f(2, 1), v2f(0, 3)};
+  ok = ok && test_floats_near(v2f_spline(&he, h, 4, 1).a, h[2].a, 2, 0) &&
+       test_floats_near(v2f_spline_deriv(&he, h, 4, 0).a, h[1].a, 2, 0) &&
+       test_floats_near(v2f_spline_deriv(&he, h, 4, 1).a, h[3].a, 2, 1.e-5f);
+  float u[13];
+  vec3f q[13];
+  for (size_t i = 0; i < 13; ++i)
+  {
+    u[i] = (float) i / 3 - 0.2f;
+  }
+  v3f_spline_many(&cr, p, 7, u, q, 13);
+  for (size_t i = 0; i < 13 && ok; ++i)
+  {
+    vec3f a  = v3f_spline(&cr, p, 7, u[i] - 1.e-3f);
+    vec3f b  = v3f_spline(&cr, p, 7, u[i] + 1.e-3f);
+    vec3f fd = v3f_sdiv(v3f_sub(b, a), 2.e-3f);
+    ok       = test_floats_near(q[i].a, v3f_spline(&cr, p, 7, u[i]).a, 3,
+                                1.e-5f) &&
+         (u[i] < 0.01f || u[i] > 3.99f ||
+          test_floats_near(v3f_spline_deriv(&cr, p, 7, u[i]).a, fd.a, 3,
+                           2.e-2f));
+  }
+  // rotations stay unit length and hit their inner controls
+  quatf r[4] = {qf_ident, qf_aangle(afrads(1), v3f(0, 1, 0)),
+                qf_aangle(afrads(2), v3f(0, 1, 0)),
+                qf_smul(qf_aangle(afrads(3), v3f(0, 1, 0)), -1)};
+  quatf rm   = qf_spline(&cr, r, 4, 0.5f);
+  ok         = ok && fabsf(qf_len(rm) - 1) < 1.e-5f &&
+       fabsf(qf_dot(qf_spline(&cr, r, 4, 1), r[2])) > 0.99999f;
+  quatf rq[13];
+  for (size_t i = 0; i < 13; ++i)
+  {
+    u[i] = (float) i / 12;
+  }
+  qf_spline_many(&cr, r, 4, u, rq, 13);
+  for (size_t i = 0; i < 13 && ok; ++i)
+  {
+    ok = test_floats_near(rq[i].a, qf_spline(&cr, r, 4, u[i]).a, 4, 1.e-5f);
+  }
+  // equal steps in distance give equal chords along the curve
+  arclenf a = {0};
+  ok        = ok && v3f_arclen_build(&a, &cr, p, 7, 1024);
+  float l   = ok ? arclenf_length(&a) : 0;
+  vec3f at  = p[1];
+  for (int i = 1; i <= 40 && ok; ++i)
+  {
+    vec3f next = v3f_spline(&cr, p, 7, arclenf_param(&a, l * (float) i / 40));
+    ok         = fabsf(v3f_distance(at, next) - l / 40) < 2.e-2f * l / 40;
+    at         = next;
+  }
+  ok = ok && v3f_distance(at, p[5]) < 1.e-4f;
+  // a planar curve measures the same as its copy lifted into 3d
+  vec2f p2[7];
+  for (size_t i = 0; i < 7; ++i)
+  {
+    p2[i] = v2f(p[i].x, p[i].y);
+    p[i].z = 0;
+  }
+  arclenf a2 = {0};
+  ok         = ok && v2f_arclen_build(&a2, &cr, p2, 7, 256) &&
+       v3f_arclen_build(&a, &cr, p, 7, 256) &&
+       fabsf(arclenf_length(&a2) - arclenf_length(&a)) < 1.e-4f;
+  arclenf_free(&a2);
+  arclenf_free(&a);
+  return ok;
+}
+
+bool test_random_noise()
+{
+  // streams replay exactly, differ from each other, and a fill matches the
+  // same draws made one block at a time
+  rngf r = rngf_new(42, 0), r2 = rngf_new(42, 0), r3 = rngf_new(42, 1);
+  uint32_t u[40], v[40], w[40];
+  rngf_u32_many(&r, u, 40);
+  rngf_u32_many(&r3, w, 40);
+  for (size_t i = 0; i < 40; i += 4)
+  {
+    rngf_u32_many(&r2, v + i, 4);
+  }
+  // the random123 known answer for a zero key and counter
+  rngf z = rngf_new(0, 0);
+  uint32_t k[4];
+  rngf_u32_many(&z, k, 4);
+  bool ok = k[0] == 0x6627e8d5u && k[1] == 0xe169c58du &&
+            k[2] == 0xbc57ac4cu && k[3] == 0x9b00dbd8u && r.counter == 10 &&
+            r2.counter == 10;
+  size_t same = 0;
+  for (size_t i = 0; i < 40; ++i)
+  {
+    ok = ok && u[i] == v[i];
+    same += u[i] == w[i];
+  }
+  ok = ok && same == 0;
+  float f[1000];
+  vec2f d[300];
+  vec3f s[300];
+  quatf q[300];
+  rngf_float_many(&r, f, 1000);
+  rngf_v2f_disk(&r, d, 300);
+  rngf_v3f_sphere(&r, s, 300);
+  rngf_qf_uniform(&r, q, 300);
+  float mean = 0;
+  for (size_t i = 0; i < 1000; ++i)
+  {
+    ok = ok && f[i] >= 0 && f[i] < 1;
+    mean += f[i] / 1000;
+  }
+  vec3f c = v3f_zero;
+  for (size_t i = 0; i < 300 && ok; ++i)
+  {
+    ok = v2f_len(d[i]) <= 1 + 1.e-5f && fabsf(v3f_len(s[i]) - 1) < 1.e-5f &&
+         fabsf(qf_len(q[i]) - 1) < 1.e-5f;
+    c  = v3f_add(c, v3f_sdiv(s[i], 300));
+  }
+  ok = ok && fabsf(mean - 0.5f) < 0.05f && v3f_len(c) < 0.15f;
+  // noise vanishes on the lattice, stays bounded and continuous, and the
+  // batched form agrees with single points
+  vec3f p[20];
+  float n[20];
+  rngf_v3f_box(&r, v3f(-10, -10, -10), v3f(10, 10, 10), p, 20);
+  perlin3_many(p, n, 20, 7);
+  for (size_t i = 0; i < 20 && ok; ++i)
+  {
+    vec3f e = v3f_add(p[i], v3f(1.e-3f, 0, 0));
+    vec4f p4 = v4f(p[i].x, p[i].y, p[i].z, p[i].x);
+    vec2f p2 = v2f(p[i].x, p[i].y);
+    ok = n[i] == perlin3(p[i], 7) && fabsf(n[i]) <= 1.1f &&
+         fabsf(perlin3(e, 7) - n[i]) < 1.e-2f &&
+         fabsf(perlin2(p2, 7)) <= 1.1f && fabsf(perlin4(p4, 7)) <= 1.1f &&
+         perlin2(v2f(floorf(p2.x), floorf(p2.y)), 7) == 0 &&
+         perlin3(v3f(floorf(p[i].x), floorf(p[i].y), floorf(p[i].z)), 7) ==
+             0 &&
+         perlin4(v4f(floorf(p4.x), 3, -2, floorf(p4.w)), 7) == 0;
+  }
+  ok = ok && perlin3(p[0], 7) != perlin3(p[0], 8);
+  return ok;
+}
+
+bool test_spatial_hash()
+{
+  // neighbouring cells get consecutive codes and codes round trip
+  vec3i a = v3i(-5, 7, 1), q = v3i(-1048576, 1048575, 0);
+  bool ok = morton3_from_v3i(v3i(1, 0, 0)) == morton3_from_v3i(v3i_zero) + 1 &&
+            morton3_from_v3i(v3i(0, 1, 1)) == morton3_from_v3i(v3i_zero) + 6 &&
+            morton2_from_v2i(v2i(0, 1)) == morton2_from_v2i(v2i_zero) + 2 &&
+            morton2_from_v2i(v2i(-1, 0)) < morton2_from_v2i(v2i_zero);
+  vec3i ra = v3i_from_morton3(morton3_from_v3i(a));
+  vec3i rq = v3i_from_morton3(morton3_from_v3i(q));
+  vec2i r2 = v2i_from_morton2(morton2_from_v2i(v2i(INT32_MIN, INT32_MAX)));
+  ok       = ok && ra.x == a.x && ra.y == a.y && ra.z == a.z && rq.x == q.x &&
+       rq.y == q.y && rq.z == q.z && r2.x == INT32_MIN && r2.y == INT32_MAX;
+  vec3f c[2] = {v3f(-0.5f, 0.5f, 2.5f), v3f(-2, 1.99f, 0)};
+  vec3i k[2];
+  v3i_cells_many(c, 1, k, 2);
+  ok = ok && k[0].x == -1 && k[0].y == 0 && k[0].z == 2 && k[1].x == -2 &&
+       k[1].y == 1 && k[1].z == 0;
+  // fixed radius queries match the brute force answer
+  vec3f p[500];
+  rngf rng = rngf_new(3, 0);
+  rngf_v3f_box(&rng, v3f(-5, -5, -5), v3f(5, 5, 5), p, 500);
+  hashgridf g = {0};
+  ok          = ok && hashgridf_build(&g, p, 500, 0.75f);
+  uint32_t got[500], want[500];
+  for (size_t i = 0; i < 500 && ok; i += 7)
+  {
+    float r   = i % 2 ? 0.75f : 1.6f;
+    size_t n  = hashgridf_query(&g, p[i], r, got, 500), m = 0;
+    for (uint32_t j = 0; j < 500; ++j)
+    {
+      if (v3f_distance(p[i], p[j]) <= r)
+      {
+        want[m++] = j;
+      }
+    }
+    qsort(got, n, sizeof(uint32_t), test_cmp_u32);
+    ok = n == m && n >= 1;
+    for (size_t j = 0; j < n && ok; ++j)
+    {
+      ok = got[j] == want[j];
+    }
+  }
+  hashgridf_free(&g);
+  return ok;
+}
+
+static int test_cmp_pair(const void *l, const void *r)
+{
+  const sapf_pair *a = (const sapf_pair *) l, *b = (const sapf_pair *) r;
+  return a->a != b->a ? (a->a > b->a) - (a->a < b->a)
+                      : (a->b > b->b) - (a->b < b->b);
+}
+
+static bool test_sap_brute(const sapf *s, const vec3f *lo, const vec3f *hi,
+                           const size_t n)
+{
+  size_t m = 0;
+  sapf_pair *p = (sapf_pair *) malloc(s->npairs * sizeof(sapf_pair) + 1);
+  memcpy(p, s->pairs, s->npairs * sizeof(sapf_pair));
+  qsort(p, s->npairs, sizeof(sapf_pair), test_cmp_pair);
+  bool ok = true;
+  for (uint32_t i = 0; i < n && ok; ++i)
+  {
+    for (uint32_t j = i + 1; j < n && ok; ++j)
+    {
+      if (aabbf_overlaps((aabbf){lo[i], hi[i]}, (aabbf){lo[j], hi[j]}))
+      {
+        ok = m < s->npairs && p[m].a == i && p[m].b == j;
+        m++;
+      }
+    }
+  }
+  free(p);
+  return ok && m == s->npairs;
+}
+
+bool test_sweep_prune()
+{
+  // frames of small motion take the incremental path, large motion and a
+  // change of spread axis the full sort; each matches brute force
+  enum { n = 600 };
+  vec3f lo[n], hi[n], c[n];
+  rngf r = rngf_new(5, 0);
+  rngf_v3f_box(&r, v3f(-20, -4, -4), v3f(20, 4, 4), c, n);
+  sapf s  = {0};
+  bool ok = true;
+  for (int f = 0; f < 6 && ok; ++f)
+  {
+    vec3f d[n];
+    float e = f == 2 ? 2 : 0.1f;
+    rngf_v3f_box(&r, v3f(-e, -e, -e), v3f(e, e, e), d, n);
+    for (size_t i = 0; i < n; ++i)
+    {
+      c[i]  = f == 3 ? v3f(c[i].y, c[i].x * 3, c[i].z) : v3f_add(c[i], d[i]);
+      lo[i] = v3f_sub(c[i], v3f(0.6f, 0.6f, 0.6f));
+      hi[i] = v3f_add(c[i], v3f(0.6f, 0.6f, 0.6f));
+    }
+    ok = sapf_update(&s, lo, hi, n) && test_sap_brute(&s, lo, hi, n) &&
+         s.axis == (f >= 3 ? 1u : 0u);
+  }
+  ok = ok && s.npairs > 0 && sapf_update(&s, lo, hi, n / 2) &&
+       test_sap_brute(&s, lo, hi, n / 2);
+  sapf_free(&s);
+  return ok;
+}
+
+bool test_skinning()
+{
+  // dual quaternions compose and transform like their matrices
+  dquatf a = dqf_from_rt(qf_aangle(afrads(0.7f), v3f(0, 1, 0)), v3f(1, 2, 3));
+  dquatf b = dqf_from_rt(qf_aangle(afrads(-1.2f), v3f_normalize(v3f(1, 0, 1))),
+                         v3f(-2, 0, 1));
+  vec3f p  = v3f(0.5f, -1, 2);
+  vec4f mp = m4f_mulv(dqf_m4f(dqf_mul(a, b)), v4f(p.x, p.y, p.z, 1));
+  vec3f ab = dqf_transform(a, dqf_transform(b, p));
+  bool ok  = test_floats_near(dqf_transform(dqf_mul(a, b), p).a, ab.a, 3,
+                              1.e-5f) &&
+            test_floats_near(mp.a, ab.a, 3, 1.e-5f) &&
+            test_floats_near(dqf_translation(a).a, v3f(1, 2, 3).a, 3, 1.e-6f);
+  // 19 vertices, so the last block is partial
+  enum { n = 19 };
+  float x[n], y[n], z[n], nx[n], ny[n], nz[n], w[4][n];
+  uint16_t j[4][n];
+  mat4f mp3[3]  = {dqf_m4f(a), dqf_m4f(b), m4f_ident};
+  dquatf dq3[3] = {a, b, dqf_ident};
+  for (size_t i = 0; i < n; ++i)
+  {
+    x[i]  = (float) i;
+    y[i]  = 1 - (float) i / 2;
+    z[i]  = 0.25f * (float) i;
+    nx[i] = 0;
+    ny[i] = 1;
+    nz[i] = 0;
+    for (size_t k = 0; k < 4; ++k)
+    {
+      j[k][i] = (uint16_t) ((i + k) % 3);
+      w[k][i] = k == 0 ? 1.f : 0.f;
+    }
+  }
+  skinf_in in = {x, y, z, nx, ny, nz, {j[0], j[1], j[2], j[3]},
+                 {w[0], w[1], w[2], w[3]}};
+  float o[2][6][n];
+  skinf_out lo = {o[0][0], o[0][1], o[0][2], o[0][3], o[0][4], o[0][5]};
+  skinf_out dq = {o[1][0], o[1][1], o[1][2], o[1][3], o[1][4], o[1][5]};
+  // a single influence is just that joint's transform
+  skinf_lbs(mp3, &in, &lo, n);
+  skinf_dqs(dq3, &in, &dq, n);
+  for (size_t i = 0; i < n && ok; ++i)
+  {
+    vec3f e  = dqf_transform(dq3[i % 3], v3f(x[i], y[i], z[i]));
+    vec4f en = qf_rotv(dq3[i % 3].r, v4f(0, 1, 0, 0));
+    for (size_t c = 0; c < 3; ++c)
+    {
+      ok = ok && fabsf(o[0][c][i] - e.a[c]) < 1.e-4f &&
+           fabsf(o[1][c][i] - e.a[c]) < 1.e-4f &&
+           fabsf(o[0][c + 3][i] - en.a[c]) < 1.e-5f &&
+           fabsf(o[1][c + 3][i] - en.a[c]) < 1.e-5f;
+    }
+  }
+  // halfway between opposite twists, dqs turns the vertex halfway and
+  // keeps its length where lbs collapses it onto the axis
+  dquatf tw[2] = {dqf_from_rt(qf_aangle(afrads(1.5f), v3f(1, 0, 0)), v3f_zero),
+                  dqf_from_rt(qf_aangle(afrads(-1.5f), v3f(1, 0, 0)),
+                              v3f_zero)};
+  mat4f tm[2]  = {dqf_m4f(tw[0]), dqf_m4f(tw[1])};
+  for (size_t i = 0; i < n; ++i)
+  {
+    x[i]    = 1;
+    y[i]    = 0;
+    z[i]    = 1;
+    j[0][i] = j[2][i] = j[3][i] = 0;
+    j[1][i] = 1;
+    w[0][i] = w[1][i] = 0.5f;
+    w[2][i] = w[3][i] = 0;
+  }
+  in.nx = NULL;
+  skinf_lbs(tm, &in, &lo, n);
+  skinf_dqs(tw, &in, &dq, n);
+  ok = ok && fabsf(o[1][2][n - 1] - 1) < 1.e-5f &&
+       fabsf(o[1][1][n - 1]) < 1.e-5f &&
+       fabsf(o[0][2][n - 1] - cosf(1.5f)) < 1.e-5f;
+  return ok;
+}
+
 int main()
 {
   test_group(gm, {
@@ -54,5 +1121,28 @@ int main()
     test_true(test_v3f_length());
     test_true(test_m4f_trs());
     test_true(test_quat_conjugate());
+    test_true(test_v4f_ops());
+    test_true(test_m4f_mul());
+    test_true(test_m4f_mulv());
+    test_true(test_quat_rotate());
+    test_true(test_batch_kernels());
+    test_true(test_vec3f_x8());
+    test_true(test_mat_inverse());
+    test_true(test_mat_inverse_near_singular());
+    test_true(test_mat_solve());
+    test_true(test_quat_blend());
+    test_true(test_bounding_volumes());
+    test_true(test_frustum_cull());
+    test_true(test_bvh());
+    test_true(test_ray_packets());
+    test_true(test_fast_math());
+    test_true(test_double_types());
+    test_true(test_quantize());
+    test_true(test_xform());
+    test_true(test_splines());
+    test_true(test_random_noise());
+    test_true(test_spatial_hash());
+    test_true(test_sweep_prune());
+    test_true(test_skinning());
   });
 }
\ No newline at end of file
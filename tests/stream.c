@@ -2,11 +2,333 @@
 #include "../stream.h"
 #include "../test.h"
 
+#ifdef _WIN32
+#include <windows.h>
+#define TEST_THREAD DWORD WINAPI
+typedef HANDLE test_thread_t;
+#define test_spawn(Thread, Fn, Arg)                                            \
+  ((Thread) = CreateThread(NULL, 0, (Fn), (Arg), 0, NULL))
+#define test_join(Thread)                                                      \
+  (WaitForSingleObject((Thread), INFINITE), CloseHandle(Thread))
+#define test_yield() SwitchToThread()
+#else
+#include <pthread.h>
+#include <sched.h>
+#define TEST_THREAD void *
+typedef pthread_t test_thread_t;
+#define test_spawn(Thread, Fn, Arg) pthread_create(&(Thread), NULL, (Fn), (Arg))
+#define test_join(Thread) pthread_join((Thread), NULL)
+#define test_yield() sched_yield()
+#endif
+
+#define TEST_MESSAGES 100000
+
+// a producer thread feeding the calling thread must deliver every counter
+// once and in order, across flushes of varying size
+static TEST_THREAD test_spsc_producer(void *arg)
+{
+  stream_spsc_t *q = (stream_spsc_t *) arg;
+  for (uint32_t i = 0; i < TEST_MESSAGES; ++i)
+  {
+    while (!stream_spsc_writeb(q, sizeof(i), (BYTE *) &i))
+    {
+      stream_spsc_flush(q);
+      test_yield();
+    }
+    if (i % 7 == 0)
+    {
+      stream_spsc_flush(q);
+    }
+  }
+  stream_spsc_flush(q);
+  return 0;
+}
+
+static bool test_spsc_threads(void)
+{
+  stream_spsc_t *q = stream_spsc(1024);
+  test_thread_t producer;
+  test_spawn(producer, test_spsc_producer, q);
+  bool ok     = true;
+  uint32_t at = 0;
+  uint32_t values[64];
+  while (at < TEST_MESSAGES)
+  {
+    size_t n = stream_spsc_deqb(q, sizeof(values), (BYTE *) values);
+    for (size_t i = 0; i < n / sizeof(uint32_t); ++i)
+    {
+      ok = ok && values[i] == at++;
+    }
+    if (!n)
+    {
+      test_yield();
+    }
+  }
+  test_join(producer);
+  ok = ok && stream_spsc_length(q) == 0;
+  stream_spsc_free(q);
+  return ok;
+}
+
+typedef struct test_mpmc_job_t
+{
+  stream_mpmc_t *q;
+  uint64_t id;
+  uint64_t sum;
+} test_mpmc_job_t;
+
+static TEST_THREAD test_mpmc_producer(void *arg)
+{
+  test_mpmc_job_t *job = (test_mpmc_job_t *) arg;
+  for (uint64_t i = 0; i < TEST_MESSAGES; ++i)
+  {
+    uint64_t tag = job->id << 32 | i;
+    while (!stream_mpmc_pushb(job->q, sizeof(tag), (BYTE *) &tag))
+    {
+      test_yield();
+    }
+  }
+  return 0;
+}
+
+static TEST_THREAD test_mpmc_consumer(void *arg)
+{
+  test_mpmc_job_t *job = (test_mpmc_job_t *) arg;
+  for (uint64_t i = 0; i < TEST_MESSAGES;)
+  {
+    uint64_t tag;
+    if (stream_mpmc_deqb(job->q, sizeof(tag), (BYTE *) &tag) == sizeof(tag))
+    {
+      job->sum += tag;
+      ++i;
+    }
+    else
+    {
+      test_yield();
+    }
+  }
+  return 0;
+}
+
+// two producers and two consumers over a small ring must hand over every tag
+// exactly once
+static bool test_mpmc_threads(void)
+{
+  stream_mpmc_t *q = stream_mpmc(16, sizeof(uint64_t));
+  test_mpmc_job_t jobs[4];
+  test_thread_t threads[4];
+  uint64_t expect = 0;
+  for (uint64_t i = 0; i < 4; ++i)
+  {
+    jobs[i].q   = q;
+    jobs[i].id  = i;
+    jobs[i].sum = 0;
+    test_spawn(threads[i], i < 2 ? test_mpmc_producer : test_mpmc_consumer,
+               &jobs[i]);
+  }
+  for (uint64_t i = 0; i < 2; ++i)
+  {
+    expect += (i << 32) * TEST_MESSAGES +
+              (uint64_t) TEST_MESSAGES * (TEST_MESSAGES - 1) / 2;
+  }
+  uint64_t sum = 0;
+  for (size_t i = 0; i < 4; ++i)
+  {
+    test_join(threads[i]);
+    sum += jobs[i].sum;
+  }
+  uint64_t tag;
+  bool drained = stream_mpmc_deqb(q, sizeof(tag), (BYTE *) &tag) == 0;
+  bool aligned = (size_t) q->cells % STREAM_CACHE_LINE == 0;
+  stream_mpmc_free(q);
+  return sum == expect && drained && aligned;
+}
+
 int main(void)
 {
   test_group(stream, {
     stream_t *s = NULL;
     test_true(spushb(s, strlen("Hello, world!"), "Hello, world!"));
     test_expr(slength(s), int, strlen("Hello, world!"));
+    test_true(sinsb(s, 4, "big ", 7));
+    test_true(!memcmp(sbegptr(s), "Hello, big world!", 17));
+    test_true(!memcmp(sdeqb(s, 7), "Hello, ", 7));
+    test_true(!memcmp(spopb(s, 6), "world!", 6));
+    test_true(!memcmp(sbegptr(s), "big ", 4));
+    sfree(s);
+    // dequeues past half the payload keep the returned bytes intact
+    test_true(spushb(s, 10, "abcdefghij"));
+    test_true(!memcmp(sdeqb(s, 6), "abcdef", 6));
+    test_true(!memcmp(sdeqb(s, 3), "ghi", 3));
+    sfree(s);
+    // mixed pushes and dequeues against a running counter
+    BYTE in[97];
+    size_t ok = 1;
+    size_t n  = 0;
+    size_t m  = 0;
+    for (size_t i = 0; i < 2000; ++i)
+    {
+      size_t len = (i * 7919) % 97;
+      for (size_t j = 0; j < len; ++j)
+      {
+        in[j] = (BYTE) n++;
+      }
+      spushb(s, len, in);
+      BYTE *out = sdeqb(s, (i * 104729) % 89);
+      for (size_t j = 0; j < (i * 104729) % 89 && m < n; ++j)
+      {
+        ok = ok && out[j] == (BYTE) m++;
+      }
+    }
+    test_true(ok);
+    test_expr(slength(s), int, n - m);
+    sfree(s);
+  });
+  test_group(stream_ring, {
+    stream_t *s = NULL;
+    test_true(sring(s, 40));
+    test_expr(scapacity(s), int, 64);
+    // steady state queueing wraps without growing or moving the payload
+    BYTE in[40];
+    BYTE *buffer = NULL;
+    size_t ok    = 1;
+    size_t n     = 0;
+    size_t m     = 0;
+    for (size_t i = 0; i < 1000; ++i)
+    {
+      for (size_t j = 0; j < 40; ++j)
+      {
+        in[j] = (BYTE) n++;
+      }
+      senqb(s, 24 + i % 17, in);
+      n -= 16 - i % 17;
+      BYTE *out = sdeqb(s, 24 + i % 17);
+      for (size_t j = 0; j < 24 + i % 17; ++j)
+      {
+        ok = ok && out[j] == (BYTE) m++;
+      }
+      buffer = i == 100 ? s->buffer : buffer;
+      ok     = ok && (i <= 100 || buffer == s->buffer);
+    }
+    test_true(ok);
+    test_expr(scapacity(s), int, 64);
+    test_true(sempty(s));
+    // spans split where the ring wraps
+    BYTE *ptrs[2];
+    size_t lens[2];
+    sskipb(s, 0);
+    senqb(s, 40, in);
+    sdeqb(s, 40);
+    test_expr(swspans(s, ptrs, lens), int, 2);
+    test_expr(lens[0] + lens[1], int, 64);
+    memset(ptrs[0], 'a', lens[0]);
+    memset(ptrs[1], 'b', 10);
+    test_expr(scommitb(s, lens[0] + 10), int, 34);
+    test_expr(srspans(s, ptrs, lens), int, 2);
+    test_true(lens[0] == 24 && ptrs[0][23] == 'a' && ptrs[1][9] == 'b');
+    test_expr(sskipb(s, 20), int, 20);
+    test_true(!memcmp(sdeqb(s, 6), "aaaabb", 6));
+    // growing and inserting unwrap the bytes
+    senqb(s, 40, in);
+    senqb(s, 20, in);
+    test_expr(scapacity(s), int, 128);
+    test_true(sinsb(s, 3, "xyz", 2));
+    test_true(!memcmp(sdeqb(s, 6), "bbxyzb", 6));
+    test_expr(slength(s), int, 65);
+    sfree(s);
+  });
+  test_group(stream_queue, {
+    stream_spsc_t *q = stream_spsc(40);
+    BYTE out[64];
+    // batched writes stay invisible until flushed
+    test_true(stream_spsc_writeb(q, 10, "0123456789"));
+    test_true(stream_spsc_writeb(q, 10, "abcdefghij"));
+    test_expr(stream_spsc_deqb(q, 64, out), int, 0);
+    stream_spsc_flush(q);
+    test_expr(stream_spsc_length(q), int, 20);
+    test_expr(stream_spsc_deqb(q, 15, out), int, 15);
+    test_true(!memcmp(out, "0123456789abcde", 15));
+    // a push that does not fit leaves the queue alone, others wrap
+    test_true(!stream_spsc_pushb(q, 60, out));
+    test_true(stream_spsc_pushb(q, 50, "ABCDEFGHIJKLMNOPQRSTUVWXYZ"
+                                       "abcdefghijklmnopqrstuvwx"));
+    test_expr(stream_spsc_deqb(q, 64, out), int, 55);
+    test_true(!memcmp(out, "fghijABCDE", 10) && out[54] == 'x');
+    stream_spsc_free(q);
+    test_true(!q);
+
+    stream_mpmc_t *m = stream_mpmc(3, 16);
+    test_true(!stream_mpmc_pushb(m, 17, "0123456789abcdefg"));
+    test_true(stream_mpmc_pushb(m, 5, "hello"));
+    test_true(stream_mpmc_pushb(m, 3, "big"));
+    test_true(stream_mpmc_pushb(m, 16, "0123456789abcdef"));
+    test_true(stream_mpmc_pushb(m, 5, "world"));
+    test_true(!stream_mpmc_pushb(m, 1, "!"));
+    test_expr(stream_mpmc_deqb(m, 64, out), int, 5);
+    test_true(!memcmp(out, "hello", 5));
+    test_expr(stream_mpmc_deqb(m, 2, out), int, 2);
+    test_true(stream_mpmc_pushb(m, 1, "!"));
+    test_expr(stream_mpmc_deqb(m, 64, out), int, 16);
+    test_expr(stream_mpmc_deqb(m, 64, out), int, 5);
+    test_expr(stream_mpmc_deqb(m, 64, out), int, 1);
+    test_expr(stream_mpmc_deqb(m, 64, out), int, 0);
+    stream_mpmc_free(m);
+  });
+  test_group(stream_queue_threads, {
+    test_true(test_spsc_threads());
+    test_true(test_mpmc_threads());
+  });
+  test_group(stream_chain, {
+    stream_pool_t *pool = stream_pool(32);
+    stream_chain_t *c   = stream_chain(pool);
+    test_expr(stream_chain_deqb(c, 0, NULL), int, 0);
+    BYTE text[128];
+    BYTE out[128];
+    for (size_t i = 0; i < sizeof(text); ++i)
+    {
+      text[i] = (BYTE) ('a' + i % 26);
+    }
+    // pushes fill chunks in place, so earlier bytes never move
+    test_true(stream_chain_pushb(c, 20, text));
+    BYTE *first = c->segs[0].ptr;
+    test_true(stream_chain_pushb(c, 80, text + 20));
+    test_expr(stream_chain_length(c), int, 100);
+    test_true(c->segs[0].ptr == first);
+    test_expr(c->nsegs, int, 4);
+    test_expr(stream_chain_copy(c, 0, 128, out), int, 100);
+    test_true(!memcmp(out, text, 100));
+    // inserts split the segment they land in
+    test_true(stream_chain_insb(c, 5, "HELLO", 10));
+    test_true(stream_chain_insb(c, 3, "END", 105));
+    test_true(stream_chain_insb(c, 3, "TOP", 0));
+    test_expr(stream_chain_length(c), int, 111);
+    test_expr(stream_chain_copy(c, 10, 12, out), int, 12);
+    test_true(!memcmp(out, "hijHELLOklmn", 12));
+    test_expr(stream_chain_copy(c, 100, 128, out), int, 11);
+    test_true(!memcmp(out, "opqrstuvEND", 11));
+    // segments export in order as iovecs
+    stream_iovec_t iov[16];
+    size_t n     = stream_chain_iov(c, iov, 16);
+    size_t total = 0;
+    for (size_t i = 0; i < n; ++i)
+    {
+      memcpy(out + total, iov[i].iov_base, iov[i].iov_len);
+      total += iov[i].iov_len;
+    }
+    test_expr(total, int, 111);
+    test_true(!memcmp(out, "TOPabcdefghijHELLO", 18));
+    // dequeued chunks go back to the pool and get reused
+    test_expr(stream_chain_deqb(c, 50, NULL), int, 50);
+    test_expr(stream_chain_deqb(c, 10, out), int, 10);
+    test_true(!memcmp(out, "qrstuvwxyz", 10));
+    test_true(pool->idle != NULL);
+    stream_chunk_t *idle = pool->idle;
+    test_true(stream_chain_pushb(c, 128, text));
+    test_true(pool->idle != idle);
+    test_expr(stream_chain_deqb(c, 1000, NULL), int, 179);
+    test_expr(c->nsegs, int, 0);
+    stream_chain_free(c);
+    stream_pool_free(pool);
+    test_true(!pool);
   });
-}
\ No newline at end of file
+}